@@ -0,0 +1,100 @@
+#pragma once
+
+// Deterministic synthetic data and timing helpers shared by the benchmarks.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+inline uint32_t NextRandom(uint32_t &state)
+{
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+// A score file name such as "Chopin - Nocturne No. 12 in E flat (42).pdf".
+inline std::string MakeScoreName(uint32_t &state, size_t index)
+{
+    static const char *COMPOSERS[] = {"Bach",    "Mozart",  "Chopin",
+                                      "Debussy", "Brahms",  "Schubert",
+                                      "Ravel",   "Handel",  "Liszt",
+                                      "Satie",   "Grieg",   "Dvorak"};
+    static const char *FORMS[] = {"Sonata",  "Prelude", "Etude",
+                                  "Nocturne", "Waltz",  "Fugue",
+                                  "Suite",   "Ballade", "Impromptu"};
+    static const char *KEYS[] = {"C major", "D minor", "E flat",  "F sharp",
+                                 "G major", "A minor", "B flat"};
+
+    std::string name = COMPOSERS[NextRandom(state) % 12];
+    name += " - ";
+    name += FORMS[NextRandom(state) % 9];
+    name += " No. " + std::to_string(NextRandom(state) % 40 + 1);
+    name += " in ";
+    name += KEYS[NextRandom(state) % 7];
+    name += " (" + std::to_string(index) + ").pdf";
+    return name;
+}
+
+// Spreads files over a few hundred folders like a real collection.
+inline std::string MakeScorePath(uint32_t &state, const std::string &name)
+{
+    return "/Users/musician/Sheet Music/Collection " +
+           std::to_string(NextRandom(state) % 300) + "/" + name;
+}
+
+/**
+ * @brief Summary of repeated timings, in milliseconds.
+ */
+struct TimingStats
+{
+    double min = 0.0;
+    double median = 0.0;
+    double p95 = 0.0;
+    double max = 0.0;
+    // Median absolute deviation from the median: a spread that one slow
+    // outlier run does not inflate.
+    double mad = 0.0;
+};
+
+inline TimingStats SummarizeMs(std::vector<double> times)
+{
+    TimingStats stats;
+    if (times.empty())
+        return stats;
+
+    std::sort(times.begin(), times.end());
+    stats.min = times.front();
+    stats.median = times[times.size() / 2];
+    stats.p95 = times[(std::min)(times.size() - 1, times.size() * 95 / 100)];
+    stats.max = times.back();
+
+    for (double &time : times)
+        time = time > stats.median ? time - stats.median : stats.median - time;
+    std::sort(times.begin(), times.end());
+    stats.mad = times[times.size() / 2];
+    return stats;
+}
+
+inline double ElapsedMs(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+}
+
+inline double MedianMs(int runs, const std::function<void()> &body)
+{
+    std::vector<double> times;
+    for (int run = 0; run < runs; run++)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        body();
+        times.push_back(ElapsedMs(start));
+    }
+    return SummarizeMs(std::move(times)).median;
+}
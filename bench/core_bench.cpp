@@ -0,0 +1,481 @@
+// Timings for the non-render hot paths: library search, sorting and folder
+// scans, setlist search, save and load, and notes escaping. Each case runs
+// a few warm-up iterations and then --runs timed ones, and reports the
+// minimum, median and median absolute deviation.
+//
+//   core_bench [--runs N] [--files N] [--filter text]
+//              [--save file] [--compare file] [--threshold percent]
+//
+// --save writes the medians as a baseline; --compare reads one back and
+// prints each case's change. A case only counts as slower or faster when
+// its median moved by more than the threshold (default 5%) and by more
+// than three times the combined spread of both runs. The exit status is 1
+// if any case got slower.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "bench_common.h"
+#include "pdf_library.h"
+#include "setlist_gen.h"
+
+namespace fs = std::filesystem;
+
+namespace
+{
+const int WARMUP_RUNS = 3;
+const char *BASELINE_HEADER = "core_bench baseline v1";
+
+struct Options
+{
+    int runs = 15;
+    size_t files = 100000;
+    std::string filter;
+    std::string savePath;
+    std::string comparePath;
+    double thresholdPercent = 5.0;
+};
+
+struct CaseResult
+{
+    std::string name;
+    TimingStats stats;
+};
+
+struct Baseline
+{
+    double median = 0.0;
+    double mad = 0.0;
+};
+
+class Runner
+{
+public:
+    explicit Runner(const Options &options) : m_options(options) {}
+
+    /**
+     * @brief Time body, calling setup untimed before every run.
+     */
+    void Measure(const std::string &name,
+                 const std::function<void()> &setup,
+                 const std::function<void()> &body)
+    {
+        if (!m_options.filter.empty() &&
+            name.find(m_options.filter) == std::string::npos)
+            return;
+
+        std::vector<double> times;
+        for (int run = 0; run < WARMUP_RUNS + m_options.runs; run++)
+        {
+            if (setup)
+                setup();
+            const auto start = std::chrono::steady_clock::now();
+            body();
+            const double elapsed = ElapsedMs(start);
+            if (run >= WARMUP_RUNS)
+                times.push_back(elapsed);
+        }
+
+        CaseResult result{name, SummarizeMs(std::move(times))};
+        printf("  %-32s %10.3f %10.3f %8.3f", name.c_str(), result.stats.min,
+               result.stats.median, result.stats.mad);
+        PrintComparison(result);
+        printf("\n");
+        m_results.push_back(std::move(result));
+    }
+
+    void Measure(const std::string &name, const std::function<void()> &body)
+    {
+        Measure(name, nullptr, body);
+    }
+
+    bool LoadBaseline(const std::string &path)
+    {
+        std::ifstream in{fs::path(path)};
+        std::string line;
+        if (!in.is_open() || !std::getline(in, line) ||
+            line != BASELINE_HEADER)
+        {
+            fprintf(stderr, "core_bench: %s is not a baseline file\n",
+                    path.c_str());
+            return false;
+        }
+
+        // <name>\t<median ms>\t<mad ms>
+        while (std::getline(in, line))
+        {
+            const size_t first = line.find('\t');
+            const size_t second = line.find('\t', first + 1);
+            if (first == std::string::npos || second == std::string::npos)
+                continue;
+            Baseline baseline;
+            baseline.median = std::strtod(line.c_str() + first + 1, nullptr);
+            baseline.mad = std::strtod(line.c_str() + second + 1, nullptr);
+            m_baseline[line.substr(0, first)] = baseline;
+        }
+        return true;
+    }
+
+    bool SaveBaseline(const std::string &path) const
+    {
+        std::ofstream out(fs::path(path), std::ios::out | std::ios::trunc);
+        if (!out.is_open())
+            return false;
+
+        out << BASELINE_HEADER << "\n";
+        for (const CaseResult &result : m_results)
+        {
+            out << result.name << "\t" << result.stats.median << "\t"
+                << result.stats.mad << "\n";
+        }
+        return out.good();
+    }
+
+    bool HasBaseline() const { return !m_baseline.empty(); }
+    size_t GetSlowerCount() const { return m_slower; }
+
+private:
+    void PrintComparison(const CaseResult &result)
+    {
+        auto it = m_baseline.find(result.name);
+        if (it == m_baseline.end())
+        {
+            if (HasBaseline())
+                printf("  %10s", "new");
+            return;
+        }
+
+        const Baseline &baseline = it->second;
+        const double delta = result.stats.median - baseline.median;
+        const double percent =
+            baseline.median > 0.0 ? delta / baseline.median * 100.0 : 0.0;
+        const double noise = 3.0 * (result.stats.mad + baseline.mad);
+        const double limit =
+            (std::max)(baseline.median * m_options.thresholdPercent / 100.0,
+                       noise);
+
+        const char *verdict = "";
+        if (delta > limit)
+        {
+            verdict = "  slower";
+            m_slower++;
+        }
+        else if (-delta > limit)
+        {
+            verdict = "  faster";
+        }
+        printf("  %10.3f %+7.1f%%%s", baseline.median, percent, verdict);
+    }
+
+    const Options &m_options;
+    std::vector<CaseResult> m_results;
+    std::map<std::string, Baseline> m_baseline;
+    size_t m_slower = 0;
+};
+
+bool ParseOptions(int argc, char **argv, Options &options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--runs") == 0 && hasValue)
+            options.runs = (std::max)(1, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--files") == 0 && hasValue)
+            options.files = (std::max)(
+                static_cast<size_t>(std::strtoul(argv[++i], nullptr, 10)),
+                size_t(1));
+        else if (std::strcmp(argv[i], "--filter") == 0 && hasValue)
+            options.filter = argv[++i];
+        else if (std::strcmp(argv[i], "--save") == 0 && hasValue)
+            options.savePath = argv[++i];
+        else if (std::strcmp(argv[i], "--compare") == 0 && hasValue)
+            options.comparePath = argv[++i];
+        else if (std::strcmp(argv[i], "--threshold") == 0 && hasValue)
+            options.thresholdPercent = std::atof(argv[++i]);
+        else
+        {
+            fprintf(stderr, "core_bench: unknown option %s\n", argv[i]);
+            return false;
+        }
+    }
+    return true;
+}
+
+void BuildLibrary(PdfLibrary &library, size_t count, uint32_t &state)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        const std::string name = MakeScoreName(state, i);
+        library.AddEntry(
+            PathInterner::Shared().Intern(MakeScorePath(state, name)),
+            1600000000 + NextRandom(state) % 100000000,
+            20000 + NextRandom(state) % 5000000);
+    }
+}
+
+// A scanned folder: PDFs in mixed-case extensions, other files the scan
+// must skip, and subfolders it must not descend into.
+bool BuildScanTree(const fs::path &root, size_t pdfCount, uint32_t &state)
+{
+    std::error_code error;
+    fs::remove_all(root, error);
+    if (!fs::create_directories(root, error))
+        return false;
+
+    for (size_t i = 0; i < pdfCount; i++)
+    {
+        std::string name = MakeScoreName(state, i);
+        if (i % 10 == 0)
+            name.replace(name.size() - 4, 4, ".PDF");
+        std::ofstream(root / name) << "%PDF-1.4\n";
+        if (i % 4 == 0)
+            std::ofstream(root / (name + ".txt")) << "notes\n";
+    }
+    for (int folder = 0; folder < 20; folder++)
+    {
+        const fs::path sub = root / ("Folder " + std::to_string(folder));
+        fs::create_directories(sub, error);
+        for (int i = 0; i < 50; i++)
+            std::ofstream(sub / ("nested " + std::to_string(i) + ".pdf"))
+                << "%PDF-1.4\n";
+    }
+    return true;
+}
+
+std::string MakeNotes(uint32_t &state)
+{
+    static const char *LINES[] = {
+        "Capo 2, repeat the chorus twice",
+        "Slow down into the last verse",
+        "Page turn after bar 32 \\ watch the singer",
+        "Key change up a half step",
+        "Tacet first time, come in on the repeat",
+        "Fermata on the final chord"};
+
+    std::string notes;
+    const uint32_t lines = 2 + NextRandom(state) % 6;
+    for (uint32_t i = 0; i < lines; i++)
+    {
+        if (i > 0)
+            notes += '\n';
+        notes += LINES[NextRandom(state) % 6];
+    }
+    return notes;
+}
+
+SetlistSnapshot BuildSetlists(const PdfLibrary &library,
+                              size_t setlistCount,
+                              size_t itemsPerSetlist,
+                              uint32_t &state)
+{
+    SetlistSnapshot setlists;
+    for (size_t s = 0; s < setlistCount; s++)
+    {
+        Setlist setlist("Concert " + std::to_string(s + 1));
+        for (size_t i = 0; i < itemsPerSetlist; i++)
+        {
+            setlist.AddItem(library.GetPath(NextRandom(state) %
+                                            library.GetFileCount()));
+            if (i % 2 == 0)
+                setlist.SetItemNotes(i, MakeNotes(state));
+        }
+        setlists = setlists.PushBack(std::move(setlist));
+    }
+    return setlists;
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    Options options;
+    if (!ParseOptions(argc, argv, options))
+        return 2;
+
+    Runner runner(options);
+    if (!options.comparePath.empty() &&
+        !runner.LoadBaseline(options.comparePath))
+        return 2;
+
+    printf("core_bench: %d runs per case after %d warm-up runs, times in "
+           "ms\n",
+           options.runs, WARMUP_RUNS);
+    printf("  %-32s %10s %10s %8s", "case", "min", "median", "mad");
+    if (runner.HasBaseline())
+        printf("  %10s %8s", "baseline", "change");
+    printf("\n");
+
+    uint32_t state = 0x2545F491u;
+    std::vector<uint32_t> matches;
+
+    // --- Library search and sort ---
+    PdfLibrary library;
+    BuildLibrary(library, options.files, state);
+    library.Sort(LibrarySortKey::Name);
+
+    const char *QUERIES[] = {"b", "bach", "chopin noc 12", "sonata f sharp",
+                             "zqx"};
+    for (const char *query : QUERIES)
+    {
+        runner.Measure(std::string("library filter \"") + query + "\"",
+                       [&] { library.Filter(query, matches); });
+    }
+
+    // Each sort starts from a different order, so none runs on its own
+    // already sorted output.
+    runner.Measure(
+        "library sort name",
+        [&] { library.Sort(LibrarySortKey::Size); },
+        [&] { library.Sort(LibrarySortKey::Name); });
+    runner.Measure(
+        "library sort modified",
+        [&] { library.Sort(LibrarySortKey::Name); },
+        [&] { library.Sort(LibrarySortKey::Modified); });
+    runner.Measure(
+        "library sort size",
+        [&] { library.Sort(LibrarySortKey::Name); },
+        [&] { library.Sort(LibrarySortKey::Size); });
+
+    // A drop of new files merged into the sorted library, as the import
+    // delivers them.
+    std::vector<LibraryFileInfo> dropped(500);
+    for (size_t i = 0; i < dropped.size(); i++)
+    {
+        const std::string name = MakeScoreName(state, options.files + i);
+        dropped[i].fullPath = "/dropped/" + name;
+        dropped[i].fileSize = 20000 + NextRandom(state) % 5000000;
+        dropped[i].modifiedTime = 1600000000 + NextRandom(state) % 100000000;
+    }
+    library.Sort(LibrarySortKey::Name);
+    PdfLibrary withDrop;
+    runner.Measure(
+        "library add 500 dropped",
+        [&] { withDrop = library; },
+        [&] { withDrop.AddFiles(dropped); });
+
+    // --- Folder scan ---
+    const fs::path scratch =
+        fs::temp_directory_path() /
+        ("pdfapp_core_bench_" +
+         std::to_string(std::chrono::steady_clock::now()
+                            .time_since_epoch()
+                            .count()));
+    const size_t scanCount = (std::min)(options.files, size_t(5000));
+    if (BuildScanTree(scratch / "library", scanCount, state))
+    {
+        const std::string folder = (scratch / "library").string();
+        PdfLibrary scanned;
+        scanned.LoadFolder(folder);
+        if (scanned.GetFileCount() != scanCount)
+        {
+            fprintf(stderr, "core_bench: scan found %zu of %zu files\n",
+                    scanned.GetFileCount(), scanCount);
+            return 1;
+        }
+        runner.Measure("scan folder " + std::to_string(scanCount) + " pdfs",
+                       [&] { scanned.LoadFolder(folder); });
+    }
+    else
+    {
+        fprintf(stderr, "core_bench: could not create %s, skipping scans\n",
+                scratch.string().c_str());
+    }
+
+    // --- Setlists ---
+    const size_t setlistCount = (std::max)(options.files / 100, size_t(10));
+    const SetlistSnapshot snapshot =
+        BuildSetlists(library, setlistCount, 25, state);
+    const std::string savePath = (scratch / "setlists.dat").string();
+
+    // Checked once untimed, so --filter can skip any of the timed cases.
+    SetlistManager loaded;
+    if (!SetlistManager::SaveSnapshotToFile(snapshot, savePath) ||
+        !loaded.LoadFromFile(savePath) ||
+        loaded.GetSetlistCount() != snapshot.size())
+    {
+        fprintf(stderr, "core_bench: setlists did not survive a save\n");
+        return 1;
+    }
+
+    runner.Measure("setlists save", [&] {
+        SetlistManager::SaveSnapshotToFile(snapshot, savePath);
+    });
+    runner.Measure("setlists load", [&] { loaded.LoadFromFile(savePath); });
+
+    std::vector<SetlistSearchHit> hits;
+    runner.Measure("setlists search \"capo\"",
+                   [&] { loaded.Search("capo", hits); });
+    runner.Measure("setlists search \"bach fug\"",
+                   [&] { loaded.Search("bach fug", hits); });
+
+    // The setlist list's fallback for names the word index misses, over
+    // more names than a real collection so the time is measurable.
+    std::vector<std::string> setlistNames;
+    for (size_t i = 0; i < 10000; i++)
+        setlistNames.push_back(
+            "Concert " + std::to_string(i + 1) + " " +
+            library.GetFilename(NextRandom(state) % library.GetFileCount()));
+    size_t nameMatches = 0;
+    runner.Measure("setlists fuzzy 10k names \"cnrt 9\"", [&] {
+        nameMatches = 0;
+        for (const std::string &name : setlistNames)
+            nameMatches += SetlistSearchIndex::FuzzyMatch(name, "cnrt 9");
+    });
+
+    // --- Notes escaping ---
+    std::vector<std::string> notes;
+    for (size_t i = 0; i < 20000; i++)
+        notes.push_back(MakeNotes(state));
+    std::vector<std::string> encoded(notes.size());
+    std::vector<std::string> decoded(notes.size());
+    for (size_t i = 0; i < notes.size(); i++)
+    {
+        encoded[i] = SetlistManager::EncodeNotes(notes[i]);
+        decoded[i] = SetlistManager::DecodeNotes(encoded[i]);
+    }
+    if (decoded != notes)
+    {
+        fprintf(stderr, "core_bench: notes did not survive encoding\n");
+        return 1;
+    }
+
+    runner.Measure("notes encode 20k", [&] {
+        for (size_t i = 0; i < notes.size(); i++)
+            encoded[i] = SetlistManager::EncodeNotes(notes[i]);
+    });
+    runner.Measure("notes decode 20k", [&] {
+        for (size_t i = 0; i < encoded.size(); i++)
+            decoded[i] = SetlistManager::DecodeNotes(encoded[i]);
+    });
+
+    std::error_code cleanupError;
+    fs::remove_all(scratch, cleanupError);
+
+    if (!options.savePath.empty())
+    {
+        if (!runner.SaveBaseline(options.savePath))
+        {
+            fprintf(stderr, "core_bench: could not write %s\n",
+                    options.savePath.c_str());
+            return 2;
+        }
+        printf("Baseline saved to %s\n", options.savePath.c_str());
+    }
+
+    if (runner.GetSlowerCount() > 0)
+    {
+        printf("%zu case(s) slower than the baseline\n",
+               runner.GetSlowerCount());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,138 @@
+// Compares the column-wise PdfLibrary against the array-of-structs layout it
+// replaced, on a synthetic library.
+//
+//   library_bench [file count]
+
+#include "pdf_library.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "bench_common.h"
+
+namespace
+{
+// The layout before the columns: two heap strings per file.
+struct AosEntry
+{
+    std::string filename;
+    std::string fullPath;
+    int64_t modifiedTime = 0;
+    uint64_t fileSize = 0;
+};
+
+char ToLowerAscii(char c)
+{
+    if (c >= 'A' && c <= 'Z')
+        return static_cast<char>(c - 'A' + 'a');
+    return c;
+}
+
+// Same rule as SetlistSearchIndex::FuzzyMatch.
+bool FuzzyMatch(const char *text, const char *query)
+{
+    while (*text && *query)
+    {
+        if (ToLowerAscii(*text) == ToLowerAscii(*query))
+            query++;
+        text++;
+    }
+    return *query == '\0';
+}
+
+bool CaseInsensitiveLess(const AosEntry &left, const AosEntry &right)
+{
+    const size_t shared =
+        (std::min)(left.filename.size(), right.filename.size());
+    for (size_t i = 0; i < shared; i++)
+    {
+        const char a = ToLowerAscii(left.filename[i]);
+        const char b = ToLowerAscii(right.filename[i]);
+        if (a != b)
+            return a < b;
+    }
+    if (left.filename.size() != right.filename.size())
+        return left.filename.size() < right.filename.size();
+    return left.filename < right.filename;
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const size_t count =
+        argc > 1 ? static_cast<size_t>(std::strtoul(argv[1], nullptr, 10))
+                 : 100000;
+    const int runs = 15;
+
+    uint32_t state = 0x2545F491u;
+    std::vector<AosEntry> aos;
+    aos.reserve(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        AosEntry entry;
+        entry.filename = MakeScoreName(state, i);
+        entry.fullPath = MakeScorePath(state, entry.filename);
+        entry.modifiedTime = 1600000000 + NextRandom(state) % 100000000;
+        entry.fileSize = 20000 + NextRandom(state) % 5000000;
+        aos.push_back(std::move(entry));
+    }
+
+    PdfLibrary library;
+    const double buildMs = MedianMs(1, [&] {
+        for (const AosEntry &entry : aos)
+            library.AddEntry(PathInterner::Shared().Intern(entry.fullPath),
+                             entry.modifiedTime, entry.fileSize);
+    });
+
+    printf("library_bench: %zu files, median of %d runs\n", count, runs);
+    printf("  build columns             %9.2f ms\n", buildMs);
+
+    std::vector<AosEntry> aosSorted;
+    const double aosSortMs = MedianMs(runs, [&] {
+        aosSorted = aos;
+        std::sort(aosSorted.begin(), aosSorted.end(), CaseInsensitiveLess);
+    });
+    const double soaSortMs =
+        MedianMs(runs, [&] { library.Sort(LibrarySortKey::Name); });
+    printf("  sort by name    structs   %9.2f ms (includes copy)\n",
+           aosSortMs);
+    printf("                  columns   %9.2f ms\n", soaSortMs);
+
+    const char *QUERIES[] = {"b", "bach", "chopin noc 12", "sonata f sharp",
+                             "zqx"};
+    for (const char *query : QUERIES)
+    {
+        size_t aosMatches = 0;
+        const double aosMs = MedianMs(runs, [&] {
+            aosMatches = 0;
+            for (const AosEntry &entry : aosSorted)
+            {
+                if (FuzzyMatch(entry.filename.c_str(), query))
+                    aosMatches++;
+            }
+        });
+
+        std::vector<uint32_t> matches;
+        const double soaMs =
+            MedianMs(runs, [&] { library.Filter(query, matches); });
+
+        if (aosMatches != matches.size())
+        {
+            printf("Mismatch for \"%s\": %zu vs %zu\n", query, aosMatches,
+                   matches.size());
+            return 1;
+        }
+        printf("  filter %-16s structs %9.2f ms, columns %7.2f ms "
+               "(%zu matches)\n",
+               query, aosMs, soaMs, matches.size());
+    }
+
+    printf("  path table                %9.2f MB for %zu paths\n",
+           PathInterner::Shared().GetMemoryUsage() / (1024.0 * 1024.0),
+           PathInterner::Shared().GetPathCount());
+    return 0;
+}
@@ -0,0 +1,23 @@
+# Merges the raw profiles left by the pgo_train workload into the single
+# .profdata file that PDFAPP_PGO=USE reads.
+#
+#   cmake -DLLVM_PROFDATA=... -DRAW_DIR=... -DOUTPUT=... -P pgo_merge.cmake
+
+file(GLOB RAW_PROFILES "${RAW_DIR}/*.profraw")
+if(NOT RAW_PROFILES)
+    message(FATAL_ERROR "No raw profiles in ${RAW_DIR}; was the build "
+        "configured with PDFAPP_PGO=GENERATE?")
+endif()
+
+get_filename_component(OUTPUT_DIR "${OUTPUT}" DIRECTORY)
+file(MAKE_DIRECTORY "${OUTPUT_DIR}")
+execute_process(
+    COMMAND "${LLVM_PROFDATA}" merge "-output=${OUTPUT}" ${RAW_PROFILES}
+    RESULT_VARIABLE MERGE_RESULT
+)
+if(NOT MERGE_RESULT EQUAL 0)
+    message(FATAL_ERROR "llvm-profdata merge failed (${MERGE_RESULT})")
+endif()
+
+list(LENGTH RAW_PROFILES RAW_COUNT)
+message(STATUS "Merged ${RAW_COUNT} raw profile(s) into ${OUTPUT}")
@@ -0,0 +1,411 @@
+// Golden-image and timing check for page rendering. Renders pages of every
+// PDF in a corpus folder exactly as the viewer does (RenderPageBitmap()
+// with the viewer's scale and size cap), compares them with stored golden
+// images, and compares the median render time with a stored baseline.
+//
+//   render_check <corpus dir> <golden dir> [--update] [--pages N] [--runs N]
+//                [--channel-tolerance N] [--max-changed percent]
+//                [--max-slowdown percent] [--diff-dir dir]
+//
+// --update (re)writes the golden images and timings instead of checking.
+// Goldens are RGBA PAM files, one per page, plus timings.txt. A page fails
+// when its size changed, when more than --max-changed percent of its
+// pixels differ by more than --channel-tolerance in any channel, or when
+// its median render time grew by more than --max-slowdown percent and by
+// more than three times the combined spread of both measurements. The
+// exit status is 1 if any page failed.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <fpdfview.h>
+
+#include "bench_common.h"
+#include "pdfium_support.h"
+#include "pixel_kernels.h"
+
+namespace fs = std::filesystem;
+
+namespace
+{
+const char *TIMINGS_FILE = "timings.txt";
+const char *TIMINGS_HEADER = "render_check timings v1";
+
+struct Options
+{
+    fs::path corpus;
+    fs::path golden;
+    fs::path diffDir;
+    bool update = false;
+    int pages = 3;
+    int runs = 5;
+    int channelTolerance = 24;
+    double maxChangedPercent = 0.1;
+    double maxSlowdownPercent = 25.0;
+};
+
+struct Baseline
+{
+    double median = 0.0;
+    double mad = 0.0;
+};
+
+bool ParseOptions(int argc, char **argv, Options &options)
+{
+    std::vector<const char *> positional;
+    for (int i = 1; i < argc; i++)
+    {
+        const bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--update") == 0)
+            options.update = true;
+        else if (std::strcmp(argv[i], "--pages") == 0 && hasValue)
+            options.pages = (std::max)(1, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--runs") == 0 && hasValue)
+            options.runs = (std::max)(1, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--channel-tolerance") == 0 && hasValue)
+            options.channelTolerance =
+                (std::min)((std::max)(0, std::atoi(argv[++i])), 255);
+        else if (std::strcmp(argv[i], "--max-changed") == 0 && hasValue)
+            options.maxChangedPercent = std::atof(argv[++i]);
+        else if (std::strcmp(argv[i], "--max-slowdown") == 0 && hasValue)
+            options.maxSlowdownPercent = std::atof(argv[++i]);
+        else if (std::strcmp(argv[i], "--diff-dir") == 0 && hasValue)
+            options.diffDir = argv[++i];
+        else if (argv[i][0] != '-')
+            positional.push_back(argv[i]);
+        else
+        {
+            fprintf(stderr, "render_check: unknown option %s\n", argv[i]);
+            return false;
+        }
+    }
+
+    if (positional.size() != 2)
+    {
+        fprintf(stderr, "usage: render_check <corpus dir> <golden dir> "
+                        "[--update] [options]\n");
+        return false;
+    }
+    options.corpus = positional[0];
+    options.golden = positional[1];
+    return true;
+}
+
+// ---- PAM (P7) images: an ASCII header, then raw RGBA rows ----
+
+bool WritePam(const fs::path &path, const PageBitmap &bitmap)
+{
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open())
+        return false;
+
+    out << "P7\nWIDTH " << bitmap.width << "\nHEIGHT " << bitmap.height
+        << "\nDEPTH 4\nMAXVAL 255\nTUPLTYPE RGB_ALPHA\nENDHDR\n";
+    out.write(reinterpret_cast<const char *>(bitmap.pixels.data()),
+              static_cast<std::streamsize>(bitmap.pixels.size()));
+    return out.good();
+}
+
+bool ReadPam(const fs::path &path, PageBitmap &bitmap)
+{
+    std::ifstream in(path, std::ios::binary);
+    std::string line;
+    if (!in.is_open() || !std::getline(in, line) || line != "P7")
+        return false;
+
+    int depth = 0;
+    while (std::getline(in, line) && line != "ENDHDR")
+    {
+        if (line.rfind("WIDTH ", 0) == 0)
+            bitmap.width = std::atoi(line.c_str() + 6);
+        else if (line.rfind("HEIGHT ", 0) == 0)
+            bitmap.height = std::atoi(line.c_str() + 7);
+        else if (line.rfind("DEPTH ", 0) == 0)
+            depth = std::atoi(line.c_str() + 6);
+    }
+    if (depth != 4 || bitmap.width <= 0 || bitmap.height <= 0)
+        return false;
+
+    bitmap.pixels.resize(static_cast<size_t>(bitmap.width) *
+                         static_cast<size_t>(bitmap.height) * 4);
+    in.read(reinterpret_cast<char *>(bitmap.pixels.data()),
+            static_cast<std::streamsize>(bitmap.pixels.size()));
+    return in.gcount() ==
+           static_cast<std::streamsize>(bitmap.pixels.size());
+}
+
+// Changed pixels in white, for looking at a failure.
+bool WriteMaskPgm(const fs::path &path,
+                  const std::vector<uint8_t> &mask,
+                  int width,
+                  int height)
+{
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open())
+        return false;
+
+    out << "P5\n" << width << " " << height << "\n255\n";
+    out.write(reinterpret_cast<const char *>(mask.data()),
+              static_cast<std::streamsize>(mask.size()));
+    return out.good();
+}
+
+std::map<std::string, Baseline> ReadTimings(const fs::path &path)
+{
+    std::map<std::string, Baseline> timings;
+    std::ifstream in(path);
+    std::string line;
+    if (!in.is_open() || !std::getline(in, line) || line != TIMINGS_HEADER)
+        return timings;
+
+    // <page key>\t<median ms>\t<mad ms>
+    while (std::getline(in, line))
+    {
+        const size_t first = line.find('\t');
+        const size_t second = line.find('\t', first + 1);
+        if (first == std::string::npos || second == std::string::npos)
+            continue;
+        Baseline baseline;
+        baseline.median = std::strtod(line.c_str() + first + 1, nullptr);
+        baseline.mad = std::strtod(line.c_str() + second + 1, nullptr);
+        timings[line.substr(0, first)] = baseline;
+    }
+    return timings;
+}
+
+std::vector<fs::path> ListCorpus(const fs::path &folder)
+{
+    std::vector<fs::path> files;
+    std::error_code error;
+    for (fs::directory_iterator it(folder, error), end; !error && it != end;
+         it.increment(error))
+    {
+        std::string extension = it->path().extension().string();
+        for (char &c : extension)
+        {
+            if (c >= 'A' && c <= 'Z')
+                c = static_cast<char>(c - 'A' + 'a');
+        }
+        if (it->is_regular_file() && extension == ".pdf")
+            files.push_back(it->path());
+    }
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+// Renders the page runs times after one warm-up render and keeps the last
+// bitmap.
+bool RenderTimed(FPDF_DOCUMENT document,
+                 int page,
+                 int runs,
+                 PageBitmap &bitmap,
+                 TimingStats &stats)
+{
+    std::vector<double> times;
+    for (int run = 0; run <= runs; run++)
+    {
+        PageBitmap rendered;
+        std::lock_guard<std::mutex> lock(PdfiumMutex());
+        const auto start = std::chrono::steady_clock::now();
+        if (!RenderPageBitmap(document, page, VIEWER_RENDER_SCALE,
+                              VIEWER_MAX_TEXTURE_SIZE, rendered))
+            return false;
+        if (run > 0)
+            times.push_back(ElapsedMs(start));
+        bitmap = std::move(rendered);
+    }
+    stats = SummarizeMs(std::move(times));
+    return true;
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    Options options;
+    if (!ParseOptions(argc, argv, options))
+        return 2;
+
+    const std::vector<fs::path> corpus = ListCorpus(options.corpus);
+    if (corpus.empty())
+    {
+        fprintf(stderr, "render_check: no PDFs in %s\n",
+                options.corpus.string().c_str());
+        return 2;
+    }
+
+    std::error_code error;
+    fs::create_directories(options.golden, error);
+    if (!options.diffDir.empty())
+        fs::create_directories(options.diffDir, error);
+
+    // Same configuration as the app, so fonts and rendering match.
+    FPDF_LIBRARY_CONFIG config;
+    config.version = 2;
+    config.m_pUserFontPaths = nullptr;
+    config.m_pIsolate = nullptr;
+    config.m_v8EmbedderSlot = 0;
+    FPDF_InitLibraryWithConfig(&config);
+
+    const fs::path timingsPath = options.golden / TIMINGS_FILE;
+    const std::map<std::string, Baseline> baseline =
+        options.update ? std::map<std::string, Baseline>()
+                       : ReadTimings(timingsPath);
+    std::ofstream timingsOut;
+    if (options.update)
+    {
+        timingsOut.open(timingsPath, std::ios::out | std::ios::trunc);
+        timingsOut << TIMINGS_HEADER << "\n";
+    }
+
+    printf("render_check: %s %zu file(s), scale %.1f, median of %d runs\n",
+           options.update ? "updating goldens for" : "checking",
+           corpus.size(), VIEWER_RENDER_SCALE, options.runs);
+
+    size_t pagesChecked = 0;
+    size_t failures = 0;
+    for (const fs::path &file : corpus)
+    {
+        std::vector<unsigned char> data;
+        FPDF_DOCUMENT document = nullptr;
+        int pageCount = 0;
+        if (ReadPdfFile(file.string(), data))
+        {
+            std::lock_guard<std::mutex> lock(PdfiumMutex());
+            document = FPDF_LoadMemDocument(
+                data.data(), static_cast<int>(data.size()), nullptr);
+            if (document)
+                pageCount = FPDF_GetPageCount(document);
+        }
+        if (!document || pageCount <= 0)
+        {
+            printf("  %-32s FAIL could not be opened\n",
+                   file.filename().string().c_str());
+            failures++;
+            if (document)
+                FPDF_CloseDocument(document);
+            continue;
+        }
+
+        const int pages = (std::min)(pageCount, options.pages);
+        for (int page = 0; page < pages; page++)
+        {
+            const std::string key =
+                file.stem().string() + ".p" + std::to_string(page + 1);
+            const fs::path goldenPath = options.golden / (key + ".pam");
+            pagesChecked++;
+
+            PageBitmap bitmap;
+            TimingStats stats;
+            if (!RenderTimed(document, page, options.runs, bitmap, stats))
+            {
+                printf("  %-32s FAIL could not be rendered\n", key.c_str());
+                failures++;
+                continue;
+            }
+            printf("  %-32s %5dx%-5d %8.2f ms", key.c_str(), bitmap.width,
+                   bitmap.height, stats.median);
+
+            if (options.update)
+            {
+                timingsOut << key << "\t" << stats.median << "\t"
+                           << stats.mad << "\n";
+                if (!WritePam(goldenPath, bitmap))
+                {
+                    printf("  FAIL could not write %s\n",
+                           goldenPath.string().c_str());
+                    failures++;
+                    continue;
+                }
+                printf("  written\n");
+                continue;
+            }
+
+            std::string problems;
+            PageBitmap golden;
+            if (!ReadPam(goldenPath, golden))
+            {
+                problems += " no golden image;";
+            }
+            else if (golden.width != bitmap.width ||
+                     golden.height != bitmap.height)
+            {
+                problems += " size was " + std::to_string(golden.width) +
+                            "x" + std::to_string(golden.height) + ";";
+            }
+            else
+            {
+                const size_t pixelCount =
+                    static_cast<size_t>(bitmap.width) *
+                    static_cast<size_t>(bitmap.height);
+                std::vector<uint8_t> mask(pixelCount);
+                const size_t changed = ComputeDiffMask(
+                    golden.pixels.data(), bitmap.pixels.data(), pixelCount,
+                    static_cast<uint8_t>(options.channelTolerance),
+                    mask.data());
+                const double changedPercent =
+                    100.0 * static_cast<double>(changed) /
+                    static_cast<double>(pixelCount);
+                if (changedPercent > options.maxChangedPercent)
+                {
+                    char text[64];
+                    snprintf(text, sizeof(text), " %.3f%% of pixels differ;",
+                             changedPercent);
+                    problems += text;
+                    if (!options.diffDir.empty())
+                        WriteMaskPgm(options.diffDir / (key + ".diff.pgm"),
+                                     mask, bitmap.width, bitmap.height);
+                }
+            }
+
+            auto timing = baseline.find(key);
+            if (timing != baseline.end())
+            {
+                const double base = timing->second.median;
+                const double delta = stats.median - base;
+                printf(" (was %.2f)", base);
+                if (delta > base * options.maxSlowdownPercent / 100.0 &&
+                    delta > 3.0 * (stats.mad + timing->second.mad))
+                {
+                    char text[64];
+                    snprintf(text, sizeof(text), " %.0f%% slower;",
+                             base > 0.0 ? delta / base * 100.0 : 0.0);
+                    problems += text;
+                }
+            }
+
+            if (problems.empty())
+            {
+                printf("  ok\n");
+            }
+            else
+            {
+                problems.pop_back();
+                printf("  FAIL%s\n", problems.c_str());
+                failures++;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(PdfiumMutex());
+        FPDF_CloseDocument(document);
+    }
+
+    FPDF_DestroyLibrary();
+
+    if (options.update)
+    {
+        printf("Wrote %zu golden page(s) to %s\n", pagesChecked - failures,
+               options.golden.string().c_str());
+        return failures > 0 ? 1 : 0;
+    }
+    printf("%zu of %zu page(s) failed\n", failures, pagesChecked);
+    return failures > 0 ? 1 : 0;
+}
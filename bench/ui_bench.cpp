@@ -0,0 +1,347 @@
+// Frame-time benchmark for the main window's panels. Drives the same
+// Render* calls as main.cpp against a headless ImGui context (no platform
+// or renderer backend) with synthetic libraries and setlists, and reports
+// the CPU time of each panel and of ImGui::Render().
+//
+//   ui_bench [--frames N] [--pdf file.pdf] [file count ...]
+//
+// Without --pdf no document is open, so the toolbar, notes and viewer
+// panels measure their empty states. With --pdf the file is added to the
+// first setlist and played, using a hidden window for the GL context the
+// viewer uploads pages into.
+
+#include <GLFW/glfw3.h>
+#include <fpdfview.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "app_init.h"
+#include "bench_common.h"
+#include "imgui.h"
+#include "library_thumbnails.h"
+#include "pdf_library.h"
+#include "pdf_viewer.h"
+#include "setlist_gen.h"
+#include "ui_panels.h"
+
+namespace
+{
+const float DISPLAY_WIDTH = 1600.0f;
+const float DISPLAY_HEIGHT = 900.0f;
+const int WARMUP_FRAMES = 10;
+const size_t ITEMS_PER_SETLIST = 20;
+
+enum Panel
+{
+    PANEL_MENU_BAR,
+    PANEL_LIBRARY,
+    PANEL_TOOLBAR,
+    PANEL_NOTES,
+    PANEL_VIEWER,
+    PANEL_RENDER,
+    PANEL_TOTAL,
+    PANEL_COUNT
+};
+
+const char *PANEL_NAMES[PANEL_COUNT] = {"menu",   "library", "toolbar",
+                                        "notes",  "viewer",  "render",
+                                        "total"};
+
+enum class Scenario
+{
+    Library,       // library tab, no input
+    LibraryScroll, // library tab, mouse wheel over the file list each frame
+    Setlists       // setlists tab with the first setlist selected
+};
+
+const char *ScenarioName(Scenario scenario)
+{
+    switch (scenario)
+    {
+    case Scenario::Library:
+        return "library";
+    case Scenario::LibraryScroll:
+        return "library scroll";
+    case Scenario::Setlists:
+        return "setlists";
+    }
+    return "";
+}
+
+struct Workspace
+{
+    PdfLibrary library;
+    LibraryThumbnails thumbnails;
+    SetlistManager setlists;
+    PdfViewer viewer;
+    AppUiState uiState;
+    int selectedFileIndex = -1;
+    int selectedSetlistIndex = -1;
+    int selectedSetlistItemIndex = -1;
+    uint32_t random = 0x2545F491u;
+    PathId documentPath = INVALID_PATH_ID;
+};
+
+// One library and one set of setlists grow from run to run. The panels
+// cache per library revision, so swapping in a fresh library could hand
+// them indices from an older one.
+void GrowWorkspace(Workspace &workspace, size_t fileCount)
+{
+    PdfLibrary &library = workspace.library;
+    for (size_t i = library.GetFileCount(); i < fileCount; i++)
+    {
+        const std::string name = MakeScoreName(workspace.random, i);
+        library.AddEntry(
+            PathInterner::Shared().Intern(
+                MakeScorePath(workspace.random, name)),
+            1600000000 + NextRandom(workspace.random) % 100000000,
+            20000 + NextRandom(workspace.random) % 5000000);
+    }
+    library.Sort(LibrarySortKey::Name);
+
+    // About one setlist per 200 files, each a concert's worth of pieces
+    // with a note on every third.
+    SetlistManager &setlists = workspace.setlists;
+    const size_t setlistCount = (std::max)(fileCount / 200, size_t(10));
+    std::vector<PathId> paths;
+    while (setlists.GetSetlistCount() < setlistCount)
+    {
+        const size_t index = setlists.CreateSetlist("");
+        paths.clear();
+        for (size_t i = 0; i < ITEMS_PER_SETLIST; i++)
+            paths.push_back(library.GetPath(
+                NextRandom(workspace.random) % library.GetFileCount()));
+        setlists.AddItems(index, paths);
+        for (size_t i = 0; i < ITEMS_PER_SETLIST; i += 3)
+            setlists.SetItemNotes(index, i,
+                                  "Capo 2. Repeat the chorus twice,\n"
+                                  "slow down into the last verse.");
+    }
+}
+
+void BeginImGui()
+{
+    ImGui::CreateContext();
+    ImGuiIO &io = ImGui::GetIO();
+    io.IniFilename = nullptr;
+    io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;
+    io.ConfigFlags |= ImGuiConfigFlags_DockingEnable;
+    io.DisplaySize = ImVec2(DISPLAY_WIDTH, DISPLAY_HEIGHT);
+
+    // There is no renderer, so the atlas is built once up front instead of
+    // being uploaded on demand.
+    io.Fonts->AddFontDefault();
+    unsigned char *pixels = nullptr;
+    int width = 0;
+    int height = 0;
+    io.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+}
+
+void RunFrame(Workspace &workspace,
+              Scenario scenario,
+              std::vector<double> (&samples)[PANEL_COUNT])
+{
+    ImGuiIO &io = ImGui::GetIO();
+    io.DeltaTime = 1.0f / 60.0f;
+    if (scenario == Scenario::LibraryScroll)
+    {
+        // Over the file list, below the search and sort controls.
+        io.AddMousePosEvent(
+            DISPLAY_WIDTH * workspace.uiState.sidebarWidthRatio * 0.5f,
+            DISPLAY_HEIGHT * 0.7f);
+        io.AddMouseWheelEvent(0.0f, -1.0f);
+    }
+
+    if (workspace.viewer.IsLoaded())
+        workspace.viewer.Update();
+    workspace.thumbnails.Update();
+
+    const auto frameStart = std::chrono::steady_clock::now();
+    ImGui::NewFrame();
+    ImGuiViewport *viewport = ImGui::GetMainViewport();
+
+    auto start = std::chrono::steady_clock::now();
+    RenderMainMenuBar(workspace.library, workspace.viewer,
+                      workspace.setlists, workspace.uiState,
+                      workspace.selectedFileIndex,
+                      workspace.selectedSetlistIndex,
+                      workspace.selectedSetlistItemIndex);
+    samples[PANEL_MENU_BAR].push_back(ElapsedMs(start));
+
+    ImGui::DockSpaceOverViewport(0, viewport);
+
+    start = std::chrono::steady_clock::now();
+    RenderLibraryPanel(workspace.library, workspace.thumbnails,
+                       workspace.viewer,
+                       workspace.setlists, workspace.uiState,
+                       workspace.selectedFileIndex,
+                       workspace.selectedSetlistIndex,
+                       workspace.selectedSetlistItemIndex, viewport);
+    samples[PANEL_LIBRARY].push_back(ElapsedMs(start));
+
+    start = std::chrono::steady_clock::now();
+    RenderDocumentToolbar(workspace.viewer, workspace.setlists,
+                          workspace.uiState, io, viewport);
+    samples[PANEL_TOOLBAR].push_back(ElapsedMs(start));
+
+    start = std::chrono::steady_clock::now();
+    RenderNotesPanel(workspace.setlists, workspace.uiState, viewport);
+    samples[PANEL_NOTES].push_back(ElapsedMs(start));
+
+    start = std::chrono::steady_clock::now();
+    RenderViewerPanel(workspace.viewer, workspace.setlists,
+                      workspace.uiState, viewport);
+    samples[PANEL_VIEWER].push_back(ElapsedMs(start));
+
+    RenderSplitters(workspace.uiState, io, viewport,
+                    workspace.setlists.IsActive() &&
+                        workspace.uiState.notesVisible);
+
+    start = std::chrono::steady_clock::now();
+    ImGui::Render();
+    samples[PANEL_RENDER].push_back(ElapsedMs(start));
+    samples[PANEL_TOTAL].push_back(ElapsedMs(frameStart));
+}
+
+void RunScenario(Workspace &workspace, Scenario scenario, int frames)
+{
+    workspace.uiState = AppUiState();
+    workspace.selectedFileIndex = -1;
+    workspace.selectedSetlistItemIndex = -1;
+    workspace.selectedSetlistIndex =
+        scenario == Scenario::Setlists ? 0 : -1;
+    workspace.uiState.setlistsPanelOpenRequested =
+        scenario == Scenario::Setlists;
+
+    // A fresh context per run, so tab selection and scroll positions do
+    // not carry over.
+    BeginImGui();
+    std::vector<double> samples[PANEL_COUNT];
+    for (int frame = 0; frame < WARMUP_FRAMES + frames; frame++)
+    {
+        if (frame == WARMUP_FRAMES)
+        {
+            for (std::vector<double> &panel : samples)
+                panel.clear();
+        }
+        RunFrame(workspace, scenario, samples);
+    }
+    ImGui::DestroyContext();
+
+    printf("%8zu  %-15s", workspace.library.GetFileCount(),
+           ScenarioName(scenario));
+    for (std::vector<double> &panel : samples)
+    {
+        const TimingStats stats = SummarizeMs(std::move(panel));
+        printf(" %6.3f/%-6.3f", stats.median, stats.p95);
+    }
+    printf("\n");
+}
+
+// The synthetic setlists point at files that do not exist, so the real
+// document is put first in the first setlist and played from there.
+bool PlayDocument(Workspace &workspace)
+{
+    if (workspace.documentPath == INVALID_PATH_ID)
+        return true;
+
+    const Setlist *first = workspace.setlists.GetSetlist(0);
+    if (!first)
+        return false;
+    if (first->GetItemCount() == 0 ||
+        first->GetItems()[0].path != workspace.documentPath)
+    {
+        const size_t added = first->GetItemCount();
+        workspace.setlists.AddItem(0, workspace.documentPath);
+        workspace.setlists.MoveItem(0, added, 0);
+    }
+    return workspace.setlists.JumpToItem(0, 0, workspace.viewer);
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    int frames = 120;
+    std::string pdfPath;
+    std::vector<size_t> fileCounts;
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+            frames = (std::max)(1, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--pdf") == 0 && i + 1 < argc)
+            pdfPath = argv[++i];
+        else
+            fileCounts.push_back(
+                static_cast<size_t>(std::strtoul(argv[i], nullptr, 10)));
+    }
+    if (fileCounts.empty())
+        fileCounts = {1000, 10000, 100000};
+    std::sort(fileCounts.begin(), fileCounts.end());
+
+    GLFWwindow *window = nullptr;
+    if (!pdfPath.empty())
+    {
+        if (!glfwInit())
+        {
+            fprintf(stderr, "ui_bench: GLFW could not be initialized\n");
+            return 1;
+        }
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        window = InitWindow(640, 480, "ui_bench");
+        if (!window)
+        {
+            fprintf(stderr, "ui_bench: no OpenGL context for --pdf\n");
+            glfwTerminate();
+            return 1;
+        }
+        InitPDFium();
+    }
+
+    int status = 0;
+    {
+        Workspace workspace;
+        if (!pdfPath.empty())
+            workspace.documentPath = PathInterner::Shared().Intern(pdfPath);
+
+        printf("ui_bench: %d frames per run at %.0fx%.0f, %s, "
+               "ms per frame as median/p95\n",
+               frames, DISPLAY_WIDTH, DISPLAY_HEIGHT,
+               pdfPath.empty() ? "no document" : pdfPath.c_str());
+        printf("%8s  %-15s", "files", "scenario");
+        for (const char *name : PANEL_NAMES)
+            printf(" %-13s", name);
+        printf("\n");
+
+        const Scenario SCENARIOS[] = {Scenario::Library,
+                                      Scenario::LibraryScroll,
+                                      Scenario::Setlists};
+        for (size_t i = 0; i < fileCounts.size(); i++)
+        {
+            GrowWorkspace(workspace, fileCounts[i]);
+            if (!PlayDocument(workspace))
+            {
+                fprintf(stderr, "ui_bench: could not open %s\n",
+                        pdfPath.c_str());
+                status = 1;
+                break;
+            }
+            for (Scenario scenario : SCENARIOS)
+                RunScenario(workspace, scenario, frames);
+        }
+    }
+
+    // The ImGui contexts are gone already; only PDFium and GLFW remain.
+    if (window)
+    {
+        FPDF_DestroyLibrary();
+        glfwDestroyWindow(window);
+        glfwTerminate();
+    }
+    return status;
+}
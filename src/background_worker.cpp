@@ -0,0 +1,91 @@
+#include "background_worker.h"
+
+#include <algorithm>
+#include <utility>
+
+BackgroundWorker::BackgroundWorker(size_t threadCount)
+{
+    threadCount = (std::max)(threadCount, static_cast<size_t>(1));
+    m_threads.reserve(threadCount);
+    for (size_t i = 0; i < threadCount; i++)
+        m_threads.emplace_back(&BackgroundWorker::Run, this);
+}
+
+BackgroundWorker::~BackgroundWorker()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+        m_tasks.clear();
+    }
+    m_wake.notify_all();
+
+    for (std::thread &thread : m_threads)
+    {
+        if (thread.joinable())
+            thread.join();
+    }
+}
+
+void BackgroundWorker::Post(std::function<void()> task)
+{
+    if (!task)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_stopping)
+            return;
+        m_tasks.push_back(std::move(task));
+    }
+    m_wake.notify_one();
+}
+
+void BackgroundWorker::PostFront(std::function<void()> task)
+{
+    if (!task)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_stopping)
+            return;
+        m_tasks.push_front(std::move(task));
+    }
+    m_wake.notify_one();
+}
+
+void BackgroundWorker::CancelPending()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_tasks.clear();
+}
+
+size_t BackgroundWorker::GetPendingCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_tasks.size() + m_running;
+}
+
+void BackgroundWorker::Run()
+{
+    while (true)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [this] { return m_stopping || !m_tasks.empty(); });
+            if (m_stopping)
+                return;
+
+            task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+            m_running++;
+        }
+
+        task();
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_running--;
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief A small pool of threads that run posted tasks in FIFO order.
+ *
+ * Tasks that touch PDFium must take PdfiumMutex() themselves. Pending tasks
+ * are discarded on destruction; running tasks are allowed to finish.
+ *
+ * An owner whose tasks use its other members declares the worker as its
+ * last member. Members are destroyed in reverse order, so the threads are
+ * joined before anything a running task might still touch goes away.
+ */
+class BackgroundWorker
+{
+public:
+    explicit BackgroundWorker(size_t threadCount = 1);
+    ~BackgroundWorker();
+
+    BackgroundWorker(const BackgroundWorker &) = delete;
+    BackgroundWorker &operator=(const BackgroundWorker &) = delete;
+
+    /**
+     * @brief Queue a task to run on a worker thread.
+     */
+    void Post(std::function<void()> task);
+
+    /**
+     * @brief Queue a task ahead of everything not yet started.
+     */
+    void PostFront(std::function<void()> task);
+
+    /**
+     * @brief Drop every task that has not started yet.
+     */
+    void CancelPending();
+
+    /**
+     * @brief Number of tasks queued or currently running.
+     */
+    size_t GetPendingCount() const;
+
+private:
+    void Run();
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::deque<std::function<void()>> m_tasks;
+    std::vector<std::thread> m_threads;
+    size_t m_running = 0;
+    bool m_stopping = false;
+};
@@ -0,0 +1,127 @@
+#include "bilevel_page.h"
+
+#include <cstdio>
+#include <cstring>
+
+#include "pixel_kernels.h"
+
+namespace
+{
+// Green level separating ink from paper, and how far from it a pixel may
+// be and still count as clearly one or the other.
+const uint8_t INK_THRESHOLD = 128;
+const uint8_t CLEAR_MARGIN = 48;
+const size_t MAX_AMBIGUOUS_PERCENT = 10;
+
+// PackBits: a header byte n below 128 is followed by n + 1 literal bytes;
+// above 128, the next byte repeats 257 - n times. Long runs of blank
+// paper shrink to two bytes per 1024 pixels.
+void PackBitsEncode(const uint8_t *data, size_t size, std::vector<uint8_t> &out)
+{
+    size_t i = 0;
+    while (i < size)
+    {
+        size_t run = 1;
+        while (i + run < size && run < 128 && data[i + run] == data[i])
+            run++;
+        if (run >= 2)
+        {
+            out.push_back(static_cast<uint8_t>(257 - run));
+            out.push_back(data[i]);
+            i += run;
+            continue;
+        }
+
+        // Literals continue until three equal bytes would start a run.
+        const size_t start = i;
+        while (i < size && i - start < 128)
+        {
+            if (i + 2 < size && data[i] == data[i + 1] &&
+                data[i] == data[i + 2])
+                break;
+            i++;
+        }
+        out.push_back(static_cast<uint8_t>(i - start - 1));
+        out.insert(out.end(), data + start, data + i);
+    }
+}
+
+bool PackBitsDecode(const uint8_t *data,
+                    size_t size,
+                    uint8_t *out,
+                    size_t outSize)
+{
+    size_t in = 0;
+    size_t written = 0;
+    while (in < size)
+    {
+        const uint8_t header = data[in++];
+        if (header < 128)
+        {
+            const size_t count = static_cast<size_t>(header) + 1;
+            if (count > size - in || count > outSize - written)
+                return false;
+            std::memcpy(out + written, data + in, count);
+            in += count;
+            written += count;
+        }
+        else if (header > 128)
+        {
+            const size_t count = 257 - static_cast<size_t>(header);
+            if (in >= size || count > outSize - written)
+                return false;
+            std::memset(out + written, data[in++], count);
+            written += count;
+        }
+    }
+    return written == outSize;
+}
+} // namespace
+
+bool CompressBilevelPage(const PageBitmap &bitmap, BilevelPage &out)
+{
+    if (!bitmap.IsValid())
+        return false;
+
+    const size_t pixelCount =
+        static_cast<size_t>(bitmap.width) * static_cast<size_t>(bitmap.height);
+    std::vector<uint8_t> bits((pixelCount + 7) / 8);
+    const size_t ambiguous =
+        ThresholdToBits(bitmap.pixels.data(), pixelCount, INK_THRESHOLD,
+                        CLEAR_MARGIN, bits.data());
+    if (ambiguous * 100 > pixelCount * MAX_AMBIGUOUS_PERCENT)
+        return false;
+
+    out.width = bitmap.width;
+    out.height = bitmap.height;
+    out.nativeWidth = bitmap.nativeWidth;
+    out.nativeHeight = bitmap.nativeHeight;
+    out.packed.clear();
+    PackBitsEncode(bits.data(), bits.size(), out.packed);
+    out.packed.shrink_to_fit();
+    return true;
+}
+
+bool ExpandBilevelPage(const BilevelPage &page, PageBitmap &out)
+{
+    if (page.width <= 0 || page.height <= 0)
+        return false;
+
+    const size_t pixelCount =
+        static_cast<size_t>(page.width) * static_cast<size_t>(page.height);
+    std::vector<uint8_t> bits((pixelCount + 7) / 8);
+    if (!PackBitsDecode(page.packed.data(), page.packed.size(), bits.data(),
+                        bits.size()))
+    {
+        printf("[BilevelPage] Stored page is corrupt\n");
+        return false;
+    }
+
+    out.width = page.width;
+    out.height = page.height;
+    out.nativeWidth = page.nativeWidth;
+    out.nativeHeight = page.nativeHeight;
+    out.pixels.resize(pixelCount * 4);
+    ExpandBits(bits.data(), pixelCount, out.pixels.data());
+    return true;
+}
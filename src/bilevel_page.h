@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "pdfium_support.h"
+
+/**
+ * @brief A rasterized page stored at one bit per pixel.
+ *
+ * The bits are PackBits-compressed; a scanned score page at the viewer's
+ * resolution, about 8 MB as RGBA, typically takes well under 100 KB.
+ */
+struct BilevelPage
+{
+    int width = 0;
+    int height = 0;
+    double nativeWidth = 0.0;  // PDF points
+    double nativeHeight = 0.0; // PDF points
+    std::vector<uint8_t> packed;
+
+    size_t GetByteSize() const { return sizeof(*this) + packed.capacity(); }
+};
+
+/**
+ * @brief Threshold and compress a page that is effectively black and white.
+ *
+ * Pages where more than a tenth of the pixels are gray or colored are
+ * refused, since thresholding would visibly change them.
+ * @return false if the page is not suited to one bit per pixel.
+ */
+bool CompressBilevelPage(const PageBitmap &bitmap, BilevelPage &out);
+
+/**
+ * @brief Expand a stored page back to an RGBA bitmap for upload.
+ * @return false if the stored data is corrupt.
+ */
+bool ExpandBilevelPage(const BilevelPage &page, PageBitmap &out);
@@ -0,0 +1,587 @@
+#include "command_line.h"
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <shellapi.h>
+#endif
+
+#include <fpdfview.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <thread>
+
+#include "pdf_library.h"
+#include "pdfium_support.h"
+#include "png_encoder.h"
+#include "setlist_gen.h"
+
+namespace fs = std::filesystem;
+
+namespace
+{
+double ElapsedMs(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+}
+
+bool ParsePositiveInt(const std::string &text, int &value)
+{
+    char *end = nullptr;
+    const long parsed = std::strtol(text.c_str(), &end, 10);
+    if (text.empty() || *end != '\0' || parsed < 1 || parsed > 1000000)
+        return false;
+    value = static_cast<int>(parsed);
+    return true;
+}
+
+bool ParseLayout(const std::string &text, CommandLineOptions &options)
+{
+    options.impose = text != "merge";
+    if (text == "merge")
+        return true;
+    if (text == "2up")
+        options.imposition.layout = ImpositionLayout::TwoUp;
+    else if (text == "4up")
+        options.imposition.layout = ImpositionLayout::FourUp;
+    else if (text == "booklet")
+        options.imposition.layout = ImpositionLayout::Booklet;
+    else
+        return false;
+    return true;
+}
+
+// Checks the combination of options once all of them are known.
+bool ValidateOptions(const CommandLineOptions &options, std::string &error)
+{
+    switch (options.job)
+    {
+    case BatchJob::None:
+        if (!options.openPath.empty() && !options.setlistName.empty())
+            error = "open either a file or a setlist, not both";
+        else if (options.pageGiven && options.openPath.empty() &&
+                 options.setlistName.empty())
+            error = "--page needs a file or --setlist";
+        else if (!options.outputPath.empty() || !options.pageRange.empty() ||
+                 options.renderScale > 0.0 || options.impose)
+            error = "--output, --pages, --scale and --layout need --render "
+                    "or --export";
+        break;
+    case BatchJob::Render:
+        if (options.inputs.empty() || options.outputPath.empty())
+            error = "--render needs input files and --output <folder>";
+        break;
+    case BatchJob::Export:
+        if (options.outputPath.empty())
+            error = "--export needs --output <file.pdf>";
+        else if (options.inputs.empty() == options.setlistName.empty())
+            error = "--export needs either input files or --setlist";
+        break;
+    case BatchJob::Index:
+        if (options.inputs.size() != 1)
+            error = "--index needs exactly one folder";
+        break;
+    }
+
+    if (options.job != BatchJob::None && options.pageGiven)
+        error = "--page is for opening a file; use --pages with batch jobs";
+    if (options.job != BatchJob::None && options.job != BatchJob::Export &&
+        !options.setlistName.empty())
+        error = "--setlist is for opening or exporting a setlist";
+    return error.empty();
+}
+
+// The library keeps filesystem clock seconds, whose epoch is unspecified.
+// Shift them by the current offset between the two clocks for the listing.
+int64_t FileClockToUnixSeconds(int64_t fileSeconds)
+{
+    using std::chrono::duration_cast;
+    using std::chrono::seconds;
+    const int64_t systemNow =
+        duration_cast<seconds>(
+            std::chrono::system_clock::now().time_since_epoch())
+            .count();
+    const int64_t fileNow =
+        duration_cast<seconds>(
+            fs::file_time_type::clock::now().time_since_epoch())
+            .count();
+    return fileSeconds + (systemNow - fileNow);
+}
+
+struct OpenedDocument
+{
+    std::vector<unsigned char> data;
+    FPDF_DOCUMENT document = nullptr;
+    int pageCount = 0;
+
+    ~OpenedDocument()
+    {
+        if (!document)
+            return;
+        std::lock_guard<std::mutex> lock(PdfiumMutex());
+        FPDF_CloseDocument(document);
+    }
+};
+
+bool OpenDocument(const std::string &path, OpenedDocument &opened)
+{
+    if (!ReadPdfFile(path, opened.data))
+        return false;
+
+    std::lock_guard<std::mutex> lock(PdfiumMutex());
+    opened.document = FPDF_LoadMemDocument(
+        opened.data.data(), static_cast<int>(opened.data.size()), nullptr);
+    if (!opened.document)
+    {
+        fprintf(stderr, "[Batch] %s is not a readable PDF (error %lu)\n",
+                path.c_str(), FPDF_GetLastError());
+        return false;
+    }
+    opened.pageCount = FPDF_GetPageCount(opened.document);
+    return true;
+}
+
+std::string LowerAscii(std::string text)
+{
+    for (char &c : text)
+        if (c >= 'A' && c <= 'Z')
+            c = static_cast<char>(c - 'A' + 'a');
+    return text;
+}
+
+// Output name for each input's pages. Inputs that share a file name (as
+// compared on a case-insensitive filesystem) get their parent folder's name
+// in front, and their one-based input position as well if that still clashes.
+// Returns false when names still clash after that.
+bool RenderOutputStems(const std::vector<std::string> &inputs,
+                       std::vector<std::string> &stems)
+{
+    stems.clear();
+    stems.reserve(inputs.size());
+    for (const std::string &input : inputs)
+        stems.push_back(fs::path(input).stem().string());
+
+    const auto countOf = [](const std::vector<std::string> &names,
+                            const std::string &name)
+    {
+        const std::string key = LowerAscii(name);
+        return std::count_if(names.begin(), names.end(),
+                             [&key](const std::string &other)
+                             { return LowerAscii(other) == key; });
+    };
+
+    std::vector<std::string> named = stems;
+    for (size_t i = 0; i < inputs.size(); ++i)
+    {
+        if (countOf(stems, stems[i]) < 2)
+            continue;
+        std::error_code error;
+        const std::string parent = fs::absolute(fs::path(inputs[i]), error)
+                                       .parent_path()
+                                       .filename()
+                                       .string();
+        if (!parent.empty())
+            named[i] = parent + "-" + stems[i];
+    }
+
+    for (size_t i = 0; i < inputs.size(); ++i)
+    {
+        stems[i] = countOf(named, named[i]) > 1
+                       ? named[i] + "-" + std::to_string(i + 1)
+                       : named[i];
+    }
+
+    for (const std::string &stem : stems)
+    {
+        if (countOf(stems, stem) > 1)
+        {
+            fprintf(stderr, "[Batch] Two inputs would both be written as "
+                            "%s-<page>.png\n",
+                    stem.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+int RunRender(const CommandLineOptions &options)
+{
+    const fs::path outputFolder(options.outputPath);
+    std::error_code error;
+    fs::create_directories(outputFolder, error);
+    if (!fs::is_directory(outputFolder, error))
+    {
+        fprintf(stderr, "[Batch] Cannot create folder %s\n",
+                options.outputPath.c_str());
+        return 1;
+    }
+
+    const double scale =
+        options.renderScale > 0.0 ? options.renderScale : VIEWER_RENDER_SCALE;
+    const auto jobStart = std::chrono::steady_clock::now();
+    double renderMs = 0.0;
+    int pagesWritten = 0;
+    std::vector<std::string> stems;
+    if (!RenderOutputStems(options.inputs, stems))
+        return 1;
+
+    bool failed = false;
+    for (size_t inputIndex = 0; inputIndex < options.inputs.size();
+         ++inputIndex)
+    {
+        const std::string &input = options.inputs[inputIndex];
+        OpenedDocument opened;
+        std::vector<int> pages;
+        if (!OpenDocument(input, opened))
+        {
+            failed = true;
+            continue;
+        }
+        if (!ParsePageRange(options.pageRange, opened.pageCount, pages))
+        {
+            fprintf(stderr, "[Batch] Invalid page range \"%s\" for %s\n",
+                    options.pageRange.c_str(), input.c_str());
+            failed = true;
+            continue;
+        }
+
+        const std::string &stem = stems[inputIndex];
+        for (int page : pages)
+        {
+            PageBitmap bitmap;
+            const auto start = std::chrono::steady_clock::now();
+            bool rendered = false;
+            {
+                std::lock_guard<std::mutex> lock(PdfiumMutex());
+                rendered = RenderPageBitmap(opened.document, page, scale,
+                                            VIEWER_MAX_TEXTURE_SIZE, bitmap);
+            }
+            const double pageMs = ElapsedMs(start);
+
+            std::string png;
+            bool written = rendered && EncodePng(bitmap.pixels.data(),
+                                                 bitmap.width, bitmap.height,
+                                                 png);
+            if (written)
+            {
+                const fs::path outputPath =
+                    outputFolder /
+                    (stem + "-" + std::to_string(page + 1) + ".png");
+                std::ofstream out(outputPath,
+                                  std::ios::binary | std::ios::trunc);
+                written = static_cast<bool>(out.write(
+                    png.data(), static_cast<std::streamsize>(png.size())));
+            }
+            if (!written)
+            {
+                fprintf(stderr, "[Batch] Failed to render %s page %d\n",
+                        input.c_str(), page + 1);
+                failed = true;
+                continue;
+            }
+
+            renderMs += pageMs;
+            pagesWritten++;
+            printf("[Batch] %s page %d: %d x %d, rendered in %.1f ms\n",
+                   input.c_str(), page + 1, bitmap.width, bitmap.height,
+                   pageMs);
+        }
+    }
+
+    const double totalMs = ElapsedMs(jobStart);
+    printf("[Batch] Rendered %d page(s) in %.0f ms (%.1f ms per page "
+           "rendering, %.0f ms total)\n",
+           pagesWritten, renderMs,
+           pagesWritten > 0 ? renderMs / pagesWritten : 0.0, totalMs);
+    return failed ? 1 : 0;
+}
+
+int RunExport(const CommandLineOptions &options)
+{
+    std::vector<ExportPart> parts;
+    if (!options.setlistName.empty())
+    {
+        SetlistManager setlists;
+        const std::string savePath = SetlistManager::GetDefaultSavePath();
+        const int index = setlists.LoadFromFile(savePath)
+                              ? setlists.FindSetlist(options.setlistName)
+                              : -1;
+        if (index < 0)
+        {
+            fprintf(stderr, "[Batch] No setlist named \"%s\" in %s\n",
+                    options.setlistName.c_str(), savePath.c_str());
+            return 1;
+        }
+        for (const SetlistItem &item :
+             setlists.GetSetlist(static_cast<size_t>(index))->GetItems())
+            parts.push_back(
+                {item.GetName(), item.GetFullPath(), options.pageRange});
+    }
+    else
+    {
+        for (const std::string &input : options.inputs)
+            parts.push_back({fs::path(input).filename().string(), input,
+                             options.pageRange});
+    }
+
+    PdfExporter exporter;
+    const bool started =
+        options.impose
+            ? exporter.StartImposition(parts, options.imposition,
+                                       options.outputPath)
+            : exporter.StartMerge(parts, options.outputPath);
+    if (!started)
+        return 1;
+
+    while (exporter.IsRunning())
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+    const ExportStatus status = exporter.GetStatus();
+    printf("[Batch] %s: %d page(s) at %.1f pages/s. %s\n",
+           status.outputPath.c_str(), status.pagesWritten,
+           status.pagesPerSecond, status.message.c_str());
+    return status.succeeded ? 0 : 1;
+}
+
+// One line per PDF: page count, size in bytes, modification time in Unix
+// seconds and path, tab separated, in name order. Unreadable files get a
+// page count of -1.
+int RunIndex(const CommandLineOptions &options)
+{
+    const auto start = std::chrono::steady_clock::now();
+    PdfLibrary library;
+    if (!library.LoadFolder(options.inputs[0]))
+    {
+        fprintf(stderr, "[Batch] Cannot read folder %s\n",
+                options.inputs[0].c_str());
+        return 1;
+    }
+    const double scanMs = ElapsedMs(start);
+
+    std::ofstream file;
+    if (!options.outputPath.empty())
+    {
+        file.open(fs::path(options.outputPath), std::ios::trunc);
+        if (!file.is_open())
+        {
+            fprintf(stderr, "[Batch] Cannot write %s\n",
+                    options.outputPath.c_str());
+            return 1;
+        }
+    }
+
+    int pageTotal = 0;
+    size_t unreadable = 0;
+    std::string line;
+    for (size_t i = 0; i < library.GetFileCount(); i++)
+    {
+        const std::string path = library.GetFullPath(i);
+        OpenedDocument opened;
+        const int pageCount =
+            OpenDocument(path, opened) ? opened.pageCount : -1;
+        if (pageCount < 0)
+            unreadable++;
+        else
+            pageTotal += pageCount;
+
+        const int64_t modified =
+            FileClockToUnixSeconds(library.GetModifiedTime(i));
+        line = std::to_string(pageCount) + "\t" +
+               std::to_string(library.GetFileSize(i)) + "\t" +
+               std::to_string(modified) + "\t" + path + "\n";
+        if (file.is_open())
+            file << line;
+        else
+            fputs(line.c_str(), stdout);
+    }
+
+    // The listing may be on stdout, so the summary goes to stderr.
+    fprintf(stderr,
+            "[Batch] Indexed %zu PDF(s), %d page(s), %zu unreadable: "
+            "scan %.1f ms, total %.1f ms\n",
+            library.GetFileCount(), pageTotal, unreadable, scanMs,
+            ElapsedMs(start));
+    return unreadable > 0 ? 1 : 0;
+}
+} // namespace
+
+std::vector<std::string> GetUtf8Arguments(int argc, char **argv)
+{
+    std::vector<std::string> args;
+#ifdef _WIN32
+    (void)argv;
+    int count = 0;
+    LPWSTR *wide = CommandLineToArgvW(GetCommandLineW(), &count);
+    for (int i = 1; wide && i < count; i++)
+    {
+        const int size = WideCharToMultiByte(CP_UTF8, 0, wide[i], -1, nullptr,
+                                             0, nullptr, nullptr);
+        std::string arg(static_cast<size_t>((std::max)(size, 1)) - 1, '\0');
+        WideCharToMultiByte(CP_UTF8, 0, wide[i], -1, arg.data(), size,
+                            nullptr, nullptr);
+        args.push_back(std::move(arg));
+    }
+    LocalFree(wide);
+    (void)argc;
+#else
+    for (int i = 1; i < argc; i++)
+        args.emplace_back(argv[i]);
+#endif
+    return args;
+}
+
+bool ParseCommandLine(const std::vector<std::string> &args,
+                      CommandLineOptions &options,
+                      std::string &error)
+{
+    auto setJob = [&](BatchJob job) {
+        if (options.job != BatchJob::None && options.job != job)
+            error = "only one of --render, --export and --index may be given";
+        options.job = job;
+    };
+
+    std::vector<std::string> positional;
+    for (size_t i = 0; i < args.size() && error.empty(); i++)
+    {
+        const std::string &arg = args[i];
+        const bool hasValue = i + 1 < args.size();
+        auto needValue = [&]() {
+            if (!hasValue)
+                error = arg + " needs a value";
+            return hasValue;
+        };
+
+        if (arg == "--help" || arg == "-h")
+            options.showHelp = true;
+        else if (arg == "--render")
+            setJob(BatchJob::Render);
+        else if (arg == "--export")
+            setJob(BatchJob::Export);
+        else if (arg == "--index")
+            setJob(BatchJob::Index);
+        else if (arg == "--page")
+        {
+            if (!needValue())
+                break;
+            int page = 0;
+            if (!ParsePositiveInt(args[++i], page))
+                error = "--page needs a page number from 1";
+            options.openPage = page - 1;
+            options.pageGiven = true;
+        }
+        else if (arg == "--setlist")
+        {
+            if (needValue())
+                options.setlistName = args[++i];
+        }
+        else if (arg == "--output" || arg == "-o")
+        {
+            if (needValue())
+                options.outputPath = args[++i];
+        }
+        else if (arg == "--pages")
+        {
+            if (needValue())
+                options.pageRange = args[++i];
+        }
+        else if (arg == "--scale")
+        {
+            if (!needValue())
+                break;
+            options.renderScale = std::strtod(args[++i].c_str(), nullptr);
+            if (options.renderScale <= 0.0 || options.renderScale > 8.0)
+                error = "--scale needs a value above 0 and at most 8";
+        }
+        else if (arg == "--layout")
+        {
+            if (needValue() && !ParseLayout(args[++i], options))
+                error = "--layout must be merge, 2up, 4up or booklet";
+        }
+        else if (arg == "--paper")
+        {
+            if (!needValue())
+                break;
+            const std::string &paper = args[++i];
+            if (paper == "letter")
+                options.imposition.paper = PaperSize::Letter;
+            else if (paper == "a4")
+                options.imposition.paper = PaperSize::A4;
+            else
+                error = "--paper must be letter or a4";
+        }
+        else if (arg.rfind("-psn_", 0) == 0)
+        {
+            // Process serial number added by older macOS launchers.
+        }
+        else if (arg.size() > 1 && arg[0] == '-')
+            error = "unknown option " + arg;
+        else
+            positional.push_back(arg);
+    }
+    if (!error.empty())
+        return false;
+    if (options.showHelp)
+        return true;
+
+    if (options.job == BatchJob::None)
+    {
+        if (positional.size() > 1)
+        {
+            error = "only one file can be opened";
+            return false;
+        }
+        if (!positional.empty())
+            options.openPath = positional[0];
+    }
+    else
+    {
+        options.inputs = std::move(positional);
+    }
+    return ValidateOptions(options, error);
+}
+
+void PrintUsage(const char *program)
+{
+    printf("Usage:\n"
+           "  %s [file.pdf] [--page N]\n"
+           "  %s --setlist NAME [--page N]\n"
+           "  %s --render FILE... --output FOLDER [--pages RANGE] "
+           "[--scale S]\n"
+           "  %s --export FILE... | --setlist NAME --output FILE.pdf\n"
+           "      [--pages RANGE] [--layout merge|2up|4up|booklet] "
+           "[--paper letter|a4]\n"
+           "  %s --index FOLDER [--output FILE.tsv]\n"
+           "\n"
+           "Without a batch job the window opens on the file or setlist.\n"
+           "RANGE is one-based, such as 1,3,5-7; it applies to every input.\n",
+           program, program, program, program, program);
+}
+
+int RunBatchJob(const CommandLineOptions &options)
+{
+    switch (options.job)
+    {
+    case BatchJob::Render:
+        return RunRender(options);
+    case BatchJob::Export:
+        return RunExport(options);
+    case BatchJob::Index:
+        return RunIndex(options);
+    case BatchJob::None:
+        break;
+    }
+    return 0;
+}
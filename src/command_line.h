@@ -0,0 +1,66 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "pdf_export.h"
+
+/**
+ * @brief Work that runs without a window and exits.
+ */
+enum class BatchJob
+{
+    None,
+    Render, // Rasterize pages to PNG files
+    Export, // Merge or impose PDFs, or a setlist, into one file
+    Index   // List a folder's PDFs with their page counts
+};
+
+/**
+ * @brief What the app was asked to do on launch.
+ */
+struct CommandLineOptions
+{
+    bool showHelp = false;
+
+    // Interactive launch: open one document, or play a setlist.
+    std::string openPath;
+    int openPage = 0; // zero-based
+    bool pageGiven = false;
+    std::string setlistName;
+
+    // Headless batch job.
+    BatchJob job = BatchJob::None;
+    std::vector<std::string> inputs;
+    std::string outputPath;
+    std::string pageRange; // one-based, as accepted by ParsePageRange()
+    double renderScale = 0.0; // 0 renders at the viewer's scale
+    bool impose = false;
+    ImpositionOptions imposition;
+};
+
+/**
+ * @brief Get the program arguments as UTF-8.
+ * On Windows the narrow argv uses the ANSI code page, so the wide command
+ * line is converted instead.
+ */
+std::vector<std::string> GetUtf8Arguments(int argc, char **argv);
+
+/**
+ * @brief Parse the arguments after the program name.
+ * @param args Arguments, UTF-8 encoded.
+ * @param options Receives the parsed options.
+ * @param error Receives a message when the arguments are invalid.
+ * @return true if the arguments were valid, false otherwise.
+ */
+bool ParseCommandLine(const std::vector<std::string> &args,
+                      CommandLineOptions &options,
+                      std::string &error);
+
+void PrintUsage(const char *program);
+
+/**
+ * @brief Run a batch job to completion. PDFium must be initialized.
+ * @return Process exit status: 0 on success, 1 if the job failed.
+ */
+int RunBatchJob(const CommandLineOptions &options);
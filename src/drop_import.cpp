@@ -0,0 +1,289 @@
+#include "drop_import.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <utility>
+
+#include "pdf_library.h"
+#include "pdfium_support.h"
+
+namespace fs = std::filesystem;
+
+namespace
+{
+// PDF readers accept the header anywhere in the first kilobyte.
+const size_t HEADER_SEARCH_BYTES = 1024;
+
+bool HasPdfExtension(const fs::path &path)
+{
+    std::string extension = path.extension().string();
+    for (char &c : extension)
+    {
+        if (c >= 'A' && c <= 'Z')
+            c = static_cast<char>(c - 'A' + 'a');
+    }
+    return extension == ".pdf";
+}
+
+bool HasPdfHeader(const std::string &path)
+{
+    std::ifstream file(fs::path(path), std::ios::binary);
+    if (!file.is_open())
+        return false;
+
+    char head[HEADER_SEARCH_BYTES];
+    file.read(head, sizeof(head));
+    const std::streamsize length = file.gcount();
+    static const char SIGNATURE[] = "%PDF-";
+    return std::search(head, head + length, SIGNATURE,
+                       SIGNATURE + sizeof(SIGNATURE) - 1) != head + length;
+}
+
+// Opening documents is serialized by PdfiumMutex(), so more threads than
+// this mostly wait on the lock.
+size_t ChooseThreadCount()
+{
+    const unsigned int cores = std::thread::hardware_concurrency();
+    return (std::min)(static_cast<size_t>(cores > 1 ? cores - 1 : 1),
+                      static_cast<size_t>(4));
+}
+} // namespace
+
+DropImporter::DropImporter() : m_worker(ChooseThreadCount()) {}
+
+DropImporter::~DropImporter() { Cancel(); }
+
+void DropImporter::Begin(const std::vector<std::string> &paths,
+                         ImportTarget target,
+                         uint32_t setlistId)
+{
+    if (paths.empty())
+        return;
+
+    uint64_t batchId = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_batches.empty() && !m_progress.IsActive())
+        {
+            // A fresh drop after the last one finished starts new totals.
+            m_progress = ImportProgress();
+            m_recentErrors.clear();
+        }
+
+        Batch batch;
+        batch.id = m_nextBatchId++;
+        batch.target = target;
+        batch.setlistId = setlistId;
+        m_batches.push_back(std::move(batch));
+        m_progress.scanning = true;
+        batchId = m_batches.back().id;
+    }
+
+    const uint64_t generation = m_generation.load();
+    m_worker.Post([this, batchId, generation, paths]() {
+        ScanDrop(batchId, generation, paths);
+    });
+}
+
+void DropImporter::Cancel()
+{
+    m_generation++;
+    m_worker.CancelPending();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_batches.clear();
+    m_progress.found = m_progress.checked;
+    m_progress.scanning = false;
+}
+
+void DropImporter::TakeResults(std::vector<ImportedFile> &out)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_ready.empty())
+        return;
+
+    for (ImportedFile &file : m_ready)
+        out.push_back(std::move(file));
+    m_ready.clear();
+}
+
+ImportProgress DropImporter::GetProgress() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_progress;
+}
+
+std::vector<std::string> DropImporter::GetRecentErrors() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_recentErrors;
+}
+
+void DropImporter::ScanDrop(uint64_t batchId,
+                            uint64_t generation,
+                            std::vector<std::string> paths)
+{
+    std::vector<std::string> files;
+    for (const std::string &path : paths)
+    {
+        std::error_code error;
+        if (!fs::is_directory(fs::path(path), error))
+        {
+            // Dropped files are checked whatever their name; the header
+            // check decides.
+            files.push_back(path);
+            continue;
+        }
+
+        std::vector<std::string> found;
+        fs::recursive_directory_iterator it(
+            fs::path(path), fs::directory_options::skip_permission_denied,
+            error);
+        for (; !error && it != fs::recursive_directory_iterator();
+             it.increment(error))
+        {
+            if (m_generation.load() != generation)
+                return;
+            if (it->is_regular_file(error) && HasPdfExtension(it->path()))
+                found.push_back(it->path().string());
+        }
+        std::sort(found.begin(), found.end());
+        files.insert(files.end(), found.begin(), found.end());
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_generation.load() != generation)
+            return;
+        Batch *batch = FindBatch(batchId);
+        if (!batch)
+            return;
+
+        batch->expected = files.size();
+        batch->scanning = false;
+        batch->results.resize(files.size());
+        m_progress.found += files.size();
+        m_progress.scanning =
+            std::any_of(m_batches.begin(), m_batches.end(),
+                        [](const Batch &other) { return other.scanning; });
+        ReleaseCompleteBatches();
+    }
+
+    printf("[DropImport] Checking %zu file(s)\n", files.size());
+    for (size_t order = 0; order < files.size(); order++)
+    {
+        m_worker.Post([this, batchId, generation, order,
+                       path = std::move(files[order])]() mutable {
+            CheckFile(batchId, generation, order, std::move(path));
+        });
+    }
+}
+
+void DropImporter::CheckFile(uint64_t batchId,
+                             uint64_t generation,
+                             size_t order,
+                             std::string path)
+{
+    if (m_generation.load() != generation)
+        return;
+
+    ImportedFile result;
+    result.batchId = batchId;
+    result.path = std::move(path);
+
+    std::vector<unsigned char> data;
+    if (!HasPdfHeader(result.path))
+    {
+        result.error = "not a PDF file";
+    }
+    else if (!PdfLibrary::ReadFileInfo(result.path, result.fileSize,
+                                       result.modifiedTime) ||
+             !ReadPdfFile(result.path, data))
+    {
+        result.error = "could not be read";
+    }
+    else
+    {
+        std::lock_guard<std::mutex> pdfiumLock(PdfiumMutex());
+        FPDF_DOCUMENT document = FPDF_LoadMemDocument(
+            data.data(), static_cast<int>(data.size()), nullptr);
+        if (!document)
+        {
+            const unsigned long code = FPDF_GetLastError();
+            result.error = code == FPDF_ERR_PASSWORD
+                               ? "password protected"
+                               : "damaged (PDFium error " +
+                                     std::to_string(code) + ")";
+        }
+        else
+        {
+            result.pageCount = FPDF_GetPageCount(document);
+            FPDF_CloseDocument(document);
+            if (result.pageCount <= 0)
+                result.error = "has no pages";
+            else
+                result.valid = true;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_generation.load() != generation)
+        return;
+    Batch *batch = FindBatch(batchId);
+    if (!batch)
+        return;
+
+    result.target = batch->target;
+    result.setlistId = batch->setlistId;
+    batch->checked++;
+    m_progress.checked++;
+    if (result.valid)
+    {
+        m_progress.accepted++;
+    }
+    else
+    {
+        m_progress.rejected++;
+        if (m_recentErrors.size() >= RECENT_ERROR_LIMIT)
+            m_recentErrors.erase(m_recentErrors.begin());
+        m_recentErrors.push_back(
+            fs::path(result.path).filename().string() + ": " + result.error);
+        printf("[DropImport] Skipped %s: %s\n", result.path.c_str(),
+               result.error.c_str());
+    }
+
+    batch->results[order] = std::move(result);
+    ReleaseCompleteBatches();
+}
+
+// Caller holds m_mutex.
+DropImporter::Batch *DropImporter::FindBatch(uint64_t batchId)
+{
+    for (Batch &batch : m_batches)
+    {
+        if (batch.id == batchId)
+            return &batch;
+    }
+    return nullptr;
+}
+
+// Caller holds m_mutex.
+void DropImporter::ReleaseCompleteBatches()
+{
+    for (auto it = m_batches.begin(); it != m_batches.end();)
+    {
+        if (it->scanning || it->checked < it->expected)
+        {
+            ++it;
+            continue;
+        }
+
+        for (ImportedFile &file : it->results)
+            m_ready.push_back(std::move(file));
+        it = m_batches.erase(it);
+    }
+}
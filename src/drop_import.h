@@ -0,0 +1,131 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "background_worker.h"
+
+/**
+ * @brief Where files from one drop end up.
+ */
+enum class ImportTarget
+{
+    Library,
+    Setlist
+};
+
+/**
+ * @brief The outcome of checking one dropped file.
+ */
+struct ImportedFile
+{
+    uint64_t batchId = 0;
+    ImportTarget target = ImportTarget::Library;
+    uint32_t setlistId = 0; // Setlist::GetId() of the target setlist
+    std::string path;
+    bool valid = false;
+    int pageCount = 0;
+    uint64_t fileSize = 0;    // as PdfLibrary::ReadFileInfo(), if valid
+    int64_t modifiedTime = 0; // likewise
+    std::string error; // why the file was rejected
+};
+
+/**
+ * @brief Totals across the drops since the importer was last idle.
+ */
+struct ImportProgress
+{
+    size_t found = 0; // files queued for checking so far
+    size_t checked = 0;
+    size_t accepted = 0;
+    size_t rejected = 0;
+    bool scanning = false; // dropped folders are still being listed
+    bool IsActive() const { return scanning || checked < found; }
+};
+
+/**
+ * @brief Validates dropped files and folders off the main thread.
+ *
+ * Folders are walked and every file is checked (PDF header, then page
+ * count through PDFium) on a small thread pool. Only the PDFium
+ * part takes PdfiumMutex(); reading the file and checking its header run
+ * in parallel. The main thread collects results with TakeResults() each
+ * frame, so a drop of hundreds of files never stalls the UI.
+ */
+class DropImporter
+{
+public:
+    DropImporter();
+    ~DropImporter();
+
+    DropImporter(const DropImporter &) = delete;
+    DropImporter &operator=(const DropImporter &) = delete;
+
+    /**
+     * @brief Start checking a drop. Folders are searched recursively.
+     * @param paths Dropped files and folders (UTF-8).
+     * @param target Whether valid files go to the library or a setlist.
+     * @param setlistId Setlist::GetId() of the setlist to add to for
+     *        ImportTarget::Setlist. An id rather than an index, since the
+     *        setlists may be edited while the drop is checked.
+     */
+    void Begin(const std::vector<std::string> &paths,
+               ImportTarget target,
+               uint32_t setlistId);
+
+    /**
+     * @brief Drop every file that has not been checked yet.
+     */
+    void Cancel();
+
+    /**
+     * @brief Move finished results into out.
+     *
+     * Files are held back until their whole drop is checked and then
+     * delivered together in drop order: a setlist keeps the dropped order,
+     * and the library merges each drop in once rather than every frame.
+     */
+    void TakeResults(std::vector<ImportedFile> &out);
+
+    ImportProgress GetProgress() const;
+
+    /**
+     * @brief The most recent rejections, as "name: reason", oldest first.
+     */
+    std::vector<std::string> GetRecentErrors() const;
+
+private:
+    struct Batch
+    {
+        uint64_t id = 0;
+        ImportTarget target = ImportTarget::Library;
+        uint32_t setlistId = 0;
+        size_t expected = 0;
+        size_t checked = 0;
+        bool scanning = true;
+        std::vector<ImportedFile> results; // by order in the drop
+    };
+
+    void ScanDrop(uint64_t batchId, uint64_t generation,
+                  std::vector<std::string> paths);
+    void CheckFile(uint64_t batchId, uint64_t generation, size_t order,
+                   std::string path);
+    Batch *FindBatch(uint64_t batchId);
+    void ReleaseCompleteBatches();
+
+    mutable std::mutex m_mutex;
+    std::vector<Batch> m_batches;
+    std::vector<ImportedFile> m_ready;
+    std::vector<std::string> m_recentErrors;
+    ImportProgress m_progress;
+    uint64_t m_nextBatchId = 1;
+    std::atomic<uint64_t> m_generation{0};
+
+    static constexpr size_t RECENT_ERROR_LIMIT = 50;
+
+    BackgroundWorker m_worker;
+};
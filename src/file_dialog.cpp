@@ -145,6 +145,39 @@ namespace FileDialog
         
         return result;
     }
+
+    std::string SavePDF(const std::string& defaultName)
+    {
+        std::string result;
+
+        std::wstring filter = L"PDF Files (*.pdf)";
+        filter.push_back(L'\0');
+        filter += L"*.pdf";
+        filter.push_back(L'\0');
+
+        wchar_t filename[MAX_PATH] = L"";
+        std::wstring defaultNameW = Utf8ToWide(defaultName);
+        if (defaultNameW.size() < MAX_PATH)
+            wcscpy_s(filename, MAX_PATH, defaultNameW.c_str());
+
+        OPENFILENAMEW ofn;
+        ZeroMemory(&ofn, sizeof(ofn));
+        ofn.lStructSize = sizeof(ofn);
+        ofn.hwndOwner = NULL;
+        ofn.lpstrFilter = filter.c_str();
+        ofn.lpstrFile = filename;
+        ofn.nMaxFile = MAX_PATH;
+        ofn.lpstrTitle = L"Save PDF";
+        ofn.lpstrDefExt = L"pdf";
+        ofn.Flags = OFN_OVERWRITEPROMPT | OFN_PATHMUSTEXIST | OFN_NOCHANGEDIR;
+
+        if (GetSaveFileNameW(&ofn))
+        {
+            result = WideToUtf8(filename);
+        }
+
+        return result;
+    }
 }
 
 #else
@@ -172,5 +205,11 @@ namespace FileDialog
         printf("[FileDialog] Folder dialogs not implemented for this platform.\n");
         return "";
     }
+
+    std::string SavePDF(const std::string& /*defaultName*/)
+    {
+        printf("[FileDialog] File dialogs not implemented for this platform.\n");
+        return "";
+    }
 }
 #endif
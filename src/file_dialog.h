@@ -26,4 +26,11 @@ namespace FileDialog
      * @return The selected folder path (UTF-8 encoded), or empty string if cancelled.
      */
     std::string OpenFolder();
+
+    /**
+     * @brief Open a native save dialog for a PDF file.
+     * @param defaultName Suggested file name (UTF-8 encoded).
+     * @return The chosen file path (UTF-8 encoded), or empty string if cancelled.
+     */
+    std::string SavePDF(const std::string& defaultName);
 }
@@ -81,4 +81,25 @@ std::string OpenFolder()
 {
     return RunOpenPanel(true, nullptr);
 }
+
+std::string SavePDF(const std::string &defaultName)
+{
+    @autoreleasepool
+    {
+        NSSavePanel *panel = [NSSavePanel savePanel];
+        panel.canCreateDirectories = YES;
+        panel.title = @"Save PDF";
+        panel.nameFieldStringValue =
+            [NSString stringWithUTF8String:defaultName.c_str()] ?: @"";
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wdeprecated-declarations"
+        panel.allowedFileTypes = @[ @"pdf" ];
+#pragma clang diagnostic pop
+
+        if ([panel runModal] != NSModalResponseOK)
+            return {};
+
+        return PathFromURL(panel.URL);
+    }
+}
 } // namespace FileDialog
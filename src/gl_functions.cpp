@@ -0,0 +1,66 @@
+#include "gl_functions.h"
+
+#include <cstdio>
+
+namespace
+{
+GlFunctions g_functions;
+bool g_loaded = false;
+
+template <typename Function>
+bool LoadFunction(Function &function, const char *name)
+{
+    function = reinterpret_cast<Function>(glfwGetProcAddress(name));
+    if (!function)
+        printf("[GL] Missing entry point %s\n", name);
+    return function != nullptr;
+}
+} // namespace
+
+bool LoadGlFunctions()
+{
+    if (g_loaded)
+        return true;
+
+    // Evaluate every load so all missing names are logged.
+    bool ok = true;
+    ok &= LoadFunction(g_functions.GenFramebuffers, "glGenFramebuffers");
+    ok &= LoadFunction(g_functions.DeleteFramebuffers, "glDeleteFramebuffers");
+    ok &= LoadFunction(g_functions.BindFramebuffer, "glBindFramebuffer");
+    ok &= LoadFunction(g_functions.FramebufferTexture2D,
+                       "glFramebufferTexture2D");
+    ok &= LoadFunction(g_functions.CheckFramebufferStatus,
+                       "glCheckFramebufferStatus");
+    ok &= LoadFunction(g_functions.BlitFramebuffer, "glBlitFramebuffer");
+    if (!ok)
+    {
+        g_functions = GlFunctions();
+        return false;
+    }
+
+    // glfwGetProcAddress may return stubs for functions the context does
+    // not support, so check the version before trusting the sync entry
+    // points.
+    GLFWwindow *context = glfwGetCurrentContext();
+    const int major = glfwGetWindowAttrib(context, GLFW_CONTEXT_VERSION_MAJOR);
+    const int minor = glfwGetWindowAttrib(context, GLFW_CONTEXT_VERSION_MINOR);
+    if (major > 3 || (major == 3 && minor >= 2) ||
+        glfwExtensionSupported("GL_ARB_sync"))
+    {
+        bool sync = true;
+        sync &= LoadFunction(g_functions.FenceSync, "glFenceSync");
+        sync &= LoadFunction(g_functions.ClientWaitSync, "glClientWaitSync");
+        sync &= LoadFunction(g_functions.DeleteSync, "glDeleteSync");
+        if (!sync)
+        {
+            g_functions.FenceSync = nullptr;
+            g_functions.ClientWaitSync = nullptr;
+            g_functions.DeleteSync = nullptr;
+        }
+    }
+
+    g_loaded = true;
+    return true;
+}
+
+const GlFunctions &Gl() { return g_functions; }
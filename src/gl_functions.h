@@ -0,0 +1,82 @@
+#pragma once
+
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+
+// The system GL headers only guarantee OpenGL 1.1 (Windows in particular),
+// so the few newer entry points the app calls directly are loaded at
+// runtime through GLFW. ImGui's backend keeps its own private loader.
+
+#ifndef GL_READ_FRAMEBUFFER
+#define GL_READ_FRAMEBUFFER 0x8CA8
+#endif
+#ifndef GL_DRAW_FRAMEBUFFER
+#define GL_DRAW_FRAMEBUFFER 0x8CA9
+#endif
+#ifndef GL_COLOR_ATTACHMENT0
+#define GL_COLOR_ATTACHMENT0 0x8CE0
+#endif
+#ifndef GL_FRAMEBUFFER_COMPLETE
+#define GL_FRAMEBUFFER_COMPLETE 0x8CD5
+#endif
+#ifndef GL_SYNC_GPU_COMMANDS_COMPLETE
+#define GL_SYNC_GPU_COMMANDS_COMPLETE 0x9117
+#define GL_ALREADY_SIGNALED 0x911A
+#define GL_TIMEOUT_EXPIRED 0x911B
+#define GL_CONDITION_SATISFIED 0x911C
+#define GL_WAIT_FAILED 0x911D
+typedef struct __GLsync *GLsync;
+#endif
+
+#ifdef _WIN32
+#define GL_FUNCTIONS_APIENTRY __stdcall
+#else
+#define GL_FUNCTIONS_APIENTRY
+#endif
+
+/**
+ * @brief OpenGL 3.0+ entry points not declared by the system headers.
+ */
+struct GlFunctions
+{
+    void(GL_FUNCTIONS_APIENTRY *GenFramebuffers)(GLsizei, GLuint *) = nullptr;
+    void(GL_FUNCTIONS_APIENTRY *DeleteFramebuffers)(GLsizei,
+                                                    const GLuint *) = nullptr;
+    void(GL_FUNCTIONS_APIENTRY *BindFramebuffer)(GLenum, GLuint) = nullptr;
+    void(GL_FUNCTIONS_APIENTRY *FramebufferTexture2D)(GLenum, GLenum, GLenum,
+                                                      GLuint,
+                                                      GLint) = nullptr;
+    GLenum(GL_FUNCTIONS_APIENTRY *CheckFramebufferStatus)(GLenum) = nullptr;
+    void(GL_FUNCTIONS_APIENTRY *BlitFramebuffer)(GLint, GLint, GLint, GLint,
+                                                 GLint, GLint, GLint, GLint,
+                                                 GLbitfield,
+                                                 GLenum) = nullptr;
+
+    // Sync objects (GL 3.2 or ARB_sync). Null when unsupported; callers
+    // must check before use.
+    GLsync(GL_FUNCTIONS_APIENTRY *FenceSync)(GLenum, GLbitfield) = nullptr;
+    GLenum(GL_FUNCTIONS_APIENTRY *ClientWaitSync)(GLsync,
+                                                  GLbitfield,
+                                                  uint64_t) = nullptr;
+    void(GL_FUNCTIONS_APIENTRY *DeleteSync)(GLsync) = nullptr;
+
+    bool HasSync() const
+    {
+        return FenceSync && ClientWaitSync && DeleteSync;
+    }
+};
+
+/**
+ * @brief Load the entry points for the current context.
+ * Call once after the main window's context is made current. Contexts
+ * that share with it use the same pointers.
+ * @return false if any required entry point is missing. Optional ones
+ *         are left null.
+ */
+bool LoadGlFunctions();
+
+/**
+ * @brief The loaded entry points; null until LoadGlFunctions() succeeds.
+ */
+const GlFunctions &Gl();
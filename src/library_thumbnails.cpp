@@ -0,0 +1,460 @@
+#include "library_thumbnails.h"
+
+#include <fpdfview.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <unordered_set>
+
+#include "pdfium_support.h"
+#include "setlist_gen.h"
+
+#ifndef GL_CLAMP_TO_EDGE
+#define GL_CLAMP_TO_EDGE 0x812F
+#endif
+
+namespace
+{
+// Cache files hold a fixed header, the UTF-8 path of the PDF they were made
+// from and then RGB rows, top row first. The path lets a library scan find
+// thumbnails whose file is gone.
+const char THUMBNAIL_MAGIC[8] = {'P', 'D', 'F', 'T', 'H', 'M', 'B', '2'};
+
+struct ThumbnailHeader
+{
+    char magic[8];
+    uint64_t fileSize;
+    int64_t modifiedTime;
+    uint32_t width;
+    uint32_t height;
+    uint32_t pathLength;
+};
+
+const uint32_t MAX_CACHED_PATH_LENGTH = 32 * 1024;
+
+// Requests older than this many frames belong to cells that have scrolled
+// out of view.
+const uint64_t STALE_REQUEST_FRAMES = 2;
+
+// FNV-1a, to turn a path into a cache file name.
+uint64_t HashPath(const std::string &path)
+{
+    uint64_t hash = 1469598103934665603ull;
+    for (unsigned char c : path)
+    {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+std::filesystem::path CacheFilePath(const std::string &folder,
+                                    const std::string &pdfPath)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.thumb",
+             static_cast<unsigned long long>(HashPath(pdfPath)));
+    return std::filesystem::path(folder) / name;
+}
+
+bool ReadCacheHeader(std::ifstream &in,
+                     ThumbnailHeader &header,
+                     std::string &pdfPath)
+{
+    if (!in.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+        std::memcmp(header.magic, THUMBNAIL_MAGIC, sizeof(header.magic)) !=
+            0 ||
+        header.pathLength > MAX_CACHED_PATH_LENGTH)
+        return false;
+
+    pdfPath.resize(header.pathLength);
+    return static_cast<bool>(
+        in.read(pdfPath.data(), static_cast<std::streamsize>(pdfPath.size())));
+}
+
+bool ReadCachedThumbnail(const std::filesystem::path &cachePath,
+                         const std::string &pdfPath,
+                         uint64_t fileSize,
+                         int64_t modifiedTime,
+                         int &width,
+                         int &height,
+                         std::vector<unsigned char> &rgba)
+{
+    std::ifstream in(cachePath, std::ios::binary);
+    ThumbnailHeader header;
+    std::string cachedPath;
+    // Two paths may share a hash; the stored path tells them apart.
+    if (!ReadCacheHeader(in, header, cachedPath) || cachedPath != pdfPath ||
+        header.fileSize != fileSize || header.modifiedTime != modifiedTime ||
+        header.width == 0 || header.height == 0 ||
+        header.width > LibraryThumbnails::THUMBNAIL_SIZE ||
+        header.height > LibraryThumbnails::THUMBNAIL_SIZE)
+        return false;
+
+    const size_t pixelCount =
+        static_cast<size_t>(header.width) * header.height;
+    std::vector<unsigned char> rgb(pixelCount * 3);
+    if (!in.read(reinterpret_cast<char *>(rgb.data()),
+                 static_cast<std::streamsize>(rgb.size())))
+        return false;
+
+    rgba.resize(pixelCount * 4);
+    for (size_t i = 0; i < pixelCount; i++)
+    {
+        rgba[i * 4 + 0] = rgb[i * 3 + 0];
+        rgba[i * 4 + 1] = rgb[i * 3 + 1];
+        rgba[i * 4 + 2] = rgb[i * 3 + 2];
+        rgba[i * 4 + 3] = 255;
+    }
+    width = static_cast<int>(header.width);
+    height = static_cast<int>(header.height);
+    return true;
+}
+
+void WriteCachedThumbnail(const std::filesystem::path &cachePath,
+                          const std::string &pdfPath,
+                          uint64_t fileSize,
+                          int64_t modifiedTime,
+                          int width,
+                          int height,
+                          const std::vector<unsigned char> &rgba)
+{
+    std::error_code error;
+    std::filesystem::create_directories(cachePath.parent_path(), error);
+
+    if (pdfPath.size() > MAX_CACHED_PATH_LENGTH)
+        return;
+
+    ThumbnailHeader header = {};
+    std::memcpy(header.magic, THUMBNAIL_MAGIC, sizeof(header.magic));
+    header.fileSize = fileSize;
+    header.modifiedTime = modifiedTime;
+    header.width = static_cast<uint32_t>(width);
+    header.height = static_cast<uint32_t>(height);
+    header.pathLength = static_cast<uint32_t>(pdfPath.size());
+
+    // Rendered pages are opaque, so alpha is not stored.
+    const size_t pixelCount = static_cast<size_t>(width) * height;
+    std::vector<unsigned char> rgb(pixelCount * 3);
+    for (size_t i = 0; i < pixelCount; i++)
+    {
+        rgb[i * 3 + 0] = rgba[i * 4 + 0];
+        rgb[i * 3 + 1] = rgba[i * 4 + 1];
+        rgb[i * 3 + 2] = rgba[i * 4 + 2];
+    }
+
+    // Written under a temporary name so a reader never sees half a file.
+    std::filesystem::path temporaryPath = cachePath;
+    temporaryPath += ".tmp";
+    {
+        std::ofstream out(temporaryPath, std::ios::binary | std::ios::trunc);
+        if (!out.write(reinterpret_cast<const char *>(&header),
+                       sizeof(header)) ||
+            !out.write(pdfPath.data(),
+                       static_cast<std::streamsize>(pdfPath.size())) ||
+            !out.write(reinterpret_cast<const char *>(rgb.data()),
+                       static_cast<std::streamsize>(rgb.size())))
+        {
+            out.close();
+            std::filesystem::remove(temporaryPath, error);
+            return;
+        }
+    }
+    std::filesystem::rename(temporaryPath, cachePath, error);
+    if (error)
+        std::filesystem::remove(temporaryPath, error);
+}
+
+bool RenderThumbnail(const std::string &pdfPath,
+                     int &width,
+                     int &height,
+                     std::vector<unsigned char> &rgba)
+{
+    std::vector<unsigned char> data;
+    if (!ReadPdfFile(pdfPath, data))
+        return false;
+
+    PageBitmap bitmap;
+    bool rendered = false;
+    {
+        std::lock_guard<std::mutex> lock(PdfiumMutex());
+        FPDF_DOCUMENT document = FPDF_LoadMemDocument(
+            data.data(), static_cast<int>(data.size()), nullptr);
+        if (!document)
+            return false;
+        rendered = RenderPageBitmap(document, 0, 1.0,
+                                    LibraryThumbnails::THUMBNAIL_SIZE,
+                                    bitmap);
+        FPDF_CloseDocument(document);
+    }
+    if (!rendered)
+        return false;
+
+    width = bitmap.width;
+    height = bitmap.height;
+    rgba = std::move(bitmap.pixels);
+    return true;
+}
+} // namespace
+
+// Two threads, so cache reads continue while the other renders under the
+// PDFium lock.
+LibraryThumbnails::LibraryThumbnails()
+    : m_cacheFolder(GetDefaultCacheFolder()), m_worker(2)
+{
+}
+
+LibraryThumbnails::~LibraryThumbnails()
+{
+    m_worker.CancelPending();
+}
+
+bool LibraryThumbnails::GetTexture(PathId path,
+                                   uint64_t fileSize,
+                                   int64_t modifiedTime,
+                                   GLuint &texture,
+                                   int &width,
+                                   int &height)
+{
+    if (path == INVALID_PATH_ID)
+        return false;
+
+    auto found = m_textures.find(path);
+    if (found != m_textures.end())
+    {
+        CachedTexture &cached = found->second;
+        if (cached.fileSize == fileSize &&
+            cached.modifiedTime == modifiedTime)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            cached.lastUsedFrame = m_frame;
+            if (cached.texture == 0)
+                return false;
+            texture = cached.texture;
+            width = cached.width;
+            height = cached.height;
+            return true;
+        }
+
+        // The file changed since its thumbnail was made.
+        if (cached.texture != 0)
+            glDeleteTextures(1, &cached.texture);
+        m_textures.erase(found);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto pending = m_pending.find(path);
+        if (pending != m_pending.end())
+        {
+            pending->second = m_frame;
+            return false;
+        }
+        m_pending.emplace(path, m_frame);
+    }
+
+    // Newest requests first: they are the cells on screen now.
+    m_worker.PostFront([this, path, fileSize, modifiedTime]() {
+        Load(path, fileSize, modifiedTime);
+    });
+    return false;
+}
+
+void LibraryThumbnails::Load(PathId path,
+                             uint64_t fileSize,
+                             int64_t modifiedTime)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto pending = m_pending.find(path);
+        if (pending == m_pending.end())
+            return;
+        if (m_frame - pending->second > STALE_REQUEST_FRAMES)
+        {
+            // Scrolled away; the cell asks again if it comes back.
+            m_pending.erase(pending);
+            return;
+        }
+    }
+
+    Thumbnail thumbnail;
+    thumbnail.path = path;
+    thumbnail.fileSize = fileSize;
+    thumbnail.modifiedTime = modifiedTime;
+
+    const std::string pdfPath = PathInterner::Shared().GetPath(path);
+    const std::filesystem::path cachePath =
+        CacheFilePath(m_cacheFolder, pdfPath);
+    if (!ReadCachedThumbnail(cachePath, pdfPath, fileSize, modifiedTime,
+                             thumbnail.width, thumbnail.height,
+                             thumbnail.pixels))
+    {
+        if (RenderThumbnail(pdfPath, thumbnail.width, thumbnail.height,
+                            thumbnail.pixels))
+            WriteCachedThumbnail(cachePath, pdfPath, fileSize, modifiedTime,
+                                 thumbnail.width, thumbnail.height,
+                                 thumbnail.pixels);
+        else
+            thumbnail.pixels.clear();
+    }
+
+    // Stays pending until Update() has a texture for it, so the grid does
+    // not queue it again in between.
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_completed.push_back(std::move(thumbnail));
+}
+
+void LibraryThumbnails::Update()
+{
+    std::vector<Thumbnail> completed;
+    uint64_t frame = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        completed.swap(m_completed);
+        for (const Thumbnail &thumbnail : completed)
+            m_pending.erase(thumbnail.path);
+        frame = m_frame++;
+    }
+
+    for (const Thumbnail &thumbnail : completed)
+    {
+        CachedTexture &cached = m_textures[thumbnail.path];
+        if (cached.texture != 0)
+            glDeleteTextures(1, &cached.texture);
+        cached = CachedTexture();
+        cached.fileSize = thumbnail.fileSize;
+        cached.modifiedTime = thumbnail.modifiedTime;
+        cached.lastUsedFrame = frame;
+        if (thumbnail.pixels.empty())
+            continue;
+
+        cached.width = thumbnail.width;
+        cached.height = thumbnail.height;
+        glGenTextures(1, &cached.texture);
+        glBindTexture(GL_TEXTURE_2D, cached.texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, thumbnail.width,
+                     thumbnail.height, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                     thumbnail.pixels.data());
+    }
+
+    // Entries drawn in the frame just finished always stay; beyond the
+    // limit, the least recently drawn of the rest go. Files that could not
+    // be rendered count too, or scrolling a folder of them would grow the
+    // map without bound.
+    size_t idle = 0;
+    for (const auto &entry : m_textures)
+        idle += entry.second.lastUsedFrame < frame;
+    if (idle <= m_textureLimit)
+        return;
+
+    std::vector<std::pair<uint64_t, PathId>> candidates;
+    candidates.reserve(idle);
+    for (const auto &entry : m_textures)
+    {
+        if (entry.second.lastUsedFrame < frame)
+            candidates.emplace_back(entry.second.lastUsedFrame, entry.first);
+    }
+    const size_t excess = idle - m_textureLimit;
+    std::nth_element(candidates.begin(),
+                     candidates.begin() + static_cast<ptrdiff_t>(excess - 1),
+                     candidates.end());
+    for (size_t i = 0; i < excess; i++)
+    {
+        auto found = m_textures.find(candidates[i].second);
+        if (found->second.texture != 0)
+            glDeleteTextures(1, &found->second.texture);
+        m_textures.erase(found);
+    }
+}
+
+void LibraryThumbnails::PruneDiskCache(const std::string &libraryFolder,
+                                       std::vector<PathId> libraryPaths)
+{
+    // Behind any thumbnails the grid is waiting for.
+    m_worker.Post([this, libraryFolder,
+                   libraryPaths = std::move(libraryPaths)]() {
+        PruneCacheFolder(libraryFolder, libraryPaths);
+    });
+}
+
+void LibraryThumbnails::PruneCacheFolder(
+    const std::string &libraryFolder,
+    const std::vector<PathId> &libraryPaths) const
+{
+    namespace fs = std::filesystem;
+    const std::unordered_set<PathId> listed(libraryPaths.begin(),
+                                            libraryPaths.end());
+    const fs::path folder(libraryFolder);
+
+    // Iterated with error codes; the range-for increment would throw.
+    std::error_code error;
+    size_t removed = 0;
+    for (fs::directory_iterator entry(m_cacheFolder, error);
+         !error && entry != fs::directory_iterator();
+         entry.increment(error))
+    {
+        if (entry->path().extension() != ".thumb")
+            continue;
+
+        ThumbnailHeader header;
+        std::string pdfPath;
+        bool stale = false;
+        {
+            std::ifstream in(entry->path(), std::ios::binary);
+            stale = !ReadCacheHeader(in, header, pdfPath);
+        }
+        if (!stale)
+        {
+            // The folder scan lists exactly folder / name for every PDF in
+            // it, so one of those missing from the library has gone. Files
+            // elsewhere may belong to another library; they go only once
+            // they no longer exist.
+            const fs::path source(pdfPath);
+            const bool inFolder =
+                (folder / source.filename()).string() == pdfPath;
+            const PathId id = PathInterner::Shared().Find(pdfPath);
+            std::error_code existsError;
+            stale = inFolder ? listed.count(id) == 0
+                             : !fs::exists(source, existsError) &&
+                                   !existsError;
+        }
+        std::error_code removeError;
+        if (stale && fs::remove(entry->path(), removeError))
+            removed++;
+    }
+    if (removed > 0)
+        printf("[Thumbnails] Removed %zu cached thumbnail(s) of files no "
+               "longer in the library\n",
+               removed);
+}
+
+void LibraryThumbnails::Clear()
+{
+    m_worker.CancelPending();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pending.clear();
+        m_completed.clear();
+    }
+    for (const auto &entry : m_textures)
+    {
+        if (entry.second.texture != 0)
+            glDeleteTextures(1, &entry.second.texture);
+    }
+    m_textures.clear();
+}
+
+std::string LibraryThumbnails::GetDefaultCacheFolder()
+{
+    return (std::filesystem::path(SetlistManager::GetDefaultSavePath())
+                .parent_path() /
+            "thumbnails")
+        .string();
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <GLFW/glfw3.h>
+
+#include "background_worker.h"
+#include "path_interner.h"
+
+/**
+ * @brief First-page thumbnails for the library grid.
+ *
+ * Thumbnails are rendered at low resolution on background threads and
+ * saved to a disk cache, so a folder only pays for rendering once. A
+ * cached thumbnail is reused while the file's size and modification time
+ * match those it was made from. Only thumbnails the grid asks for are
+ * loaded, newest request first, and requests for cells scrolled out of
+ * view are dropped before they start. Each library scan deletes cached
+ * thumbnails of files that have left the library.
+ *
+ * Textures are created in Update() and must be used on the thread that
+ * owns the GL context.
+ */
+class LibraryThumbnails
+{
+public:
+    LibraryThumbnails();
+    ~LibraryThumbnails();
+
+    LibraryThumbnails(const LibraryThumbnails &) = delete;
+    LibraryThumbnails &operator=(const LibraryThumbnails &) = delete;
+
+    /**
+     * @brief Get a file's thumbnail texture, queuing it if it is not
+     *        loaded. Call for every visible cell, every frame.
+     * @param path File to show.
+     * @param fileSize File size as listed by the library.
+     * @param modifiedTime Modification time as listed by the library.
+     * @return false while the thumbnail is loading or if the file could
+     *         not be rendered.
+     */
+    bool GetTexture(PathId path,
+                    uint64_t fileSize,
+                    int64_t modifiedTime,
+                    GLuint &texture,
+                    int &width,
+                    int &height);
+
+    /**
+     * @brief Upload finished thumbnails and release textures over the
+     *        limit. Call once per frame.
+     */
+    void Update();
+
+    /**
+     * @brief Limit how many textures are kept beyond those drawn this
+     *        frame. Used to shed memory under pressure.
+     */
+    void SetTextureLimit(size_t textures) { m_textureLimit = textures; }
+    size_t GetTextureLimit() const { return m_textureLimit; }
+
+    /**
+     * @brief Delete cached thumbnails of files that have left the library,
+     *        in the background. Call after each scan of the library folder.
+     * @param libraryFolder The scanned folder.
+     * @param libraryPaths Every file the library lists.
+     */
+    void PruneDiskCache(const std::string &libraryFolder,
+                        std::vector<PathId> libraryPaths);
+
+    /**
+     * @brief Delete every texture and drop queued work. Call before the
+     *        GL context is destroyed.
+     */
+    void Clear();
+
+    /**
+     * @brief Folder for cached thumbnails, beside the saved setlists.
+     */
+    static std::string GetDefaultCacheFolder();
+
+    // Longest edge of a thumbnail, in pixels.
+    static constexpr int THUMBNAIL_SIZE = 160;
+
+    // About 100 KB each, so the default keeps roughly 25 MB of textures.
+    static constexpr size_t TEXTURE_CAPACITY = 256;
+
+private:
+    struct Thumbnail
+    {
+        PathId path = INVALID_PATH_ID;
+        uint64_t fileSize = 0;
+        int64_t modifiedTime = 0;
+        int width = 0;
+        int height = 0;
+        // RGBA, empty if the file could not be rendered.
+        std::vector<unsigned char> pixels;
+    };
+
+    void Load(PathId path, uint64_t fileSize, int64_t modifiedTime);
+    void PruneCacheFolder(const std::string &libraryFolder,
+                          const std::vector<PathId> &libraryPaths) const;
+
+    struct CachedTexture
+    {
+        uint64_t fileSize = 0;
+        int64_t modifiedTime = 0;
+        GLuint texture = 0; // 0 if the file could not be rendered
+        int width = 0;
+        int height = 0;
+        uint64_t lastUsedFrame = 0;
+    };
+
+    // Main thread only.
+    std::unordered_map<PathId, CachedTexture> m_textures;
+    size_t m_textureLimit = TEXTURE_CAPACITY;
+    std::string m_cacheFolder;
+
+    // Shared with the workers. m_pending maps each queued file to the last
+    // frame it was asked for.
+    std::mutex m_mutex;
+    uint64_t m_frame = 1;
+    std::unordered_map<PathId, uint64_t> m_pending;
+    std::vector<Thumbnail> m_completed;
+
+    BackgroundWorker m_worker;
+};
@@ -18,15 +18,36 @@
 
 #include <cstdio>
 #include <string>
+#include <vector>
 
 #include "app_init.h"
+#include "command_line.h"
+#include "drop_import.h"
 #include "imgui.h"
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_opengl3.h"
+#include "library_thumbnails.h"
+#include "memory_pressure.h"
+#include "page_mirror.h"
+#include "pdf_compare.h"
+#include "pdf_export.h"
 #include "pdf_library.h"
 #include "pdf_viewer.h"
+#include "presenter_window.h"
+#include "remote_control.h"
 #include "setlist_gen.h"
+#include "texture_uploader.h"
 #include "ui_panels.h"
+#include "view_memory.h"
+
+// Filled by the GLFW drop callback during glfwPollEvents().
+static std::vector<std::string> g_droppedPaths;
+
+static void DropCallback(GLFWwindow *, int count, const char **paths)
+{
+    for (int i = 0; i < count; i++)
+        g_droppedPaths.emplace_back(paths[i]);
+}
 
 static int FindRestoredSetlistIndex(const SetlistManager &setlistManager,
                                     const AppUiState &uiState)
@@ -75,8 +96,296 @@ static void CaptureSessionState(AppUiState &uiState,
     }
 }
 
-int main(int, char **)
+// Remote commands take the same paths as the toolbar buttons.
+static void ApplyRemoteCommands(RemoteControlServer &remote,
+                                SetlistManager &setlistManager,
+                                PdfViewer &viewer)
+{
+    RemoteCommand command;
+    while (remote.PopCommand(command))
+    {
+        switch (command.type)
+        {
+        case RemoteCommandType::NextPage:
+            if (setlistManager.IsActive())
+                setlistManager.Next(viewer);
+            else
+                viewer.NextPage();
+            break;
+        case RemoteCommandType::PreviousPage:
+            if (setlistManager.IsActive())
+                setlistManager.Previous(viewer);
+            else
+                viewer.PreviousPage();
+            break;
+        case RemoteCommandType::GoToPage:
+            viewer.GoToPage(command.value);
+            break;
+        case RemoteCommandType::GoToItem:
+            if (setlistManager.IsActive())
+                setlistManager.JumpToItem(
+                    static_cast<size_t>(setlistManager.GetActiveSetlistIndex()),
+                    static_cast<size_t>(command.value), viewer);
+            break;
+        }
+        remote.NotifyDispatched(command);
+    }
+}
+
+// Drops go to the playing setlist when there is one, else the library.
+static void BeginDropImport(DropImporter &importer,
+                            const SetlistManager &setlistManager,
+                            AppUiState &uiState)
 {
+    if (g_droppedPaths.empty())
+        return;
+
+    const Setlist *active = setlistManager.IsActive()
+                                ? setlistManager.GetSetlist(static_cast<size_t>(
+                                      setlistManager.GetActiveSetlistIndex()))
+                                : nullptr;
+    if (active)
+        importer.Begin(g_droppedPaths, ImportTarget::Setlist,
+                       active->GetId());
+    else
+        importer.Begin(g_droppedPaths, ImportTarget::Library, 0);
+    g_droppedPaths.clear();
+    uiState.importStatusOpen = true;
+}
+
+static void ApplyImportResults(DropImporter &importer,
+                               PdfLibrary &library,
+                               SetlistManager &setlistManager,
+                               int &selectedFileIndex)
+{
+    std::vector<ImportedFile> results;
+    importer.TakeResults(results);
+    if (results.empty())
+        return;
+
+    std::vector<LibraryFileInfo> libraryFiles;
+    std::vector<PathId> setlistPaths;
+    uint64_t setlistBatch = 0;
+    uint32_t setlistId = 0;
+    auto flushSetlist = [&]() {
+        // The setlist may have been deleted while the drop was checked;
+        // its files are then left out rather than added elsewhere.
+        const int setlistIndex = setlistManager.FindSetlistById(setlistId);
+        if (!setlistPaths.empty() && setlistIndex >= 0)
+            setlistManager.AddItems(static_cast<size_t>(setlistIndex),
+                                    setlistPaths);
+        setlistPaths.clear();
+    };
+
+    for (const ImportedFile &file : results)
+    {
+        if (!file.valid)
+            continue;
+
+        if (file.target == ImportTarget::Library)
+        {
+            libraryFiles.push_back(
+                {file.path, file.fileSize, file.modifiedTime, file.pageCount});
+            continue;
+        }
+
+        // Each setlist drop arrives whole and becomes one undo step.
+        if (file.batchId != setlistBatch)
+        {
+            flushSetlist();
+            setlistBatch = file.batchId;
+            setlistId = file.setlistId;
+        }
+        setlistPaths.push_back(PathInterner::Shared().Intern(file.path));
+    }
+    flushSetlist();
+
+    if (libraryFiles.empty())
+        return;
+
+    // Adding reorders the library; keep the same file selected.
+    PathId selectedPath = INVALID_PATH_ID;
+    if (selectedFileIndex >= 0 &&
+        selectedFileIndex < static_cast<int>(library.GetFileCount()))
+        selectedPath = library.GetPath(static_cast<size_t>(selectedFileIndex));
+    if (library.AddFiles(libraryFiles) > 0 &&
+        selectedPath != INVALID_PATH_ID)
+        selectedFileIndex = library.FindFile(selectedPath);
+}
+
+static void PublishRemoteState(RemoteControlServer &remote,
+                               const SetlistManager &setlistManager,
+                               const PdfViewer &viewer)
+{
+    RemoteViewState state;
+    state.title = viewer.IsLoaded() ? viewer.GetFilename() : "";
+    state.page = viewer.GetCurrentPage();
+    state.pageCount = viewer.GetPageCount();
+    if (setlistManager.IsActive())
+    {
+        const Setlist *setlist = setlistManager.GetSetlist(
+            static_cast<size_t>(setlistManager.GetActiveSetlistIndex()));
+        state.itemIndex = setlistManager.GetActiveItemIndex();
+        state.itemCount =
+            setlist ? static_cast<int>(setlist->GetItemCount()) : 0;
+    }
+    remote.PublishState(state);
+}
+
+// Keeps the mirror on the leader's page and feeds it bitmaps the viewer
+// already rasterized, prefetching the next pages so followers can preload
+// them before the leader turns.
+static void UpdateMirror(PageMirror &mirror,
+                         PdfViewer &viewer,
+                         const AppUiState &uiState)
+{
+    mirror.SetEnabled(uiState.remoteControlEnabled && uiState.mirrorEnabled);
+    if (!mirror.IsEnabled())
+        return;
+
+    if (!viewer.IsLoaded())
+    {
+        mirror.SetCurrentPage(viewer.GetDocumentId(), "", 0, 0);
+        return;
+    }
+
+    const uint64_t documentId = viewer.GetDocumentId();
+    const int current = viewer.GetCurrentPage();
+    mirror.SetCurrentPage(documentId, viewer.GetFilename(), current,
+                          viewer.GetPageCount());
+    for (int offset = 0; offset <= PageMirror::UPCOMING_PAGES; offset++)
+    {
+        const int page = current + offset;
+        if (page >= viewer.GetPageCount())
+            break;
+        if (!mirror.NeedsPage(documentId, page))
+            continue;
+
+        if (auto bitmap = viewer.GetCachedPage(page))
+            mirror.OfferPage(documentId, page, std::move(bitmap));
+        else if (offset > 0)
+            viewer.PrefetchPage(page);
+    }
+}
+
+// Pages the viewer keeps under pressure: the current one plus the next two,
+// then only the next, so a page turn mid-show never waits on a render.
+static const size_t MODERATE_PRESSURE_CACHED_PAGES = 3;
+static const size_t CRITICAL_PRESSURE_CACHED_PAGES = 2;
+// Library thumbnails kept besides those on screen; they reload from disk.
+static const size_t MODERATE_PRESSURE_THUMBNAILS = 32;
+static const size_t CRITICAL_PRESSURE_THUMBNAILS = 0;
+
+// Sheds caches when the system runs short of memory and restores them
+// once it recovers.
+static void ApplyMemoryPressure(MemoryPressure level,
+                                MemoryPressure &applied,
+                                PdfViewer &viewer,
+                                PageMirror &mirror,
+                                LibraryThumbnails &thumbnails)
+{
+    if (level == applied)
+        return;
+    applied = level;
+
+    switch (level)
+    {
+    case MemoryPressure::Normal:
+        viewer.SetCacheLimit(PdfViewer::PAGE_CACHE_CAPACITY);
+        thumbnails.SetTextureLimit(LibraryThumbnails::TEXTURE_CAPACITY);
+        break;
+    case MemoryPressure::Moderate:
+        viewer.SetCacheLimit(MODERATE_PRESSURE_CACHED_PAGES);
+        thumbnails.SetTextureLimit(MODERATE_PRESSURE_THUMBNAILS);
+        mirror.ReleaseStalePages();
+        break;
+    case MemoryPressure::Critical:
+        viewer.SetCacheLimit(CRITICAL_PRESSURE_CACHED_PAGES);
+        thumbnails.SetTextureLimit(CRITICAL_PRESSURE_THUMBNAILS);
+        mirror.ReleaseStalePages();
+        break;
+    }
+    printf("[App] Keeping up to %zu rendered pages\n",
+           viewer.GetCacheLimit());
+}
+
+#ifdef _WIN32
+// The app is a GUI-subsystem executable, so it starts without a console.
+// Borrow the one it was launched from so command-line output is visible.
+static void AttachParentConsole()
+{
+    if (!AttachConsole(ATTACH_PARENT_PROCESS))
+        return;
+    FILE *stream = nullptr;
+    freopen_s(&stream, "CONOUT$", "w", stdout);
+    freopen_s(&stream, "CONOUT$", "w", stderr);
+}
+#endif
+
+// Open the document or setlist named on the command line, in place of the
+// last session's setlist.
+static void ApplyLaunchOptions(const CommandLineOptions &options,
+                               SetlistManager &setlistManager,
+                               PdfViewer &viewer,
+                               AppUiState &uiState,
+                               int &selectedSetlistIndex)
+{
+    if (!options.setlistName.empty())
+    {
+        const int index = setlistManager.FindSetlist(options.setlistName);
+        if (index < 0)
+        {
+            printf("[App] No setlist named \"%s\"\n",
+                   options.setlistName.c_str());
+            return;
+        }
+        selectedSetlistIndex = index;
+        if (!setlistManager.ActivateSetlist(static_cast<size_t>(index),
+                                            viewer))
+            return;
+        uiState.sidebarVisible = true;
+        uiState.setlistsPanelOpenRequested = true;
+    }
+    else if (!viewer.Load(options.openPath, !options.pageGiven))
+    {
+        printf("[App] Failed to open %s\n", options.openPath.c_str());
+        return;
+    }
+
+    if (options.pageGiven)
+        viewer.GoToPage(options.openPage);
+}
+
+int main(int argc, char **argv)
+{
+    const std::vector<std::string> args = GetUtf8Arguments(argc, argv);
+#ifdef _WIN32
+    if (!args.empty())
+        AttachParentConsole();
+#endif
+    CommandLineOptions options;
+    std::string argumentError;
+    if (!ParseCommandLine(args, options, argumentError))
+    {
+        fprintf(stderr, "%s\n\n", argumentError.c_str());
+        PrintUsage("PdfApp");
+        return 2;
+    }
+    if (options.showHelp)
+    {
+        PrintUsage("PdfApp");
+        return 0;
+    }
+    if (options.job != BatchJob::None)
+    {
+        InitPDFium();
+        const int status = RunBatchJob(options);
+        FPDF_DestroyLibrary();
+        return status;
+    }
+    const bool launchTarget =
+        !options.openPath.empty() || !options.setlistName.empty();
+
     // Initialize systems
     GLFWwindow *window = InitWindow(1280, 720, "PDF Manager");
     if (!window)
@@ -87,7 +396,32 @@ int main(int, char **)
 
     // Create application state
     PdfLibrary library;
+    LibraryThumbnails thumbnails;
+    // Declared before the viewer, whose prefetch thread queues uploads.
+    TextureUploader uploader;
+    uploader.Start(window);
+    // Declared before the viewer, which records into it when it closes.
+    ViewMemory viewMemory;
+    viewMemory.LoadFromFile(ViewMemory::GetDefaultSavePath());
     PdfViewer viewer;
+    viewer.SetTextureUploader(&uploader);
+    viewer.SetViewMemory(&viewMemory);
+    PdfCompare compare;
+    PdfExporter exporter;
+    RemoteControlServer remote;
+    // Declared after the server so its encoder thread, which wakes the
+    // server, is joined first.
+    PageMirror mirror;
+    PresenterWindow presenter;
+    DropImporter importer;
+    MemoryPressureMonitor memoryPressure;
+    MemoryPressure appliedMemoryPressure = MemoryPressure::Normal;
+    // Each scan of the library folder clears out thumbnails of files that
+    // have left it.
+    uint64_t prunedScanCount = 0;
+    glfwSetDropCallback(window, DropCallback);
+    mirror.SetChangeCallback([&remote]() { remote.Wake(); });
+    remote.AttachMirror(&mirror);
     int selectedFileIndex = -1;
     int selectedSetlistIndex = -1;
     int selectedSetlistItemIndex = -1;
@@ -110,7 +444,7 @@ int main(int, char **)
         if (setlistManager.LoadFromFile(savePath))
         {
             printf("[App] Loaded setlists from %s\n", savePath.c_str());
-            if (uiState.restoreLastSession)
+            if (uiState.restoreLastSession && !launchTarget)
             {
                 selectedSetlistIndex =
                     FindRestoredSetlistIndex(setlistManager, uiState);
@@ -130,13 +464,45 @@ int main(int, char **)
             }
         }
     }
+    if (launchTarget)
+        ApplyLaunchOptions(options, setlistManager, viewer, uiState,
+                           selectedSetlistIndex);
 
     while (!glfwWindowShouldClose(window))
     {
         glfwPollEvents();
 
+        // Apply remote page turns before the viewer renders so they reach
+        // the screen in this frame.
+        if (uiState.remoteControlAllowLan &&
+            uiState.remoteControlToken.empty())
+            uiState.remoteControlToken = RemoteControlServer::GenerateToken();
+        remote.Configure(uiState.remoteControlEnabled,
+                         uiState.remoteControlPort,
+                         uiState.remoteControlAllowLan,
+                         uiState.remoteControlToken);
+        ApplyRemoteCommands(remote, setlistManager, viewer);
+        BeginDropImport(importer, setlistManager, uiState);
+        ApplyImportResults(importer, library, setlistManager,
+                           selectedFileIndex);
+
+        ApplyMemoryPressure(memoryPressure.Poll(), appliedMemoryPressure,
+                            viewer, mirror, thumbnails);
+
         // Update viewer (renders page if needed)
         viewer.Update();
+        thumbnails.Update();
+        if (library.GetScanCount() != prunedScanCount)
+        {
+            prunedScanCount = library.GetScanCount();
+            std::vector<PathId> libraryPaths(library.GetFileCount());
+            for (size_t i = 0; i < libraryPaths.size(); i++)
+                libraryPaths[i] = library.GetPath(i);
+            thumbnails.PruneDiskCache(library.GetFolderPath(),
+                                      std::move(libraryPaths));
+        }
+        compare.Update();
+        UpdateMirror(mirror, viewer, uiState);
         uiState.autoFontSizePx = ChooseAutoAppFontSizePx(window);
         CaptureSessionState(uiState, library, setlistManager,
                             selectedSetlistIndex);
@@ -158,7 +524,7 @@ int main(int, char **)
 
         // Render UI panels
         ImGuiViewport *viewport = ImGui::GetMainViewport();
-        RenderLibraryPanel(library, viewer, setlistManager,
+        RenderLibraryPanel(library, thumbnails, viewer, setlistManager,
                            uiState,
                            selectedFileIndex, selectedSetlistIndex,
                            selectedSetlistItemIndex, viewport);
@@ -167,6 +533,11 @@ int main(int, char **)
         RenderViewerPanel(viewer, setlistManager, uiState, viewport);
         RenderSplitters(uiState, io, viewport,
                         setlistManager.IsActive() && uiState.notesVisible);
+        RenderExportWindows(exporter, viewer, setlistManager, uiState);
+        RenderCompareWindow(compare, uiState);
+        RenderRemoteControlStatus(remote, mirror, uiState);
+        RenderImportStatus(importer, uiState);
+        RenderPresenterControls(viewer, presenter, uiState);
         if (uiState.exitRequested)
             glfwSetWindowShouldClose(window, GLFW_TRUE);
 
@@ -189,6 +560,20 @@ int main(int, char **)
         }
 
         glfwSwapBuffers(window);
+        remote.NotifyFramePresented();
+
+        // The performer window samples the textures uploaded above, after
+        // the swap has flushed them.
+        if (uiState.presenterOpen && !presenter.IsOpen() &&
+            !presenter.Open(window))
+            uiState.presenterOpen = false;
+        if (presenter.ShouldClose())
+            uiState.presenterOpen = false;
+        if (!uiState.presenterOpen)
+            presenter.Close();
+        presenter.Render(viewer.GetTexture(), viewer.GetTextureWidth(),
+                         viewer.GetTextureHeight());
+        PublishRemoteState(remote, setlistManager, viewer);
     }
 
     // Auto-save setlists on exit
@@ -202,7 +587,14 @@ int main(int, char **)
     SaveUiSettings(uiState);
 
     // Cleanup
+    remote.Configure(false, uiState.remoteControlPort, false, "");
+    presenter.Close();
+    importer.Cancel();
+    compare.Close();
+    thumbnails.Clear();
     viewer.Close();
+    viewMemory.SaveToFile(ViewMemory::GetDefaultSavePath());
+    uploader.Stop();
     Shutdown(window);
 
     return 0;
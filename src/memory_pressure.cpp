@@ -0,0 +1,331 @@
+#include "memory_pressure.h"
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(__APPLE__)
+#include <dispatch/dispatch.h>
+
+#include <atomic>
+#elif defined(__linux__)
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#endif
+
+#include <cstdio>
+
+namespace
+{
+const auto SAMPLE_INTERVAL = std::chrono::seconds(1);
+
+#if defined(_WIN32)
+// Percent of physical memory in use above which caches start shrinking.
+// The low-memory notification itself only fires once the system is short.
+const DWORD MODERATE_MEMORY_LOAD = 90;
+#elif defined(__linux__)
+// Share of the last ten seconds in which some or all tasks were stalled
+// waiting for memory.
+const double MODERATE_SOME_PERCENT = 10.0;
+const double CRITICAL_SOME_PERCENT = 40.0;
+const double CRITICAL_FULL_PERCENT = 5.0;
+
+// A cgroup limit being hit is a single event, so its level is held for a
+// while instead of lasting one sample.
+const auto EVENT_HOLD = std::chrono::seconds(10);
+
+// Reads "some avg10=" and "full avg10=" from a PSI file.
+bool ReadPressureAverages(const std::string &path, double &some, double &full)
+{
+    std::ifstream in(path);
+    if (!in.is_open())
+        return false;
+
+    some = 0.0;
+    full = 0.0;
+    std::string line;
+    while (std::getline(in, line))
+    {
+        const size_t avg = line.find("avg10=");
+        if (avg == std::string::npos)
+            continue;
+        const double value = std::strtod(line.c_str() + avg + 6, nullptr);
+        if (line.rfind("some", 0) == 0)
+            some = value;
+        else if (line.rfind("full", 0) == 0)
+            full = value;
+    }
+    return true;
+}
+
+// Directory of this process's cgroup v2 hierarchy, or empty.
+std::string FindCgroupDirectory()
+{
+    std::ifstream in("/proc/self/cgroup");
+    std::string line;
+    while (std::getline(in, line))
+    {
+        if (line.rfind("0::", 0) == 0)
+            return "/sys/fs/cgroup" + line.substr(3);
+    }
+    return "";
+}
+
+uint64_t ReadEventCount(const std::string &events, const char *name)
+{
+    std::istringstream in(events);
+    std::string key;
+    uint64_t count = 0;
+    while (in >> key >> count)
+    {
+        if (key == name)
+            return count;
+    }
+    return 0;
+}
+#endif
+} // namespace
+
+#if defined(_WIN32)
+
+struct MemoryPressureMonitor::Platform
+{
+    HANDLE lowMemory = nullptr;
+};
+
+MemoryPressureMonitor::MemoryPressureMonitor() : m_platform(new Platform)
+{
+    m_platform->lowMemory =
+        CreateMemoryResourceNotification(LowMemoryResourceNotification);
+}
+
+MemoryPressureMonitor::~MemoryPressureMonitor()
+{
+    if (m_platform->lowMemory)
+        CloseHandle(m_platform->lowMemory);
+    delete m_platform;
+}
+
+MemoryPressure MemoryPressureMonitor::Sample()
+{
+    BOOL low = FALSE;
+    if (m_platform->lowMemory &&
+        QueryMemoryResourceNotification(m_platform->lowMemory, &low) && low)
+        return MemoryPressure::Critical;
+
+    MEMORYSTATUSEX status = {};
+    status.dwLength = sizeof(status);
+    if (GlobalMemoryStatusEx(&status) &&
+        status.dwMemoryLoad >= MODERATE_MEMORY_LOAD)
+        return MemoryPressure::Moderate;
+    return MemoryPressure::Normal;
+}
+
+#elif defined(__APPLE__)
+
+// Owned by the dispatch source once it is running, and freed by its cancel
+// handler, which runs only after the last event handler has returned.
+struct MemoryPressureMonitor::Platform
+{
+    dispatch_source_t source = nullptr;
+    std::atomic<int> level{static_cast<int>(MemoryPressure::Normal)};
+};
+
+namespace
+{
+// Templates, because the state type is private to the monitor.
+template <typename State>
+void OnMemoryPressureEvent(void *context)
+{
+    State *state = static_cast<State *>(context);
+    const unsigned long flags = dispatch_source_get_data(state->source);
+    MemoryPressure level = MemoryPressure::Normal;
+    if (flags & DISPATCH_MEMORYPRESSURE_CRITICAL)
+        level = MemoryPressure::Critical;
+    else if (flags & DISPATCH_MEMORYPRESSURE_WARN)
+        level = MemoryPressure::Moderate;
+    state->level.store(static_cast<int>(level));
+}
+
+template <typename State>
+void OnMemoryPressureCancel(void *context)
+{
+    delete static_cast<State *>(context);
+}
+} // namespace
+
+MemoryPressureMonitor::MemoryPressureMonitor() : m_platform(new Platform)
+{
+    m_platform->source = dispatch_source_create(
+        DISPATCH_SOURCE_TYPE_MEMORYPRESSURE, 0,
+        DISPATCH_MEMORYPRESSURE_NORMAL | DISPATCH_MEMORYPRESSURE_WARN |
+            DISPATCH_MEMORYPRESSURE_CRITICAL,
+        dispatch_get_global_queue(QOS_CLASS_UTILITY, 0));
+    if (!m_platform->source)
+        return;
+
+    dispatch_set_context(m_platform->source, m_platform);
+    dispatch_source_set_event_handler_f(m_platform->source,
+                                        OnMemoryPressureEvent<Platform>);
+    dispatch_source_set_cancel_handler_f(m_platform->source,
+                                         OnMemoryPressureCancel<Platform>);
+    dispatch_resume(m_platform->source);
+}
+
+MemoryPressureMonitor::~MemoryPressureMonitor()
+{
+    if (!m_platform->source)
+    {
+        delete m_platform;
+        return;
+    }
+
+    dispatch_source_t source = m_platform->source;
+    dispatch_source_cancel(source);
+    dispatch_release(source);
+}
+
+MemoryPressure MemoryPressureMonitor::Sample()
+{
+    return static_cast<MemoryPressure>(m_platform->level.load());
+}
+
+#elif defined(__linux__)
+
+struct MemoryPressureMonitor::Platform
+{
+    // The cgroup's own PSI file when there is one, since a container's
+    // limit is usually reached long before the machine runs short.
+    std::string pressurePath;
+    std::string eventsPath;
+    uint64_t highEvents = 0;
+    uint64_t limitEvents = 0;
+    MemoryPressure heldLevel = MemoryPressure::Normal;
+    std::chrono::steady_clock::time_point holdUntil;
+};
+
+MemoryPressureMonitor::MemoryPressureMonitor() : m_platform(new Platform)
+{
+    const std::string cgroup = FindCgroupDirectory();
+    double some = 0.0;
+    double full = 0.0;
+    if (!cgroup.empty() &&
+        ReadPressureAverages(cgroup + "/memory.pressure", some, full))
+        m_platform->pressurePath = cgroup + "/memory.pressure";
+    else if (ReadPressureAverages("/proc/pressure/memory", some, full))
+        m_platform->pressurePath = "/proc/pressure/memory";
+
+    if (!cgroup.empty() && std::ifstream(cgroup + "/memory.events").is_open())
+        m_platform->eventsPath = cgroup + "/memory.events";
+
+    // Count only limits hit from now on.
+    Sample();
+    m_platform->heldLevel = MemoryPressure::Normal;
+}
+
+MemoryPressureMonitor::~MemoryPressureMonitor() { delete m_platform; }
+
+MemoryPressure MemoryPressureMonitor::Sample()
+{
+    MemoryPressure level = MemoryPressure::Normal;
+    double some = 0.0;
+    double full = 0.0;
+    if (!m_platform->pressurePath.empty() &&
+        ReadPressureAverages(m_platform->pressurePath, some, full))
+    {
+        if (full >= CRITICAL_FULL_PERCENT || some >= CRITICAL_SOME_PERCENT)
+            level = MemoryPressure::Critical;
+        else if (some >= MODERATE_SOME_PERCENT)
+            level = MemoryPressure::Moderate;
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+    if (!m_platform->eventsPath.empty())
+    {
+        std::ifstream in(m_platform->eventsPath);
+        std::stringstream events;
+        events << in.rdbuf();
+
+        // "high" is the soft limit that starts reclaim; "max" and "oom"
+        // mean the hard limit was reached.
+        const uint64_t high = ReadEventCount(events.str(), "high");
+        const uint64_t limit = ReadEventCount(events.str(), "max") +
+                               ReadEventCount(events.str(), "oom");
+        MemoryPressure event = MemoryPressure::Normal;
+        if (limit > m_platform->limitEvents)
+            event = MemoryPressure::Critical;
+        else if (high > m_platform->highEvents)
+            event = MemoryPressure::Moderate;
+        m_platform->highEvents = high;
+        m_platform->limitEvents = limit;
+
+        if (event != MemoryPressure::Normal &&
+            (event >= m_platform->heldLevel || now >= m_platform->holdUntil))
+        {
+            m_platform->heldLevel = event;
+            m_platform->holdUntil = now + EVENT_HOLD;
+        }
+    }
+
+    if (now < m_platform->holdUntil && m_platform->heldLevel > level)
+        level = m_platform->heldLevel;
+    return level;
+}
+
+#else
+
+struct MemoryPressureMonitor::Platform
+{
+};
+
+MemoryPressureMonitor::MemoryPressureMonitor() : m_platform(new Platform) {}
+
+MemoryPressureMonitor::~MemoryPressureMonitor() { delete m_platform; }
+
+MemoryPressure MemoryPressureMonitor::Sample()
+{
+    return MemoryPressure::Normal;
+}
+
+#endif
+
+MemoryPressure MemoryPressureMonitor::Poll()
+{
+#ifndef __APPLE__
+    // Sampling reads files or queries the system; events need no throttle.
+    const auto now = std::chrono::steady_clock::now();
+    if (now < m_nextSample)
+        return m_level;
+    m_nextSample = now + SAMPLE_INTERVAL;
+#endif
+
+    const MemoryPressure level = Sample();
+    if (level != m_level)
+    {
+        printf("[Memory] Pressure changed from %s to %s\n",
+               GetLevelName(m_level), GetLevelName(level));
+        m_level = level;
+    }
+    return m_level;
+}
+
+const char *MemoryPressureMonitor::GetLevelName(MemoryPressure level)
+{
+    switch (level)
+    {
+    case MemoryPressure::Normal:
+        return "normal";
+    case MemoryPressure::Moderate:
+        return "moderate";
+    case MemoryPressure::Critical:
+        return "critical";
+    }
+    return "";
+}
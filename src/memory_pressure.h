@@ -0,0 +1,50 @@
+#pragma once
+
+#include <chrono>
+
+/**
+ * @brief How close the system is to paging the app's memory out.
+ */
+enum class MemoryPressure
+{
+    Normal,
+    Moderate, // Memory is tight; caches should shrink.
+    Critical  // The system is reclaiming memory; keep only what is needed next.
+};
+
+/**
+ * @brief Follows the operating system's memory-pressure signal.
+ *
+ * macOS delivers dispatch memory-pressure events, Windows reports a
+ * low-memory resource notification and the overall memory load, and Linux
+ * exposes pressure stall information (PSI) and, inside a cgroup, counters
+ * of how often its memory limits were hit. Where there is no event to wait
+ * on, the state is sampled about once a second, so Poll() is cheap enough
+ * to call every frame. Platforms without any signal stay at Normal.
+ */
+class MemoryPressureMonitor
+{
+public:
+    MemoryPressureMonitor();
+    ~MemoryPressureMonitor();
+
+    MemoryPressureMonitor(const MemoryPressureMonitor &) = delete;
+    MemoryPressureMonitor &operator=(const MemoryPressureMonitor &) = delete;
+
+    /**
+     * @brief Get the current level. Main thread only.
+     */
+    MemoryPressure Poll();
+
+    static const char *GetLevelName(MemoryPressure level);
+
+private:
+    MemoryPressure Sample();
+
+    // Platform handles and counters, defined in the .cpp per platform.
+    struct Platform;
+    Platform *m_platform = nullptr;
+
+    MemoryPressure m_level = MemoryPressure::Normal;
+    std::chrono::steady_clock::time_point m_nextSample;
+};
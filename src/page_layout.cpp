@@ -0,0 +1,279 @@
+#include "page_layout.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <fpdf_doc.h>
+#include <fpdf_text.h>
+
+#include "pdfium_support.h"
+
+namespace
+{
+// Virtual device size used to map page space onto the unit square. Large
+// enough that integer rounding in FPDF_PageToDevice is invisible.
+const int DEVICE_RESOLUTION = 1 << 16;
+
+// Cells are sized so each holds a handful of items on typical pages.
+const int MAX_GRID_DIMENSION = 64;
+const size_t TARGET_ITEMS_PER_CELL = 4;
+
+int GridCell(float value, int cells)
+{
+    int cell = static_cast<int>(value * static_cast<float>(cells));
+    return (std::clamp)(cell, 0, cells - 1);
+}
+
+NormalizedRect ToNormalized(FPDF_PAGE page,
+                            double left,
+                            double top,
+                            double right,
+                            double bottom)
+{
+    int x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+    FPDF_PageToDevice(page, 0, 0, DEVICE_RESOLUTION, DEVICE_RESOLUTION, 0,
+                      left, top, &x0, &y0);
+    FPDF_PageToDevice(page, 0, 0, DEVICE_RESOLUTION, DEVICE_RESOLUTION, 0,
+                      right, bottom, &x1, &y1);
+
+    // Page rotation can swap corners, so normalize the orientation.
+    const float scale = 1.0f / static_cast<float>(DEVICE_RESOLUTION);
+    NormalizedRect rect;
+    rect.left = static_cast<float>((std::min)(x0, x1)) * scale;
+    rect.right = static_cast<float>((std::max)(x0, x1)) * scale;
+    rect.top = static_cast<float>((std::min)(y0, y1)) * scale;
+    rect.bottom = static_cast<float>((std::max)(y0, y1)) * scale;
+    return rect;
+}
+
+int ResolveLinkTarget(FPDF_DOCUMENT document, FPDF_LINK link, std::string &uri)
+{
+    FPDF_DEST dest = FPDFLink_GetDest(document, link);
+    if (dest)
+        return FPDFDest_GetDestPageIndex(document, dest);
+
+    FPDF_ACTION action = FPDFLink_GetAction(link);
+    if (!action)
+        return -1;
+
+    switch (FPDFAction_GetType(action))
+    {
+    case PDFACTION_GOTO:
+        dest = FPDFAction_GetDest(document, action);
+        return dest ? FPDFDest_GetDestPageIndex(document, dest) : -1;
+    case PDFACTION_URI:
+    {
+        unsigned long length =
+            FPDFAction_GetURIPath(document, action, nullptr, 0);
+        if (length > 1)
+        {
+            std::string buffer(length, '\0');
+            FPDFAction_GetURIPath(document, action, buffer.data(), length);
+            buffer.resize(length - 1);
+            uri = std::move(buffer);
+        }
+        return -1;
+    }
+    default:
+        return -1;
+    }
+}
+} // namespace
+
+void RectColumns::Clear()
+{
+    left.clear();
+    top.clear();
+    right.clear();
+    bottom.clear();
+}
+
+void RectColumns::Resize(size_t count)
+{
+    left.resize(count, 0.0f);
+    top.resize(count, 0.0f);
+    right.resize(count, 0.0f);
+    bottom.resize(count, 0.0f);
+}
+
+void RectColumns::Set(size_t index, const NormalizedRect &rect)
+{
+    left[index] = rect.left;
+    top[index] = rect.top;
+    right[index] = rect.right;
+    bottom[index] = rect.bottom;
+}
+
+void RectColumns::PushBack(const NormalizedRect &rect)
+{
+    left.push_back(rect.left);
+    top.push_back(rect.top);
+    right.push_back(rect.right);
+    bottom.push_back(rect.bottom);
+}
+
+std::string PageTextLayer::ExtractUtf8(size_t first, size_t last) const
+{
+    std::string text;
+    if (codepoints.empty() || first > last)
+        return text;
+
+    last = (std::min)(last, codepoints.size() - 1);
+    text.reserve(last - first + 1);
+    for (size_t i = first; i <= last; i++)
+    {
+        // PDFium separates lines with a generated "\r\n" pair.
+        if (codepoints[i] == '\r')
+            continue;
+        AppendUtf8(text, codepoints[i]);
+    }
+    return text;
+}
+
+void GridIndex::Build(const RectColumns &rects)
+{
+    Clear();
+
+    const size_t targetCells = (std::max)(
+        static_cast<size_t>(1), rects.Size() / TARGET_ITEMS_PER_CELL);
+    const int dimension = (std::clamp)(
+        static_cast<int>(std::ceil(std::sqrt(static_cast<double>(targetCells)))),
+        1, MAX_GRID_DIMENSION);
+    columns = dimension;
+    rows = dimension;
+
+    const size_t cellCount = static_cast<size_t>(columns * rows);
+    cellStart.assign(cellCount + 1, 0);
+
+    // Two passes: count per-cell entries, then scatter item indices.
+    auto forEachCell = [this](const NormalizedRect &rect, auto &&visit) {
+        if (rect.IsEmpty())
+            return;
+        const int c0 = GridCell(rect.left, columns);
+        const int c1 = GridCell(rect.right, columns);
+        const int r0 = GridCell(rect.top, rows);
+        const int r1 = GridCell(rect.bottom, rows);
+        for (int r = r0; r <= r1; r++)
+        {
+            for (int c = c0; c <= c1; c++)
+                visit(static_cast<size_t>(r * columns + c));
+        }
+    };
+
+    for (size_t i = 0; i < rects.Size(); i++)
+        forEachCell(rects.Get(i),
+                    [this](size_t cell) { cellStart[cell + 1]++; });
+
+    for (size_t cell = 0; cell < cellCount; cell++)
+        cellStart[cell + 1] += cellStart[cell];
+
+    items.resize(cellStart[cellCount]);
+    std::vector<uint32_t> cursor(cellStart.begin(), cellStart.end() - 1);
+    for (size_t i = 0; i < rects.Size(); i++)
+    {
+        forEachCell(rects.Get(i), [&](size_t cell) {
+            items[cursor[cell]++] = static_cast<uint32_t>(i);
+        });
+    }
+}
+
+void GridIndex::Clear()
+{
+    columns = 0;
+    rows = 0;
+    cellStart.clear();
+    items.clear();
+}
+
+std::pair<const uint32_t *, const uint32_t *> GridIndex::Query(float x,
+                                                               float y) const
+{
+    if (columns <= 0 || rows <= 0 || x < 0.0f || y < 0.0f || x > 1.0f ||
+        y > 1.0f)
+        return {nullptr, nullptr};
+
+    const size_t cell = static_cast<size_t>(GridCell(y, rows) * columns +
+                                            GridCell(x, columns));
+    const uint32_t *base = items.data();
+    return {base + cellStart[cell], base + cellStart[cell + 1]};
+}
+
+bool PageLayout::Build(FPDF_DOCUMENT document, int pageIndex)
+{
+    m_links.clear();
+    m_linkRects.Clear();
+    m_text.codepoints.clear();
+    m_text.boxes.Clear();
+
+    FPDF_PAGE page = FPDF_LoadPage(document, pageIndex);
+    if (!page)
+        return false;
+
+    int position = 0;
+    FPDF_LINK link = nullptr;
+    while (FPDFLink_Enumerate(page, &position, &link))
+    {
+        FS_RECTF area;
+        if (!FPDFLink_GetAnnotRect(link, &area))
+            continue;
+
+        PageLink pageLink;
+        pageLink.rect =
+            ToNormalized(page, area.left, area.top, area.right, area.bottom);
+        pageLink.targetPage = ResolveLinkTarget(document, link, pageLink.uri);
+        if (pageLink.targetPage < 0 && pageLink.uri.empty())
+            continue;
+
+        m_linkRects.PushBack(pageLink.rect);
+        m_links.push_back(std::move(pageLink));
+    }
+
+    FPDF_TEXTPAGE textPage = FPDFText_LoadPage(page);
+    if (textPage)
+    {
+        const int charCount = (std::max)(0, FPDFText_CountChars(textPage));
+        m_text.codepoints.resize(static_cast<size_t>(charCount));
+        m_text.boxes.Resize(static_cast<size_t>(charCount));
+        for (int i = 0; i < charCount; i++)
+        {
+            const size_t index = static_cast<size_t>(i);
+            m_text.codepoints[index] = FPDFText_GetUnicode(textPage, i);
+
+            // Loose boxes span the full line height, which makes hit
+            // testing forgiving between ascenders and descenders.
+            FS_RECTF box;
+            if (FPDFText_GetLooseCharBox(textPage, i, &box))
+                m_text.boxes.Set(index, ToNormalized(page, box.left, box.top,
+                                                     box.right, box.bottom));
+        }
+        FPDFText_ClosePage(textPage);
+    }
+
+    FPDF_ClosePage(page);
+
+    m_linkGrid.Build(m_linkRects);
+    m_charGrid.Build(m_text.boxes);
+    return true;
+}
+
+int PageLayout::HitTestLink(float x, float y) const
+{
+    auto [begin, end] = m_linkGrid.Query(x, y);
+    for (const uint32_t *it = begin; it != end; ++it)
+    {
+        if (m_linkRects.Contains(*it, x, y))
+            return static_cast<int>(*it);
+    }
+    return -1;
+}
+
+int PageLayout::HitTestChar(float x, float y) const
+{
+    auto [begin, end] = m_charGrid.Query(x, y);
+    for (const uint32_t *it = begin; it != end; ++it)
+    {
+        if (m_text.boxes.Contains(*it, x, y))
+            return static_cast<int>(*it);
+    }
+    return -1;
+}
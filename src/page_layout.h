@@ -0,0 +1,144 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fpdfview.h>
+
+/**
+ * @brief A rectangle in normalized page-image coordinates.
+ *
+ * (0, 0) is the top-left corner of the rendered page and (1, 1) the
+ * bottom-right, so hit tests map directly from the displayed image without
+ * involving PDFium.
+ */
+struct NormalizedRect
+{
+    float left = 0.0f;
+    float top = 0.0f;
+    float right = 0.0f;
+    float bottom = 0.0f;
+
+    bool IsEmpty() const { return right <= left || bottom <= top; }
+    bool Contains(float x, float y) const
+    {
+        return x >= left && x <= right && y >= top && y <= bottom;
+    }
+};
+
+/**
+ * @brief A link annotation on a page.
+ */
+struct PageLink
+{
+    NormalizedRect rect;
+    int targetPage = -1; // In-document destination, or -1
+    std::string uri;     // External target, if any
+};
+
+/**
+ * @brief Rectangles stored column-wise so scans touch contiguous floats.
+ */
+struct RectColumns
+{
+    std::vector<float> left;
+    std::vector<float> top;
+    std::vector<float> right;
+    std::vector<float> bottom;
+
+    size_t Size() const { return left.size(); }
+    void Clear();
+    void Resize(size_t count);
+    void Set(size_t index, const NormalizedRect &rect);
+    void PushBack(const NormalizedRect &rect);
+    NormalizedRect Get(size_t index) const
+    {
+        return {left[index], top[index], right[index], bottom[index]};
+    }
+    bool Contains(size_t index, float x, float y) const
+    {
+        return x >= left[index] && x <= right[index] && y >= top[index] &&
+               y <= bottom[index];
+    }
+};
+
+/**
+ * @brief Characters of a page in extraction order: Unicode code points and
+ *        their boxes, stored as parallel arrays.
+ */
+struct PageTextLayer
+{
+    std::vector<uint32_t> codepoints;
+    RectColumns boxes;
+
+    size_t Size() const { return codepoints.size(); }
+
+    /**
+     * @brief Encode the characters in [first, last] as UTF-8.
+     * Line breaks generated by PDFium are normalized to '\n'.
+     */
+    std::string ExtractUtf8(size_t first, size_t last) const;
+};
+
+/**
+ * @brief Uniform grid over the unit square mapping cells to item indices.
+ *
+ * Items are stored in compressed rows: cellStart[c]..cellStart[c + 1]
+ * indexes into items for cell c.
+ */
+struct GridIndex
+{
+    int columns = 0;
+    int rows = 0;
+    std::vector<uint32_t> cellStart;
+    std::vector<uint32_t> items;
+
+    void Build(const RectColumns &rects);
+    void Clear();
+
+    /**
+     * @brief Get the [begin, end) range of items for the cell containing
+     *        a point, or an empty range outside the grid.
+     */
+    std::pair<const uint32_t *, const uint32_t *> Query(float x,
+                                                        float y) const;
+};
+
+/**
+ * @brief Per-page geometry and text extracted once so hover, click and
+ *        selection need neither PDFium calls nor a live FPDF_PAGE.
+ */
+class PageLayout
+{
+public:
+    /**
+     * @brief Extract links and the text layer from a page.
+     * Caller must hold PdfiumMutex().
+     */
+    bool Build(FPDF_DOCUMENT document, int pageIndex);
+
+    const std::vector<PageLink> &GetLinks() const { return m_links; }
+    const PageTextLayer &GetText() const { return m_text; }
+
+    /**
+     * @brief Find the link under a point.
+     * @return Index into GetLinks(), or -1.
+     */
+    int HitTestLink(float x, float y) const;
+
+    /**
+     * @brief Find the character whose box contains a point.
+     * @return Character index, or -1.
+     */
+    int HitTestChar(float x, float y) const;
+
+private:
+    std::vector<PageLink> m_links;
+    RectColumns m_linkRects;
+    GridIndex m_linkGrid;
+
+    PageTextLayer m_text;
+    GridIndex m_charGrid;
+};
@@ -0,0 +1,196 @@
+#include "page_mirror.h"
+
+#include "png_encoder.h"
+
+#include <algorithm>
+#include <chrono>
+
+PageMirror::PageMirror() : m_worker(1) {}
+
+PageMirror::~PageMirror() { m_worker.CancelPending(); }
+
+void PageMirror::SetEnabled(bool enabled)
+{
+    if (enabled == m_enabled)
+        return;
+
+    m_enabled = enabled;
+    if (!enabled)
+    {
+        // Followers reconnecting later should not see stale pages.
+        m_worker.CancelPending();
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_encoded.clear();
+        m_pending.clear();
+    }
+}
+
+void PageMirror::SetCurrentPage(uint64_t documentId,
+                                const std::string &title,
+                                int page,
+                                int pageCount)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (documentId == m_state.documentId && page == m_state.page &&
+            pageCount == m_state.pageCount && title == m_state.title)
+            return;
+
+        m_state.documentId = documentId;
+        m_state.title = title;
+        m_state.page = page;
+        m_state.pageCount = pageCount;
+        m_state.sequence++;
+    }
+    Notify();
+}
+
+bool PageMirror::NeedsPage(uint64_t documentId, int page) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (FindEncoded(documentId, page))
+        return false;
+    return std::find(m_pending.begin(), m_pending.end(),
+                     std::make_pair(documentId, page)) == m_pending.end();
+}
+
+void PageMirror::OfferPage(uint64_t documentId,
+                           int page,
+                           std::shared_ptr<const PageBitmap> bitmap)
+{
+    if (!m_enabled || !bitmap || !bitmap->IsValid())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pending.emplace_back(documentId, page);
+    }
+
+    m_worker.Post([this, documentId, page, bitmap]() {
+        {
+            // The leader may have moved on while this waited in the queue.
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!IsRelevant(documentId, page))
+            {
+                m_pending.erase(std::remove(m_pending.begin(), m_pending.end(),
+                                            std::make_pair(documentId, page)),
+                                m_pending.end());
+                return;
+            }
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        auto png = std::make_shared<std::string>();
+        bool encoded = EncodePng(bitmap->pixels.data(), bitmap->width,
+                                 bitmap->height, *png);
+        const double ms = std::chrono::duration<double, std::milli>(
+                              std::chrono::steady_clock::now() - start)
+                              .count();
+
+        bool visible = false;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_pending.erase(std::remove(m_pending.begin(), m_pending.end(),
+                                        std::make_pair(documentId, page)),
+                            m_pending.end());
+            if (!encoded || !m_enabled)
+                return;
+
+            m_encodeStats.samples++;
+            m_encodeStats.lastMs = ms;
+            m_encodeStats.averageMs +=
+                (ms - m_encodeStats.averageMs) /
+                static_cast<double>(m_encodeStats.samples);
+            m_encodeStats.maxMs = (std::max)(m_encodeStats.maxMs, ms);
+
+            m_encoded.push_back({documentId, page, std::move(png)});
+            if (m_encoded.size() > ENCODED_CACHE_CAPACITY)
+            {
+                // Evict the page furthest from what followers will ask for.
+                auto distance = [this](const EncodedPage &entry) {
+                    if (entry.documentId != m_state.documentId)
+                        return 1 << 30;
+                    int offset = entry.page - m_state.page;
+                    return offset >= 0 ? offset : -offset * 2;
+                };
+                auto victim = std::max_element(
+                    m_encoded.begin(), m_encoded.end(),
+                    [&](const EncodedPage &a, const EncodedPage &b) {
+                        return distance(a) < distance(b);
+                    });
+                m_encoded.erase(victim);
+            }
+
+            visible = IsRelevant(documentId, page);
+            if (visible)
+                m_state.sequence++;
+        }
+
+        if (visible)
+            Notify();
+    });
+}
+
+void PageMirror::ReleaseStalePages()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_encoded.erase(std::remove_if(m_encoded.begin(), m_encoded.end(),
+                                   [this](const EncodedPage &entry) {
+                                       return !IsRelevant(entry.documentId,
+                                                          entry.page);
+                                   }),
+                    m_encoded.end());
+}
+
+MirrorState PageMirror::GetState() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    MirrorState state = m_state;
+    state.pageReady = FindEncoded(state.documentId, state.page) != nullptr;
+    for (int offset = 1; offset <= UPCOMING_PAGES; offset++)
+    {
+        int page = state.page + offset;
+        if (page < state.pageCount && FindEncoded(state.documentId, page))
+            state.readyUpcoming.push_back(page);
+    }
+    return state;
+}
+
+std::shared_ptr<const std::string>
+PageMirror::GetEncodedPage(uint64_t documentId, int page) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const EncodedPage *entry = FindEncoded(documentId, page);
+    return entry ? entry->png : nullptr;
+}
+
+MirrorEncodeStats PageMirror::GetEncodeStats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_encodeStats;
+}
+
+// Caller holds m_mutex.
+bool PageMirror::IsRelevant(uint64_t documentId, int page) const
+{
+    return documentId == m_state.documentId && page >= m_state.page &&
+           page <= m_state.page + UPCOMING_PAGES;
+}
+
+// Caller holds m_mutex.
+const PageMirror::EncodedPage *PageMirror::FindEncoded(uint64_t documentId,
+                                                       int page) const
+{
+    for (const EncodedPage &entry : m_encoded)
+    {
+        if (entry.documentId == documentId && entry.page == page)
+            return &entry;
+    }
+    return nullptr;
+}
+
+void PageMirror::Notify()
+{
+    if (m_onChange)
+        m_onChange();
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "background_worker.h"
+#include "pdfium_support.h"
+
+/**
+ * @brief The leader's position as seen by follower devices.
+ */
+struct MirrorState
+{
+    // Increases whenever followers should refresh.
+    uint64_t sequence = 0;
+    uint64_t documentId = 0;
+    std::string title;
+    int page = 0;
+    int pageCount = 0;
+    bool pageReady = false;
+    // Pages after the current one whose images are already encoded.
+    std::vector<int> readyUpcoming;
+};
+
+/**
+ * @brief Time spent encoding pages for followers.
+ */
+struct MirrorEncodeStats
+{
+    uint64_t samples = 0;
+    double lastMs = 0.0;
+    double averageMs = 0.0;
+    double maxMs = 0.0;
+};
+
+/**
+ * @brief Encodes the current and upcoming pages once for every follower.
+ *
+ * The main thread reports the displayed page and hands over bitmaps that
+ * are already in the viewer's page cache; a background thread encodes each
+ * to PNG once. The server only ever sends these cached encodings, so the
+ * number of followers never adds rendering or encoding work.
+ */
+class PageMirror
+{
+public:
+    PageMirror();
+    ~PageMirror();
+
+    PageMirror(const PageMirror &) = delete;
+    PageMirror &operator=(const PageMirror &) = delete;
+
+    /**
+     * @brief Set a function to call whenever the state changes.
+     * It may be called from any thread. Set it before enabling the mirror.
+     */
+    void SetChangeCallback(std::function<void()> callback)
+    {
+        m_onChange = std::move(callback);
+    }
+
+    // --- Main thread ---
+
+    void SetEnabled(bool enabled);
+    bool IsEnabled() const { return m_enabled; }
+
+    /**
+     * @brief Report the page the leader is showing.
+     * @param documentId Identifier that changes whenever a new document
+     *        is loaded.
+     */
+    void SetCurrentPage(uint64_t documentId,
+                        const std::string &title,
+                        int page,
+                        int pageCount);
+
+    /**
+     * @brief Whether a page has neither been encoded nor queued.
+     */
+    bool NeedsPage(uint64_t documentId, int page) const;
+
+    /**
+     * @brief Queue a rendered page for encoding.
+     */
+    void OfferPage(uint64_t documentId,
+                   int page,
+                   std::shared_ptr<const PageBitmap> bitmap);
+
+    /**
+     * @brief Drop encodings of pages other than the current and upcoming
+     *        ones, to give memory back under pressure.
+     */
+    void ReleaseStalePages();
+
+    // --- Any thread ---
+
+    MirrorState GetState() const;
+
+    /**
+     * @brief Get an encoded page, or nullptr if it is not cached.
+     */
+    std::shared_ptr<const std::string> GetEncodedPage(uint64_t documentId,
+                                                      int page) const;
+
+    MirrorEncodeStats GetEncodeStats() const;
+
+    // Pages after the current one that followers preload.
+    static constexpr int UPCOMING_PAGES = 2;
+
+private:
+    struct EncodedPage
+    {
+        uint64_t documentId = 0;
+        int page = 0;
+        std::shared_ptr<const std::string> png;
+    };
+
+    bool IsRelevant(uint64_t documentId, int page) const;
+    const EncodedPage *FindEncoded(uint64_t documentId, int page) const;
+    void Notify();
+
+    std::atomic<bool> m_enabled{false};
+    std::function<void()> m_onChange;
+
+    mutable std::mutex m_mutex;
+    MirrorState m_state;
+    std::vector<EncodedPage> m_encoded;
+    std::vector<std::pair<uint64_t, int>> m_pending;
+    MirrorEncodeStats m_encodeStats;
+
+    static constexpr size_t ENCODED_CACHE_CAPACITY = 8;
+
+    BackgroundWorker m_worker;
+};
@@ -0,0 +1,224 @@
+#include "path_interner.h"
+
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+size_t FindNameStart(std::string_view fullPath)
+{
+#ifdef _WIN32
+    const size_t separator = fullPath.find_last_of("/\\");
+#else
+    const size_t separator = fullPath.find_last_of('/');
+#endif
+    return separator == std::string_view::npos ? 0 : separator + 1;
+}
+} // namespace
+
+PathInterner &PathInterner::Shared()
+{
+    static PathInterner interner;
+    return interner;
+}
+
+PathInterner::PathInterner()
+    : m_pathChunks(new std::unique_ptr<PathRecord[]>[MAX_RECORD_CHUNKS]),
+      m_directoryChunks(
+          new std::unique_ptr<DirectoryRecord[]>[MAX_RECORD_CHUNKS]),
+      m_arenaBlocks(new std::unique_ptr<char[]>[MAX_ARENA_BLOCKS])
+{
+}
+
+PathInterner::~PathInterner() = default;
+
+PathId PathInterner::Intern(std::string_view fullPath)
+{
+    if (fullPath.empty())
+        return INVALID_PATH_ID;
+
+    const size_t nameStart = FindNameStart(fullPath);
+    const std::string_view directory = fullPath.substr(0, nameStart);
+    const std::string_view name = fullPath.substr(nameStart);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    uint32_t directoryIndex = 0;
+    auto directoryIt = m_directoryLookup.find(directory);
+    if (directoryIt != m_directoryLookup.end())
+    {
+        directoryIndex = directoryIt->second;
+    }
+    else
+    {
+        if (m_directoryCount >= RECORD_CHUNK * MAX_RECORD_CHUNKS)
+            return INVALID_PATH_ID;
+
+        DirectoryRecord record;
+        if (!StoreString(directory, record.offset))
+            return INVALID_PATH_ID;
+        record.length = static_cast<uint32_t>(directory.size());
+
+        const size_t chunk = m_directoryCount / RECORD_CHUNK;
+        if (!m_directoryChunks[chunk])
+            m_directoryChunks[chunk].reset(new DirectoryRecord[RECORD_CHUNK]);
+        m_directoryChunks[chunk][m_directoryCount % RECORD_CHUNK] = record;
+
+        directoryIndex = m_directoryCount++;
+        m_directoryLookup.emplace(
+            std::string_view(ArenaAt(record.offset), record.length),
+            directoryIndex);
+    }
+
+    auto pathIt = m_pathLookup.find({directoryIndex, name});
+    if (pathIt != m_pathLookup.end())
+        return pathIt->second;
+
+    const uint32_t count = m_pathCount.load(std::memory_order_relaxed);
+    if (count >= RECORD_CHUNK * MAX_RECORD_CHUNKS - 1)
+        return INVALID_PATH_ID;
+
+    PathRecord record;
+    record.directory = directoryIndex;
+    if (!StoreString(name, record.nameOffset))
+        return INVALID_PATH_ID;
+    record.nameLength = static_cast<uint32_t>(name.size());
+
+    const size_t chunk = count / RECORD_CHUNK;
+    if (!m_pathChunks[chunk])
+        m_pathChunks[chunk].reset(new PathRecord[RECORD_CHUNK]);
+    m_pathChunks[chunk][count % RECORD_CHUNK] = record;
+
+    // Ids start at 1 so that a value-initialized PathId means "no path".
+    const PathId id = count + 1;
+    m_pathCount.store(count + 1, std::memory_order_release);
+    m_pathLookup.emplace(
+        NameKey{directoryIndex,
+                std::string_view(ArenaAt(record.nameOffset),
+                                 record.nameLength)},
+        id);
+    return id;
+}
+
+PathId PathInterner::Find(std::string_view fullPath) const
+{
+    if (fullPath.empty())
+        return INVALID_PATH_ID;
+
+    const size_t nameStart = FindNameStart(fullPath);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto directoryIt = m_directoryLookup.find(fullPath.substr(0, nameStart));
+    if (directoryIt == m_directoryLookup.end())
+        return INVALID_PATH_ID;
+
+    auto pathIt = m_pathLookup.find(
+        {directoryIt->second, fullPath.substr(nameStart)});
+    return pathIt != m_pathLookup.end() ? pathIt->second : INVALID_PATH_ID;
+}
+
+std::string PathInterner::GetPath(PathId id) const
+{
+    if (id == INVALID_PATH_ID)
+        return std::string();
+
+    const PathRecord &record = Record(id);
+    const DirectoryRecord &directory = Directory(record.directory);
+    std::string path;
+    path.reserve(directory.length + record.nameLength);
+    path.append(ArenaAt(directory.offset), directory.length);
+    path.append(ArenaAt(record.nameOffset), record.nameLength);
+    return path;
+}
+
+const char *PathInterner::GetName(PathId id) const
+{
+    if (id == INVALID_PATH_ID)
+        return "";
+    return ArenaAt(Record(id).nameOffset);
+}
+
+size_t PathInterner::GetNameLength(PathId id) const
+{
+    return id == INVALID_PATH_ID ? 0 : Record(id).nameLength;
+}
+
+const char *PathInterner::GetDirectory(PathId id) const
+{
+    if (id == INVALID_PATH_ID)
+        return "";
+    return ArenaAt(Directory(Record(id).directory).offset);
+}
+
+uint32_t PathInterner::GetDirectoryIndex(PathId id) const
+{
+    return id == INVALID_PATH_ID ? 0 : Record(id).directory;
+}
+
+size_t PathInterner::GetPathCount() const
+{
+    return m_pathCount.load(std::memory_order_acquire);
+}
+
+size_t PathInterner::GetMemoryUsage() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const size_t pathChunks =
+        (GetPathCount() + RECORD_CHUNK - 1) / RECORD_CHUNK;
+    const size_t directoryChunks =
+        (m_directoryCount + RECORD_CHUNK - 1) / RECORD_CHUNK;
+    return static_cast<size_t>(m_arenaBlockCount) * ARENA_BLOCK +
+           pathChunks * RECORD_CHUNK * sizeof(PathRecord) +
+           directoryChunks * RECORD_CHUNK * sizeof(DirectoryRecord);
+}
+
+// Caller holds m_mutex.
+bool PathInterner::StoreString(std::string_view text, uint32_t &offset)
+{
+    const size_t needed = text.size() + 1;
+    if (needed > ARENA_BLOCK)
+    {
+        printf("[PathInterner] Path component too long (%zu bytes)\n",
+               text.size());
+        return false;
+    }
+
+    // Strings never straddle blocks, so each stays contiguous.
+    if (m_arenaBlockCount == 0 || m_arenaUsed + needed > ARENA_BLOCK)
+    {
+        if (m_arenaBlockCount >= MAX_ARENA_BLOCKS)
+        {
+            printf("[PathInterner] Path table is full\n");
+            return false;
+        }
+        m_arenaBlocks[m_arenaBlockCount].reset(new char[ARENA_BLOCK]);
+        m_arenaBlockCount++;
+        m_arenaUsed = 0;
+    }
+
+    char *dest = m_arenaBlocks[m_arenaBlockCount - 1].get() + m_arenaUsed;
+    if (!text.empty())
+        memcpy(dest, text.data(), text.size());
+    dest[text.size()] = '\0';
+
+    offset = ((m_arenaBlockCount - 1) << ARENA_BLOCK_BITS) | m_arenaUsed;
+    m_arenaUsed += static_cast<uint32_t>(needed);
+    return true;
+}
+
+const char *PathInterner::ArenaAt(uint32_t offset) const
+{
+    return m_arenaBlocks[offset >> ARENA_BLOCK_BITS].get() +
+           (offset & (ARENA_BLOCK - 1));
+}
+
+const PathInterner::PathRecord &PathInterner::Record(PathId id) const
+{
+    const size_t index = id - 1;
+    return m_pathChunks[index / RECORD_CHUNK][index % RECORD_CHUNK];
+}
+
+const PathInterner::DirectoryRecord &
+PathInterner::Directory(uint32_t index) const
+{
+    return m_directoryChunks[index / RECORD_CHUNK][index % RECORD_CHUNK];
+}
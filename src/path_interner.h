@@ -0,0 +1,146 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+/**
+ * @brief Handle to an interned file path. Equal paths get equal ids, so
+ *        comparing two paths is an integer compare.
+ */
+using PathId = uint32_t;
+
+constexpr PathId INVALID_PATH_ID = 0;
+
+/**
+ * @brief Process-wide table of file paths, stored once each.
+ *
+ * A path is split at its last separator into a directory, kept once in a
+ * directory table, and a file name. Both live NUL-terminated in an
+ * append-only string arena, so a path costs its name bytes plus a 12-byte
+ * record no matter how many library entries or setlist items refer to it.
+ *
+ * Intern() may be called from any thread. Storage never moves, so the
+ * accessors take no lock and the pointers they return stay valid for the
+ * life of the process; an id must reach the reading thread through the
+ * usual synchronization (a queue, a mutex, a thread start).
+ */
+class PathInterner
+{
+public:
+    /**
+     * @brief The table shared by the library, setlists and persistence.
+     */
+    static PathInterner &Shared();
+
+    PathInterner();
+    ~PathInterner();
+
+    PathInterner(const PathInterner &) = delete;
+    PathInterner &operator=(const PathInterner &) = delete;
+
+    /**
+     * @brief Get the id for a path, adding it if it is new.
+     * @return INVALID_PATH_ID for an empty path or when the table is full.
+     */
+    PathId Intern(std::string_view fullPath);
+
+    /**
+     * @brief Get the id for a path without adding it.
+     * @return INVALID_PATH_ID if the path has never been interned.
+     */
+    PathId Find(std::string_view fullPath) const;
+
+    /**
+     * @brief Rebuild the full path, exactly as it was interned.
+     */
+    std::string GetPath(PathId id) const;
+
+    /**
+     * @brief The file name component (everything after the last separator).
+     */
+    const char *GetName(PathId id) const;
+    size_t GetNameLength(PathId id) const;
+
+    /**
+     * @brief The directory component, including its trailing separator.
+     */
+    const char *GetDirectory(PathId id) const;
+
+    /**
+     * @brief Index of the path's directory; paths in the same folder share it.
+     */
+    uint32_t GetDirectoryIndex(PathId id) const;
+
+    size_t GetPathCount() const;
+
+    /**
+     * @brief Bytes held by the arena and record tables.
+     */
+    size_t GetMemoryUsage() const;
+
+private:
+    struct PathRecord
+    {
+        uint32_t directory = 0;
+        uint32_t nameOffset = 0;
+        uint32_t nameLength = 0;
+    };
+
+    struct DirectoryRecord
+    {
+        uint32_t offset = 0;
+        uint32_t length = 0;
+    };
+
+    struct NameKey
+    {
+        uint32_t directory;
+        std::string_view name;
+
+        bool operator==(const NameKey &other) const
+        {
+            return directory == other.directory && name == other.name;
+        }
+    };
+
+    struct NameKeyHash
+    {
+        size_t operator()(const NameKey &key) const
+        {
+            return std::hash<std::string_view>()(key.name) ^
+                   (static_cast<size_t>(key.directory) * 0x9E3779B97F4A7C15ull);
+        }
+    };
+
+    // Caller holds m_mutex.
+    bool StoreString(std::string_view text, uint32_t &offset);
+    const char *ArenaAt(uint32_t offset) const;
+    const PathRecord &Record(PathId id) const;
+    const DirectoryRecord &Directory(uint32_t index) const;
+
+    // Records live in fixed-size chunks that are never reallocated, which
+    // is what lets readers skip the lock.
+    static constexpr size_t RECORD_CHUNK = 4096;
+    static constexpr size_t MAX_RECORD_CHUNKS = 4096;
+    static constexpr uint32_t ARENA_BLOCK_BITS = 20;
+    static constexpr size_t ARENA_BLOCK = size_t(1) << ARENA_BLOCK_BITS;
+    static constexpr size_t MAX_ARENA_BLOCKS = 4096;
+
+    mutable std::mutex m_mutex;
+    std::unique_ptr<std::unique_ptr<PathRecord[]>[]> m_pathChunks;
+    std::unique_ptr<std::unique_ptr<DirectoryRecord[]>[]> m_directoryChunks;
+    std::unique_ptr<std::unique_ptr<char[]>[]> m_arenaBlocks;
+    std::atomic<uint32_t> m_pathCount{0};
+    uint32_t m_directoryCount = 0;
+    uint32_t m_arenaBlockCount = 0;
+    uint32_t m_arenaUsed = 0; // bytes used in the last block
+
+    std::unordered_map<std::string_view, uint32_t> m_directoryLookup;
+    std::unordered_map<NameKey, PathId, NameKeyHash> m_pathLookup;
+};
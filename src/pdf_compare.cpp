@@ -0,0 +1,410 @@
+#include "pdf_compare.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <utility>
+
+#include "pixel_kernels.h"
+
+#ifndef GL_CLAMP_TO_EDGE
+#define GL_CLAMP_TO_EDGE 0x812F
+#endif
+
+namespace
+{
+// Per-channel tolerance that absorbs anti-aliasing differences between
+// otherwise identical renders.
+const uint8_t DIFF_CHANNEL_THRESHOLD = 40;
+
+// Changed pixels are bucketed into square cells before clustering. At the
+// compare scale a cell is roughly 8 PDF points, about one notehead.
+const int CLUSTER_CELL_SIZE = 12;
+const int MIN_CHANGED_PIXELS_PER_CELL = 3;
+
+// Cells this far apart still join one region, so a changed chord or
+// lyric reads as one highlight instead of a scatter of boxes.
+const int CLUSTER_JOIN_DISTANCE = 2;
+
+std::vector<DiffRegion> ClusterDiffRegions(const std::vector<uint8_t> &mask,
+                                           int width,
+                                           int height)
+{
+    const int columns = (width + CLUSTER_CELL_SIZE - 1) / CLUSTER_CELL_SIZE;
+    const int rows = (height + CLUSTER_CELL_SIZE - 1) / CLUSTER_CELL_SIZE;
+    std::vector<uint32_t> cellCounts(static_cast<size_t>(columns * rows), 0);
+
+    for (int y = 0; y < height; y++)
+    {
+        const uint8_t *row = mask.data() + static_cast<size_t>(y) * width;
+        uint32_t *cellRow =
+            cellCounts.data() +
+            static_cast<size_t>(y / CLUSTER_CELL_SIZE) * columns;
+        for (int x = 0; x < width; x++)
+            cellRow[x / CLUSTER_CELL_SIZE] += row[x] ? 1 : 0;
+    }
+
+    std::vector<int> label(cellCounts.size(), -1);
+    std::vector<DiffRegion> regions;
+    std::vector<int> stack;
+
+    for (int start = 0; start < columns * rows; start++)
+    {
+        if (label[static_cast<size_t>(start)] >= 0 ||
+            cellCounts[static_cast<size_t>(start)] <
+                static_cast<uint32_t>(MIN_CHANGED_PIXELS_PER_CELL))
+            continue;
+
+        const int regionIndex = static_cast<int>(regions.size());
+        int minColumn = columns, maxColumn = -1, minRow = rows, maxRow = -1;
+        size_t pixels = 0;
+
+        stack.assign(1, start);
+        label[static_cast<size_t>(start)] = regionIndex;
+        while (!stack.empty())
+        {
+            const int cell = stack.back();
+            stack.pop_back();
+            const int cx = cell % columns;
+            const int cy = cell / columns;
+            minColumn = (std::min)(minColumn, cx);
+            maxColumn = (std::max)(maxColumn, cx);
+            minRow = (std::min)(minRow, cy);
+            maxRow = (std::max)(maxRow, cy);
+            pixels += cellCounts[static_cast<size_t>(cell)];
+
+            for (int ny = (std::max)(0, cy - CLUSTER_JOIN_DISTANCE);
+                 ny <= (std::min)(rows - 1, cy + CLUSTER_JOIN_DISTANCE); ny++)
+            {
+                for (int nx = (std::max)(0, cx - CLUSTER_JOIN_DISTANCE);
+                     nx <= (std::min)(columns - 1, cx + CLUSTER_JOIN_DISTANCE);
+                     nx++)
+                {
+                    const size_t neighbor =
+                        static_cast<size_t>(ny * columns + nx);
+                    if (label[neighbor] >= 0 ||
+                        cellCounts[neighbor] <
+                            static_cast<uint32_t>(MIN_CHANGED_PIXELS_PER_CELL))
+                        continue;
+                    label[neighbor] = regionIndex;
+                    stack.push_back(static_cast<int>(neighbor));
+                }
+            }
+        }
+
+        DiffRegion region;
+        region.changedPixels = pixels;
+        region.rect.left = static_cast<float>(minColumn * CLUSTER_CELL_SIZE) /
+                           static_cast<float>(width);
+        region.rect.top = static_cast<float>(minRow * CLUSTER_CELL_SIZE) /
+                          static_cast<float>(height);
+        region.rect.right =
+            (std::min)(1.0f, static_cast<float>((maxColumn + 1) *
+                                                CLUSTER_CELL_SIZE) /
+                                 static_cast<float>(width));
+        region.rect.bottom =
+            (std::min)(1.0f, static_cast<float>((maxRow + 1) *
+                                                CLUSTER_CELL_SIZE) /
+                                 static_cast<float>(height));
+        regions.push_back(region);
+    }
+
+    // Present regions in reading order.
+    std::sort(regions.begin(), regions.end(),
+              [](const DiffRegion &left, const DiffRegion &right) {
+                  if (left.rect.top != right.rect.top)
+                      return left.rect.top < right.rect.top;
+                  return left.rect.left < right.rect.left;
+              });
+    return regions;
+}
+
+PageDiff DiffPages(const PageBitmap *a, const PageBitmap *b)
+{
+    PageDiff diff;
+    diff.scanned = true;
+
+    if (!a && !b)
+        return diff;
+
+    if (!a || !b || a->width != b->width || a->height != b->height)
+    {
+        diff.changed = true;
+        diff.layoutChanged = true;
+        DiffRegion whole;
+        whole.rect = {0.0f, 0.0f, 1.0f, 1.0f};
+        diff.regions.push_back(whole);
+        return diff;
+    }
+
+    const size_t pixelCount =
+        static_cast<size_t>(a->width) * static_cast<size_t>(a->height);
+    std::vector<uint8_t> mask(pixelCount);
+    diff.changedPixels =
+        ComputeDiffMask(a->pixels.data(), b->pixels.data(), pixelCount,
+                        DIFF_CHANNEL_THRESHOLD, mask.data());
+    if (diff.changedPixels > 0)
+        diff.regions = ClusterDiffRegions(mask, a->width, a->height);
+    diff.changed = !diff.regions.empty();
+    return diff;
+}
+
+bool LoadDocument(const std::string &path,
+                  std::vector<unsigned char> &data,
+                  FPDF_DOCUMENT &document,
+                  int &pageCount)
+{
+    if (!ReadPdfFile(path, data))
+        return false;
+
+    std::lock_guard<std::mutex> lock(PdfiumMutex());
+    document = FPDF_LoadMemDocument(data.data(), static_cast<int>(data.size()),
+                                    nullptr);
+    if (!document)
+    {
+        printf("[PdfCompare] Failed to load PDF: error code %lu\n",
+               FPDF_GetLastError());
+        return false;
+    }
+
+    pageCount = FPDF_GetPageCount(document);
+    return true;
+}
+
+std::string FilenameOf(const std::string &path)
+{
+    size_t lastSlash = path.find_last_of("/\\");
+    return lastSlash != std::string::npos ? path.substr(lastSlash + 1) : path;
+}
+
+void UploadTexture(GLuint &texture, const PageBitmap &bitmap)
+{
+    if (texture == 0)
+        glGenTextures(1, &texture);
+
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, bitmap.width, bitmap.height, 0,
+                 GL_RGBA, GL_UNSIGNED_BYTE, bitmap.pixels.data());
+}
+} // namespace
+
+PdfCompare::PdfCompare() : m_worker(WORKER_THREADS) {}
+
+PdfCompare::~PdfCompare() { Close(); }
+
+bool PdfCompare::Open(const std::string &pathA, const std::string &pathB)
+{
+    std::vector<unsigned char> dataA;
+    std::vector<unsigned char> dataB;
+    FPDF_DOCUMENT documentA = nullptr;
+    FPDF_DOCUMENT documentB = nullptr;
+    int pageCountA = 0;
+    int pageCountB = 0;
+
+    if (!LoadDocument(pathA, dataA, documentA, pageCountA))
+        return false;
+    if (!LoadDocument(pathB, dataB, documentB, pageCountB))
+    {
+        std::lock_guard<std::mutex> lock(PdfiumMutex());
+        FPDF_CloseDocument(documentA);
+        return false;
+    }
+
+    Close();
+    m_dataA = std::move(dataA);
+    m_dataB = std::move(dataB);
+    m_pageCountA = (std::max)(0, pageCountA);
+    m_pageCountB = (std::max)(0, pageCountB);
+    m_pageCount = (std::max)(m_pageCountA, m_pageCountB);
+    m_filenameA = FilenameOf(pathA);
+    m_filenameB = FilenameOf(pathB);
+
+    uint64_t generation = 0;
+    {
+        std::lock_guard<std::mutex> lock(PdfiumMutex());
+        m_documentA = documentA;
+        m_documentB = documentB;
+        std::lock_guard<std::mutex> resultLock(m_mutex);
+        m_diffs.assign(static_cast<size_t>(m_pageCount), PageDiff());
+        m_scannedCount = 0;
+        m_changedCount = 0;
+        m_displayPage = 0;
+        generation = m_generation;
+    }
+
+    for (int page = 0; page < m_pageCount; page++)
+        m_worker.Post([this, page, generation]() { ScanPage(page, generation); });
+    return true;
+}
+
+void PdfCompare::Close()
+{
+    m_worker.CancelPending();
+    {
+        std::lock_guard<std::mutex> lock(PdfiumMutex());
+        std::lock_guard<std::mutex> resultLock(m_mutex);
+        m_generation++;
+        if (m_documentA)
+            FPDF_CloseDocument(m_documentA);
+        if (m_documentB)
+            FPDF_CloseDocument(m_documentB);
+        m_documentA = nullptr;
+        m_documentB = nullptr;
+        m_diffs.clear();
+        m_scannedCount = 0;
+        m_changedCount = 0;
+        m_displayPage = 0;
+        m_pendingImageA.reset();
+        m_pendingImageB.reset();
+        m_displayDirty = false;
+    }
+
+    CleanupTextures();
+    m_dataA.clear();
+    m_dataB.clear();
+    m_pageCountA = 0;
+    m_pageCountB = 0;
+    m_pageCount = 0;
+    m_filenameA.clear();
+    m_filenameB.clear();
+}
+
+int PdfCompare::GetScannedPageCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_scannedCount;
+}
+
+int PdfCompare::GetChangedPageCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_changedCount;
+}
+
+PageDiff PdfCompare::GetPageDiff(int page) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (page < 0 || page >= static_cast<int>(m_diffs.size()))
+        return PageDiff();
+    return m_diffs[static_cast<size_t>(page)];
+}
+
+int PdfCompare::FindChangedPage(int fromPage, int direction) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const int count = static_cast<int>(m_diffs.size());
+    for (int page = fromPage; page >= 0 && page < count; page += direction)
+    {
+        if (m_diffs[static_cast<size_t>(page)].changed)
+            return page;
+    }
+    return -1;
+}
+
+void PdfCompare::SetDisplayPage(int page)
+{
+    if (!IsOpen() || page < 0 || page >= m_pageCount)
+        return;
+
+    uint64_t generation = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (page == m_displayPage && (m_textureA || m_textureB ||
+                                      m_displayDirty))
+            return;
+        m_displayPage = page;
+        generation = m_generation;
+    }
+
+    // Bitmaps of already scanned pages are not kept, so render again with
+    // priority over the remaining scan.
+    m_worker.PostFront(
+        [this, page, generation]() { ScanPage(page, generation); });
+}
+
+void PdfCompare::Update()
+{
+    std::shared_ptr<const PageBitmap> imageA;
+    std::shared_ptr<const PageBitmap> imageB;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_displayDirty)
+            return;
+        imageA = std::move(m_pendingImageA);
+        imageB = std::move(m_pendingImageB);
+        m_displayDirty = false;
+    }
+
+    CleanupTextures();
+    if (imageA)
+    {
+        UploadTexture(m_textureA, *imageA);
+        m_aspectA = static_cast<float>(imageA->width) /
+                    static_cast<float>(imageA->height);
+    }
+    if (imageB)
+    {
+        UploadTexture(m_textureB, *imageB);
+        m_aspectB = static_cast<float>(imageB->width) /
+                    static_cast<float>(imageB->height);
+    }
+}
+
+void PdfCompare::ScanPage(int page, uint64_t generation)
+{
+    auto imageA = std::make_shared<PageBitmap>();
+    auto imageB = std::make_shared<PageBitmap>();
+    bool hasA = false;
+    bool hasB = false;
+    {
+        std::lock_guard<std::mutex> lock(PdfiumMutex());
+        if (generation != m_generation)
+            return;
+
+        if (page < m_pageCountA)
+            hasA = RenderPageBitmap(m_documentA, page, COMPARE_RENDER_SCALE,
+                                    COMPARE_MAX_DIMENSION, *imageA);
+        if (page < m_pageCountB)
+            hasB = RenderPageBitmap(m_documentB, page, COMPARE_RENDER_SCALE,
+                                    COMPARE_MAX_DIMENSION, *imageB);
+    }
+
+    PageDiff diff = DiffPages(hasA ? imageA.get() : nullptr,
+                              hasB ? imageB.get() : nullptr);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (generation != m_generation ||
+        page >= static_cast<int>(m_diffs.size()))
+        return;
+
+    PageDiff &stored = m_diffs[static_cast<size_t>(page)];
+    if (!stored.scanned)
+    {
+        m_scannedCount++;
+        if (diff.changed)
+            m_changedCount++;
+        stored = std::move(diff);
+    }
+
+    if (page == m_displayPage)
+    {
+        m_pendingImageA = hasA ? std::move(imageA) : nullptr;
+        m_pendingImageB = hasB ? std::move(imageB) : nullptr;
+        m_displayDirty = true;
+    }
+}
+
+void PdfCompare::CleanupTextures()
+{
+    if (m_textureA)
+        glDeleteTextures(1, &m_textureA);
+    if (m_textureB)
+        glDeleteTextures(1, &m_textureB);
+    m_textureA = 0;
+    m_textureB = 0;
+    m_aspectA = 0.0f;
+    m_aspectB = 0.0f;
+}
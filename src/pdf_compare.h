@@ -0,0 +1,155 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <GLFW/glfw3.h>
+#include <fpdfview.h>
+
+#include "background_worker.h"
+#include "page_layout.h"
+#include "pdfium_support.h"
+
+/**
+ * @brief A cluster of changed pixels on a compared page.
+ */
+struct DiffRegion
+{
+    NormalizedRect rect;
+    size_t changedPixels = 0;
+};
+
+/**
+ * @brief Comparison result for one page index of two documents.
+ */
+struct PageDiff
+{
+    bool scanned = false;
+    bool changed = false;
+    // The page exists in only one document or its size differs, so the
+    // whole page is reported as a single region.
+    bool layoutChanged = false;
+    size_t changedPixels = 0;
+    std::vector<DiffRegion> regions;
+};
+
+/**
+ * @brief Compares two revisions of a document page by page.
+ *
+ * Opening a pair queues every page for scanning on background threads.
+ * Each task rasterizes the corresponding pages of both documents under the
+ * PDFium lock, then builds a SIMD difference mask and clusters changed
+ * pixels into regions outside the lock, so one page is diffed while the
+ * next is rendered. The page being displayed is scanned first and its
+ * bitmaps are kept for upload.
+ */
+class PdfCompare
+{
+public:
+    PdfCompare();
+    ~PdfCompare();
+
+    PdfCompare(const PdfCompare &) = delete;
+    PdfCompare &operator=(const PdfCompare &) = delete;
+
+    /**
+     * @brief Open two PDF files and start scanning for differences.
+     * @param pathA Original revision (UTF-8 encoded).
+     * @param pathB Revised revision (UTF-8 encoded).
+     * @return true if both documents loaded, false otherwise.
+     */
+    bool Open(const std::string &pathA, const std::string &pathB);
+
+    /**
+     * @brief Stop scanning and release both documents.
+     */
+    void Close();
+
+    bool IsOpen() const { return m_documentA != nullptr; }
+
+    const std::string &GetFilenameA() const { return m_filenameA; }
+    const std::string &GetFilenameB() const { return m_filenameB; }
+
+    /**
+     * @brief Number of page indices compared (the longer document).
+     */
+    int GetPageCount() const { return m_pageCount; }
+
+    int GetScannedPageCount() const;
+    int GetChangedPageCount() const;
+    bool IsScanComplete() const { return GetScannedPageCount() == m_pageCount; }
+
+    /**
+     * @brief Get a copy of the result for a page; scanned is false until
+     *        the background scan reaches it.
+     */
+    PageDiff GetPageDiff(int page) const;
+
+    /**
+     * @brief Find the nearest scanned page with changes.
+     * @param fromPage First page to consider.
+     * @param direction +1 to search forward, -1 to search backward.
+     * @return Page index, or -1 if no changed page was found.
+     */
+    int FindChangedPage(int fromPage, int direction) const;
+
+    // --- Display ---
+
+    void SetDisplayPage(int page);
+    int GetDisplayPage() const { return m_displayPage; }
+
+    /**
+     * @brief Upload bitmaps for the display page. Call once per frame.
+     */
+    void Update();
+
+    GLuint GetTextureA() const { return m_textureA; }
+    GLuint GetTextureB() const { return m_textureB; }
+    float GetDisplayAspectA() const { return m_aspectA; }
+    float GetDisplayAspectB() const { return m_aspectB; }
+
+private:
+    void ScanPage(int page, uint64_t generation);
+    void CleanupTextures();
+
+    // PDFium state, guarded by PdfiumMutex() for background readers
+    FPDF_DOCUMENT m_documentA = nullptr;
+    FPDF_DOCUMENT m_documentB = nullptr;
+    std::vector<unsigned char> m_dataA;
+    std::vector<unsigned char> m_dataB;
+    int m_pageCountA = 0;
+    int m_pageCountB = 0;
+    int m_pageCount = 0;
+    std::string m_filenameA;
+    std::string m_filenameB;
+
+    // Written under both PdfiumMutex() and m_mutex; read under either.
+    uint64_t m_generation = 0;
+
+    // Scan results shared with the workers
+    mutable std::mutex m_mutex;
+    std::vector<PageDiff> m_diffs;
+    int m_scannedCount = 0;
+    int m_changedCount = 0;
+    int m_displayPage = 0;
+    std::shared_ptr<const PageBitmap> m_pendingImageA;
+    std::shared_ptr<const PageBitmap> m_pendingImageB;
+    bool m_displayDirty = false;
+
+    // Main-thread textures for the display page
+    GLuint m_textureA = 0;
+    GLuint m_textureB = 0;
+    float m_aspectA = 0.0f;
+    float m_aspectB = 0.0f;
+
+    // Rendering is serialized by the PDFium lock; a second thread lets
+    // diffing of one page overlap rendering of the next.
+    static constexpr int WORKER_THREADS = 2;
+    static constexpr double COMPARE_RENDER_SCALE = 1.5;
+    static constexpr int COMPARE_MAX_DIMENSION = 2048;
+
+    BackgroundWorker m_worker;
+};
@@ -0,0 +1,650 @@
+#include "pdf_export.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <utility>
+
+#include <fpdf_edit.h>
+#include <fpdf_ppo.h>
+#include <fpdf_save.h>
+#include <fpdfview.h>
+
+#include "pdfium_support.h"
+
+namespace
+{
+// FPDF_SaveAsCopy hands the serialized document over in blocks, so the
+// output is written as it is produced instead of being buffered in memory.
+struct StreamFileWrite : FPDF_FILEWRITE
+{
+    std::ofstream *out = nullptr;
+};
+
+int WriteStreamBlock(FPDF_FILEWRITE *writer,
+                     const void *data,
+                     unsigned long size)
+{
+    std::ofstream *out = static_cast<StreamFileWrite *>(writer)->out;
+    out->write(static_cast<const char *>(data),
+               static_cast<std::streamsize>(size));
+    return out->good() ? 1 : 0;
+}
+
+// Caller holds PdfiumMutex().
+bool SaveDocument(FPDF_DOCUMENT document, const std::string &outputPath)
+{
+    const std::filesystem::path destinationPath(outputPath);
+    std::filesystem::path temporaryPath = destinationPath;
+    temporaryPath += ".tmp";
+
+    std::ofstream out(temporaryPath,
+                      std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!out.is_open())
+    {
+        printf("[PdfExport] Failed to create: %s\n", outputPath.c_str());
+        return false;
+    }
+
+    StreamFileWrite writer;
+    writer.version = 1;
+    writer.WriteBlock = WriteStreamBlock;
+    writer.out = &out;
+
+    bool saved = FPDF_SaveAsCopy(document, &writer, FPDF_NO_INCREMENTAL);
+    out.close();
+    saved = saved && !out.fail();
+
+    std::error_code error;
+    if (saved)
+        std::filesystem::rename(temporaryPath, destinationPath, error);
+    if (!saved || error)
+    {
+        std::error_code cleanupError;
+        std::filesystem::remove(temporaryPath, cleanupError);
+        printf("[PdfExport] Failed while writing: %s\n", outputPath.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+// Opens sources on demand for imposition, keeping the most recently used
+// ones. Booklet order alternates between the front and back of the page
+// sequence, so two entries avoid reloading on every slot.
+class SourceDocumentCache
+{
+public:
+    explicit SourceDocumentCache(size_t capacity) : m_capacity(capacity) {}
+
+    ~SourceDocumentCache()
+    {
+        std::lock_guard<std::mutex> lock(PdfiumMutex());
+        for (Entry &entry : m_entries)
+            FPDF_CloseDocument(entry.document);
+    }
+
+    SourceDocumentCache(const SourceDocumentCache &) = delete;
+    SourceDocumentCache &operator=(const SourceDocumentCache &) = delete;
+
+    // Returns nullptr if the source could not be read or parsed.
+    FPDF_DOCUMENT Acquire(size_t partIndex, const std::string &path)
+    {
+        m_useCounter++;
+        for (Entry &entry : m_entries)
+        {
+            if (entry.partIndex == partIndex)
+            {
+                entry.lastUse = m_useCounter;
+                return entry.document;
+            }
+        }
+
+        Entry entry;
+        entry.partIndex = partIndex;
+        entry.lastUse = m_useCounter;
+        if (!ReadPdfFile(path, entry.data))
+            return nullptr;
+
+        std::lock_guard<std::mutex> lock(PdfiumMutex());
+        entry.document = FPDF_LoadMemDocument(
+            entry.data.data(), static_cast<int>(entry.data.size()), nullptr);
+        if (!entry.document)
+            return nullptr;
+
+        if (m_entries.size() >= m_capacity)
+        {
+            auto oldest = std::min_element(
+                m_entries.begin(), m_entries.end(),
+                [](const Entry &left, const Entry &right) {
+                    return left.lastUse < right.lastUse;
+                });
+            FPDF_CloseDocument(oldest->document);
+            m_entries.erase(oldest);
+        }
+
+        // Moving the entry keeps the data buffer the document points into.
+        m_entries.push_back(std::move(entry));
+        return m_entries.back().document;
+    }
+
+private:
+    struct Entry
+    {
+        size_t partIndex = 0;
+        uint64_t lastUse = 0;
+        std::vector<unsigned char> data;
+        FPDF_DOCUMENT document = nullptr;
+    };
+
+    size_t m_capacity;
+    uint64_t m_useCounter = 0;
+    std::vector<Entry> m_entries;
+};
+
+struct SequencePage
+{
+    size_t partIndex;
+    int pageIndex;
+};
+
+bool ParsePageNumber(const std::string &text, size_t &pos, int &value)
+{
+    if (pos >= text.size() ||
+        !std::isdigit(static_cast<unsigned char>(text[pos])))
+        return false;
+
+    value = 0;
+    while (pos < text.size() &&
+           std::isdigit(static_cast<unsigned char>(text[pos])))
+    {
+        value = value * 10 + (text[pos] - '0');
+        if (value > 1000000)
+            return false;
+        pos++;
+    }
+    return true;
+}
+} // namespace
+
+bool ParsePageRange(const std::string &range,
+                    int pageCount,
+                    std::vector<int> &pages)
+{
+    pages.clear();
+
+    std::string text;
+    for (char c : range)
+    {
+        if (!std::isspace(static_cast<unsigned char>(c)))
+            text += c;
+    }
+
+    if (text.empty())
+    {
+        for (int page = 0; page < pageCount; page++)
+            pages.push_back(page);
+        return true;
+    }
+
+    size_t pos = 0;
+    while (pos < text.size())
+    {
+        int first = 0;
+        if (!ParsePageNumber(text, pos, first))
+            return false;
+
+        int last = first;
+        if (pos < text.size() && text[pos] == '-')
+        {
+            pos++;
+            if (pos >= text.size() || text[pos] == ',')
+                last = pageCount;
+            else if (!ParsePageNumber(text, pos, last))
+                return false;
+        }
+
+        if (first < 1 || last < first || last > pageCount)
+            return false;
+        for (int page = first; page <= last; page++)
+            pages.push_back(page - 1);
+
+        if (pos < text.size())
+        {
+            if (text[pos] != ',')
+                return false;
+            pos++;
+        }
+    }
+
+    return true;
+}
+
+std::vector<int> ImpositionOrder(int pageCount, ImpositionLayout layout)
+{
+    std::vector<int> order;
+    if (pageCount <= 0)
+        return order;
+
+    if (layout != ImpositionLayout::Booklet)
+    {
+        order.reserve(static_cast<size_t>(pageCount));
+        for (int page = 0; page < pageCount; page++)
+            order.push_back(page);
+        return order;
+    }
+
+    const int paddedCount = (pageCount + 3) / 4 * 4;
+    const int last = paddedCount - 1;
+    auto slot = [pageCount](int page) { return page < pageCount ? page : -1; };
+
+    order.reserve(static_cast<size_t>(paddedCount));
+    for (int sheet = 0; sheet < paddedCount / 4; sheet++)
+    {
+        order.push_back(slot(last - 2 * sheet));
+        order.push_back(slot(2 * sheet));
+        order.push_back(slot(2 * sheet + 1));
+        order.push_back(slot(last - 2 * sheet - 1));
+    }
+    return order;
+}
+
+PdfExporter::PdfExporter() : m_worker(1) {}
+
+PdfExporter::~PdfExporter() { Cancel(); }
+
+bool PdfExporter::StartMerge(const std::vector<ExportPart> &parts,
+                             const std::string &outputPath)
+{
+    if (!BeginJob(parts.size(), outputPath))
+        return false;
+
+    m_worker.Post([this, parts, outputPath]() { RunMerge(parts, outputPath); });
+    return true;
+}
+
+bool PdfExporter::StartImposition(const std::vector<ExportPart> &parts,
+                                  const ImpositionOptions &options,
+                                  const std::string &outputPath)
+{
+    // The slot count is only known once page ranges have been resolved.
+    if (!BeginJob(0, outputPath))
+        return false;
+
+    m_worker.Post([this, parts, options, outputPath]() {
+        RunImposition(parts, options, outputPath);
+    });
+    return true;
+}
+
+bool PdfExporter::BeginJob(size_t progressTotal, const std::string &outputPath)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_status.running)
+        return false;
+
+    m_status = ExportStatus();
+    m_status.running = true;
+    m_status.progressTotal = progressTotal;
+    m_status.outputPath = outputPath;
+    m_jobStart = std::chrono::steady_clock::now();
+    m_cancelRequested = false;
+    return true;
+}
+
+bool PdfExporter::IsRunning() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_status.running;
+}
+
+ExportStatus PdfExporter::GetStatus() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_status;
+}
+
+void PdfExporter::ClearStatus()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_status.running)
+        m_status = ExportStatus();
+}
+
+void PdfExporter::RunMerge(const std::vector<ExportPart> &parts,
+                           const std::string &outputPath)
+{
+    FPDF_DOCUMENT output = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(PdfiumMutex());
+        output = FPDF_CreateNewDocument();
+    }
+    if (!output)
+    {
+        Finish(false, "Could not create the output document.");
+        return;
+    }
+
+    int pagesWritten = 0;
+    std::string failure;
+    for (size_t i = 0; i < parts.size(); i++)
+    {
+        const ExportPart &part = parts[i];
+        if (m_cancelRequested)
+        {
+            failure = "Export cancelled.";
+            break;
+        }
+        SetProgress(i, pagesWritten, part.name);
+
+        // Only one source is resident at a time; its bytes are released as
+        // soon as its pages have been copied into the output.
+        std::vector<unsigned char> data;
+        if (!ReadPdfFile(part.sourcePath, data))
+        {
+            failure = "Could not read " + part.name + ".";
+            break;
+        }
+
+        FPDF_DOCUMENT source = nullptr;
+        int sourcePageCount = 0;
+        {
+            std::lock_guard<std::mutex> lock(PdfiumMutex());
+            source = FPDF_LoadMemDocument(
+                data.data(), static_cast<int>(data.size()), nullptr);
+            if (source)
+                sourcePageCount = FPDF_GetPageCount(source);
+            else
+                printf("[PdfExport] Failed to load %s: error code %lu\n",
+                       part.sourcePath.c_str(), FPDF_GetLastError());
+        }
+        if (!source)
+        {
+            failure = "Could not open " + part.name + ".";
+            break;
+        }
+
+        std::vector<int> pages;
+        if (!ParsePageRange(part.pageRange, sourcePageCount, pages))
+        {
+            failure = "Invalid page range \"" + part.pageRange + "\" for " +
+                      part.name + ".";
+        }
+
+        // Copy in batches, taking the PDFium lock per batch so the viewer
+        // keeps rendering while a large source is merged.
+        for (size_t batchStart = 0;
+             batchStart < pages.size() && failure.empty();
+             batchStart += MERGE_BATCH_PAGES)
+        {
+            if (m_cancelRequested)
+            {
+                failure = "Export cancelled.";
+                break;
+            }
+
+            const size_t batchSize =
+                (std::min)(pages.size() - batchStart, MERGE_BATCH_PAGES);
+            std::lock_guard<std::mutex> lock(PdfiumMutex());
+            if (!FPDF_ImportPagesByIndex(
+                    output, source, pages.data() + batchStart,
+                    static_cast<unsigned long>(batchSize), pagesWritten))
+                failure = "Could not copy pages from " + part.name + ".";
+            else
+                pagesWritten += static_cast<int>(batchSize);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(PdfiumMutex());
+            FPDF_CloseDocument(source);
+        }
+        SetProgress(i, pagesWritten, part.name);
+
+        if (!failure.empty())
+            break;
+    }
+
+    if (failure.empty() && pagesWritten == 0)
+        failure = "No pages were selected.";
+
+    if (failure.empty())
+    {
+        SetProgress(parts.size(), pagesWritten, "Saving");
+        std::lock_guard<std::mutex> lock(PdfiumMutex());
+        if (!SaveDocument(output, outputPath))
+            failure = "Could not write the output file.";
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(PdfiumMutex());
+        FPDF_CloseDocument(output);
+    }
+
+    if (failure.empty())
+        Finish(true, "Exported " + std::to_string(pagesWritten) + " pages.");
+    else
+        Finish(false, failure);
+}
+
+void PdfExporter::RunImposition(const std::vector<ExportPart> &parts,
+                                const ImpositionOptions &options,
+                                const std::string &outputPath)
+{
+    // Resolve every range up front: booklet order needs the total page
+    // count before the first sheet can be laid out.
+    std::vector<SequencePage> sequence;
+    FS_SIZEF blankSize = {612.0f, 792.0f};
+    bool haveBlankSize = false;
+    std::string failure;
+    for (size_t i = 0; i < parts.size() && failure.empty(); i++)
+    {
+        const ExportPart &part = parts[i];
+        if (m_cancelRequested)
+        {
+            failure = "Export cancelled.";
+            break;
+        }
+        SetProgress(0, 0, part.name);
+
+        std::vector<unsigned char> data;
+        if (!ReadPdfFile(part.sourcePath, data))
+        {
+            failure = "Could not read " + part.name + ".";
+            break;
+        }
+
+        std::lock_guard<std::mutex> lock(PdfiumMutex());
+        FPDF_DOCUMENT source = FPDF_LoadMemDocument(
+            data.data(), static_cast<int>(data.size()), nullptr);
+        if (!source)
+        {
+            failure = "Could not open " + part.name + ".";
+            break;
+        }
+
+        std::vector<int> pages;
+        if (!ParsePageRange(part.pageRange, FPDF_GetPageCount(source), pages))
+        {
+            failure = "Invalid page range \"" + part.pageRange + "\" for " +
+                      part.name + ".";
+        }
+        else
+        {
+            // Blank padding pages take the size of the first real page.
+            if (!haveBlankSize && !pages.empty())
+                haveBlankSize =
+                    FPDF_GetPageSizeByIndexF(source, pages[0], &blankSize);
+            for (int page : pages)
+                sequence.push_back({i, page});
+        }
+        FPDF_CloseDocument(source);
+    }
+
+    if (failure.empty() && sequence.empty())
+        failure = "No pages were selected.";
+    if (!failure.empty())
+    {
+        Finish(false, failure);
+        return;
+    }
+
+    const std::vector<int> order =
+        ImpositionOrder(static_cast<int>(sequence.size()), options.layout);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_status.progressTotal = order.size();
+    }
+
+    const bool portraitSheet = options.layout == ImpositionLayout::FourUp;
+    const size_t columns = 2;
+    const size_t rows = portraitSheet ? 2 : 1;
+    const float paperWidth = options.paper == PaperSize::A4 ? 595.0f : 612.0f;
+    const float paperHeight = options.paper == PaperSize::A4 ? 842.0f : 792.0f;
+    const float sheetWidth = portraitSheet ? paperWidth : paperHeight;
+    const float sheetHeight = portraitSheet ? paperHeight : paperWidth;
+
+    FPDF_DOCUMENT output = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(PdfiumMutex());
+        output = FPDF_CreateNewDocument();
+    }
+    if (!output)
+    {
+        Finish(false, "Could not create the output document.");
+        return;
+    }
+
+    SourceDocumentCache sources(2);
+    int pagesPlaced = 0;
+    for (size_t chunkStart = 0; chunkStart < order.size() && failure.empty();
+         chunkStart += IMPOSITION_CHUNK_SLOTS)
+    {
+        if (m_cancelRequested)
+        {
+            failure = "Export cancelled.";
+            break;
+        }
+
+        const size_t chunkEnd =
+            (std::min)(order.size(), chunkStart + IMPOSITION_CHUNK_SLOTS);
+        FPDF_DOCUMENT chunk = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(PdfiumMutex());
+            chunk = FPDF_CreateNewDocument();
+        }
+        if (!chunk)
+        {
+            failure = "Could not create an imposition chunk.";
+            break;
+        }
+
+        // Gather the chunk's pages in slot order. The PDFium lock is taken
+        // per page so the viewer keeps rendering during long exports.
+        for (size_t slot = chunkStart; slot < chunkEnd && failure.empty();
+             slot++)
+        {
+            const int chunkIndex = static_cast<int>(slot - chunkStart);
+            if (order[slot] < 0)
+            {
+                std::lock_guard<std::mutex> lock(PdfiumMutex());
+                FPDF_PAGE blank = FPDFPage_New(chunk, chunkIndex,
+                                               blankSize.width,
+                                               blankSize.height);
+                if (blank)
+                    FPDF_ClosePage(blank);
+                else
+                    failure = "Could not add a blank page.";
+                continue;
+            }
+
+            const SequencePage &page =
+                sequence[static_cast<size_t>(order[slot])];
+            const ExportPart &part = parts[page.partIndex];
+            FPDF_DOCUMENT source =
+                sources.Acquire(page.partIndex, part.sourcePath);
+            if (!source)
+            {
+                failure = "Could not open " + part.name + ".";
+                break;
+            }
+
+            std::lock_guard<std::mutex> lock(PdfiumMutex());
+            if (!FPDF_ImportPagesByIndex(chunk, source, &page.pageIndex, 1,
+                                         chunkIndex))
+                failure = "Could not copy pages from " + part.name + ".";
+            else
+                pagesPlaced++;
+        }
+
+        if (failure.empty())
+        {
+            std::lock_guard<std::mutex> lock(PdfiumMutex());
+            FPDF_DOCUMENT sheets = FPDF_ImportNPagesToOne(
+                chunk, sheetWidth, sheetHeight, columns, rows);
+            if (!sheets ||
+                !FPDF_ImportPages(output, sheets, nullptr,
+                                  FPDF_GetPageCount(output)))
+                failure = "Could not lay out sheets.";
+            if (sheets)
+                FPDF_CloseDocument(sheets);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(PdfiumMutex());
+            FPDF_CloseDocument(chunk);
+        }
+        SetProgress(chunkEnd, pagesPlaced, "Laying out sheets");
+    }
+
+    if (failure.empty())
+    {
+        SetProgress(order.size(), pagesPlaced, "Saving");
+        std::lock_guard<std::mutex> lock(PdfiumMutex());
+        if (!SaveDocument(output, outputPath))
+            failure = "Could not write the output file.";
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(PdfiumMutex());
+        FPDF_CloseDocument(output);
+    }
+
+    if (failure.empty())
+        Finish(true, "Imposed " + std::to_string(pagesPlaced) + " pages.");
+    else
+        Finish(false, failure);
+}
+
+void PdfExporter::SetProgress(size_t progressDone,
+                              int pagesWritten,
+                              const std::string &currentName)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    double seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - m_jobStart)
+                         .count();
+    m_status.progressDone = progressDone;
+    m_status.pagesWritten = pagesWritten;
+    m_status.pagesPerSecond = seconds > 0.0 ? pagesWritten / seconds : 0.0;
+    m_status.currentName = currentName;
+}
+
+void PdfExporter::Finish(bool succeeded, const std::string &message)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    double seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - m_jobStart)
+                         .count();
+    printf("[PdfExport] %s (%d pages in %.2f s)\n", message.c_str(),
+           m_status.pagesWritten, seconds);
+
+    if (seconds > 0.0)
+        m_status.pagesPerSecond = m_status.pagesWritten / seconds;
+    m_status.running = false;
+    m_status.finished = true;
+    m_status.succeeded = succeeded;
+    m_status.currentName.clear();
+    m_status.message = message;
+}
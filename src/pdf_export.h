@@ -0,0 +1,170 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "background_worker.h"
+
+/**
+ * @brief One source document contributing pages to an export.
+ */
+struct ExportPart
+{
+    std::string name;
+    std::string sourcePath;
+    // Page range such as "1,3,5-7" (one-based). Empty selects every page.
+    std::string pageRange;
+};
+
+/**
+ * @brief How source pages are placed on output sheets.
+ */
+enum class ImpositionLayout
+{
+    TwoUp,   // Two pages side by side on a landscape sheet
+    FourUp,  // Four pages in a 2x2 grid on a portrait sheet
+    Booklet  // Saddle-stitch order, two pages per landscape sheet side
+};
+
+enum class PaperSize
+{
+    Letter,
+    A4
+};
+
+struct ImpositionOptions
+{
+    ImpositionLayout layout = ImpositionLayout::TwoUp;
+    PaperSize paper = PaperSize::Letter;
+};
+
+/**
+ * @brief Snapshot of an export job for display.
+ */
+struct ExportStatus
+{
+    bool running = false;
+    bool finished = false;
+    bool succeeded = false;
+    // Sources for a merge, page slots for an imposition.
+    size_t progressDone = 0;
+    size_t progressTotal = 0;
+    int pagesWritten = 0;
+    double pagesPerSecond = 0.0;
+    std::string currentName;
+    std::string outputPath;
+    std::string message;
+};
+
+/**
+ * @brief Parse a one-based page range string into zero-based page indices.
+ *
+ * Accepts comma separated pages and ranges ("1,3,5-7"); an open range
+ * ("5-") runs to the last page. Whitespace is ignored and an empty string
+ * selects every page.
+ *
+ * @param range Range text.
+ * @param pageCount Number of pages in the document.
+ * @param pages Receives the indices in the order given.
+ * @return true if every entry was valid, false otherwise.
+ */
+bool ParsePageRange(const std::string &range,
+                    int pageCount,
+                    std::vector<int> &pages);
+
+/**
+ * @brief Order pages for imposition.
+ *
+ * N-up layouts keep reading order. A booklet is padded to a multiple of
+ * four and ordered so that folding the duplex-printed stack in half gives
+ * pages in sequence: sheet s carries (last - 2s, 2s) on the front and
+ * (2s + 1, last - 2s - 1) on the back.
+ *
+ * @param pageCount Number of source pages.
+ * @param layout Target layout.
+ * @return Source page index per slot, or -1 for a blank slot.
+ */
+std::vector<int> ImpositionOrder(int pageCount, ImpositionLayout layout);
+
+/**
+ * @brief Builds new PDF files from pages of existing ones.
+ *
+ * Jobs run on a background thread. Merges read and import sources one at a
+ * time and close them straight after, so memory stays bounded by the
+ * largest source plus the output. Impositions work through the page
+ * sequence in fixed-size chunks and keep at most two sources open. The
+ * output is streamed to a temporary file and moved into place once
+ * complete.
+ */
+class PdfExporter
+{
+public:
+    PdfExporter();
+    ~PdfExporter();
+
+    PdfExporter(const PdfExporter &) = delete;
+    PdfExporter &operator=(const PdfExporter &) = delete;
+
+    /**
+     * @brief Concatenate the selected pages of each part into one PDF.
+     * @param parts Sources in output order.
+     * @param outputPath Destination file (UTF-8 encoded).
+     * @return true if the job was queued, false if one is already running.
+     */
+    bool StartMerge(const std::vector<ExportPart> &parts,
+                    const std::string &outputPath);
+
+    /**
+     * @brief Place the selected pages of each part several to a sheet.
+     * @param parts Sources in reading order.
+     * @param options Layout and paper size.
+     * @param outputPath Destination file (UTF-8 encoded).
+     * @return true if the job was queued, false if one is already running.
+     */
+    bool StartImposition(const std::vector<ExportPart> &parts,
+                         const ImpositionOptions &options,
+                         const std::string &outputPath);
+
+    /**
+     * @brief Ask the running job to stop after the current source or chunk.
+     */
+    void Cancel() { m_cancelRequested = true; }
+
+    bool IsRunning() const;
+    ExportStatus GetStatus() const;
+
+    /**
+     * @brief Forget the result of a finished job.
+     */
+    void ClearStatus();
+
+private:
+    void RunMerge(const std::vector<ExportPart> &parts,
+                  const std::string &outputPath);
+    void RunImposition(const std::vector<ExportPart> &parts,
+                       const ImpositionOptions &options,
+                       const std::string &outputPath);
+    bool BeginJob(size_t progressTotal, const std::string &outputPath);
+    void SetProgress(size_t progressDone,
+                     int pagesWritten,
+                     const std::string &currentName);
+    void Finish(bool succeeded, const std::string &message);
+
+    mutable std::mutex m_mutex;
+    ExportStatus m_status;
+    std::atomic<bool> m_cancelRequested{false};
+    std::chrono::steady_clock::time_point m_jobStart;
+
+    // Source pages laid out per FPDF_ImportNPagesToOne call; a multiple of
+    // every layout's pages per sheet.
+    static constexpr size_t IMPOSITION_CHUNK_SLOTS = 64;
+
+    // Pages copied per FPDF_ImportPagesByIndex call when merging; the PDFium
+    // lock is released between batches so the viewer can render.
+    static constexpr size_t MERGE_BATCH_PAGES = 16;
+
+    BackgroundWorker m_worker;
+};
@@ -2,8 +2,13 @@
 
 #include <algorithm>
 #include <cctype>
+#include <chrono>
+#include <cstring>
 #include <filesystem>
 #include <iostream>
+#include <numeric>
+#include <string_view>
+#include <unordered_set>
 
 namespace fs = std::filesystem;
 
@@ -23,34 +28,36 @@ namespace
     }
 
     // Extract filename from path
-    std::string GetFilename(const fs::path &path)
+    std::string FilenameOf(const fs::path &path)
     {
         return path.filename().string();
     }
 
-    bool CaseInsensitiveFilenameLess(const PdfEntry &left,
-                                     const PdfEntry &right)
+    char FoldAscii(char c)
     {
-        const size_t sharedLength =
-            (std::min)(left.filename.size(), right.filename.size());
-
-        for (size_t i = 0; i < sharedLength; i++)
-        {
-            const auto leftChar = static_cast<unsigned char>(left.filename[i]);
-            const auto rightChar =
-                static_cast<unsigned char>(right.filename[i]);
-            const int foldedLeft = std::tolower(leftChar);
-            const int foldedRight = std::tolower(rightChar);
-
-            if (foldedLeft != foldedRight)
-                return foldedLeft < foldedRight;
-        }
+        if (c >= 'A' && c <= 'Z')
+            return static_cast<char>(c - 'A' + 'a');
+        return c;
+    }
 
-        if (left.filename.size() != right.filename.size())
-            return left.filename.size() < right.filename.size();
+    // One bit per letter and digit, with everything else sharing the
+    // remaining bits. A name can only match a query if it has every bit
+    // the query has, which rules out most names without reading them.
+    uint64_t CharacterBit(char folded)
+    {
+        const auto c = static_cast<unsigned char>(folded);
+        if (c >= 'a' && c <= 'z')
+            return uint64_t(1) << (c - 'a');
+        if (c >= '0' && c <= '9')
+            return uint64_t(1) << (26 + c - '0');
+        return uint64_t(1) << (36 + c % 28);
+    }
 
-        // Keep the order deterministic when filenames differ only by case.
-        return left.filename < right.filename;
+    int64_t ToSeconds(fs::file_time_type time)
+    {
+        return std::chrono::duration_cast<std::chrono::seconds>(
+                   time.time_since_epoch())
+            .count();
     }
 } // namespace
 
@@ -76,6 +83,7 @@ bool PdfLibrary::LoadFolder(const std::string &folderPath)
     }
 
     ScanFolder();
+    Sort(m_sortKey);
     return true;
 }
 
@@ -83,21 +91,271 @@ void PdfLibrary::Clear()
 {
     m_folderPath.clear();
     m_folderName.clear();
-    m_files.clear();
+    ClearFiles();
 }
 
 void PdfLibrary::Refresh()
 {
-    if (!m_folderPath.empty())
+    if (m_folderPath.empty())
+        return;
+
+    // Files added one by one are not in the folder listing; carry them over.
+    std::vector<std::string> added;
+    std::vector<int> addedPageCounts;
+    for (size_t i = 0; i < m_paths.size(); i++)
+    {
+        if (m_flags[i] & LIBRARY_FILE_ADDED)
+        {
+            added.push_back(GetFullPath(i));
+            addedPageCounts.push_back(m_pageCounts[i]);
+        }
+    }
+
+    ClearFiles();
+    ScanFolder();
+    for (size_t i = 0; i < added.size(); i++)
+        AppendFile(added[i], addedPageCounts[i]);
+    Sort(m_sortKey);
+}
+
+bool PdfLibrary::AddFile(const std::string &fullPath)
+{
+    LibraryFileInfo file;
+    file.fullPath = fullPath;
+    if (!ReadFileInfo(fullPath, file.fileSize, file.modifiedTime))
+        return false;
+    return AddFiles({file}) == 1;
+}
+
+size_t PdfLibrary::AddFiles(const std::vector<LibraryFileInfo> &files)
+{
+    // Duplicates are found with a set of the new files and one pass over
+    // the listed ones, which is cheaper than hashing a large library.
+    PathInterner &interner = PathInterner::Shared();
+    std::vector<PathId> paths(files.size());
+    std::unordered_set<PathId> fresh;
+    for (size_t i = 0; i < files.size(); i++)
+    {
+        paths[i] = interner.Intern(files[i].fullPath);
+        if (paths[i] != INVALID_PATH_ID)
+            fresh.insert(paths[i]);
+    }
+    for (size_t i = 0; i < m_paths.size() && !fresh.empty(); i++)
+        fresh.erase(m_paths[i]);
+
+    const size_t firstNew = m_paths.size();
+    for (size_t i = 0; i < files.size(); i++)
+    {
+        // Erasing also skips a file given twice.
+        if (fresh.erase(paths[i]) == 0)
+            continue;
+        AddEntry(paths[i], files[i].modifiedTime, files[i].fileSize,
+                 LIBRARY_FILE_ADDED);
+        m_pageCounts.back() = files[i].pageCount;
+    }
+
+    const size_t added = m_paths.size() - firstNew;
+    if (added == 0)
+        return 0;
+
+    // Files added without opening a folder still need a heading.
+    if (m_folderPath.empty() && m_folderName.empty())
+        m_folderName = "Added Files";
+
+    // The existing files are already in order; only the new ones need
+    // sorting before the two runs are merged.
+    std::vector<uint32_t> order(m_paths.size());
+    std::iota(order.begin(), order.end(), 0u);
+    const auto less = [this](uint32_t left, uint32_t right) {
+        return Less(m_sortKey, left, right);
+    };
+    const auto middle = order.begin() + static_cast<ptrdiff_t>(firstNew);
+    std::sort(middle, order.end(), less);
+    std::inplace_merge(order.begin(), middle, order.end(), less);
+    ApplyOrder(order);
+    return added;
+}
+
+bool PdfLibrary::ReadFileInfo(const std::string &fullPath,
+                              uint64_t &fileSize,
+                              int64_t &modifiedTime)
+{
+    const fs::path filePath(fullPath);
+    std::error_code sizeError;
+    std::error_code timeError;
+    fileSize = fs::file_size(filePath, sizeError);
+    if (sizeError)
+        return false;
+    const fs::file_time_type modified =
+        fs::last_write_time(filePath, timeError);
+    modifiedTime = timeError ? 0 : ToSeconds(modified);
+    return true;
+}
+
+void PdfLibrary::AddEntry(PathId path,
+                          int64_t modifiedTime,
+                          uint64_t fileSize,
+                          uint8_t flags)
+{
+    const PathInterner &paths = PathInterner::Shared();
+    const char *name = paths.GetName(path);
+    const size_t length = paths.GetNameLength(path);
+
+    uint64_t mask = 0;
+    m_nameOffsets.push_back(static_cast<uint32_t>(m_foldedNames.size()));
+    m_nameLengths.push_back(static_cast<uint32_t>(length));
+    for (size_t i = 0; i < length; i++)
     {
-        m_files.clear();
-        ScanFolder();
+        const char folded = FoldAscii(name[i]);
+        m_foldedNames += folded;
+        mask |= CharacterBit(folded);
     }
+
+    m_paths.push_back(path);
+    m_nameMasks.push_back(mask);
+    m_modifiedTimes.push_back(modifiedTime);
+    m_fileSizes.push_back(fileSize);
+    m_pageCounts.push_back(-1);
+    m_flags.push_back(flags);
+    m_revision++;
+}
+
+void PdfLibrary::Sort(LibrarySortKey key)
+{
+    m_sortKey = key;
+
+    std::vector<uint32_t> order(m_paths.size());
+    std::iota(order.begin(), order.end(), 0u);
+
+    // One sort per key, so each comparison has its key as a constant.
+    switch (key)
+    {
+    case LibrarySortKey::Name:
+        std::sort(order.begin(), order.end(),
+                  [this](uint32_t left, uint32_t right) {
+                      return Less(LibrarySortKey::Name, left, right);
+                  });
+        break;
+    case LibrarySortKey::Modified:
+        std::sort(order.begin(), order.end(),
+                  [this](uint32_t left, uint32_t right) {
+                      return Less(LibrarySortKey::Modified, left, right);
+                  });
+        break;
+    case LibrarySortKey::Size:
+        std::sort(order.begin(), order.end(),
+                  [this](uint32_t left, uint32_t right) {
+                      return Less(LibrarySortKey::Size, left, right);
+                  });
+        break;
+    }
+    ApplyOrder(order);
+}
+
+bool PdfLibrary::Less(LibrarySortKey key, uint32_t left, uint32_t right) const
+{
+    switch (key)
+    {
+    case LibrarySortKey::Name:
+        break;
+    case LibrarySortKey::Modified:
+        // Newest first.
+        if (m_modifiedTimes[left] != m_modifiedTimes[right])
+            return m_modifiedTimes[left] > m_modifiedTimes[right];
+        break;
+    case LibrarySortKey::Size:
+        // Largest first.
+        if (m_fileSizes[left] != m_fileSizes[right])
+            return m_fileSizes[left] > m_fileSizes[right];
+        break;
+    }
+    return NameLess(left, right);
+}
+
+bool PdfLibrary::NameLess(uint32_t left, uint32_t right) const
+{
+    const std::string_view leftName(m_foldedNames.data() + m_nameOffsets[left],
+                                    m_nameLengths[left]);
+    const std::string_view rightName(
+        m_foldedNames.data() + m_nameOffsets[right], m_nameLengths[right]);
+    if (leftName != rightName)
+        return leftName < rightName;
+
+    // Keep the order deterministic when filenames differ only by case.
+    const PathInterner &paths = PathInterner::Shared();
+    const int exact = strcmp(paths.GetName(m_paths[left]),
+                             paths.GetName(m_paths[right]));
+    if (exact != 0)
+        return exact < 0;
+    return m_paths[left] < m_paths[right];
+}
+
+void PdfLibrary::Filter(const char *query, std::vector<uint32_t> &matches) const
+{
+    matches.clear();
+    const size_t count = m_paths.size();
+    if (!query || query[0] == '\0')
+    {
+        matches.resize(count);
+        std::iota(matches.begin(), matches.end(), 0u);
+        return;
+    }
+
+    std::string foldedQuery;
+    uint64_t queryMask = 0;
+    for (const char *c = query; *c; c++)
+    {
+        foldedQuery += FoldAscii(*c);
+        queryMask |= CharacterBit(foldedQuery.back());
+    }
+
+    const char *names = m_foldedNames.data();
+    const char *queryEnd = foldedQuery.data() + foldedQuery.size();
+    for (size_t i = 0; i < count; i++)
+    {
+        if ((m_nameMasks[i] & queryMask) != queryMask)
+            continue;
+
+        // Subsequence match, same rule as the other search boxes.
+        const char *text = names + m_nameOffsets[i];
+        const char *textEnd = text + m_nameLengths[i];
+        const char *q = foldedQuery.data();
+        for (; text != textEnd && q != queryEnd; text++)
+        {
+            if (*text == *q)
+                q++;
+        }
+        if (q == queryEnd)
+            matches.push_back(static_cast<uint32_t>(i));
+    }
+}
+
+const char *PdfLibrary::GetFilename(size_t index) const
+{
+    return PathInterner::Shared().GetName(m_paths[index]);
+}
+
+std::string PdfLibrary::GetFullPath(size_t index) const
+{
+    return PathInterner::Shared().GetPath(m_paths[index]);
+}
+
+void PdfLibrary::SetPageCount(size_t index, int pageCount)
+{
+    if (index < m_pageCounts.size())
+        m_pageCounts[index] = pageCount;
+}
+
+int PdfLibrary::FindFile(PathId path) const
+{
+    auto it = std::find(m_paths.begin(), m_paths.end(), path);
+    return it != m_paths.end() ? static_cast<int>(it - m_paths.begin()) : -1;
 }
 
 void PdfLibrary::ScanFolder()
 {
     fs::path folderPath(m_folderPath);
+    m_scanCount++;
 
     try
     {
@@ -105,11 +363,22 @@ void PdfLibrary::ScanFolder()
         {
             if (entry.is_regular_file())
             {
-                std::string filename = GetFilename(entry.path());
+                std::string filename = FilenameOf(entry.path());
                 if (EndsWithPdf(filename))
                 {
-                    std::string fullPath = entry.path().string();
-                    m_files.emplace_back(filename, fullPath);
+                    PathId id =
+                        PathInterner::Shared().Intern(entry.path().string());
+                    if (id == INVALID_PATH_ID)
+                        continue;
+
+                    // The directory iterator usually has these cached.
+                    std::error_code sizeError;
+                    std::error_code timeError;
+                    const uint64_t size = entry.file_size(sizeError);
+                    const fs::file_time_type modified =
+                        entry.last_write_time(timeError);
+                    AddEntry(id, timeError ? 0 : ToSeconds(modified),
+                             sizeError ? 0 : size);
                 }
             }
         }
@@ -119,6 +388,68 @@ void PdfLibrary::ScanFolder()
         // Silently handle permission errors, etc.
         // TODO: Handle errors
     }
+}
+
+// Appends without sorting; the caller sorts once per batch.
+bool PdfLibrary::AppendFile(const std::string &fullPath, int pageCount)
+{
+    const PathId path = PathInterner::Shared().Intern(fullPath);
+    if (path == INVALID_PATH_ID || FindFile(path) >= 0)
+        return false;
+
+    uint64_t size = 0;
+    int64_t modifiedTime = 0;
+    if (!ReadFileInfo(fullPath, size, modifiedTime))
+        return false;
+
+    AddEntry(path, modifiedTime, size, LIBRARY_FILE_ADDED);
+    m_pageCounts.back() = pageCount;
+    return true;
+}
+
+void PdfLibrary::ClearFiles()
+{
+    m_paths.clear();
+    m_nameOffsets.clear();
+    m_nameLengths.clear();
+    m_nameMasks.clear();
+    m_modifiedTimes.clear();
+    m_fileSizes.clear();
+    m_pageCounts.clear();
+    m_flags.clear();
+    m_foldedNames.clear();
+    m_revision++;
+}
+
+void PdfLibrary::ApplyOrder(const std::vector<uint32_t> &order)
+{
+    auto permute = [&order](auto &column) {
+        std::remove_reference_t<decltype(column)> sorted;
+        sorted.reserve(column.size());
+        for (uint32_t index : order)
+            sorted.push_back(column[index]);
+        column.swap(sorted);
+    };
+
+    // Rewrite the name buffer too so Filter() reads it front to back.
+    std::string names;
+    names.reserve(m_foldedNames.size());
+    std::vector<uint32_t> offsets;
+    offsets.reserve(order.size());
+    for (uint32_t index : order)
+    {
+        offsets.push_back(static_cast<uint32_t>(names.size()));
+        names.append(m_foldedNames, m_nameOffsets[index], m_nameLengths[index]);
+    }
+    m_foldedNames.swap(names);
+    m_nameOffsets.swap(offsets);
 
-    std::sort(m_files.begin(), m_files.end(), CaseInsensitiveFilenameLess);
+    permute(m_paths);
+    permute(m_nameLengths);
+    permute(m_nameMasks);
+    permute(m_modifiedTimes);
+    permute(m_fileSizes);
+    permute(m_pageCounts);
+    permute(m_flags);
+    m_revision++;
 }
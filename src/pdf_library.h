@@ -1,74 +1,212 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
+#include "path_interner.h"
+
+/**
+ * @brief Orders the library list can be shown in.
+ */
+enum class LibrarySortKey
+{
+    Name,
+    Modified,
+    Size
+};
+
 /**
- * @brief Represents a PDF file entry in the library.
+ * @brief A file to add whose size and modification time were already read,
+ *        e.g. by a background thread, see PdfLibrary::AddFiles().
  */
-struct PdfEntry
+struct LibraryFileInfo
 {
-    std::string filename;
     std::string fullPath;
-    
-    PdfEntry(const std::string& name, const std::string& path)
-        : filename(name), fullPath(path) {}
+    uint64_t fileSize = 0;
+    int64_t modifiedTime = 0; // as PdfLibrary::GetModifiedTime()
+    int pageCount = -1;
+};
+
+/**
+ * @brief Per-file flag bits, see PdfLibrary::GetFlags().
+ */
+enum LibraryFileFlags : uint8_t
+{
+    // Added individually rather than found by scanning the folder; kept
+    // across Refresh().
+    LIBRARY_FILE_ADDED = 1 << 0,
 };
 
 /**
  * @brief Manages a collection of PDF files from a selected folder.
+ *
+ * Files are stored column-wise: interned paths, sizes, modification times,
+ * page counts and flags each sit in their own array, and every lowercased
+ * file name is packed into one contiguous buffer. Filter() and Sort() only
+ * touch the columns they need and stream through them in order, which
+ * keeps libraries of 100k files responsive while typing a search.
  */
 class PdfLibrary
 {
 public:
     PdfLibrary() = default;
-    
+
     /**
      * @brief Scan a folder for PDF files.
      * @param folderPath Path to the folder to scan.
      * @return true if folder was successfully scanned, false otherwise.
      */
     bool LoadFolder(const std::string& folderPath);
-    
+
     /**
      * @brief Clear the current library.
      */
     void Clear();
-    
+
     /**
      * @brief Refresh the current folder (rescan for PDFs).
      */
     void Refresh();
-    
+
     /**
-     * @brief Check if a folder is loaded.
+     * @brief Add one file that lives outside the scanned folder.
+     * @return true if added, false if it is missing or already listed.
      */
-    bool IsLoaded() const { return !m_folderPath.empty(); }
-    
+    bool AddFile(const std::string &fullPath);
+
+    /**
+     * @brief Add several files without touching the filesystem.
+     *
+     * Files already listed are skipped. The new files are sorted among
+     * themselves and merged into the existing order, so a large library
+     * is not sorted again.
+     * @return The number of files that were added.
+     */
+    size_t AddFiles(const std::vector<LibraryFileInfo> &files);
+
+    /**
+     * @brief Read a file's size and modification time as the library
+     *        stores them.
+     * @return false if the file cannot be read.
+     */
+    static bool ReadFileInfo(const std::string &fullPath,
+                             uint64_t &fileSize,
+                             int64_t &modifiedTime);
+
+    /**
+     * @brief Append an entry without touching the filesystem.
+     *
+     * Used by the folder scan and by tools that build synthetic libraries.
+     * The new entry goes last; call Sort() once after a batch.
+     */
+    void AddEntry(PathId path,
+                  int64_t modifiedTime,
+                  uint64_t fileSize,
+                  uint8_t flags = 0);
+
+    /**
+     * @brief Reorder every column, and remember the order for rescans.
+     */
+    void Sort(LibrarySortKey key);
+    LibrarySortKey GetSortKey() const { return m_sortKey; }
+
+    /**
+     * @brief Collect the indices of files whose names contain the query's
+     *        characters in order, ignoring ASCII case.
+     * @param query Search text; empty matches everything.
+     * @param matches Receives indices in display order.
+     */
+    void Filter(const char *query, std::vector<uint32_t> &matches) const;
+
+    /**
+     * @brief Check if a folder is loaded or files were added by hand.
+     */
+    bool IsLoaded() const
+    {
+        return !m_folderPath.empty() || !m_paths.empty();
+    }
+
     /**
      * @brief Get the current folder path.
      */
     const std::string& GetFolderPath() const { return m_folderPath; }
-    
+
     /**
      * @brief Get the folder name (last component of path).
      */
     const std::string& GetFolderName() const { return m_folderName; }
-    
+
     /**
-     * @brief Get the list of PDF files.
+     * @brief Get number of PDF files.
      */
-    const std::vector<PdfEntry>& GetFiles() const { return m_files; }
-    
+    size_t GetFileCount() const { return m_paths.size(); }
+
     /**
-     * @brief Get number of PDF files.
+     * @brief Changes whenever files are added, removed or reordered, so
+     *        callers can tell when cached indices are stale.
+     */
+    uint64_t GetRevision() const { return m_revision; }
+
+    /**
+     * @brief Changes each time the folder is scanned, by LoadFolder() or
+     *        Refresh().
+     */
+    uint64_t GetScanCount() const { return m_scanCount; }
+
+    // --- Per-file columns; the index must be below GetFileCount() ---
+
+    PathId GetPath(size_t index) const { return m_paths[index]; }
+    const char *GetFilename(size_t index) const;
+    std::string GetFullPath(size_t index) const;
+    uint64_t GetFileSize(size_t index) const { return m_fileSizes[index]; }
+
+    /**
+     * @brief Last write time in filesystem clock seconds; only meaningful
+     *        for comparing files with each other.
+     */
+    int64_t GetModifiedTime(size_t index) const
+    {
+        return m_modifiedTimes[index];
+    }
+
+    /**
+     * @brief Page count, or -1 until something has opened the file.
      */
-    size_t GetFileCount() const { return m_files.size(); }
+    int GetPageCount(size_t index) const { return m_pageCounts[index]; }
+    void SetPageCount(size_t index, int pageCount);
+
+    uint8_t GetFlags(size_t index) const { return m_flags[index]; }
+
+    /**
+     * @brief Find the index of a file, or -1 if it is not in the library.
+     */
+    int FindFile(PathId path) const;
 
 private:
     void ScanFolder();
-    
+    bool AppendFile(const std::string &fullPath, int pageCount);
+    void ClearFiles();
+    bool Less(LibrarySortKey key, uint32_t left, uint32_t right) const;
+    bool NameLess(uint32_t left, uint32_t right) const;
+    void ApplyOrder(const std::vector<uint32_t> &order);
+
     std::string m_folderPath;
     std::string m_folderName;
-    std::vector<PdfEntry> m_files;
+    LibrarySortKey m_sortKey = LibrarySortKey::Name;
+    uint64_t m_revision = 0;
+    uint64_t m_scanCount = 0;
+
+    // Columns, one element per file.
+    std::vector<PathId> m_paths;
+    std::vector<uint32_t> m_nameOffsets; // into m_foldedNames
+    std::vector<uint32_t> m_nameLengths;
+    std::vector<uint64_t> m_nameMasks; // characters present, see Filter()
+    std::vector<int64_t> m_modifiedTimes;
+    std::vector<uint64_t> m_fileSizes;
+    std::vector<int32_t> m_pageCounts;
+    std::vector<uint8_t> m_flags;
+
+    // ASCII-lowercased file names back to back, in display order.
+    std::string m_foldedNames;
 };
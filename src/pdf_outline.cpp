@@ -0,0 +1,114 @@
+#include "pdf_outline.h"
+
+#include <unordered_set>
+
+#include "pdfium_support.h"
+
+namespace
+{
+// Malformed outlines can contain sibling cycles or absurdly long chains.
+const int MAX_SIBLINGS_PER_LEVEL = 10000;
+
+std::string ReadBookmarkTitle(FPDF_BOOKMARK bookmark)
+{
+    unsigned long byteLength = FPDFBookmark_GetTitle(bookmark, nullptr, 0);
+    if (byteLength <= 2)
+        return {};
+
+    std::vector<unsigned short> buffer((byteLength + 1) / 2, 0);
+    FPDFBookmark_GetTitle(bookmark, buffer.data(), byteLength);
+
+    // The reported length includes the UTF-16 terminator.
+    return Utf16LeToUtf8(buffer.data(), buffer.size() - 1);
+}
+} // namespace
+
+void PdfOutline::Reset(FPDF_DOCUMENT document)
+{
+    Clear();
+    m_document = document;
+    if (!m_document)
+        return;
+
+    FPDF_BOOKMARK first = FPDFBookmark_GetFirstChild(m_document, nullptr);
+    m_rootCount = AppendSiblings(first).second;
+}
+
+void PdfOutline::Clear()
+{
+    m_document = nullptr;
+    m_nodes.clear();
+    m_rootCount = 0;
+}
+
+std::pair<int, int> PdfOutline::ExpandNode(int nodeIndex)
+{
+    if (!m_document || nodeIndex < 0 ||
+        nodeIndex >= static_cast<int>(m_nodes.size()))
+        return {0, 0};
+
+    OutlineNode &node = m_nodes[static_cast<size_t>(nodeIndex)];
+    if (node.childrenLoaded)
+        return {0, 0};
+    node.childrenLoaded = true;
+
+    FPDF_BOOKMARK first = FPDFBookmark_GetFirstChild(m_document, node.bookmark);
+    std::pair<int, int> added = AppendSiblings(first);
+
+    // AppendSiblings may reallocate m_nodes.
+    OutlineNode &expanded = m_nodes[static_cast<size_t>(nodeIndex)];
+    expanded.firstChild = added.first;
+    expanded.childCount = added.second;
+    expanded.hasChildren = added.second > 0;
+    return added;
+}
+
+void PdfOutline::SetNodePage(int nodeIndex, int pageIndex)
+{
+    if (nodeIndex < 0 || nodeIndex >= static_cast<int>(m_nodes.size()))
+        return;
+
+    OutlineNode &node = m_nodes[static_cast<size_t>(nodeIndex)];
+    node.pageIndex = pageIndex;
+    node.pageResolved = true;
+}
+
+int PdfOutline::ResolvePage(FPDF_DOCUMENT document, FPDF_BOOKMARK bookmark)
+{
+    if (!document || !bookmark)
+        return -1;
+
+    FPDF_DEST dest = FPDFBookmark_GetDest(document, bookmark);
+    if (!dest)
+    {
+        FPDF_ACTION action = FPDFBookmark_GetAction(bookmark);
+        if (action && FPDFAction_GetType(action) == PDFACTION_GOTO)
+            dest = FPDFAction_GetDest(document, action);
+    }
+
+    return dest ? FPDFDest_GetDestPageIndex(document, dest) : -1;
+}
+
+std::pair<int, int> PdfOutline::AppendSiblings(FPDF_BOOKMARK first)
+{
+    const int start = static_cast<int>(m_nodes.size());
+    std::unordered_set<FPDF_BOOKMARK> seen;
+
+    for (FPDF_BOOKMARK bookmark = first;
+         bookmark && static_cast<int>(seen.size()) < MAX_SIBLINGS_PER_LEVEL;
+         bookmark = FPDFBookmark_GetNextSibling(m_document, bookmark))
+    {
+        if (!seen.insert(bookmark).second)
+            break;
+
+        OutlineNode node;
+        node.title = ReadBookmarkTitle(bookmark);
+        node.bookmark = bookmark;
+        node.hasChildren =
+            FPDFBookmark_GetFirstChild(m_document, bookmark) != nullptr;
+        node.childrenLoaded = !node.hasChildren;
+        m_nodes.push_back(std::move(node));
+    }
+
+    return {start, static_cast<int>(m_nodes.size()) - start};
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fpdf_doc.h>
+
+/**
+ * @brief A single bookmark in a document outline.
+ *
+ * Children are stored contiguously in the owning PdfOutline once the node
+ * has been expanded, read by walking the bookmark's first child and its
+ * siblings. Until then only whether the bookmark has a first child is known.
+ */
+struct OutlineNode
+{
+    std::string title;
+    FPDF_BOOKMARK bookmark = nullptr;
+    int firstChild = -1;
+    int childCount = 0;
+    bool hasChildren = false;
+    bool childrenLoaded = false;
+    bool pageResolved = false;
+    int pageIndex = -1; // -1 while unresolved or when there is no target
+};
+
+/**
+ * @brief Lazily loaded view of a PDF outline (bookmark tree).
+ *
+ * Only the top level is read when a document opens. Deeper levels are read
+ * from PDFium when the UI expands a node. Destination page indices are
+ * filled in separately via SetNodePage(), so they can be resolved off the
+ * main thread.
+ */
+class PdfOutline
+{
+public:
+    /**
+     * @brief Read the top level of a document outline.
+     * Caller must hold PdfiumMutex().
+     */
+    void Reset(FPDF_DOCUMENT document);
+
+    void Clear();
+
+    bool IsEmpty() const { return m_rootCount == 0; }
+    int GetRootCount() const { return m_rootCount; }
+    const std::vector<OutlineNode> &GetNodes() const { return m_nodes; }
+
+    /**
+     * @brief Read the children of a node if they are not loaded yet.
+     * Caller must hold PdfiumMutex().
+     * @return Index range [first, first + count) of newly added nodes, with
+     *         count 0 if nothing was loaded.
+     */
+    std::pair<int, int> ExpandNode(int nodeIndex);
+
+    void SetNodePage(int nodeIndex, int pageIndex);
+
+    /**
+     * @brief Resolve a bookmark's destination to a page index.
+     * Caller must hold PdfiumMutex().
+     * @return Zero-based page index, or -1 if the bookmark has no
+     *         in-document target.
+     */
+    static int ResolvePage(FPDF_DOCUMENT document, FPDF_BOOKMARK bookmark);
+
+private:
+    std::pair<int, int> AppendSiblings(FPDF_BOOKMARK first);
+
+    FPDF_DOCUMENT m_document = nullptr;
+    std::vector<OutlineNode> m_nodes;
+    int m_rootCount = 0;
+};
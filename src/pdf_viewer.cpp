@@ -1,100 +1,169 @@
 #include "pdf_viewer.h"
 
 #include <algorithm>
-#include <cmath>
+#include <climits>
 #include <cstdio>
 #include <cstring>
-#include <filesystem>
-#include <fstream>
-#include <limits>
+#include <iterator>
+#include <random>
 
-PdfViewer::PdfViewer() {}
-
-PdfViewer::~PdfViewer() { Close(); }
-
-bool PdfViewer::Load(const std::string &filepath)
+namespace
 {
-    // Read file into memory to avoid path encoding issues on Windows
-    std::filesystem::path path(filepath);
-    std::ifstream file(path, std::ios::binary | std::ios::ate);
-    if (!file.is_open())
+// Identifies a file's contents for the one-bit page cache, which outlives
+// the document. Eight bytes per step hashes about 2.5 GB/s, a millisecond or
+// two for a typical score.
+uint64_t HashPdfData(const std::vector<unsigned char> &data)
+{
+    const uint64_t prime = 0x100000001b3ull;
+    uint64_t hash = 0xcbf29ce484222325ull ^ data.size();
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= data.size(); i += sizeof(uint64_t))
     {
-        printf("[PdfViewer] Failed to open file: %s\n", filepath.c_str());
-        return false;
+        uint64_t word;
+        std::memcpy(&word, data.data() + i, sizeof(word));
+        hash = (hash ^ word) * prime;
+        hash ^= hash >> 32;
     }
+    for (; i < data.size(); i++)
+        hash = (hash ^ data[i]) * prime;
+    return hash;
+}
 
-    std::streamsize fileSize = file.tellg();
-    if (fileSize <= 0 ||
-        fileSize > static_cast<std::streamsize>(
-                       (std::numeric_limits<int>::max)()))
-    {
-        printf("[PdfViewer] Invalid or unsupported file size\n");
-        return false;
-    }
-    file.seekg(0, std::ios::beg);
+// Order in which pages leave a reduced cache: the displayed page last,
+// then the pages after it from the nearest, then earlier pages.
+int RetentionRank(int page, int displayedPage)
+{
+    if (page >= displayedPage)
+        return page - displayedPage;
+    return INT_MAX / 2 + (displayedPage - page);
+}
+} // namespace
 
-    std::vector<unsigned char> pdfData(static_cast<size_t>(fileSize));
-    if (!file.read(reinterpret_cast<char *>(pdfData.data()), fileSize))
-    {
-        printf("[PdfViewer] Failed to read file contents\n");
-        return false;
-    }
-    file.close();
+// Below 10^18, so ids stay within the 19 digits a mirror URL may carry.
+PdfViewer::PdfViewer()
+{
+    std::random_device random;
+    const uint64_t bits = (uint64_t(random()) << 32) ^ random();
+    m_documentIdBase = bits % 1000000000000000000ull;
+}
 
-    // Load PDF from memory
-    FPDF_DOCUMENT document = FPDF_LoadMemDocument(
-        pdfData.data(), static_cast<int>(pdfData.size()), nullptr);
-    if (!document)
-    {
-        unsigned long error = FPDF_GetLastError();
-        printf("[PdfViewer] Failed to load PDF: error code %lu\n", error);
+PdfViewer::~PdfViewer() { Close(); }
+
+bool PdfViewer::Load(const std::string &filepath, bool restoreView)
+{
+    std::vector<unsigned char> pdfData;
+    if (!ReadPdfFile(filepath, pdfData))
         return false;
-    }
 
-    const int pageCount = FPDF_GetPageCount(document);
-    if (pageCount <= 0)
+    // Load PDF from memory
+    FPDF_DOCUMENT document = nullptr;
+    int pageCount = 0;
     {
-        printf("[PdfViewer] PDF contains no readable pages\n");
-        FPDF_CloseDocument(document);
-        return false;
+        std::lock_guard<std::mutex> lock(PdfiumMutex());
+        document = FPDF_LoadMemDocument(
+            pdfData.data(), static_cast<int>(pdfData.size()), nullptr);
+        if (!document)
+        {
+            unsigned long error = FPDF_GetLastError();
+            printf("[PdfViewer] Failed to load PDF: error code %lu\n", error);
+            return false;
+        }
+
+        pageCount = FPDF_GetPageCount(document);
+        if (pageCount <= 0)
+        {
+            printf("[PdfViewer] PDF contains no readable pages\n");
+            FPDF_CloseDocument(document);
+            return false;
+        }
     }
 
+    const uint64_t contentHash = HashPdfData(pdfData);
     Close();
     m_pdfData = std::move(pdfData);
-    m_document = document;
+    m_documentHash = contentHash;
+    {
+        std::lock_guard<std::mutex> lock(PdfiumMutex());
+        m_document = document;
+        m_outline.Reset(m_document);
+    }
     m_pageCount = pageCount;
     m_currentPage = 0;
     m_zoomLevel = 1.0f;
 
+    DocumentView view;
+    const bool restored =
+        restoreView && m_viewMemory && m_viewMemory->Find(filepath, view);
+    if (restored)
+    {
+        // The file may have lost pages since it was last open.
+        m_currentPage = (std::min)(view.page, m_pageCount - 1);
+        SetZoom(view.zoom);
+    }
+
     // Extract filename for display
     size_t lastSlash = filepath.find_last_of("/\\");
     m_filename = (lastSlash != std::string::npos)
                      ? filepath.substr(lastSlash + 1)
                      : filepath;
     m_filepath = filepath;
+    m_documentPath = PathInterner::Shared().Intern(filepath);
 
-    // Render the first page
+    // Render the page to show before anything else
     if (!RenderPageToTexture())
     {
         Close();
         return false;
     }
-    m_needsRender = false;
+    m_rememberView = restoreView;
+
+    // Returning mid-document, either direction may come next.
+    if (restored)
+    {
+        PrefetchPage(m_currentPage + 1);
+        PrefetchPage(m_currentPage - 1);
+    }
+
+    // Destinations are resolved off the main thread; the panel shows
+    // bookmarks immediately and fills in page numbers as they arrive.
+    ResolveOutlineNodes({0, m_outline.GetRootCount()});
 
     return true;
 }
 
 void PdfViewer::Close()
 {
-    if (m_page)
+    // Only views the reader chose are kept; a song played through from a
+    // setlist would otherwise reopen on its last page from the library.
+    if (m_viewMemory && m_document && m_rememberView)
+        m_viewMemory->Remember(m_filepath, {m_currentPage, m_zoomLevel});
+    m_rememberView = false;
+
+    m_worker.CancelPending();
     {
-        FPDF_ClosePage(m_page);
-        m_page = nullptr;
+        // Bumping the generation under the PDFium lock guarantees that no
+        // queued task can observe the document after it is closed.
+        std::lock_guard<std::mutex> lock(PdfiumMutex());
+        m_documentGeneration++;
+        if (m_uploader)
+            m_uploader->CancelBefore(m_documentGeneration);
+        if (m_document)
+        {
+            FPDF_CloseDocument(m_document);
+            m_document = nullptr;
+        }
+        m_outline.Clear();
     }
-    if (m_document)
     {
-        FPDF_CloseDocument(m_document);
-        m_document = nullptr;
+        std::lock_guard<std::mutex> lock(m_cacheMutex);
+        m_pageCache.clear();
+        m_pendingPages.clear();
+        m_pageLayouts.clear();
+        m_pendingLayouts.clear();
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_outlineMutex);
+        m_resolvedOutlineNodes.clear();
     }
 
     CleanupTexture();
@@ -106,19 +175,21 @@ void PdfViewer::Close()
     m_needsRender = false;
     m_filename.clear();
     m_filepath.clear();
+    m_documentPath = INVALID_PATH_ID;
+    m_documentHash = 0;
     m_pageNativeWidth = 0.0;
     m_pageNativeHeight = 0.0;
 }
 
 void PdfViewer::CleanupTexture()
 {
-    if (m_texture)
-    {
-        glDeleteTextures(1, &m_texture);
-        m_texture = 0;
-    }
+    for (const CachedTexture &cached : m_textureCache)
+        glDeleteTextures(1, &cached.texture);
+    m_textureCache.clear();
+    m_texture = 0;
     m_textureWidth = 0;
     m_textureHeight = 0;
+    m_texturePage = -1;
 }
 
 void PdfViewer::NextPage()
@@ -162,109 +233,541 @@ void PdfViewer::ZoomOut(float factor) { SetZoom(m_zoomLevel / factor); }
 
 void PdfViewer::Update()
 {
+    ApplyResolvedOutlineNodes();
+
+    CollectUploadedTextures();
     if (m_needsRender && m_document)
-    {
         RenderPageToTexture();
-        m_needsRender = false;
+}
+
+void PdfViewer::PrefetchPage(int page)
+{
+    if (!m_document || page < 0 || page >= m_pageCount ||
+        !IsWithinCacheLimit(page))
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_cacheMutex);
+        for (const CachedPage &cached : m_pageCache)
+        {
+            if (cached.page == page)
+                return;
+        }
+        if (std::find(m_pendingPages.begin(), m_pendingPages.end(), page) !=
+            m_pendingPages.end())
+            return;
+        m_pendingPages.push_back(page);
     }
+
+    const uint64_t generation = m_documentGeneration;
+    const PathId path = m_documentPath;
+    const uint64_t contentHash = m_documentHash;
+    m_worker.Post([this, page, generation, path, contentHash]() {
+        std::shared_ptr<const PageBitmap> bitmap =
+            ExpandStoredPage(path, contentHash, page);
+        std::shared_ptr<PageBitmap> rendered;
+        std::unique_lock<std::mutex> lock(PdfiumMutex());
+        if (generation != m_documentGeneration)
+            return;
+
+        if (!bitmap)
+        {
+            rendered = std::make_shared<PageBitmap>();
+            if (RenderPageBitmap(m_document, page, BASE_RENDER_SCALE,
+                                 MAX_TEXTURE_SIZE, *rendered))
+                bitmap = rendered;
+        }
+        {
+            std::lock_guard<std::mutex> cacheLock(m_cacheMutex);
+            m_pendingPages.erase(std::remove(m_pendingPages.begin(),
+                                             m_pendingPages.end(), page),
+                                 m_pendingPages.end());
+            if (!bitmap)
+                return;
+            StoreCachedPage(page, bitmap);
+            // Prefetched pages are likely to be shown next; have their
+            // textures ready too.
+            if (m_uploader)
+                m_uploader->Request(generation, page, bitmap);
+        }
+        lock.unlock();
+
+        if (rendered)
+            StoreBilevelPage(path, contentHash, page, *rendered);
+    });
+
+    RequestPageLayout(page);
 }
 
-bool PdfViewer::RenderPageToTexture()
+std::shared_ptr<const PageLayout> PdfViewer::GetPageLayout(int page) const
 {
-    if (!m_document || m_currentPage < 0 || m_currentPage >= m_pageCount)
-        return false;
+    std::lock_guard<std::mutex> lock(m_cacheMutex);
+    for (const CachedLayout &cached : m_pageLayouts)
+    {
+        if (cached.page == page)
+            return cached.layout;
+    }
+    return nullptr;
+}
+
+void PdfViewer::RequestPageLayout(int page)
+{
+    if (!m_document || page < 0 || page >= m_pageCount)
+        return;
 
-    // Close previous page if open
-    if (m_page)
     {
-        FPDF_ClosePage(m_page);
-        m_page = nullptr;
+        std::lock_guard<std::mutex> lock(m_cacheMutex);
+        for (const CachedLayout &cached : m_pageLayouts)
+        {
+            if (cached.page == page)
+                return;
+        }
+        if (std::find(m_pendingLayouts.begin(), m_pendingLayouts.end(),
+                      page) != m_pendingLayouts.end())
+            return;
+        m_pendingLayouts.push_back(page);
     }
 
-    // Load the current page
-    m_page = FPDF_LoadPage(m_document, m_currentPage);
-    if (!m_page)
+    const uint64_t generation = m_documentGeneration;
+    m_worker.Post([this, page, generation]() {
+        auto layout = std::make_shared<PageLayout>();
+        std::lock_guard<std::mutex> lock(PdfiumMutex());
+        if (generation != m_documentGeneration)
+            return;
+
+        bool built = layout->Build(m_document, page);
+        std::lock_guard<std::mutex> cacheLock(m_cacheMutex);
+        m_pendingLayouts.erase(std::remove(m_pendingLayouts.begin(),
+                                           m_pendingLayouts.end(), page),
+                               m_pendingLayouts.end());
+        if (!built)
+            return;
+
+        m_pageLayouts.push_back({page, std::move(layout)});
+        while (m_pageLayouts.size() > GetLayoutLimit())
+            m_pageLayouts.erase(m_pageLayouts.begin());
+    });
+}
+
+void PdfViewer::ExpandOutlineNode(int nodeIndex)
+{
+    std::pair<int, int> added;
     {
-        printf("[PdfViewer] Failed to load page %d\n", m_currentPage);
-        CleanupTexture();
-        return false;
+        std::lock_guard<std::mutex> lock(PdfiumMutex());
+        added = m_outline.ExpandNode(nodeIndex);
     }
+    ResolveOutlineNodes(added);
+}
 
-    // Get page dimensions and store native size
-    double pageWidth = FPDF_GetPageWidth(m_page);
-    double pageHeight = FPDF_GetPageHeight(m_page);
-    if (!std::isfinite(pageWidth) || !std::isfinite(pageHeight) ||
-        pageWidth <= 0.0 || pageHeight <= 0.0)
+void PdfViewer::ResolveOutlineNodes(std::pair<int, int> range)
+{
+    if (range.second <= 0)
+        return;
+
+    std::vector<std::pair<int, FPDF_BOOKMARK>> pending;
+    pending.reserve(static_cast<size_t>(range.second));
+    const auto &nodes = m_outline.GetNodes();
+    for (int i = range.first; i < range.first + range.second; i++)
+        pending.emplace_back(i, nodes[static_cast<size_t>(i)].bookmark);
+
+    const uint64_t generation = m_documentGeneration;
+    m_worker.Post([this, pending = std::move(pending), generation]() {
+        std::lock_guard<std::mutex> lock(PdfiumMutex());
+        if (generation != m_documentGeneration)
+            return;
+
+        std::vector<std::pair<int, int>> resolved;
+        resolved.reserve(pending.size());
+        for (const auto &[nodeIndex, bookmark] : pending)
+            resolved.emplace_back(nodeIndex,
+                                  PdfOutline::ResolvePage(m_document, bookmark));
+
+        std::lock_guard<std::mutex> outlineLock(m_outlineMutex);
+        m_resolvedOutlineNodes.insert(m_resolvedOutlineNodes.end(),
+                                      resolved.begin(), resolved.end());
+    });
+}
+
+void PdfViewer::ApplyResolvedOutlineNodes()
+{
+    std::vector<std::pair<int, int>> resolved;
     {
-        printf("[PdfViewer] Invalid page dimensions\n");
-        CleanupTexture();
-        return false;
+        std::lock_guard<std::mutex> lock(m_outlineMutex);
+        resolved.swap(m_resolvedOutlineNodes);
     }
-    m_pageNativeWidth = pageWidth;
-    m_pageNativeHeight = pageHeight;
-
-    // Render at fixed high-quality scale (independent of display zoom)
-    const int MAX_TEXTURE_SIZE = 4096;
-    const double renderScale =
-        (std::min)(BASE_RENDER_SCALE,
-                   (std::min)(static_cast<double>(MAX_TEXTURE_SIZE) / pageWidth,
-                              static_cast<double>(MAX_TEXTURE_SIZE) /
-                                  pageHeight));
-    const int renderWidth = (std::max)(
-        1, static_cast<int>(std::lround(pageWidth * renderScale)));
-    const int renderHeight = (std::max)(
-        1, static_cast<int>(std::lround(pageHeight * renderScale)));
-
-    // Allocate bitmap buffer (BGRA format)
-    const int stride = renderWidth * 4;
-    std::vector<unsigned char> buffer(
-        static_cast<size_t>(stride) * static_cast<size_t>(renderHeight),
-        0xFF);
-
-    // Create PDFium bitmap pointing to our buffer
-    FPDF_BITMAP bitmap = FPDFBitmap_CreateEx(
-        renderWidth, renderHeight, FPDFBitmap_BGRA, buffer.data(), stride);
-    if (!bitmap)
+
+    for (const auto &[nodeIndex, pageIndex] : resolved)
+        m_outline.SetNodePage(nodeIndex, pageIndex);
+}
+
+std::shared_ptr<const PageBitmap> PdfViewer::FindCachedPage(int page)
+{
+    std::lock_guard<std::mutex> lock(m_cacheMutex);
+    for (size_t i = 0; i < m_pageCache.size(); i++)
     {
-        printf("[PdfViewer] Failed to allocate page bitmap\n");
-        CleanupTexture();
-        return false;
+        if (m_pageCache[i].page != page)
+            continue;
+
+        // Move to the back so recently viewed pages are evicted last.
+        CachedPage hit = m_pageCache[i];
+        m_pageCache.erase(m_pageCache.begin() +
+                          static_cast<std::ptrdiff_t>(i));
+        m_pageCache.push_back(hit);
+        return hit.bitmap;
+    }
+    return nullptr;
+}
+
+std::shared_ptr<const PageBitmap> PdfViewer::GetCachedPage(int page) const
+{
+    std::lock_guard<std::mutex> lock(m_cacheMutex);
+    for (const CachedPage &cached : m_pageCache)
+    {
+        if (cached.page == page)
+            return cached.bitmap;
+    }
+    return nullptr;
+}
+
+// Caller must hold m_cacheMutex.
+void PdfViewer::StoreCachedPage(int page,
+                                std::shared_ptr<const PageBitmap> bitmap)
+{
+    m_pageCache.erase(std::remove_if(m_pageCache.begin(), m_pageCache.end(),
+                                     [page](const CachedPage &cached) {
+                                         return cached.page == page;
+                                     }),
+                      m_pageCache.end());
+    m_pageCache.push_back({page, std::move(bitmap)});
+    EvictCachedPages();
+}
+
+// Caller must hold m_cacheMutex. Normally evicts the least recently used
+// pages; under a reduced limit, the pages least likely to be turned to.
+void PdfViewer::EvictCachedPages()
+{
+    while (m_pageCache.size() > m_cacheLimit)
+    {
+        auto victim = m_pageCache.begin();
+        if (m_cacheLimit < PAGE_CACHE_CAPACITY)
+        {
+            victim = std::max_element(
+                m_pageCache.begin(), m_pageCache.end(),
+                [this](const CachedPage &a, const CachedPage &b) {
+                    return RetentionRank(a.page, m_displayedPage) <
+                           RetentionRank(b.page, m_displayedPage);
+                });
+        }
+        m_pageCache.erase(victim);
+    }
+}
+
+// Returns a scanned page from its one-bit copy, expanded for upload.
+std::shared_ptr<const PageBitmap> PdfViewer::ExpandStoredPage(
+    PathId path, uint64_t contentHash, int page)
+{
+    std::shared_ptr<const BilevelPage> stored;
+    {
+        std::lock_guard<std::mutex> lock(m_cacheMutex);
+        auto found = m_bilevelIndex.find({path, contentHash, page});
+        if (found == m_bilevelIndex.end())
+            return nullptr;
+
+        // Most recently used last.
+        m_bilevelCache.splice(m_bilevelCache.end(), m_bilevelCache,
+                              found->second);
+        stored = found->second->bilevel;
+    }
+
+    auto bitmap = std::make_shared<PageBitmap>();
+    if (!ExpandBilevelPage(*stored, *bitmap))
+        return nullptr;
+    bitmap->imageOnly = true;
+    return bitmap;
+}
+
+// Runs on the worker. Pages that are not black-and-white scans are skipped.
+void PdfViewer::StoreBilevelPage(PathId path,
+                                 uint64_t contentHash,
+                                 int page,
+                                 const PageBitmap &bitmap)
+{
+    if (!bitmap.imageOnly || path == INVALID_PATH_ID)
+        return;
+
+    auto bilevel = std::make_shared<BilevelPage>();
+    if (!CompressBilevelPage(bitmap, *bilevel))
+        return;
+
+    const BilevelKey key{path, contentHash, page};
+    std::lock_guard<std::mutex> lock(m_cacheMutex);
+    if (m_bilevelIndex.count(key) != 0)
+        return;
+    m_bilevelBytes += bilevel->GetByteSize();
+    m_bilevelCache.push_back({key, std::move(bilevel)});
+    m_bilevelIndex.emplace(key, std::prev(m_bilevelCache.end()));
+    EvictBilevelPages();
+}
+
+// Caller must hold m_cacheMutex. The budget shrinks in step with the pages.
+void PdfViewer::EvictBilevelPages()
+{
+    const size_t limit =
+        BILEVEL_CACHE_BYTES / PAGE_CACHE_CAPACITY * m_cacheLimit;
+    while (m_bilevelBytes > limit && !m_bilevelCache.empty())
+    {
+        const CachedBilevelPage &oldest = m_bilevelCache.front();
+        m_bilevelBytes -= oldest.bilevel->GetByteSize();
+        m_bilevelIndex.erase(oldest.key);
+        m_bilevelCache.pop_front();
     }
+}
 
-    // Fill background white
-    FPDFBitmap_FillRect(bitmap, 0, 0, renderWidth, renderHeight, 0xFFFFFFFF);
+// Caller must hold m_cacheMutex. Layouts shrink in step with the pages.
+size_t PdfViewer::GetLayoutLimit() const
+{
+    return LAYOUT_CACHE_CAPACITY * m_cacheLimit / PAGE_CACHE_CAPACITY;
+}
+
+bool PdfViewer::IsWithinCacheLimit(int page) const
+{
+    return m_cacheLimit >= PAGE_CACHE_CAPACITY ||
+           RetentionRank(page, m_currentPage) <
+               static_cast<int>(m_cacheLimit);
+}
 
-    // Render the page. LCD text rendering improves perceived sharpness on screen.
-    FPDF_RenderPageBitmap(bitmap, m_page, 0, 0, renderWidth, renderHeight, 0,
-                          FPDF_ANNOT | FPDF_LCD_TEXT);
+void PdfViewer::SetCacheLimit(size_t pages)
+{
+    pages = (std::min)((std::max)(pages, size_t(1)), PAGE_CACHE_CAPACITY);
+    {
+        std::lock_guard<std::mutex> lock(m_cacheMutex);
+        m_cacheLimit = pages;
+        m_displayedPage = m_currentPage;
+        EvictCachedPages();
+        EvictBilevelPages();
+        while (m_pageLayouts.size() > GetLayoutLimit())
+            m_pageLayouts.erase(m_pageLayouts.begin());
+    }
+    while (m_textureCache.size() > pages && EvictTexture())
+    {
+    }
+}
 
-    // Convert BGRA to RGBA for OpenGL
-    for (int i = 0; i < renderWidth * renderHeight; i++)
+bool PdfViewer::GetPageTexture(int page,
+                               GLuint &texture,
+                               int &width,
+                               int &height)
+{
+    const CachedTexture *cached = FindPageTexture(page);
+    if (!cached)
     {
-        unsigned char temp = buffer[i * 4]; // B
-        buffer[i * 4] = buffer[i * 4 + 2];  // R -> B position
-        buffer[i * 4 + 2] = temp;           // B -> R position
+        std::shared_ptr<const PageBitmap> bitmap = GetCachedPage(page);
+        if (!bitmap)
+            return false;
+        if (m_uploader && m_uploader->IsRunning())
+        {
+            // Shown from a later frame once the upload thread is done.
+            m_uploader->Request(m_documentGeneration, page, bitmap);
+            return false;
+        }
+        cached = UploadPageTexture(page, *bitmap);
     }
 
-    // Create or update OpenGL texture
-    if (m_texture == 0)
+    texture = cached->texture;
+    width = cached->width;
+    height = cached->height;
+    return true;
+}
+
+// Looks up a page's texture and marks it most recently used.
+const PdfViewer::CachedTexture *PdfViewer::FindPageTexture(int page)
+{
+    for (size_t i = 0; i < m_textureCache.size(); i++)
     {
-        glGenTextures(1, &m_texture);
+        if (m_textureCache[i].page != page)
+            continue;
+
+        CachedTexture hit = m_textureCache[i];
+        m_textureCache.erase(m_textureCache.begin() +
+                             static_cast<std::ptrdiff_t>(i));
+        m_textureCache.push_back(hit);
+        return &m_textureCache.back();
     }
+    return nullptr;
+}
 
-    glBindTexture(GL_TEXTURE_2D, m_texture);
+// Takes ownership of a texture. The current page's texture is never
+// evicted.
+const PdfViewer::CachedTexture *
+PdfViewer::StoreTexture(const CachedTexture &texture)
+{
+    if (m_textureCache.size() >=
+        (std::min)(TEXTURE_CACHE_CAPACITY, m_cacheLimit))
+        EvictTexture();
+    m_textureCache.push_back(texture);
+    return &m_textureCache.back();
+}
+
+// Deletes the least recently used texture, or under a reduced limit the
+// one least likely to be turned to. Never the current page's.
+bool PdfViewer::EvictTexture()
+{
+    auto victim = m_textureCache.end();
+    int victimRank = -1;
+    for (auto it = m_textureCache.begin(); it != m_textureCache.end(); ++it)
+    {
+        if (it->texture == m_texture)
+            continue;
+        if (m_cacheLimit >= PAGE_CACHE_CAPACITY)
+        {
+            victim = it;
+            break;
+        }
+        const int rank = RetentionRank(it->page, m_currentPage);
+        if (rank > victimRank)
+        {
+            victim = it;
+            victimRank = rank;
+        }
+    }
+    if (victim == m_textureCache.end())
+        return false;
+
+    glDeleteTextures(1, &victim->texture);
+    m_textureCache.erase(victim);
+    return true;
+}
+
+// Synchronous upload, used when there is no upload thread.
+const PdfViewer::CachedTexture *
+PdfViewer::UploadPageTexture(int page, const PageBitmap &bitmap)
+{
+    CachedTexture created;
+    created.page = page;
+    created.width = bitmap.width;
+    created.height = bitmap.height;
+    glGenTextures(1, &created.texture);
+    glBindTexture(GL_TEXTURE_2D, created.texture);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     // Use nearest-neighbor when magnifying to keep text edges crisper.
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, renderWidth, renderHeight, 0,
-                 GL_RGBA, GL_UNSIGNED_BYTE, buffer.data());
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, bitmap.width, bitmap.height, 0,
+                 GL_RGBA, GL_UNSIGNED_BYTE, bitmap.pixels.data());
+    return StoreTexture(created);
+}
+
+void PdfViewer::CollectUploadedTextures()
+{
+    if (!m_uploader)
+        return;
 
-    m_textureWidth = renderWidth;
-    m_textureHeight = renderHeight;
+    std::vector<UploadedTexture> uploaded;
+    m_uploader->TakeCompleted(uploaded);
+    for (const UploadedTexture &texture : uploaded)
+    {
+        bool duplicate = false;
+        for (const CachedTexture &cached : m_textureCache)
+            duplicate = duplicate || cached.page == texture.page;
+        if (texture.documentId != m_documentGeneration || duplicate)
+        {
+            glDeleteTextures(1, &texture.texture);
+            continue;
+        }
+
+        CachedTexture adopted;
+        adopted.page = texture.page;
+        adopted.texture = texture.texture;
+        adopted.width = texture.width;
+        adopted.height = texture.height;
+        StoreTexture(adopted);
+    }
+}
 
-    // Cleanup PDFium bitmap
-    FPDFBitmap_Destroy(bitmap);
+bool PdfViewer::RenderPageToTexture()
+{
+    if (!m_document || m_currentPage < 0 || m_currentPage >= m_pageCount)
+    {
+        m_needsRender = false;
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_cacheMutex);
+        m_displayedPage = m_currentPage;
+    }
+
+    // Prefetched pages only need a texture upload, and stored scans only
+    // need expanding.
+    std::shared_ptr<const PageBitmap> bitmap = FindCachedPage(m_currentPage);
+    if (!bitmap)
+    {
+        bitmap =
+            ExpandStoredPage(m_documentPath, m_documentHash, m_currentPage);
+        if (bitmap)
+        {
+            std::lock_guard<std::mutex> cacheLock(m_cacheMutex);
+            StoreCachedPage(m_currentPage, bitmap);
+        }
+    }
+    if (!bitmap)
+    {
+        auto rendered = std::make_shared<PageBitmap>();
+        std::lock_guard<std::mutex> lock(PdfiumMutex());
+
+        // A prefetch of this page may have finished while we waited.
+        bitmap = FindCachedPage(m_currentPage);
+        if (!bitmap)
+        {
+            // Render at fixed high-quality scale (independent of display zoom)
+            if (!RenderPageBitmap(m_document, m_currentPage, BASE_RENDER_SCALE,
+                                  MAX_TEXTURE_SIZE, *rendered))
+            {
+                CleanupTexture();
+                m_needsRender = false;
+                return false;
+            }
+
+            std::lock_guard<std::mutex> cacheLock(m_cacheMutex);
+            StoreCachedPage(m_currentPage, rendered);
+            bitmap = rendered;
+
+            // Compress off the main thread; only scans are kept.
+            if (rendered->imageOnly)
+            {
+                m_worker.Post([this, path = m_documentPath,
+                               contentHash = m_documentHash,
+                               page = m_currentPage, rendered]() {
+                    StoreBilevelPage(path, contentHash, page, *rendered);
+                });
+            }
+        }
+    }
+
+    // Extract link and text geometry once so hit tests never need the page.
+    RequestPageLayout(m_currentPage);
+
+    const CachedTexture *cached = FindPageTexture(m_currentPage);
+    if (!cached)
+    {
+        if (m_uploader && m_uploader->IsRunning())
+        {
+            // Keep showing the previous page until the upload thread's
+            // fence signals; Update() retries every frame.
+            m_uploader->Request(m_documentGeneration, m_currentPage, bitmap);
+            m_needsRender = true;
+            return true;
+        }
+        cached = UploadPageTexture(m_currentPage, *bitmap);
+    }
+
+    m_texture = cached->texture;
+    m_textureWidth = cached->width;
+    m_textureHeight = cached->height;
+    m_texturePage = m_currentPage;
+    m_pageNativeWidth = bitmap->nativeWidth;
+    m_pageNativeHeight = bitmap->nativeHeight;
+    m_needsRender = false;
     return true;
 }
@@ -3,10 +3,24 @@
 #include <string>
 #include <vector>
 #include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
 
 #include <GLFW/glfw3.h>
 #include <fpdfview.h>
 
+#include "background_worker.h"
+#include "bilevel_page.h"
+#include "page_layout.h"
+#include "path_interner.h"
+#include "pdf_outline.h"
+#include "pdfium_support.h"
+#include "texture_uploader.h"
+#include "view_memory.h"
+
 // OpenGL constant not always defined in basic headers
 #ifndef GL_CLAMP_TO_EDGE
 #define GL_CLAMP_TO_EDGE 0x812F
@@ -33,14 +47,26 @@ public:
     /**
      * @brief Load a PDF file from disk.
      * @param filepath Path to the PDF file (UTF-8 encoded).
+     * @param restoreView Reopen on the page and zoom the document was left
+     *        at, if a view memory is set and remembers it, and record the
+     *        view again on close. Otherwise the first page is shown at the
+     *        default zoom and the remembered view is left alone.
      * @return true if loaded successfully, false otherwise.
      */
-    bool Load(const std::string& filepath);
+    bool Load(const std::string& filepath, bool restoreView = true);
     
     /**
      * @brief Close the current document and free resources.
+     * Its page and zoom are recorded in the view memory, if one is set and
+     * the document was loaded with restoreView.
      */
     void Close();
+
+    /**
+     * @brief Remember each document's view when it is closed and return to
+     *        it when the document is loaded again.
+     */
+    void SetViewMemory(ViewMemory *memory) { m_viewMemory = memory; }
     
     /**
      * @brief Check if a document is currently loaded.
@@ -87,6 +113,94 @@ public:
     int GetTextureWidth() const { return m_textureWidth; }
     int GetTextureHeight() const { return m_textureHeight; }
 
+    /**
+     * @brief The page GetTexture() shows, or -1 without one. It trails
+     *        GetCurrentPage() while a page turn waits for its upload, and
+     *        is the page to hit-test the drawn image against.
+     */
+    int GetTexturePage() const { return m_texturePage; }
+
+    /**
+     * @brief Rasterize a page in the background so a later jump is instant.
+     * Already cached or pending pages are ignored.
+     */
+    void PrefetchPage(int page);
+
+    /**
+     * @brief Get a page's rasterized bitmap if it is already cached.
+     * Unlike rendering, this never rasterizes and does not affect eviction.
+     */
+    std::shared_ptr<const PageBitmap> GetCachedPage(int page) const;
+
+    /**
+     * @brief Get a texture for a page that is already rasterized.
+     *
+     * Textures are shared by every window in the context share group and
+     * kept for a few recent pages, so a page previewed here is not uploaded
+     * again when it becomes current. Never rasterizes.
+     * @return false if the page's bitmap is not cached yet.
+     */
+    bool GetPageTexture(int page, GLuint &texture, int &width, int &height);
+
+    /**
+     * @brief Upload page textures on a background thread instead of in
+     *        Update(). Set before loading a document.
+     */
+    void SetTextureUploader(TextureUploader *uploader)
+    {
+        m_uploader = uploader;
+    }
+
+    /**
+     * @brief Limit how many rasterized pages and page textures are kept.
+     *
+     * Below the default, the pages kept are the current one and those
+     * right after it, which a page turn needs next; earlier pages go
+     * first. Excess entries are released at once, and pages that would not
+     * fit are no longer prefetched. Used to shed memory under pressure.
+     * @param pages Pages to keep, from 1 to PAGE_CACHE_CAPACITY.
+     */
+    void SetCacheLimit(size_t pages);
+    size_t GetCacheLimit() const { return m_cacheLimit; }
+
+    // Rasterized pages kept for instant jumps (about 8 MB each for Letter).
+    static constexpr size_t PAGE_CACHE_CAPACITY = 6;
+
+    /**
+     * @brief Identifier that changes every time a document is loaded or
+     *        closed, for keying data derived from page contents. It starts
+     *        from a random base, so ids from an earlier launch, such as in
+     *        URLs a browser has cached, do not come back.
+     */
+    uint64_t GetDocumentId() const
+    {
+        return m_documentIdBase + m_documentGeneration;
+    }
+
+    // --- Hit Testing ---
+
+    /**
+     * @brief Get the link and character geometry of a page.
+     * @return The layout, or nullptr while it is still being extracted.
+     *         Layouts are built in the background the first time a page is
+     *         rendered or prefetched.
+     */
+    std::shared_ptr<const PageLayout> GetPageLayout(int page) const;
+
+    // --- Outline ---
+
+    /**
+     * @brief Get the bookmark tree of the loaded document.
+     * Destination pages fill in over a few frames as they are resolved.
+     */
+    const PdfOutline &GetOutline() const { return m_outline; }
+
+    /**
+     * @brief Load the children of an outline node and queue their
+     *        destinations for resolution.
+     */
+    void ExpandOutlineNode(int nodeIndex);
+
     // --- Document Info ---
     
     const std::string& GetFilename() const { return m_filename; }
@@ -105,36 +219,158 @@ public:
 private:
     bool RenderPageToTexture();
     void CleanupTexture();
+    void ResolveOutlineNodes(std::pair<int, int> range);
+    void ApplyResolvedOutlineNodes();
+    std::shared_ptr<const PageBitmap> FindCachedPage(int page);
+    void StoreCachedPage(int page, std::shared_ptr<const PageBitmap> bitmap);
+    void EvictCachedPages();
+    size_t GetLayoutLimit() const;
+    std::shared_ptr<const PageBitmap> ExpandStoredPage(PathId path,
+                                                       uint64_t contentHash,
+                                                       int page);
+    void StoreBilevelPage(PathId path,
+                          uint64_t contentHash,
+                          int page,
+                          const PageBitmap &bitmap);
+    void EvictBilevelPages();
+    bool IsWithinCacheLimit(int page) const;
+    void RequestPageLayout(int page);
+    struct CachedTexture;
+    const CachedTexture *FindPageTexture(int page);
+    const CachedTexture *StoreTexture(const CachedTexture &texture);
+    bool EvictTexture();
+    const CachedTexture *UploadPageTexture(int page, const PageBitmap &bitmap);
+    void CollectUploadedTextures();
 
-    // PDFium handles
+    // PDFium handles. Written on the main thread while holding
+    // PdfiumMutex(), so background tasks may read them under that lock.
     FPDF_DOCUMENT m_document = nullptr;
-    FPDF_PAGE m_page = nullptr;
+    uint64_t m_documentGeneration = 0;
+    uint64_t m_documentIdBase = 0; // random per viewer, see GetDocumentId()
     
     // PDF data kept in memory (required by FPDF_LoadMemDocument)
     std::vector<unsigned char> m_pdfData;
     
-    // OpenGL texture
+    // OpenGL texture of the current page; owned by m_textureCache.
     GLuint m_texture = 0;
     int m_textureWidth = 0;
     int m_textureHeight = 0;
+    int m_texturePage = -1;
     
     // State
     int m_currentPage = 0;
     int m_pageCount = 0;
     float m_zoomLevel = 1.0f;
     bool m_needsRender = false;
+    bool m_rememberView = false; // loaded with restoreView
     std::string m_filename;
     std::string m_filepath;
+    PathId m_documentPath = INVALID_PATH_ID; // keys the one-bit page cache
+    uint64_t m_documentHash = 0;             // with a hash of m_pdfData
     
     // Native page dimensions (PDF points)
     double m_pageNativeWidth = 0.0;
     double m_pageNativeHeight = 0.0;
 
+    // Rasterized pages shared with the prefetch worker, oldest first
+    struct CachedPage
+    {
+        int page = -1;
+        std::shared_ptr<const PageBitmap> bitmap;
+    };
+    mutable std::mutex m_cacheMutex;
+    std::vector<CachedPage> m_pageCache;
+    std::vector<int> m_pendingPages;
+
+    // Written by the main thread under m_cacheMutex, so the prefetch worker
+    // can evict by distance from the page on screen when the limit is
+    // below PAGE_CACHE_CAPACITY.
+    size_t m_cacheLimit = PAGE_CACHE_CAPACITY;
+    int m_displayedPage = 0;
+
+    // One-bit copies of scanned pages, least recently used first, with an
+    // index by key. Guarded by m_cacheMutex. Unlike the caches above they
+    // outlive the document, so the pages of a whole setlist come back
+    // without PDFium. The key holds a hash of the file's contents, so a
+    // file edited in between, even to the same size, misses.
+    struct BilevelKey
+    {
+        PathId path = INVALID_PATH_ID;
+        uint64_t contentHash = 0;
+        int page = -1;
+
+        bool operator==(const BilevelKey &other) const
+        {
+            return path == other.path && contentHash == other.contentHash &&
+                   page == other.page;
+        }
+    };
+    struct BilevelKeyHash
+    {
+        size_t operator()(const BilevelKey &key) const
+        {
+            uint64_t hash = key.contentHash ^ (uint64_t(key.path) << 32) ^
+                            static_cast<uint32_t>(key.page);
+            hash *= 0x9e3779b97f4a7c15ull;
+            return static_cast<size_t>(hash ^ (hash >> 32));
+        }
+    };
+    struct CachedBilevelPage
+    {
+        BilevelKey key;
+        std::shared_ptr<const BilevelPage> bilevel;
+    };
+    std::list<CachedBilevelPage> m_bilevelCache;
+    std::unordered_map<BilevelKey,
+                       std::list<CachedBilevelPage>::iterator,
+                       BilevelKeyHash>
+        m_bilevelIndex;
+    size_t m_bilevelBytes = 0;
+
+    // Uploaded page textures, oldest first. Main thread only.
+    struct CachedTexture
+    {
+        int page = -1;
+        GLuint texture = 0;
+        int width = 0;
+        int height = 0;
+    };
+    std::vector<CachedTexture> m_textureCache;
+    TextureUploader *m_uploader = nullptr;
+    ViewMemory *m_viewMemory = nullptr;
+
+    // Hit-test geometry per page, oldest first. Guarded by m_cacheMutex.
+    struct CachedLayout
+    {
+        int page = -1;
+        std::shared_ptr<const PageLayout> layout;
+    };
+    std::vector<CachedLayout> m_pageLayouts;
+    std::vector<int> m_pendingLayouts;
+
+    // Outline and destinations resolved by the worker but not yet applied
+    PdfOutline m_outline;
+    std::mutex m_outlineMutex;
+    std::vector<std::pair<int, int>> m_resolvedOutlineNodes;
+
     // Zoom limits
     static constexpr float MIN_ZOOM = 0.1f;
     static constexpr float MAX_ZOOM = 5.0f;
     
     // Base render scale — renders texture at this multiple of native size
     // for crisp display. Zoom only affects display, not render resolution.
-    static constexpr double BASE_RENDER_SCALE = 2.0;
+    static constexpr double BASE_RENDER_SCALE = VIEWER_RENDER_SCALE;
+    static constexpr int MAX_TEXTURE_SIZE = VIEWER_MAX_TEXTURE_SIZE;
+
+    // Matches the bitmap cache, since prefetched pages are uploaded too.
+    static constexpr size_t TEXTURE_CACHE_CAPACITY = 6;
+
+    // Layouts are small (tens of KB), so keep most of a long book.
+    static constexpr size_t LAYOUT_CACHE_CAPACITY = 128;
+
+    // Scanned pages compress to tens of KB at one bit per pixel, so this
+    // holds thousands: a concert's worth of scores.
+    static constexpr size_t BILEVEL_CACHE_BYTES = size_t(256) << 20;
+
+    BackgroundWorker m_worker;
 };
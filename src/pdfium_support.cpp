@@ -0,0 +1,204 @@
+#include "pdfium_support.h"
+
+#include <fpdf_edit.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+
+std::mutex &PdfiumMutex()
+{
+    static std::mutex mutex;
+    return mutex;
+}
+
+bool ReadPdfFile(const std::string &filepath, std::vector<unsigned char> &data)
+{
+    std::filesystem::path path(filepath);
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open())
+    {
+        printf("[PdfRender] Failed to open file: %s\n", filepath.c_str());
+        return false;
+    }
+
+    std::streamsize fileSize = file.tellg();
+    if (fileSize <= 0 ||
+        fileSize > static_cast<std::streamsize>(
+                       (std::numeric_limits<int>::max)()))
+    {
+        printf("[PdfRender] Invalid or unsupported file size\n");
+        return false;
+    }
+    file.seekg(0, std::ios::beg);
+
+    std::vector<unsigned char> buffer(static_cast<size_t>(fileSize));
+    if (!file.read(reinterpret_cast<char *>(buffer.data()), fileSize))
+    {
+        printf("[PdfRender] Failed to read file contents\n");
+        return false;
+    }
+
+    data = std::move(buffer);
+    return true;
+}
+
+// Scanned pages are one image, sometimes under an invisible OCR text layer.
+// Vector pages fail on their first path or text object.
+static bool IsImageOnlyPage(FPDF_PAGE page)
+{
+    const int count = FPDFPage_CountObjects(page);
+    bool sawImage = false;
+    for (int i = 0; i < count; i++)
+    {
+        FPDF_PAGEOBJECT object = FPDFPage_GetObject(page, i);
+        const int type = FPDFPageObj_GetType(object);
+        if (type == FPDF_PAGEOBJ_IMAGE)
+            sawImage = true;
+        else if (type != FPDF_PAGEOBJ_TEXT ||
+                 FPDFTextObj_GetTextRenderMode(object) !=
+                     FPDF_TEXTRENDERMODE_INVISIBLE)
+            return false;
+    }
+    return sawImage;
+}
+
+bool RenderPageBitmap(FPDF_DOCUMENT document,
+                      int pageIndex,
+                      double scale,
+                      int maxDimension,
+                      PageBitmap &out)
+{
+    if (!document || pageIndex < 0)
+        return false;
+
+    FPDF_PAGE page = FPDF_LoadPage(document, pageIndex);
+    if (!page)
+    {
+        printf("[PdfRender] Failed to load page %d\n", pageIndex);
+        return false;
+    }
+
+    // Get page dimensions and store native size
+    const double pageWidth = FPDF_GetPageWidth(page);
+    const double pageHeight = FPDF_GetPageHeight(page);
+    if (!std::isfinite(pageWidth) || !std::isfinite(pageHeight) ||
+        pageWidth <= 0.0 || pageHeight <= 0.0)
+    {
+        printf("[PdfRender] Invalid page dimensions\n");
+        FPDF_ClosePage(page);
+        return false;
+    }
+
+    const double renderScale =
+        (std::min)(scale,
+                   (std::min)(static_cast<double>(maxDimension) / pageWidth,
+                              static_cast<double>(maxDimension) / pageHeight));
+    const int renderWidth = (std::max)(
+        1, static_cast<int>(std::lround(pageWidth * renderScale)));
+    const int renderHeight = (std::max)(
+        1, static_cast<int>(std::lround(pageHeight * renderScale)));
+
+    // Allocate bitmap buffer (BGRA format)
+    const int stride = renderWidth * 4;
+    std::vector<unsigned char> buffer(
+        static_cast<size_t>(stride) * static_cast<size_t>(renderHeight),
+        0xFF);
+
+    // Create PDFium bitmap pointing to our buffer
+    FPDF_BITMAP bitmap = FPDFBitmap_CreateEx(
+        renderWidth, renderHeight, FPDFBitmap_BGRA, buffer.data(), stride);
+    if (!bitmap)
+    {
+        printf("[PdfRender] Failed to allocate page bitmap\n");
+        FPDF_ClosePage(page);
+        return false;
+    }
+
+    // Fill background white
+    FPDFBitmap_FillRect(bitmap, 0, 0, renderWidth, renderHeight, 0xFFFFFFFF);
+
+    // Render the page. LCD text rendering improves perceived sharpness on screen.
+    FPDF_RenderPageBitmap(bitmap, page, 0, 0, renderWidth, renderHeight, 0,
+                          FPDF_ANNOT | FPDF_LCD_TEXT);
+    FPDFBitmap_Destroy(bitmap);
+    const bool imageOnly = IsImageOnlyPage(page);
+    FPDF_ClosePage(page);
+
+    // Convert BGRA to RGBA for OpenGL
+    for (int i = 0; i < renderWidth * renderHeight; i++)
+    {
+        unsigned char temp = buffer[i * 4]; // B
+        buffer[i * 4] = buffer[i * 4 + 2];  // R -> B position
+        buffer[i * 4 + 2] = temp;           // B -> R position
+    }
+
+    out.width = renderWidth;
+    out.height = renderHeight;
+    out.nativeWidth = pageWidth;
+    out.nativeHeight = pageHeight;
+    out.pixels = std::move(buffer);
+    out.imageOnly = imageOnly;
+    return true;
+}
+
+void AppendUtf8(std::string &out, uint32_t codepoint)
+{
+    if ((codepoint >= 0xD800 && codepoint <= 0xDFFF) || codepoint > 0x10FFFF)
+        return;
+
+    if (codepoint < 0x80)
+    {
+        out += static_cast<char>(codepoint);
+    }
+    else if (codepoint < 0x800)
+    {
+        out += static_cast<char>(0xC0 | (codepoint >> 6));
+        out += static_cast<char>(0x80 | (codepoint & 0x3F));
+    }
+    else if (codepoint < 0x10000)
+    {
+        out += static_cast<char>(0xE0 | (codepoint >> 12));
+        out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (codepoint & 0x3F));
+    }
+    else
+    {
+        out += static_cast<char>(0xF0 | (codepoint >> 18));
+        out += static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (codepoint & 0x3F));
+    }
+}
+
+std::string Utf16LeToUtf8(const unsigned short *text, size_t length)
+{
+    std::string result;
+    result.reserve(length);
+
+    for (size_t i = 0; i < length; i++)
+    {
+        unsigned int codepoint = text[i];
+
+        // Combine surrogate pairs; drop unpaired surrogates.
+        if (codepoint >= 0xD800 && codepoint <= 0xDBFF)
+        {
+            if (i + 1 >= length || text[i + 1] < 0xDC00 || text[i + 1] > 0xDFFF)
+                continue;
+            codepoint = 0x10000 + ((codepoint - 0xD800) << 10) +
+                        (text[i + 1] - 0xDC00);
+            i++;
+        }
+        else if (codepoint >= 0xDC00 && codepoint <= 0xDFFF)
+        {
+            continue;
+        }
+
+        AppendUtf8(result, codepoint);
+    }
+
+    return result;
+}
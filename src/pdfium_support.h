@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <fpdfview.h>
+
+/**
+ * @brief Global lock guarding every PDFium call.
+ *
+ * PDFium is not thread-safe. Any thread that touches a PDFium handle must
+ * hold this mutex for the duration of the call sequence.
+ */
+std::mutex &PdfiumMutex();
+
+/**
+ * @brief Read a PDF file fully into memory for FPDF_LoadMemDocument().
+ *
+ * Reading through std::filesystem avoids path encoding issues on Windows.
+ * The buffer must outlive any document loaded from it.
+ *
+ * @param filepath Path to the file (UTF-8 encoded).
+ * @param data Receives the file contents.
+ * @return true if the whole file was read, false otherwise.
+ */
+bool ReadPdfFile(const std::string &filepath, std::vector<unsigned char> &data);
+
+/**
+ * @brief A rasterized page in RGBA8 layout, ready for texture upload.
+ */
+struct PageBitmap
+{
+    int width = 0;
+    int height = 0;
+    double nativeWidth = 0.0;  // PDF points
+    double nativeHeight = 0.0; // PDF points
+    std::vector<unsigned char> pixels;
+    // Every visible object on the page is an image, as on a scan.
+    bool imageOnly = false;
+
+    bool IsValid() const { return width > 0 && height > 0 && !pixels.empty(); }
+};
+
+/**
+ * @brief How the viewer rasterizes pages: at a fixed multiple of the native
+ *        size, independent of zoom, with neither edge above the largest
+ *        texture it uploads. Tools that check the viewer's output use these
+ *        too.
+ */
+constexpr double VIEWER_RENDER_SCALE = 2.0;
+constexpr int VIEWER_MAX_TEXTURE_SIZE = 4096;
+
+/**
+ * @brief Render one page of a document into an RGBA bitmap.
+ *
+ * The caller must hold PdfiumMutex(). The page is loaded and closed
+ * internally, so no FPDF_PAGE handle outlives the call.
+ *
+ * @param document Open PDFium document.
+ * @param pageIndex Zero-based page index.
+ * @param scale Requested multiple of the native page size.
+ * @param maxDimension Upper bound for either bitmap edge, in pixels.
+ * @param out Receives the rendered bitmap.
+ * @return true on success, false if the page could not be rendered.
+ */
+bool RenderPageBitmap(FPDF_DOCUMENT document,
+                      int pageIndex,
+                      double scale,
+                      int maxDimension,
+                      PageBitmap &out);
+
+/**
+ * @brief Append a Unicode code point to a string as UTF-8.
+ * Surrogates and out-of-range values are skipped.
+ */
+void AppendUtf8(std::string &out, uint32_t codepoint);
+
+/**
+ * @brief Convert a UTF-16LE buffer returned by PDFium into UTF-8.
+ * @param text Pointer to UTF-16LE code units.
+ * @param length Number of code units, excluding any terminator.
+ */
+std::string Utf16LeToUtf8(const unsigned short *text, size_t length);
@@ -0,0 +1,255 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Immutable sequence whose edits share structure with the original.
+ *
+ * Stored as a treap keyed by position. Insert(), Erase() and Set() return a
+ * new vector that copies only the O(log n) nodes on the path to the edit
+ * and shares everything else, so keeping old versions around (for undo or
+ * a background save) costs little. Copying a vector copies one pointer.
+ * Nodes are never modified after construction, so versions may be read
+ * from any thread.
+ */
+template <typename T>
+class PersistentVector
+{
+    // Values sit behind their own pointer so that copying a node along an
+    // edit path never copies the element itself.
+    struct Node
+    {
+        std::shared_ptr<const T> value;
+        uint32_t priority = 0;
+        size_t size = 1;
+        std::shared_ptr<const Node> left;
+        std::shared_ptr<const Node> right;
+    };
+    using NodePtr = std::shared_ptr<const Node>;
+
+public:
+    class const_iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T *;
+        using reference = const T &;
+
+        const_iterator() = default;
+
+        reference operator*() const { return *m_stack.back()->value; }
+        pointer operator->() const { return m_stack.back()->value.get(); }
+
+        const_iterator &operator++()
+        {
+            const Node *node = m_stack.back();
+            m_stack.pop_back();
+            PushLeftSpine(node->right.get());
+            return *this;
+        }
+
+        const_iterator operator++(int)
+        {
+            const_iterator previous = *this;
+            ++*this;
+            return previous;
+        }
+
+        bool operator==(const const_iterator &other) const
+        {
+            if (m_stack.empty() || other.m_stack.empty())
+                return m_stack.empty() == other.m_stack.empty();
+            return m_stack.back() == other.m_stack.back();
+        }
+        bool operator!=(const const_iterator &other) const
+        {
+            return !(*this == other);
+        }
+
+    private:
+        friend class PersistentVector;
+
+        explicit const_iterator(const Node *root) { PushLeftSpine(root); }
+
+        void PushLeftSpine(const Node *node)
+        {
+            for (; node; node = node->left.get())
+                m_stack.push_back(node);
+        }
+
+        // Ancestors still to visit; the back is the current node.
+        std::vector<const Node *> m_stack;
+    };
+
+    PersistentVector() = default;
+
+    size_t size() const { return m_root ? m_root->size : 0; }
+    bool empty() const { return !m_root; }
+
+    const_iterator begin() const { return const_iterator(m_root.get()); }
+    const_iterator end() const { return const_iterator(); }
+
+    /**
+     * @brief Element at a position; O(log n). The index must be in range.
+     */
+    const T &operator[](size_t index) const
+    {
+        const Node *node = m_root.get();
+        for (;;)
+        {
+            const size_t leftSize = SizeOf(node->left);
+            if (index < leftSize)
+            {
+                node = node->left.get();
+            }
+            else if (index == leftSize)
+            {
+                return *node->value;
+            }
+            else
+            {
+                index -= leftSize + 1;
+                node = node->right.get();
+            }
+        }
+    }
+
+    /**
+     * @brief Whether two vectors are the same version.
+     */
+    bool SharesRootWith(const PersistentVector &other) const
+    {
+        return m_root == other.m_root;
+    }
+
+    PersistentVector Insert(size_t index, T value) const
+    {
+        auto parts = Split(m_root, index);
+        NodePtr single =
+            MakeNode(std::make_shared<const T>(std::move(value)),
+                     NextPriority(), nullptr, nullptr);
+        return PersistentVector(
+            Merge(Merge(parts.first, single), parts.second));
+    }
+
+    PersistentVector PushBack(T value) const
+    {
+        return Insert(size(), std::move(value));
+    }
+
+    PersistentVector Erase(size_t index) const
+    {
+        auto parts = Split(m_root, index);
+        auto rest = Split(parts.second, 1);
+        return PersistentVector(Merge(parts.first, rest.second));
+    }
+
+    PersistentVector Set(size_t index, T value) const
+    {
+        return PersistentVector(SetAt(m_root, index, std::move(value)));
+    }
+
+    /**
+     * @brief Move one element; equivalent to erasing it and inserting it
+     *        again so that it ends up at toIndex.
+     */
+    PersistentVector Move(size_t fromIndex, size_t toIndex) const
+    {
+        if (fromIndex == toIndex)
+            return *this;
+
+        auto parts = Split(m_root, fromIndex);
+        auto rest = Split(parts.second, 1);
+        auto target = Split(Merge(parts.first, rest.second), toIndex);
+        return PersistentVector(
+            Merge(Merge(target.first, rest.first), target.second));
+    }
+
+private:
+    explicit PersistentVector(NodePtr root) : m_root(std::move(root)) {}
+
+    static size_t SizeOf(const NodePtr &node) { return node ? node->size : 0; }
+
+    static NodePtr MakeNode(std::shared_ptr<const T> value,
+                            uint32_t priority,
+                            NodePtr left,
+                            NodePtr right)
+    {
+        auto node = std::make_shared<Node>();
+        node->value = std::move(value);
+        node->priority = priority;
+        node->size = 1 + SizeOf(left) + SizeOf(right);
+        node->left = std::move(left);
+        node->right = std::move(right);
+        return node;
+    }
+
+    static NodePtr WithChildren(const NodePtr &node, NodePtr left, NodePtr right)
+    {
+        return MakeNode(node->value, node->priority, std::move(left),
+                        std::move(right));
+    }
+
+    static uint32_t NextPriority()
+    {
+        // xorshift32; balance only needs priorities that look random.
+        thread_local uint32_t state = 0x9E3779B9u;
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+
+    // Splits into the first `count` elements and the rest.
+    static std::pair<NodePtr, NodePtr> Split(const NodePtr &node, size_t count)
+    {
+        if (!node)
+            return {nullptr, nullptr};
+
+        const size_t leftSize = SizeOf(node->left);
+        if (count <= leftSize)
+        {
+            auto parts = Split(node->left, count);
+            return {parts.first,
+                    WithChildren(node, parts.second, node->right)};
+        }
+
+        auto parts = Split(node->right, count - leftSize - 1);
+        return {WithChildren(node, node->left, parts.first), parts.second};
+    }
+
+    static NodePtr Merge(const NodePtr &left, const NodePtr &right)
+    {
+        if (!left)
+            return right;
+        if (!right)
+            return left;
+
+        if (left->priority > right->priority)
+            return WithChildren(left, left->left, Merge(left->right, right));
+        return WithChildren(right, Merge(left, right->left), right->right);
+    }
+
+    static NodePtr SetAt(const NodePtr &node, size_t index, T value)
+    {
+        const size_t leftSize = SizeOf(node->left);
+        if (index < leftSize)
+            return WithChildren(node, SetAt(node->left, index, std::move(value)),
+                                node->right);
+        if (index == leftSize)
+            return MakeNode(std::make_shared<const T>(std::move(value)),
+                            node->priority, node->left, node->right);
+        return WithChildren(node, node->left,
+                            SetAt(node->right, index - leftSize - 1,
+                                  std::move(value)));
+    }
+
+    NodePtr m_root;
+};
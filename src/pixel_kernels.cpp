@@ -0,0 +1,291 @@
+#include "pixel_kernels.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PIXEL_KERNELS_SSE2 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#define PIXEL_KERNELS_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace
+{
+size_t DiffMaskScalar(const uint8_t *a,
+                      const uint8_t *b,
+                      size_t pixelCount,
+                      uint8_t threshold,
+                      uint8_t *mask)
+{
+    size_t changed = 0;
+    for (size_t i = 0; i < pixelCount; i++)
+    {
+        bool differs = false;
+        for (size_t c = 0; c < 4; c++)
+        {
+            int delta = static_cast<int>(a[i * 4 + c]) -
+                        static_cast<int>(b[i * 4 + c]);
+            if (delta > threshold || -delta > threshold)
+                differs = true;
+        }
+        mask[i] = differs ? 0xFF : 0x00;
+        changed += differs ? 1 : 0;
+    }
+    return changed;
+}
+
+size_t CountSetBytes(const uint8_t *mask, size_t count)
+{
+    size_t total = 0;
+    for (size_t i = 0; i < count; i++)
+        total += mask[i] ? 1 : 0;
+    return total;
+}
+
+// Handles any pixel count; the first pixel starts a new byte.
+size_t ThresholdScalar(const uint8_t *rgba,
+                       size_t pixelCount,
+                       uint8_t threshold,
+                       uint8_t margin,
+                       uint8_t *bits)
+{
+    const int darkBelow = static_cast<int>(threshold) - margin;
+    const int lightAbove = static_cast<int>(threshold) + margin;
+    size_t ambiguous = 0;
+    std::memset(bits, 0, (pixelCount + 7) / 8);
+    for (size_t i = 0; i < pixelCount; i++)
+    {
+        const uint8_t *pixel = rgba + i * 4;
+        if (pixel[1] < threshold)
+            bits[i / 8] |= static_cast<uint8_t>(1u << (i % 8));
+
+        const int lightest = (std::max)((std::max)(pixel[0], pixel[1]),
+                                        pixel[2]);
+        const int darkest = (std::min)((std::min)(pixel[0], pixel[1]),
+                                       pixel[2]);
+        if (lightest >= darkBelow && darkest <= lightAbove)
+            ambiguous++;
+    }
+    return ambiguous;
+}
+
+#if defined(PIXEL_KERNELS_SSE2)
+int PopCount16(int mask)
+{
+    int count = 0;
+    for (; mask; mask &= mask - 1)
+        count++;
+    return count;
+}
+#endif
+
+// Four RGBA pixels for each nibble of a bit byte, least significant first.
+struct ExpandTable
+{
+    uint8_t pixels[16][16];
+
+    ExpandTable()
+    {
+        for (int nibble = 0; nibble < 16; nibble++)
+        {
+            for (int k = 0; k < 4; k++)
+            {
+                const uint8_t level = (nibble >> k) & 1 ? 0x00 : 0xFF;
+                pixels[nibble][k * 4 + 0] = level;
+                pixels[nibble][k * 4 + 1] = level;
+                pixels[nibble][k * 4 + 2] = level;
+                pixels[nibble][k * 4 + 3] = 0xFF;
+            }
+        }
+    }
+};
+} // namespace
+
+size_t ComputeDiffMask(const uint8_t *a,
+                       const uint8_t *b,
+                       size_t pixelCount,
+                       uint8_t threshold,
+                       uint8_t *mask)
+{
+    size_t i = 0;
+
+    // Each iteration handles 16 pixels (64 bytes): saturating absolute
+    // difference minus the threshold is zero for unchanged channels, so a
+    // pixel is unchanged exactly when its 32-bit lane is zero.
+#if defined(PIXEL_KERNELS_SSE2)
+    const __m128i limit = _mm_set1_epi8(static_cast<char>(threshold));
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ones = _mm_set1_epi8(static_cast<char>(0xFF));
+    auto unchangedLanes = [&](size_t offset) {
+        __m128i va = _mm_loadu_si128(
+            reinterpret_cast<const __m128i *>(a + offset));
+        __m128i vb = _mm_loadu_si128(
+            reinterpret_cast<const __m128i *>(b + offset));
+        __m128i diff = _mm_or_si128(_mm_subs_epu8(va, vb),
+                                    _mm_subs_epu8(vb, va));
+        return _mm_cmpeq_epi32(_mm_subs_epu8(diff, limit), zero);
+    };
+
+    for (; i + 16 <= pixelCount; i += 16)
+    {
+        const size_t offset = i * 4;
+        __m128i low = _mm_packs_epi32(unchangedLanes(offset),
+                                      unchangedLanes(offset + 16));
+        __m128i high = _mm_packs_epi32(unchangedLanes(offset + 32),
+                                       unchangedLanes(offset + 48));
+        __m128i unchanged = _mm_packs_epi16(low, high);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(mask + i),
+                         _mm_xor_si128(unchanged, ones));
+    }
+#elif defined(PIXEL_KERNELS_NEON)
+    const uint8x16_t limit = vdupq_n_u8(threshold);
+    auto unchangedLanes = [&](size_t offset) {
+        uint8x16_t diff = vabdq_u8(vld1q_u8(a + offset), vld1q_u8(b + offset));
+        uint32x4_t excess = vreinterpretq_u32_u8(vqsubq_u8(diff, limit));
+        return vmovn_u32(vceqq_u32(excess, vdupq_n_u32(0)));
+    };
+
+    for (; i + 16 <= pixelCount; i += 16)
+    {
+        const size_t offset = i * 4;
+        uint16x8_t low = vcombine_u16(unchangedLanes(offset),
+                                      unchangedLanes(offset + 16));
+        uint16x8_t high = vcombine_u16(unchangedLanes(offset + 32),
+                                       unchangedLanes(offset + 48));
+        uint8x16_t unchanged = vcombine_u8(vmovn_u16(low), vmovn_u16(high));
+        vst1q_u8(mask + i, vmvnq_u8(unchanged));
+    }
+#endif
+
+    size_t changed = CountSetBytes(mask, i);
+    changed += DiffMaskScalar(a + i * 4, b + i * 4, pixelCount - i, threshold,
+                              mask + i);
+    return changed;
+}
+
+size_t ThresholdToBits(const uint8_t *rgba,
+                       size_t pixelCount,
+                       uint8_t threshold,
+                       uint8_t margin,
+                       uint8_t *bits)
+{
+    size_t i = 0;
+    size_t ambiguous = 0;
+    const uint8_t darkBelow =
+        static_cast<uint8_t>(threshold > margin ? threshold - margin : 0);
+    const uint8_t lightAbove = static_cast<uint8_t>(
+        (std::min)(255, static_cast<int>(threshold) + margin));
+
+    // Each iteration reduces 16 pixels to their green, lightest and darkest
+    // channels, one byte per pixel, then writes two bytes of bits.
+#if defined(PIXEL_KERNELS_SSE2)
+    const __m128i lowByte = _mm_set1_epi32(0xFF);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i inkLevel = _mm_set1_epi8(static_cast<char>(threshold));
+    const __m128i darkLevel = _mm_set1_epi8(static_cast<char>(darkBelow));
+    const __m128i lightLevel = _mm_set1_epi8(static_cast<char>(lightAbove));
+    // Byte 0 of each 32-bit lane ends up holding the wanted channel value,
+    // which packs down to one byte per pixel.
+    auto pack = [&](const __m128i *lanes) {
+        return _mm_packus_epi16(
+            _mm_packs_epi32(_mm_and_si128(lanes[0], lowByte),
+                            _mm_and_si128(lanes[1], lowByte)),
+            _mm_packs_epi32(_mm_and_si128(lanes[2], lowByte),
+                            _mm_and_si128(lanes[3], lowByte)));
+    };
+
+    for (; i + 16 <= pixelCount; i += 16)
+    {
+        __m128i green[4];
+        __m128i lightest[4];
+        __m128i darkest[4];
+        for (int k = 0; k < 4; k++)
+        {
+            const __m128i v = _mm_loadu_si128(
+                reinterpret_cast<const __m128i *>(rgba + (i + k * 4) * 4));
+            const __m128i g = _mm_srli_epi32(v, 8);
+            const __m128i b = _mm_srli_epi32(v, 16);
+            green[k] = g;
+            lightest[k] = _mm_max_epu8(_mm_max_epu8(v, g), b);
+            darkest[k] = _mm_min_epu8(_mm_min_epu8(v, g), b);
+        }
+
+        // a < b exactly when the saturating b - a is nonzero.
+        const __m128i notInk =
+            _mm_cmpeq_epi8(_mm_subs_epu8(inkLevel, pack(green)), zero);
+        const __m128i notDark =
+            _mm_cmpeq_epi8(_mm_subs_epu8(darkLevel, pack(lightest)), zero);
+        const __m128i notLight =
+            _mm_cmpeq_epi8(_mm_subs_epu8(pack(darkest), lightLevel), zero);
+
+        const int ink = ~_mm_movemask_epi8(notInk) & 0xFFFF;
+        bits[i / 8] = static_cast<uint8_t>(ink);
+        bits[i / 8 + 1] = static_cast<uint8_t>(ink >> 8);
+        ambiguous +=
+            PopCount16(_mm_movemask_epi8(_mm_and_si128(notDark, notLight)));
+    }
+#elif defined(PIXEL_KERNELS_NEON)
+    static const uint8_t WEIGHTS[16] = {1, 2, 4, 8, 16, 32, 64, 128,
+                                        1, 2, 4, 8, 16, 32, 64, 128};
+    const uint8x16_t weights = vld1q_u8(WEIGHTS);
+    const uint8x16_t inkLevel = vdupq_n_u8(threshold);
+    const uint8x16_t darkLevel = vdupq_n_u8(darkBelow);
+    const uint8x16_t lightLevel = vdupq_n_u8(lightAbove);
+
+    for (; i + 16 <= pixelCount; i += 16)
+    {
+        const uint8x16x4_t v = vld4q_u8(rgba + i * 4);
+        const uint8x16_t lightest =
+            vmaxq_u8(vmaxq_u8(v.val[0], v.val[1]), v.val[2]);
+        const uint8x16_t darkest =
+            vminq_u8(vminq_u8(v.val[0], v.val[1]), v.val[2]);
+
+        // Weighting each lane by its bit and adding pairs three times
+        // leaves one byte of bits per half.
+        const uint8x16_t ink =
+            vandq_u8(vcltq_u8(v.val[1], inkLevel), weights);
+        uint8x8_t sum = vpadd_u8(vget_low_u8(ink), vget_high_u8(ink));
+        sum = vpadd_u8(sum, sum);
+        sum = vpadd_u8(sum, sum);
+        bits[i / 8] = vget_lane_u8(sum, 0);
+        bits[i / 8 + 1] = vget_lane_u8(sum, 1);
+
+        // Ambiguous lanes are 0xFF; shifted to 1, pairwise widening adds
+        // them up.
+        const uint8x16_t unclear = vandq_u8(vcgeq_u8(lightest, darkLevel),
+                                            vcleq_u8(darkest, lightLevel));
+        const uint64x2_t count = vpaddlq_u32(
+            vpaddlq_u16(vpaddlq_u8(vshrq_n_u8(unclear, 7))));
+        ambiguous += static_cast<size_t>(vgetq_lane_u64(count, 0) +
+                                         vgetq_lane_u64(count, 1));
+    }
+#endif
+
+    ambiguous += ThresholdScalar(rgba + i * 4, pixelCount - i, threshold,
+                                 margin, bits + i / 8);
+    return ambiguous;
+}
+
+void ExpandBits(const uint8_t *bits, size_t pixelCount, uint8_t *rgba)
+{
+    static const ExpandTable table;
+
+    // Whole bytes are two 16-byte copies each, which compilers emit as
+    // single vector moves.
+    const size_t wholeBytes = pixelCount / 8;
+    for (size_t byte = 0; byte < wholeBytes; byte++)
+    {
+        uint8_t *out = rgba + byte * 32;
+        std::memcpy(out, table.pixels[bits[byte] & 0x0F], 16);
+        std::memcpy(out + 16, table.pixels[bits[byte] >> 4], 16);
+    }
+
+    for (size_t i = wholeBytes * 8; i < pixelCount; i++)
+    {
+        const bool ink = (bits[i / 8] >> (i % 8)) & 1;
+        std::memcpy(rgba + i * 4, table.pixels[ink ? 1 : 0], 4);
+    }
+}
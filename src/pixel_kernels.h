@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Build a per-pixel change mask for two RGBA8 images of equal size.
+ *
+ * A pixel is marked 0xFF when any channel differs by more than
+ * @p threshold, otherwise 0x00. Uses SSE2 or NEON when available.
+ *
+ * @param a First image, pixelCount * 4 bytes.
+ * @param b Second image, pixelCount * 4 bytes.
+ * @param pixelCount Number of pixels in each image.
+ * @param threshold Per-channel tolerance for anti-aliasing noise.
+ * @param mask Receives pixelCount bytes.
+ * @return Number of changed pixels.
+ */
+size_t ComputeDiffMask(const uint8_t *a,
+                       const uint8_t *b,
+                       size_t pixelCount,
+                       uint8_t threshold,
+                       uint8_t *mask);
+
+/**
+ * @brief Threshold an RGBA8 image to one bit per pixel.
+ *
+ * Bit k of byte k / 8 (least significant first) is set when pixel k is ink,
+ * meaning its green channel is below @p threshold. Rows are not padded. A
+ * pixel counts as ambiguous unless every color channel is below
+ * threshold - margin (clearly ink) or above threshold + margin (clearly
+ * paper), so gray shading and color show up in the count. Uses SSE2 or
+ * NEON when available.
+ *
+ * @param rgba Pixels, pixelCount * 4 bytes.
+ * @param pixelCount Number of pixels.
+ * @param threshold Green level below which a pixel is ink.
+ * @param margin Distance from the threshold that still counts as clear.
+ * @param bits Receives (pixelCount + 7) / 8 bytes.
+ * @return Number of ambiguous pixels.
+ */
+size_t ThresholdToBits(const uint8_t *rgba,
+                       size_t pixelCount,
+                       uint8_t threshold,
+                       uint8_t margin,
+                       uint8_t *bits);
+
+/**
+ * @brief Expand bits from ThresholdToBits() to opaque black-and-white RGBA8.
+ * @param bits (pixelCount + 7) / 8 bytes.
+ * @param pixelCount Number of pixels.
+ * @param rgba Receives pixelCount * 4 bytes.
+ */
+void ExpandBits(const uint8_t *bits, size_t pixelCount, uint8_t *rgba);
@@ -0,0 +1,336 @@
+#include "png_encoder.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+namespace
+{
+// --- Checksums ---------------------------------------------------------------
+
+uint32_t Crc32(const unsigned char *data, size_t length, uint32_t crc = 0)
+{
+    static const std::array<uint32_t, 256> table = [] {
+        std::array<uint32_t, 256> values{};
+        for (uint32_t i = 0; i < 256; i++)
+        {
+            uint32_t value = i;
+            for (int bit = 0; bit < 8; bit++)
+                value = (value & 1) ? 0xEDB88320u ^ (value >> 1) : value >> 1;
+            values[i] = value;
+        }
+        return values;
+    }();
+
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++)
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+uint32_t Adler32(const unsigned char *data, size_t length)
+{
+    uint32_t a = 1;
+    uint32_t b = 0;
+    while (length > 0)
+    {
+        // 5552 is the largest block that cannot overflow before the modulo.
+        size_t block = length < 5552 ? length : 5552;
+        length -= block;
+        while (block-- > 0)
+        {
+            a += *data++;
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+    }
+    return (b << 16) | a;
+}
+
+// --- Deflate -----------------------------------------------------------------
+
+class BitWriter
+{
+public:
+    explicit BitWriter(std::string &out) : m_out(out) {}
+
+    // Deflate packs values least significant bit first.
+    void Write(uint32_t value, int bitCount)
+    {
+        m_buffer |= static_cast<uint64_t>(value) << m_bitCount;
+        m_bitCount += bitCount;
+        while (m_bitCount >= 8)
+        {
+            m_out += static_cast<char>(m_buffer & 0xFF);
+            m_buffer >>= 8;
+            m_bitCount -= 8;
+        }
+    }
+
+    // Huffman codes are defined most significant bit first.
+    void WriteCode(uint32_t code, int length)
+    {
+        uint32_t reversed = 0;
+        for (int i = 0; i < length; i++)
+            reversed |= ((code >> i) & 1u) << (length - 1 - i);
+        Write(reversed, length);
+    }
+
+    void Flush()
+    {
+        if (m_bitCount > 0)
+            m_out += static_cast<char>(m_buffer & 0xFF);
+        m_buffer = 0;
+        m_bitCount = 0;
+    }
+
+private:
+    std::string &m_out;
+    uint64_t m_buffer = 0;
+    int m_bitCount = 0;
+};
+
+const int LENGTH_BASE[29] = {3,  4,  5,  6,  7,  8,  9,  10,  11,  13,
+                             15, 17, 19, 23, 27, 31, 35, 43,  51,  59,
+                             67, 83, 99, 115, 131, 163, 195, 227, 258};
+const int LENGTH_EXTRA[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                              2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+const int DISTANCE_BASE[30] = {1,    2,    3,    4,     5,     7,    9,
+                               13,   17,   25,   33,    49,    65,   97,
+                               129,  193,  257,  385,   513,   769,  1025,
+                               1537, 2049, 3073, 4097,  6145,  8193, 12289,
+                               16385, 24577};
+const int DISTANCE_EXTRA[30] = {0, 0, 0, 0, 1, 1, 2,  2,  3,  3,
+                                4, 4, 5, 5, 6, 6, 7,  7,  8,  8,
+                                9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+const int WINDOW_SIZE = 32768;
+const int MIN_MATCH = 3;
+const int MAX_MATCH = 258;
+const int HASH_BITS = 15;
+const int MAX_CHAIN = 16;
+
+// Fixed Huffman literal/length alphabet (RFC 1951, 3.2.6).
+void WriteLiteralLength(BitWriter &bits, int symbol)
+{
+    if (symbol < 144)
+        bits.WriteCode(0x30 + symbol, 8);
+    else if (symbol < 256)
+        bits.WriteCode(0x190 + (symbol - 144), 9);
+    else if (symbol < 280)
+        bits.WriteCode(symbol - 256, 7);
+    else
+        bits.WriteCode(0xC0 + (symbol - 280), 8);
+}
+
+void WriteMatch(BitWriter &bits, int length, int distance)
+{
+    int lengthCode = 28;
+    while (LENGTH_BASE[lengthCode] > length)
+        lengthCode--;
+    WriteLiteralLength(bits, 257 + lengthCode);
+    if (LENGTH_EXTRA[lengthCode] > 0)
+        bits.Write(static_cast<uint32_t>(length - LENGTH_BASE[lengthCode]),
+                   LENGTH_EXTRA[lengthCode]);
+
+    int distanceCode = 29;
+    while (DISTANCE_BASE[distanceCode] > distance)
+        distanceCode--;
+    bits.WriteCode(static_cast<uint32_t>(distanceCode), 5);
+    if (DISTANCE_EXTRA[distanceCode] > 0)
+        bits.Write(
+            static_cast<uint32_t>(distance - DISTANCE_BASE[distanceCode]),
+            DISTANCE_EXTRA[distanceCode]);
+}
+
+uint32_t Hash3(const unsigned char *data)
+{
+    uint32_t value = (static_cast<uint32_t>(data[0]) << 16) |
+                     (static_cast<uint32_t>(data[1]) << 8) | data[2];
+    return (value * 2654435761u) >> (32 - HASH_BITS);
+}
+
+void Deflate(const std::vector<unsigned char> &data, std::string &out)
+{
+    BitWriter bits(out);
+    bits.Write(1, 1); // BFINAL
+    bits.Write(1, 2); // BTYPE = fixed Huffman
+
+    const int size = static_cast<int>(data.size());
+    std::vector<int> head(static_cast<size_t>(1) << HASH_BITS, -1);
+    std::vector<int> previous(WINDOW_SIZE, -1);
+    auto insert = [&](int position) {
+        uint32_t hash = Hash3(&data[static_cast<size_t>(position)]);
+        previous[static_cast<size_t>(position & (WINDOW_SIZE - 1))] =
+            head[hash];
+        head[hash] = position;
+    };
+
+    int position = 0;
+    while (position < size)
+    {
+        int bestLength = 0;
+        int bestDistance = 0;
+        if (position + MIN_MATCH <= size)
+        {
+            const int maxLength = (std::min)(MAX_MATCH, size - position);
+            int candidate =
+                head[Hash3(&data[static_cast<size_t>(position)])];
+            for (int chain = 0; chain < MAX_CHAIN && candidate >= 0 &&
+                                position - candidate <= WINDOW_SIZE;
+                 chain++)
+            {
+                int length = 0;
+                while (length < maxLength &&
+                       data[static_cast<size_t>(candidate + length)] ==
+                           data[static_cast<size_t>(position + length)])
+                    length++;
+                if (length > bestLength)
+                {
+                    bestLength = length;
+                    bestDistance = position - candidate;
+                    if (length == maxLength)
+                        break;
+                }
+                candidate = previous[static_cast<size_t>(
+                    candidate & (WINDOW_SIZE - 1))];
+            }
+        }
+
+        if (bestLength >= MIN_MATCH)
+        {
+            WriteMatch(bits, bestLength, bestDistance);
+            const int end = position + bestLength;
+            for (; position < end; position++)
+            {
+                if (position + MIN_MATCH <= size)
+                    insert(position);
+            }
+        }
+        else
+        {
+            WriteLiteralLength(bits, data[static_cast<size_t>(position)]);
+            if (position + MIN_MATCH <= size)
+                insert(position);
+            position++;
+        }
+    }
+
+    WriteLiteralLength(bits, 256);
+    bits.Flush();
+}
+
+// --- PNG ---------------------------------------------------------------------
+
+void AppendUint32(std::string &out, uint32_t value)
+{
+    out += static_cast<char>((value >> 24) & 0xFF);
+    out += static_cast<char>((value >> 16) & 0xFF);
+    out += static_cast<char>((value >> 8) & 0xFF);
+    out += static_cast<char>(value & 0xFF);
+}
+
+void AppendChunk(std::string &out, const char *type, const std::string &data)
+{
+    AppendUint32(out, static_cast<uint32_t>(data.size()));
+    std::string typed(type, 4);
+    typed += data;
+    out += typed;
+    AppendUint32(out, Crc32(reinterpret_cast<const unsigned char *>(
+                                typed.data()),
+                            typed.size()));
+}
+
+// Filters one RGB row into dest (filter byte first), picking whichever of
+// None, Sub and Up has the smallest sum of absolute residuals.
+void FilterRow(const unsigned char *row,
+               const unsigned char *above,
+               size_t rowBytes,
+               unsigned char *dest)
+{
+    uint64_t costs[3] = {0, 0, 0};
+    for (size_t i = 0; i < rowBytes; i++)
+    {
+        unsigned char left = i >= 3 ? row[i - 3] : 0;
+        unsigned char up = above ? above[i] : 0;
+        costs[0] += static_cast<uint64_t>(
+            std::abs(static_cast<signed char>(row[i])));
+        costs[1] += static_cast<uint64_t>(
+            std::abs(static_cast<signed char>(row[i] - left)));
+        costs[2] += static_cast<uint64_t>(
+            std::abs(static_cast<signed char>(row[i] - up)));
+    }
+
+    int filter = 0;
+    for (int candidate = 1; candidate < 3; candidate++)
+    {
+        if (costs[candidate] < costs[filter])
+            filter = candidate;
+    }
+
+    dest[0] = static_cast<unsigned char>(filter);
+    for (size_t i = 0; i < rowBytes; i++)
+    {
+        unsigned char left = i >= 3 ? row[i - 3] : 0;
+        unsigned char up = above ? above[i] : 0;
+        unsigned char predicted = filter == 1 ? left : filter == 2 ? up : 0;
+        dest[i + 1] = static_cast<unsigned char>(row[i] - predicted);
+    }
+}
+} // namespace
+
+bool EncodePng(const unsigned char *rgba,
+               int width,
+               int height,
+               std::string &out)
+{
+    out.clear();
+    if (!rgba || width <= 0 || height <= 0)
+        return false;
+
+    const size_t rowBytes = static_cast<size_t>(width) * 3;
+    std::vector<unsigned char> rgbRow(rowBytes);
+    std::vector<unsigned char> previousRow(rowBytes);
+    std::vector<unsigned char> filtered((rowBytes + 1) *
+                                       static_cast<size_t>(height));
+
+    for (int y = 0; y < height; y++)
+    {
+        const unsigned char *source =
+            rgba + static_cast<size_t>(y) * static_cast<size_t>(width) * 4;
+        for (int x = 0; x < width; x++)
+        {
+            rgbRow[static_cast<size_t>(x) * 3] = source[x * 4];
+            rgbRow[static_cast<size_t>(x) * 3 + 1] = source[x * 4 + 1];
+            rgbRow[static_cast<size_t>(x) * 3 + 2] = source[x * 4 + 2];
+        }
+        FilterRow(rgbRow.data(), y > 0 ? previousRow.data() : nullptr,
+                  rowBytes,
+                  filtered.data() + static_cast<size_t>(y) * (rowBytes + 1));
+        rgbRow.swap(previousRow);
+    }
+
+    std::string zlib;
+    zlib += static_cast<char>(0x78); // deflate, 32K window
+    zlib += static_cast<char>(0x01); // no preset dictionary, fastest level
+    Deflate(filtered, zlib);
+    AppendUint32(zlib, Adler32(filtered.data(), filtered.size()));
+
+    std::string header;
+    AppendUint32(header, static_cast<uint32_t>(width));
+    AppendUint32(header, static_cast<uint32_t>(height));
+    header += static_cast<char>(8); // bit depth
+    header += static_cast<char>(2); // truecolor
+    header += static_cast<char>(0); // deflate
+    header += static_cast<char>(0); // adaptive filtering
+    header += static_cast<char>(0); // no interlace
+
+    out.assign("\x89PNG\r\n\x1a\n", 8);
+    AppendChunk(out, "IHDR", header);
+    AppendChunk(out, "IDAT", zlib);
+    AppendChunk(out, "IEND", std::string());
+    return true;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <string>
+
+/**
+ * @brief Encode an RGBA8 image as an 8-bit RGB PNG.
+ *
+ * Alpha is dropped since rendered pages are opaque. Rows use the cheapest
+ * of the None/Sub/Up filters and the stream is compressed with a
+ * single-block LZ77 + fixed-Huffman deflate. That keeps the encoder
+ * dependency-free and fast; on sheet music, which is mostly long runs of
+ * white, it still gets most of zlib's ratio.
+ *
+ * @param rgba Pixels, tightly packed, top row first.
+ * @param width Image width in pixels.
+ * @param height Image height in pixels.
+ * @param out Receives the PNG file bytes.
+ * @return true on success, false for an empty image.
+ */
+bool EncodePng(const unsigned char *rgba,
+               int width,
+               int height,
+               std::string &out);
@@ -0,0 +1,229 @@
+#include "presenter_window.h"
+
+#include "gl_functions.h"
+
+#include <cstdio>
+
+namespace
+{
+// Prefer a monitor other than the one the main window is on.
+GLFWmonitor *FindStageMonitor(GLFWwindow *mainWindow)
+{
+    int count = 0;
+    GLFWmonitor **monitors = glfwGetMonitors(&count);
+    if (count < 2)
+        return nullptr;
+
+    int windowX = 0;
+    int windowY = 0;
+    int windowWidth = 0;
+    int windowHeight = 0;
+    glfwGetWindowPos(mainWindow, &windowX, &windowY);
+    glfwGetWindowSize(mainWindow, &windowWidth, &windowHeight);
+    const int centerX = windowX + windowWidth / 2;
+    const int centerY = windowY + windowHeight / 2;
+
+    for (int i = 0; i < count; i++)
+    {
+        int x = 0;
+        int y = 0;
+        glfwGetMonitorPos(monitors[i], &x, &y);
+        const GLFWvidmode *mode = glfwGetVideoMode(monitors[i]);
+        if (!mode)
+            continue;
+        const bool containsMain = centerX >= x && centerX < x + mode->width &&
+                                  centerY >= y && centerY < y + mode->height;
+        if (!containsMain)
+            return monitors[i];
+    }
+    return nullptr;
+}
+} // namespace
+
+PresenterWindow::~PresenterWindow() { Close(); }
+
+bool PresenterWindow::Open(GLFWwindow *shareWith)
+{
+    if (m_window)
+        return true;
+    if (!LoadGlFunctions())
+    {
+        printf("[Presenter] Framebuffer blits are not supported\n");
+        return false;
+    }
+
+    // Context version hints set for the main window are still in effect,
+    // which sharing requires.
+    GLFWmonitor *monitor = FindStageMonitor(shareWith);
+    const GLFWvidmode *mode = monitor ? glfwGetVideoMode(monitor) : nullptr;
+    if (mode)
+    {
+        // Matching the current mode gives a borderless window instead of a
+        // display mode change.
+        glfwWindowHint(GLFW_RED_BITS, mode->redBits);
+        glfwWindowHint(GLFW_GREEN_BITS, mode->greenBits);
+        glfwWindowHint(GLFW_BLUE_BITS, mode->blueBits);
+        glfwWindowHint(GLFW_REFRESH_RATE, mode->refreshRate);
+        m_window = glfwCreateWindow(mode->width, mode->height,
+                                   "PDF Manager - Performer", monitor,
+                                   shareWith);
+        glfwWindowHint(GLFW_REFRESH_RATE, GLFW_DONT_CARE);
+    }
+    else
+    {
+        m_window = glfwCreateWindow(960, 720, "PDF Manager - Performer",
+                                    nullptr, shareWith);
+    }
+    if (!m_window)
+    {
+        printf("[Presenter] Could not create window\n");
+        return false;
+    }
+
+    glfwSetWindowUserPointer(m_window, this);
+    glfwSetKeyCallback(m_window, KeyCallback);
+
+    GLFWwindow *previous = glfwGetCurrentContext();
+    glfwMakeContextCurrent(m_window);
+    // The main window already waits for vsync; waiting again here would
+    // halve the frame rate of both.
+    glfwSwapInterval(0);
+    Gl().GenFramebuffers(1, &m_readFramebuffer);
+    glfwMakeContextCurrent(previous);
+
+    printf("[Presenter] Opened %s\n",
+           monitor ? glfwGetMonitorName(monitor) : "windowed");
+    return true;
+}
+
+void PresenterWindow::Close()
+{
+    if (!m_window)
+        return;
+
+    GLFWwindow *previous = glfwGetCurrentContext();
+    glfwMakeContextCurrent(m_window);
+    if (m_readFramebuffer)
+        Gl().DeleteFramebuffers(1, &m_readFramebuffer);
+    m_readFramebuffer = 0;
+    glfwMakeContextCurrent(previous == m_window ? nullptr : previous);
+
+    glfwDestroyWindow(m_window);
+    m_window = nullptr;
+}
+
+bool PresenterWindow::ShouldClose() const
+{
+    return m_window && glfwWindowShouldClose(m_window);
+}
+
+void PresenterWindow::SetZoom(float zoom)
+{
+    m_zoom = zoom < MIN_ZOOM ? MIN_ZOOM : zoom > MAX_ZOOM ? MAX_ZOOM : zoom;
+}
+
+void PresenterWindow::Render(GLuint texture,
+                             int textureWidth,
+                             int textureHeight)
+{
+    if (!m_window)
+        return;
+
+    GLFWwindow *previous = glfwGetCurrentContext();
+    glfwMakeContextCurrent(m_window);
+
+    int width = 0;
+    int height = 0;
+    glfwGetFramebufferSize(m_window, &width, &height);
+    glViewport(0, 0, width, height);
+    // Stage monitors are often in dark rooms; keep the margins black.
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    if (texture && textureWidth > 0 && textureHeight > 0 && width > 0 &&
+        height > 0)
+    {
+        const GlFunctions &gl = Gl();
+        gl.BindFramebuffer(GL_READ_FRAMEBUFFER, m_readFramebuffer);
+        gl.FramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                                GL_TEXTURE_2D, texture, 0);
+        if (gl.CheckFramebufferStatus(GL_READ_FRAMEBUFFER) ==
+            GL_FRAMEBUFFER_COMPLETE)
+        {
+            const float fitWidth =
+                static_cast<float>(width) / static_cast<float>(textureWidth);
+            const float fitHeight =
+                static_cast<float>(height) / static_cast<float>(textureHeight);
+            float scale = m_fit == PresenterFit::Width
+                              ? fitWidth
+                              : (fitWidth < fitHeight ? fitWidth : fitHeight);
+            scale *= m_zoom;
+
+            const int drawWidth =
+                static_cast<int>(static_cast<float>(textureWidth) * scale);
+            const int drawHeight =
+                static_cast<int>(static_cast<float>(textureHeight) * scale);
+            const int left = (width - drawWidth) / 2;
+            // Fit to width reads from the top; anything taller than the
+            // screen is cropped at the bottom.
+            const int top = m_fit == PresenterFit::Width && drawHeight > height
+                                ? 0
+                                : (height - drawHeight) / 2;
+
+            // Texture row 0 is the top of the page but framebuffer row 0 is
+            // the bottom of the window, so flip while blitting.
+            gl.BindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+            gl.BlitFramebuffer(0, 0, textureWidth, textureHeight, left,
+                               height - top, left + drawWidth,
+                               height - top - drawHeight, GL_COLOR_BUFFER_BIT,
+                               GL_LINEAR);
+        }
+        gl.FramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                                GL_TEXTURE_2D, 0, 0);
+        gl.BindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    }
+
+    glfwSwapBuffers(m_window);
+    glfwMakeContextCurrent(previous);
+}
+
+void PresenterWindow::KeyCallback(GLFWwindow *window,
+                                  int key,
+                                  int,
+                                  int action,
+                                  int)
+{
+    if (action != GLFW_PRESS && action != GLFW_REPEAT)
+        return;
+
+    auto *presenter =
+        static_cast<PresenterWindow *>(glfwGetWindowUserPointer(window));
+    if (!presenter)
+        return;
+
+    switch (key)
+    {
+    case GLFW_KEY_F:
+        presenter->SetFit(presenter->GetFit() == PresenterFit::Page
+                              ? PresenterFit::Width
+                              : PresenterFit::Page);
+        break;
+    case GLFW_KEY_EQUAL:
+    case GLFW_KEY_KP_ADD:
+        presenter->SetZoom(presenter->GetZoom() * 1.1f);
+        break;
+    case GLFW_KEY_MINUS:
+    case GLFW_KEY_KP_SUBTRACT:
+        presenter->SetZoom(presenter->GetZoom() / 1.1f);
+        break;
+    case GLFW_KEY_0:
+    case GLFW_KEY_KP_0:
+        presenter->SetZoom(1.0f);
+        break;
+    case GLFW_KEY_ESCAPE:
+        glfwSetWindowShouldClose(window, GLFW_TRUE);
+        break;
+    default:
+        break;
+    }
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <GLFW/glfw3.h>
+
+enum class PresenterFit
+{
+    Page,
+    Width
+};
+
+/**
+ * @brief A borderless performer window for a stage monitor.
+ *
+ * The window's GL context shares objects with the main window, so it
+ * displays the viewer's page texture directly instead of uploading its own
+ * copy. Fit and zoom are independent of the main viewer and can be changed
+ * from the keyboard while the window has focus: F toggles fit, +/- zoom,
+ * 0 resets.
+ */
+class PresenterWindow
+{
+public:
+    PresenterWindow() = default;
+    ~PresenterWindow();
+
+    PresenterWindow(const PresenterWindow &) = delete;
+    PresenterWindow &operator=(const PresenterWindow &) = delete;
+
+    /**
+     * @brief Create the window, full screen on a secondary monitor if one
+     *        is connected and windowed otherwise.
+     * @param shareWith Window whose context owns the page textures.
+     * @return false if the window or GL entry points are unavailable.
+     */
+    bool Open(GLFWwindow *shareWith);
+    void Close();
+    bool IsOpen() const { return m_window != nullptr; }
+
+    /**
+     * @brief Whether the user asked to close the window.
+     */
+    bool ShouldClose() const;
+
+    /**
+     * @brief Draw a page texture and present it. Call on the main thread
+     *        after the main window's swap; restores the current context.
+     */
+    void Render(GLuint texture, int textureWidth, int textureHeight);
+
+    PresenterFit GetFit() const { return m_fit; }
+    void SetFit(PresenterFit fit) { m_fit = fit; }
+    float GetZoom() const { return m_zoom; }
+    void SetZoom(float zoom);
+
+private:
+    static void KeyCallback(GLFWwindow *window,
+                            int key,
+                            int scancode,
+                            int action,
+                            int mods);
+
+    GLFWwindow *m_window = nullptr;
+    // Framebuffer objects are not shared between contexts, so the blit
+    // source lives in this window's context.
+    GLuint m_readFramebuffer = 0;
+    PresenterFit m_fit = PresenterFit::Page;
+    float m_zoom = 1.0f;
+
+    static constexpr float MIN_ZOOM = 0.5f;
+    static constexpr float MAX_ZOOM = 4.0f;
+};
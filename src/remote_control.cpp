@@ -0,0 +1,1091 @@
+#include "remote_control.h"
+
+#include "page_mirror.h"
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <cerrno>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <random>
+
+namespace
+{
+#ifdef _WIN32
+using SocketHandle = SOCKET;
+const SocketHandle INVALID_SOCKET_HANDLE = INVALID_SOCKET;
+void CloseSocket(SocketHandle socket) { closesocket(socket); }
+#else
+using SocketHandle = int;
+const SocketHandle INVALID_SOCKET_HANDLE = -1;
+void CloseSocket(SocketHandle socket) { close(socket); }
+#endif
+
+#ifdef MSG_NOSIGNAL
+const int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+const int SEND_FLAGS = 0;
+#endif
+
+// Followers hold their event stream open, so leave room for a band.
+const int MAX_CLIENTS = 32;
+const size_t MAX_REQUEST_BYTES = 8192;
+
+// Replies waiting on a slow client. Page images are a few MB at most, so
+// a client this far behind has stopped reading.
+const size_t MAX_OUTBOUND_BYTES = size_t(32) << 20;
+
+// A client whose pending reply makes no progress for this long is dropped.
+const auto SEND_STALL_TIMEOUT = std::chrono::seconds(10);
+
+// Shorter tokens are refused when LAN access is on.
+const size_t MIN_TOKEN_LENGTH = 16;
+
+// select() wakes immediately for traffic; the timeout only bounds how long
+// Stop() waits for the thread to notice.
+const int SELECT_TIMEOUT_MS = 50;
+
+// Keeps idle event streams from being dropped by proxies and sleeping
+// tablets, and lets the server notice followers that went away.
+const auto EVENT_HEARTBEAT = std::chrono::seconds(15);
+
+const char CONTROL_PAGE[] = R"HTML(<!doctype html>
+<html><head><meta charset="utf-8">
+<meta name="viewport" content="width=device-width,initial-scale=1">
+<title>PDF Manager Remote</title>
+<style>
+body{margin:0;font-family:sans-serif;background:#12141a;color:#ddd;
+display:flex;flex-direction:column;height:100vh}
+#status{padding:12px;text-align:center}
+#buttons{flex:1;display:flex}
+button{flex:1;margin:8px;font-size:2em;border:0;border-radius:12px;
+background:#2b3240;color:#fff}
+button:active{background:#46516a}
+</style></head><body>
+<div id="status">Connecting...</div>
+<div id="buttons">
+<button onclick="send('/prev')">&#9664; Prev</button>
+<button onclick="send('/next')">Next &#9654;</button>
+</div>
+<script>
+const auth=location.search;
+function send(path){fetch(path+auth,{method:'POST'}).then(refresh);}
+function refresh(){fetch('/status'+auth).then(r=>r.json()).then(s=>{
+document.getElementById('status').textContent=s.title?
+s.title+' — page '+s.page+' / '+s.pageCount:'No document';});}
+refresh();setInterval(refresh,1000);
+</script></body></html>
+)HTML";
+
+const char MIRROR_PAGE[] = R"HTML(<!doctype html>
+<html><head><meta charset="utf-8">
+<meta name="viewport" content="width=device-width,initial-scale=1">
+<title>PDF Manager Follower</title>
+<style>
+html,body{margin:0;height:100%;background:#000}
+#page{width:100%;height:100%;object-fit:contain;display:block}
+#status{position:fixed;left:0;right:0;bottom:0;padding:4px 8px;
+font:12px sans-serif;color:#aaa;background:rgba(0,0,0,.5)}
+</style></head><body>
+<img id="page" alt="">
+<div id="status">Connecting...</div>
+<script>
+const auth=location.search;
+const img=document.getElementById('page');
+const status=document.getElementById('status');
+let preload={};
+function show(s){
+if(!s.enabled){status.textContent='Mirroring is off';return;}
+status.textContent=s.title?s.title+' — page '+s.page+' / '+s.pageCount:
+'No document';
+if(s.image&&img.getAttribute('src')!==s.image+auth)img.src=s.image+auth;
+if(Object.keys(preload).length>16)preload={};
+for(const u of s.upcoming){if(!preload[u]){preload[u]=new Image();
+preload[u].src=u+auth;}}}
+const events=new EventSource('/mirror/events'+auth);
+events.onmessage=e=>show(JSON.parse(e.data));
+events.onerror=()=>{status.textContent='Reconnecting...';};
+</script></body></html>
+)HTML";
+
+struct ClientConnection
+{
+    SocketHandle socket = INVALID_SOCKET_HANDLE;
+    std::string buffer;
+    // Address the client connected to, accepted as a Host header.
+    std::string localAddress;
+
+    // Reply bytes the socket has not taken yet, from outboundOffset on.
+    // Further requests wait until it drains.
+    std::string outbound;
+    size_t outboundOffset = 0;
+    bool closeAfterSend = false;
+    std::chrono::steady_clock::time_point lastSendProgress;
+
+    // Set once the client has asked for /mirror/events; the connection
+    // then only receives pushed events.
+    bool eventStream = false;
+    bool sentState = false;
+    uint64_t sentSequence = 0;
+    bool sentEnabled = false;
+    std::chrono::steady_clock::time_point lastEventSent;
+};
+
+bool WouldBlock()
+{
+#ifdef _WIN32
+    const int error = WSAGetLastError();
+    return error == WSAEWOULDBLOCK || error == WSAEINTR;
+#else
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+#endif
+}
+
+// Sends what the socket takes without blocking.
+// @return false if the connection failed.
+bool FlushOutbound(ClientConnection &client)
+{
+    while (client.outboundOffset < client.outbound.size())
+    {
+        const int chunk = static_cast<int>(
+            (std::min)(client.outbound.size() - client.outboundOffset,
+                       static_cast<size_t>(1 << 20)));
+        const int result =
+            send(client.socket, client.outbound.data() + client.outboundOffset,
+                 chunk, SEND_FLAGS);
+        if (result < 0 && WouldBlock())
+            return true;
+        if (result <= 0)
+            return false;
+        client.outboundOffset += static_cast<size_t>(result);
+        client.lastSendProgress = std::chrono::steady_clock::now();
+    }
+    client.outbound.clear();
+    client.outboundOffset = 0;
+    return true;
+}
+
+// Queues data behind anything still pending and sends what it can now.
+// @return false if the connection failed or fell too far behind.
+bool QueueSend(ClientConnection &client, const std::string &data)
+{
+    if (client.outbound.empty())
+        client.lastSendProgress = std::chrono::steady_clock::now();
+    if (client.outbound.size() - client.outboundOffset + data.size() >
+        MAX_OUTBOUND_BYTES)
+        return false;
+    client.outbound += data;
+    return FlushOutbound(client);
+}
+
+// select() watches at most FD_SETSIZE sockets, and on POSIX it cannot
+// watch a descriptor numbered FD_SETSIZE or above at all.
+bool FitsInSelectSet(SocketHandle socket, size_t watchedSockets)
+{
+#ifdef _WIN32
+    (void)socket;
+    return watchedSockets < FD_SETSIZE;
+#else
+    return socket < FD_SETSIZE && watchedSockets < FD_SETSIZE;
+#endif
+}
+
+// One slow client must not hold up the others, so sends never block.
+bool ConfigureClientSocket(SocketHandle socket)
+{
+#ifdef _WIN32
+    u_long nonBlocking = 1;
+    if (ioctlsocket(socket, FIONBIO, &nonBlocking) != 0)
+        return false;
+#else
+    const int flags = fcntl(socket, F_GETFL, 0);
+    if (flags < 0 || fcntl(socket, F_SETFL, flags | O_NONBLOCK) != 0)
+        return false;
+#endif
+
+    // Responses are tiny; send them without waiting to coalesce.
+    int noDelay = 1;
+    setsockopt(socket, IPPROTO_TCP, TCP_NODELAY,
+               reinterpret_cast<const char *>(&noDelay), sizeof(noDelay));
+
+#ifdef SO_NOSIGPIPE
+    int noSigPipe = 1;
+    setsockopt(socket, SOL_SOCKET, SO_NOSIGPIPE, &noSigPipe,
+               sizeof(noSigPipe));
+#endif
+    return true;
+}
+
+std::string HttpResponse(int status,
+                         const char *reason,
+                         const char *contentType,
+                         const std::string &body,
+                         bool keepAlive,
+                         const char *cacheControl = "no-store",
+                         const char *extraHeaders = "")
+{
+    std::string response = "HTTP/1.1 " + std::to_string(status) + " " +
+                           reason + "\r\n";
+    response += "Content-Type: ";
+    response += contentType;
+    response += "\r\nContent-Length: " + std::to_string(body.size()) + "\r\n";
+    response += "Cache-Control: ";
+    response += cacheControl;
+    response += "\r\n";
+    response += extraHeaders;
+    response += keepAlive ? "Connection: keep-alive\r\n"
+                          : "Connection: close\r\n";
+    response += "\r\n";
+    response += body;
+    return response;
+}
+
+std::string JsonEscape(const std::string &text)
+{
+    std::string escaped;
+    escaped.reserve(text.size());
+    for (char c : text)
+    {
+        switch (c)
+        {
+        case '"':
+            escaped += "\\\"";
+            break;
+        case '\\':
+            escaped += "\\\\";
+            break;
+        case '\n':
+            escaped += "\\n";
+            break;
+        case '\r':
+            escaped += "\\r";
+            break;
+        case '\t':
+            escaped += "\\t";
+            break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20)
+            {
+                char code[8];
+                snprintf(code, sizeof(code), "\\u%04x", c);
+                escaped += code;
+            }
+            else
+            {
+                escaped += c;
+            }
+            break;
+        }
+    }
+    return escaped;
+}
+
+// Parses the one-based number after a route prefix such as "/page/".
+bool ParseRouteNumber(const std::string &path,
+                      const char *prefix,
+                      int &value)
+{
+    const size_t prefixLength = std::strlen(prefix);
+    if (path.compare(0, prefixLength, prefix) != 0 ||
+        path.size() == prefixLength || path.size() > prefixLength + 6)
+        return false;
+
+    value = 0;
+    for (size_t i = prefixLength; i < path.size(); i++)
+    {
+        if (!std::isdigit(static_cast<unsigned char>(path[i])))
+            return false;
+        value = value * 10 + (path[i] - '0');
+    }
+    return value >= 1;
+}
+
+// Parses "/mirror/page/<doc>/<N>.png" with a one-based page number.
+bool ParseMirrorPagePath(const std::string &path,
+                         uint64_t &documentId,
+                         int &page)
+{
+    const char prefix[] = "/mirror/page/";
+    const char suffix[] = ".png";
+    const size_t prefixLength = sizeof(prefix) - 1;
+    const size_t suffixLength = sizeof(suffix) - 1;
+    if (path.size() <= prefixLength + suffixLength ||
+        path.compare(0, prefixLength, prefix) != 0 ||
+        path.compare(path.size() - suffixLength, suffixLength, suffix) != 0)
+        return false;
+
+    const std::string numbers = path.substr(
+        prefixLength, path.size() - prefixLength - suffixLength);
+    const size_t slash = numbers.find('/');
+    if (slash == std::string::npos || slash == 0 || slash > 19 ||
+        numbers.size() - slash - 1 < 1 || numbers.size() - slash - 1 > 6)
+        return false;
+
+    documentId = 0;
+    for (size_t i = 0; i < slash; i++)
+    {
+        if (!std::isdigit(static_cast<unsigned char>(numbers[i])))
+            return false;
+        documentId = documentId * 10 + static_cast<uint64_t>(numbers[i] - '0');
+    }
+    page = 0;
+    for (size_t i = slash + 1; i < numbers.size(); i++)
+    {
+        if (!std::isdigit(static_cast<unsigned char>(numbers[i])))
+            return false;
+        page = page * 10 + (numbers[i] - '0');
+    }
+    if (page < 1)
+        return false;
+    page--;
+    return true;
+}
+
+std::string MirrorPageUrl(uint64_t documentId, int page)
+{
+    return "/mirror/page/" + std::to_string(documentId) + "/" +
+           std::to_string(page + 1) + ".png";
+}
+
+std::string ToLowerAscii(std::string text)
+{
+    for (char &c : text)
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    return text;
+}
+
+std::string LocalAddress(SocketHandle socket)
+{
+    sockaddr_in address;
+    socklen_t addressLength = sizeof(address);
+    char text[INET_ADDRSTRLEN] = {};
+    if (getsockname(socket, reinterpret_cast<sockaddr *>(&address),
+                    &addressLength) != 0 ||
+        !inet_ntop(AF_INET, &address.sin_addr, text, sizeof(text)))
+        return "";
+    return text;
+}
+
+// A rebinding attack reaches the server under the attacker's host name,
+// so only the names this machine itself answers to are accepted.
+bool IsAllowedHost(const std::string &host, const std::string &localAddress)
+{
+    std::string name = host;
+    if (!name.empty() && name[0] == '[')
+        name = name.substr(0, name.find(']') + 1);
+    else
+        name = name.substr(0, name.find(':'));
+
+    return name == "localhost" || name == "127.0.0.1" || name == "[::1]" ||
+           (!localAddress.empty() && name == localAddress);
+}
+
+// Value of a "key=value" pair in a query string, or empty if absent.
+std::string QueryValue(const std::string &query, const char *key)
+{
+    const std::string prefix = std::string(key) + "=";
+    size_t start = 0;
+    while (start <= query.size())
+    {
+        size_t end = query.find('&', start);
+        if (end == std::string::npos)
+            end = query.size();
+        if (query.compare(start, prefix.size(), prefix) == 0)
+            return query.substr(start + prefix.size(),
+                                end - start - prefix.size());
+        start = end + 1;
+    }
+    return "";
+}
+
+// Compares without returning early, so timing does not reveal how much of
+// a guessed token was right.
+bool TokensEqual(const std::string &given, const std::string &expected)
+{
+    if (given.size() != expected.size())
+        return false;
+    unsigned char difference = 0;
+    for (size_t i = 0; i < given.size(); i++)
+        difference |= static_cast<unsigned char>(given[i] ^ expected[i]);
+    return difference == 0;
+}
+
+// Value of a header in a lowercased header block, or empty if absent.
+std::string HeaderValue(const std::string &headers, const char *name)
+{
+    std::string key = std::string("\r\n") + name + ":";
+    size_t start = headers.find(key);
+    if (start == std::string::npos)
+        return "";
+
+    start += key.size();
+    size_t end = headers.find("\r\n", start);
+    std::string value = headers.substr(start, end - start);
+    value.erase(0, value.find_first_not_of(' '));
+    value.erase(value.find_last_not_of(' ') + 1);
+    return value;
+}
+} // namespace
+
+RemoteControlServer::~RemoteControlServer() { Stop(); }
+
+void RemoteControlServer::Configure(bool enabled,
+                                    int port,
+                                    bool allowLan,
+                                    const std::string &token)
+{
+    if (enabled == m_enabled && port == m_port && allowLan == m_allowLan &&
+        token == m_token)
+        return;
+
+    // The server thread reads these, so change them only once it is gone.
+    Stop();
+    m_enabled = enabled;
+    m_port = port;
+    m_allowLan = allowLan;
+    m_token = token;
+    m_lastError.clear();
+    if (enabled)
+        Start(port, allowLan);
+}
+
+bool RemoteControlServer::Start(int port, bool allowLan)
+{
+    if (port < 1 || port > 65535)
+    {
+        m_lastError = "Invalid port";
+        return false;
+    }
+    if (allowLan && m_token.size() < MIN_TOKEN_LENGTH)
+    {
+        m_lastError = "Network access needs an access token";
+        return false;
+    }
+
+#ifdef _WIN32
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0)
+    {
+        m_lastError = "Winsock initialization failed";
+        return false;
+    }
+#endif
+
+    SocketHandle listenSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (listenSocket == INVALID_SOCKET_HANDLE)
+    {
+        m_lastError = "Could not create socket";
+#ifdef _WIN32
+        WSACleanup();
+#endif
+        return false;
+    }
+
+#ifndef _WIN32
+    // Allow an immediate restart on the same port after Stop().
+    int reuse = 1;
+    setsockopt(listenSocket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+#endif
+
+    sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<unsigned short>(port));
+    address.sin_addr.s_addr = htonl(allowLan ? INADDR_ANY : INADDR_LOOPBACK);
+
+    if (bind(listenSocket, reinterpret_cast<const sockaddr *>(&address),
+             sizeof(address)) != 0 ||
+        listen(listenSocket, 8) != 0)
+    {
+        m_lastError = "Port " + std::to_string(port) + " is not available";
+        CloseSocket(listenSocket);
+#ifdef _WIN32
+        WSACleanup();
+#endif
+        printf("[RemoteControl] %s\n", m_lastError.c_str());
+        return false;
+    }
+
+    // Without the wake socket followers still update, but only on the next
+    // select() timeout.
+    SocketHandle wakeSocket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (wakeSocket != INVALID_SOCKET_HANDLE)
+    {
+        sockaddr_in wakeAddress;
+        std::memset(&wakeAddress, 0, sizeof(wakeAddress));
+        wakeAddress.sin_family = AF_INET;
+        wakeAddress.sin_port = 0;
+        wakeAddress.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t addressLength = sizeof(wakeAddress);
+        if (bind(wakeSocket, reinterpret_cast<const sockaddr *>(&wakeAddress),
+                 sizeof(wakeAddress)) == 0 &&
+            getsockname(wakeSocket, reinterpret_cast<sockaddr *>(&wakeAddress),
+                        &addressLength) == 0)
+        {
+            std::lock_guard<std::mutex> lock(m_wakeMutex);
+            m_wakeSocket = static_cast<intptr_t>(wakeSocket);
+            m_wakePort = ntohs(wakeAddress.sin_port);
+        }
+        else
+        {
+            CloseSocket(wakeSocket);
+        }
+    }
+
+    m_stopping = false;
+    m_thread = std::thread(&RemoteControlServer::Run, this,
+                           static_cast<intptr_t>(listenSocket));
+    printf("[RemoteControl] Listening on %s:%d\n",
+           allowLan ? "0.0.0.0" : "127.0.0.1", port);
+    return true;
+}
+
+void RemoteControlServer::Stop()
+{
+    if (!m_thread.joinable())
+        return;
+
+    m_stopping = true;
+    m_thread.join();
+    m_followerCount = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        if (m_wakeSocket != static_cast<intptr_t>(INVALID_SOCKET_HANDLE))
+            CloseSocket(static_cast<SocketHandle>(m_wakeSocket));
+        m_wakeSocket = static_cast<intptr_t>(INVALID_SOCKET_HANDLE);
+        m_wakePort = 0;
+    }
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+void RemoteControlServer::Wake()
+{
+    std::lock_guard<std::mutex> lock(m_wakeMutex);
+    if (m_wakeSocket == static_cast<intptr_t>(INVALID_SOCKET_HANDLE))
+        return;
+
+    sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(m_wakePort);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    const char signal = 1;
+    sendto(static_cast<SocketHandle>(m_wakeSocket), &signal, 1, 0,
+           reinterpret_cast<const sockaddr *>(&address), sizeof(address));
+}
+
+bool RemoteControlServer::PopCommand(RemoteCommand &command)
+{
+    return m_commands.Pop(command);
+}
+
+void RemoteControlServer::PublishState(const RemoteViewState &state)
+{
+    std::lock_guard<std::mutex> lock(m_stateMutex);
+    m_viewState = state;
+}
+
+void RemoteControlServer::NotifyDispatched(const RemoteCommand &command)
+{
+    m_awaitingPresent.push_back(command.receivedAt);
+}
+
+void RemoteControlServer::NotifyFramePresented()
+{
+    if (m_awaitingPresent.empty())
+        return;
+
+    const auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(m_stateMutex);
+    for (const auto &receivedAt : m_awaitingPresent)
+    {
+        double ms =
+            std::chrono::duration<double, std::milli>(now - receivedAt)
+                .count();
+        m_latency.samples++;
+        m_latency.lastMs = ms;
+        m_latency.averageMs +=
+            (ms - m_latency.averageMs) / static_cast<double>(m_latency.samples);
+        m_latency.maxMs = (std::max)(m_latency.maxMs, ms);
+    }
+    m_awaitingPresent.clear();
+}
+
+RemoteLatencyStats RemoteControlServer::GetLatencyStats() const
+{
+    std::lock_guard<std::mutex> lock(m_stateMutex);
+    return m_latency;
+}
+
+void RemoteControlServer::Run(intptr_t listenHandle)
+{
+    const SocketHandle listenSocket = static_cast<SocketHandle>(listenHandle);
+    SocketHandle wakeSocket;
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        wakeSocket = static_cast<SocketHandle>(m_wakeSocket);
+    }
+    std::vector<ClientConnection> clients;
+
+    while (!m_stopping)
+    {
+        fd_set readSet;
+        fd_set writeSet;
+        FD_ZERO(&readSet);
+        FD_ZERO(&writeSet);
+        FD_SET(listenSocket, &readSet);
+        SocketHandle maxSocket = listenSocket;
+        if (wakeSocket != INVALID_SOCKET_HANDLE)
+        {
+            FD_SET(wakeSocket, &readSet);
+            maxSocket = (std::max)(maxSocket, wakeSocket);
+        }
+        for (const ClientConnection &client : clients)
+        {
+            // A client with a reply still pending is not read from, so it
+            // cannot queue up more work than it takes in.
+            if (client.outbound.empty())
+                FD_SET(client.socket, &readSet);
+            else
+                FD_SET(client.socket, &writeSet);
+            maxSocket = (std::max)(maxSocket, client.socket);
+        }
+
+        timeval timeout = {0, SELECT_TIMEOUT_MS * 1000};
+        int ready = select(static_cast<int>(maxSocket + 1), &readSet,
+                           &writeSet, nullptr, &timeout);
+        if (ready < 0)
+            continue;
+        if (ready == 0)
+        {
+            FD_ZERO(&readSet);
+            FD_ZERO(&writeSet);
+        }
+
+        if (wakeSocket != INVALID_SOCKET_HANDLE &&
+            FD_ISSET(wakeSocket, &readSet))
+        {
+            // The datagram only exists to end select(); drop it.
+            char signal[16];
+            recv(wakeSocket, signal, sizeof(signal), 0);
+        }
+
+        if (FD_ISSET(listenSocket, &readSet))
+        {
+            SocketHandle accepted = accept(listenSocket, nullptr, nullptr);
+            if (accepted != INVALID_SOCKET_HANDLE)
+            {
+                // The listening and wake sockets are watched too.
+                if (static_cast<int>(clients.size()) >= MAX_CLIENTS ||
+                    !FitsInSelectSet(accepted, clients.size() + 2) ||
+                    !ConfigureClientSocket(accepted))
+                {
+                    CloseSocket(accepted);
+                }
+                else
+                {
+                    ClientConnection client;
+                    client.socket = accepted;
+                    client.localAddress = LocalAddress(accepted);
+                    clients.push_back(client);
+                }
+            }
+        }
+
+        const auto now = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < clients.size();)
+        {
+            ClientConnection &client = clients[i];
+            bool open = true;
+
+            if (FD_ISSET(client.socket, &readSet))
+            {
+                char buffer[2048];
+                int received =
+                    recv(client.socket, buffer, sizeof(buffer), 0);
+                if (received == 0 || (received < 0 && !WouldBlock()))
+                    open = false;
+                else if (received > 0 && !client.eventStream)
+                    client.buffer.append(buffer,
+                                         static_cast<size_t>(received));
+            }
+
+            if (open && FD_ISSET(client.socket, &writeSet))
+                open = FlushOutbound(client);
+
+            // Answer every complete request in the buffer; pipelined
+            // requests are handled in order, each once the previous reply
+            // has gone out.
+            size_t headerEnd;
+            while (open && !client.eventStream && !client.closeAfterSend &&
+                   client.outbound.empty() &&
+                   (headerEnd = client.buffer.find("\r\n\r\n")) !=
+                       std::string::npos)
+            {
+                std::string headers =
+                    ToLowerAscii(client.buffer.substr(0, headerEnd + 2));
+                size_t bodyLength = 0;
+                std::string contentLength =
+                    HeaderValue(headers, "content-length");
+                if (!contentLength.empty())
+                    bodyLength = static_cast<size_t>(
+                        std::strtoul(contentLength.c_str(), nullptr, 10));
+                if (bodyLength > MAX_REQUEST_BYTES)
+                {
+                    open = false;
+                    break;
+                }
+                if (client.buffer.size() < headerEnd + 4 + bodyLength)
+                    break;
+
+                std::string requestLine =
+                    client.buffer.substr(0, client.buffer.find("\r\n"));
+                client.buffer.erase(0, headerEnd + 4 + bodyLength);
+
+                size_t methodEnd = requestLine.find(' ');
+                size_t pathEnd = requestLine.find(' ', methodEnd + 1);
+                if (methodEnd == std::string::npos ||
+                    pathEnd == std::string::npos)
+                {
+                    open = false;
+                    break;
+                }
+                std::string method = requestLine.substr(0, methodEnd);
+                std::string path =
+                    requestLine.substr(methodEnd + 1, pathEnd - methodEnd - 1);
+                std::string query;
+                const size_t queryStart = path.find('?');
+                if (queryStart != std::string::npos)
+                {
+                    query = path.substr(queryStart + 1);
+                    path.erase(queryStart);
+                }
+
+                std::string connection = HeaderValue(headers, "connection");
+                bool keepAlive =
+                    requestLine.compare(pathEnd + 1, std::string::npos,
+                                        "HTTP/1.0") == 0
+                        ? connection == "keep-alive"
+                        : connection != "close";
+
+                bool eventStream = false;
+                std::string response = CheckAccess(
+                    headers, query, client.localAddress, keepAlive);
+                if (response.empty())
+                    response =
+                        HandleRequest(method, path, keepAlive, eventStream);
+                if (!QueueSend(client, response))
+                    open = false;
+                else if (!keepAlive)
+                    client.closeAfterSend = true;
+                if (open && eventStream)
+                {
+                    client.eventStream = true;
+                    client.buffer.clear();
+                    m_followerCount++;
+                }
+            }
+
+            if (open && !client.closeAfterSend &&
+                client.buffer.size() > MAX_REQUEST_BYTES)
+            {
+                open = QueueSend(client, HttpResponse(413, "Payload Too Large",
+                                                      "text/plain",
+                                                      "Request too large\n",
+                                                      false));
+                client.closeAfterSend = true;
+            }
+
+            if (open && client.closeAfterSend && client.outbound.empty())
+                open = false;
+            if (open && !client.outbound.empty() &&
+                now - client.lastSendProgress >= SEND_STALL_TIMEOUT)
+                open = false;
+
+            if (open)
+            {
+                i++;
+            }
+            else
+            {
+                if (client.eventStream)
+                    m_followerCount--;
+                CloseSocket(client.socket);
+                clients.erase(clients.begin() + static_cast<ptrdiff_t>(i));
+            }
+        }
+
+        // Push the leader's position to every follower that has not seen
+        // it yet. Only the small JSON event goes out here; images are
+        // fetched separately and come straight from the mirror's cache. A
+        // follower still taking an earlier event is skipped and gets the
+        // latest state once it catches up.
+        if (m_followerCount > 0 && m_mirror)
+        {
+            const MirrorState state = m_mirror->GetState();
+            const bool enabled = m_mirror->IsEnabled();
+            std::string event;
+            for (size_t i = 0; i < clients.size();)
+            {
+                ClientConnection &client = clients[i];
+                bool open = true;
+                if (client.eventStream && client.outbound.empty())
+                {
+                    if (!client.sentState ||
+                        client.sentSequence != state.sequence ||
+                        client.sentEnabled != enabled)
+                    {
+                        if (event.empty())
+                            event = "data: " + MirrorEventJson(state) + "\n\n";
+                        open = QueueSend(client, event);
+                        client.sentState = true;
+                        client.sentSequence = state.sequence;
+                        client.sentEnabled = enabled;
+                        client.lastEventSent = now;
+                    }
+                    else if (now - client.lastEventSent >= EVENT_HEARTBEAT)
+                    {
+                        open = QueueSend(client, ": keep-alive\n\n");
+                        client.lastEventSent = now;
+                    }
+                }
+
+                if (open)
+                {
+                    i++;
+                }
+                else
+                {
+                    m_followerCount--;
+                    CloseSocket(client.socket);
+                    clients.erase(clients.begin() +
+                                  static_cast<ptrdiff_t>(i));
+                }
+            }
+        }
+    }
+
+    for (const ClientConnection &client : clients)
+        CloseSocket(client.socket);
+    CloseSocket(listenSocket);
+}
+
+// Returns an error response for a refused request, or an empty string.
+std::string RemoteControlServer::CheckAccess(const std::string &headers,
+                                             const std::string &query,
+                                             const std::string &localAddress,
+                                             bool keepAlive) const
+{
+    // Browsers always send Host; a pedal bridge speaking HTTP/1.0 may not.
+    const std::string host = HeaderValue(headers, "host");
+    if (!host.empty() && !IsAllowedHost(host, localAddress))
+        return HttpResponse(403, "Forbidden", "text/plain", "Unknown host\n",
+                            keepAlive);
+
+    // Pages served here are same-origin; any other page is refused.
+    const std::string origin = HeaderValue(headers, "origin");
+    if (!origin.empty() && origin != "http://" + host)
+        return HttpResponse(403, "Forbidden", "text/plain",
+                            "Cross-origin request refused\n", keepAlive);
+
+    if (m_allowLan)
+    {
+        // The header block is lowercased; tokens are lowercase hex.
+        std::string token = HeaderValue(headers, "x-remote-token");
+        if (token.empty())
+            token = ToLowerAscii(QueryValue(query, "token"));
+        if (!TokensEqual(token, m_token))
+            return HttpResponse(401, "Unauthorized", "text/plain",
+                                "Open the address shown in PDF Manager, "
+                                "including its token\n",
+                                keepAlive);
+    }
+    return "";
+}
+
+std::string RemoteControlServer::HandleRequest(const std::string &method,
+                                               const std::string &path,
+                                               bool &keepAlive,
+                                               bool &eventStream)
+{
+    if (method != "GET" && method != "POST")
+        return HttpResponse(405, "Method Not Allowed", "text/plain",
+                            "Method not allowed\n", keepAlive, "no-store",
+                            "Allow: GET, POST\r\n");
+
+    if (m_mirror && method == "GET" && path.compare(0, 7, "/mirror") == 0)
+        return HandleMirrorRequest(path, keepAlive, eventStream);
+
+    if (path == "/" || path == "/index.html")
+        return HttpResponse(200, "OK", "text/html; charset=utf-8",
+                            CONTROL_PAGE, keepAlive);
+
+    if (path == "/status")
+        return HttpResponse(200, "OK", "application/json", StatusJson(),
+                            keepAlive);
+
+    RemoteCommandType type = RemoteCommandType::NextPage;
+    int number = 0;
+    if (path == "/next")
+        type = RemoteCommandType::NextPage;
+    else if (path == "/prev" || path == "/previous")
+        type = RemoteCommandType::PreviousPage;
+    else if (ParseRouteNumber(path, "/page/", number))
+        type = RemoteCommandType::GoToPage;
+    else if (ParseRouteNumber(path, "/item/", number))
+        type = RemoteCommandType::GoToItem;
+    else
+        return HttpResponse(404, "Not Found", "text/plain", "Not found\n",
+                            keepAlive);
+
+    // A GET can be triggered by any link or image on any site.
+    if (method != "POST")
+        return HttpResponse(405, "Method Not Allowed", "text/plain",
+                            "Use POST for commands\n", keepAlive, "no-store",
+                            "Allow: POST\r\n");
+
+    // Routes without a number leave it at zero.
+    if (!QueueCommand(type, (std::max)(number - 1, 0)))
+        return HttpResponse(503, "Service Unavailable", "application/json",
+                            "{\"ok\":false,\"error\":\"queue full\"}",
+                            keepAlive);
+    return HttpResponse(200, "OK", "application/json", "{\"ok\":true}",
+                        keepAlive);
+}
+
+std::string RemoteControlServer::HandleMirrorRequest(const std::string &path,
+                                                     bool &keepAlive,
+                                                     bool &eventStream)
+{
+    if (path == "/mirror" || path == "/mirror/")
+        return HttpResponse(200, "OK", "text/html; charset=utf-8",
+                            MIRROR_PAGE, keepAlive);
+
+    if (path == "/mirror/events")
+    {
+        // No Content-Length: the body is the open-ended event stream that
+        // Run() writes to. The first event goes out on this same pass.
+        eventStream = true;
+        keepAlive = true;
+        return "HTTP/1.1 200 OK\r\n"
+               "Content-Type: text/event-stream\r\n"
+               "Cache-Control: no-store\r\n"
+               "Connection: keep-alive\r\n"
+               "\r\n"
+               "retry: 1000\n\n";
+    }
+
+    uint64_t documentId = 0;
+    int page = 0;
+    if (ParseMirrorPagePath(path, documentId, page))
+    {
+        // Only pages the mirror has already encoded are served; a request
+        // never triggers rendering or encoding on behalf of one client.
+        std::shared_ptr<const std::string> png =
+            m_mirror->GetEncodedPage(documentId, page);
+        if (png)
+            return HttpResponse(200, "OK", "image/png", *png, keepAlive,
+                                "public, max-age=86400, immutable");
+    }
+
+    return HttpResponse(404, "Not Found", "text/plain", "Not found\n",
+                        keepAlive);
+}
+
+bool RemoteControlServer::QueueCommand(RemoteCommandType type, int value)
+{
+    RemoteCommand command;
+    command.type = type;
+    command.value = value;
+    command.receivedAt = std::chrono::steady_clock::now();
+    if (!m_commands.Push(command))
+        return false;
+
+    // Wake the main loop in case it is waiting for events.
+    glfwPostEmptyEvent();
+    return true;
+}
+
+std::string RemoteControlServer::GenerateToken()
+{
+    static const char HEX_DIGITS[] = "0123456789abcdef";
+    std::random_device random;
+    std::string token;
+    for (int i = 0; i < 4; i++)
+    {
+        uint32_t bits = random();
+        for (int j = 0; j < 8; j++, bits >>= 4)
+            token += HEX_DIGITS[bits & 0xF];
+    }
+    return token;
+}
+
+std::string RemoteControlServer::StatusJson() const
+{
+    std::lock_guard<std::mutex> lock(m_stateMutex);
+    char latency[160];
+    snprintf(latency, sizeof(latency),
+             "{\"samples\":%llu,\"lastMs\":%.2f,\"averageMs\":%.2f,"
+             "\"maxMs\":%.2f}",
+             static_cast<unsigned long long>(m_latency.samples),
+             m_latency.lastMs, m_latency.averageMs, m_latency.maxMs);
+
+    std::string json = "{\"title\":\"" + JsonEscape(m_viewState.title) + "\"";
+    json += ",\"page\":" + std::to_string(m_viewState.page + 1);
+    json += ",\"pageCount\":" + std::to_string(m_viewState.pageCount);
+    json += ",\"item\":" + std::to_string(m_viewState.itemIndex + 1);
+    json += ",\"itemCount\":" + std::to_string(m_viewState.itemCount);
+    json += ",\"latency\":";
+    json += latency;
+    json += "}";
+    return json;
+}
+
+std::string RemoteControlServer::MirrorEventJson(const MirrorState &state) const
+{
+    const bool enabled = m_mirror && m_mirror->IsEnabled();
+    std::string json = "{\"enabled\":";
+    json += enabled ? "true" : "false";
+    json += ",\"seq\":" + std::to_string(state.sequence);
+    json += ",\"title\":\"" + JsonEscape(state.title) + "\"";
+    json += ",\"page\":" + std::to_string(state.page + 1);
+    json += ",\"pageCount\":" + std::to_string(state.pageCount);
+    json += ",\"image\":";
+    json += state.pageReady
+                ? "\"" + MirrorPageUrl(state.documentId, state.page) + "\""
+                : std::string("null");
+    json += ",\"upcoming\":[";
+    for (size_t i = 0; i < state.readyUpcoming.size(); i++)
+    {
+        if (i > 0)
+            json += ",";
+        json += "\"" + MirrorPageUrl(state.documentId, state.readyUpcoming[i]) +
+                "\"";
+    }
+    json += "]}";
+    return json;
+}
@@ -0,0 +1,209 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "spsc_queue.h"
+
+class PageMirror;
+struct MirrorState;
+
+enum class RemoteCommandType
+{
+    NextPage,
+    PreviousPage,
+    GoToPage, // value is a zero-based page index
+    GoToItem  // value is a zero-based setlist item index
+};
+
+/**
+ * @brief A navigation request received from a remote client.
+ */
+struct RemoteCommand
+{
+    RemoteCommandType type = RemoteCommandType::NextPage;
+    int value = 0;
+    std::chrono::steady_clock::time_point receivedAt;
+};
+
+/**
+ * @brief What the main thread is showing, reported to remote clients.
+ */
+struct RemoteViewState
+{
+    std::string title;
+    int page = 0;
+    int pageCount = 0;
+    int itemIndex = -1;
+    int itemCount = 0;
+};
+
+/**
+ * @brief Time from a command arriving on the socket to the swap of the
+ *        first frame that shows its result.
+ */
+struct RemoteLatencyStats
+{
+    uint64_t samples = 0;
+    double lastMs = 0.0;
+    double averageMs = 0.0;
+    double maxMs = 0.0;
+};
+
+/**
+ * @brief Embedded HTTP server for page turns from phones and pedal bridges.
+ *
+ * A single thread serves keep-alive connections on non-blocking sockets,
+ * so a client that reads slowly only delays its own replies. It answers:
+ *   GET  /             small control page with large buttons
+ *   POST /next, /prev  turn the page
+ *   POST /page/N       jump to page N (one-based)
+ *   POST /item/N       jump to setlist item N (one-based)
+ *   GET  /status       current page and latency as JSON
+ * Commands must be POSTs, so a link or image on another site cannot turn
+ * pages.
+ *
+ * With a PageMirror attached it also serves follower devices:
+ *   GET  /mirror                     full-screen page that follows the leader
+ *   GET  /mirror/events              server-sent events, one per page change
+ *   GET  /mirror/page/<doc>/<N>.png  an already-encoded page image
+ * Event streams stay open and are written as soon as the mirror changes,
+ * without waiting for the select() timeout.
+ *
+ * Commands are handed to the main thread through a lock-free queue and
+ * applied there with PopCommand(). The server binds to 127.0.0.1 unless
+ * LAN access is allowed, and then every request must carry the access
+ * token, as a "token" query parameter or an X-Remote-Token header.
+ * Requests naming a Host other than loopback or the address they arrived
+ * on, and cross-origin browser requests, are refused so other web pages
+ * cannot reach the server.
+ */
+class RemoteControlServer
+{
+public:
+    RemoteControlServer() = default;
+    ~RemoteControlServer();
+
+    RemoteControlServer(const RemoteControlServer &) = delete;
+    RemoteControlServer &operator=(const RemoteControlServer &) = delete;
+
+    /**
+     * @brief Start, stop or restart the server to match the settings.
+     * Does nothing if the settings are unchanged, so it can be called
+     * every frame; a failed start is not retried until they change.
+     * @param token Access token required from every client when LAN
+     *        access is allowed; see GenerateToken().
+     */
+    void Configure(bool enabled,
+                   int port,
+                   bool allowLan,
+                   const std::string &token);
+
+    bool IsRunning() const { return m_thread.joinable(); }
+    int GetPort() const { return m_port; }
+    bool IsLanAllowed() const { return m_allowLan; }
+    const std::string &GetToken() const { return m_token; }
+    const std::string &GetLastError() const { return m_lastError; }
+
+    /**
+     * @brief Serve follower pages from a mirror. Call before the server
+     *        starts; the mirror must outlive it.
+     */
+    void AttachMirror(PageMirror *mirror) { m_mirror = mirror; }
+
+    /**
+     * @brief Number of followers with an open event stream.
+     */
+    int GetFollowerCount() const { return m_followerCount; }
+
+    /**
+     * @brief Make the server thread check for mirror changes right away.
+     * Safe to call from any thread.
+     */
+    void Wake();
+
+    // --- Main thread ---
+
+    /**
+     * @brief Take the oldest pending command.
+     * @return false if no command is waiting.
+     */
+    bool PopCommand(RemoteCommand &command);
+
+    /**
+     * @brief Update the state reported by /status.
+     */
+    void PublishState(const RemoteViewState &state);
+
+    /**
+     * @brief Record that a command has been applied; its latency is
+     *        measured at the next NotifyFramePresented().
+     */
+    void NotifyDispatched(const RemoteCommand &command);
+
+    /**
+     * @brief Call right after the buffer swap.
+     */
+    void NotifyFramePresented();
+
+    RemoteLatencyStats GetLatencyStats() const;
+
+    /**
+     * @brief Make a new random access token (32 lowercase hex digits).
+     */
+    static std::string GenerateToken();
+
+private:
+    bool Start(int port, bool allowLan);
+    void Stop();
+    void Run(intptr_t listenSocket);
+    std::string CheckAccess(const std::string &headers,
+                            const std::string &query,
+                            const std::string &localAddress,
+                            bool keepAlive) const;
+    std::string HandleRequest(const std::string &method,
+                              const std::string &path,
+                              bool &keepAlive,
+                              bool &eventStream);
+    std::string HandleMirrorRequest(const std::string &path,
+                                    bool &keepAlive,
+                                    bool &eventStream);
+    bool QueueCommand(RemoteCommandType type, int value);
+    std::string StatusJson() const;
+    std::string MirrorEventJson(const MirrorState &state) const;
+
+    // Settings last passed to Configure(); written on the main thread
+    // only while the server thread is stopped.
+    bool m_enabled = false;
+    int m_port = 0;
+    bool m_allowLan = false;
+    std::string m_token;
+    std::string m_lastError;
+
+    std::thread m_thread;
+    std::atomic<bool> m_stopping{false};
+
+    PageMirror *m_mirror = nullptr;
+    std::atomic<int> m_followerCount{0};
+
+    // Loopback UDP socket in the select() set; Wake() sends it a datagram.
+    std::mutex m_wakeMutex;
+    intptr_t m_wakeSocket = -1;
+    unsigned short m_wakePort = 0;
+
+    // Server thread produces, main thread consumes.
+    SpscQueue<RemoteCommand, 256> m_commands;
+
+    // Main-thread bookkeeping for latency measurement.
+    std::vector<std::chrono::steady_clock::time_point> m_awaitingPresent;
+
+    // Shared with the server thread for /status.
+    mutable std::mutex m_stateMutex;
+    RemoteViewState m_viewState;
+    RemoteLatencyStats m_latency;
+};
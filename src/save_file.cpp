@@ -0,0 +1,36 @@
+#include "save_file.h"
+
+#include <system_error>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#endif
+
+bool ReplaceSaveFile(const std::filesystem::path &temporaryPath,
+                     const std::filesystem::path &destinationPath)
+{
+#ifdef _WIN32
+    if (MoveFileExW(temporaryPath.c_str(), destinationPath.c_str(),
+                    MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+        return true;
+
+    std::error_code cleanupError;
+    std::filesystem::remove(temporaryPath, cleanupError);
+    return false;
+#else
+    std::error_code renameError;
+    std::filesystem::rename(temporaryPath, destinationPath, renameError);
+    if (!renameError)
+        return true;
+
+    std::error_code cleanupError;
+    std::filesystem::remove(temporaryPath, cleanupError);
+    return false;
+#endif
+}
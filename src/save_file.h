@@ -0,0 +1,16 @@
+#pragma once
+
+#include <filesystem>
+
+/**
+ * @brief Moves a fully written temporary file over a save file.
+ *
+ * The caller writes and closes @p temporaryPath first, so a crash leaves
+ * either the old save or the new one, never a partial file. On Windows the
+ * move is made with MOVEFILE_WRITE_THROUGH so it is on disk on return.
+ * The temporary file is removed if the move fails.
+ *
+ * @return true if @p destinationPath now holds the new contents.
+ */
+bool ReplaceSaveFile(const std::filesystem::path &temporaryPath,
+                     const std::filesystem::path &destinationPath);
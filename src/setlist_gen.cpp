@@ -7,30 +7,64 @@
 #include <fstream>
 #include <iostream>
 #include <sstream>
+#include <string_view>
+#include <unordered_map>
 
-#ifdef _WIN32
-#ifndef WIN32_LEAN_AND_MEAN
-#define WIN32_LEAN_AND_MEAN
-#endif
-#ifndef NOMINMAX
-#define NOMINMAX
-#endif
-#include <windows.h>
-#endif
+#include "save_file.h"
+
+namespace
+{
+uint32_t NextSetlistId()
+{
+    // Setlists are only created on the UI thread.
+    static uint32_t nextId = 1;
+    return nextId++;
+}
+
+// Item keys start at 1; the setlist's name is search document 0.
+uint32_t NextItemKey()
+{
+    static uint32_t nextKey = 1;
+    return nextKey++;
+}
 
-Setlist::Setlist(const std::string &name) : m_name(name) {}
+uint64_t NameDocument(const Setlist &setlist)
+{
+    return SetlistSearchIndex::MakeDocumentId(setlist.GetId(), 0);
+}
+
+uint64_t ItemDocument(const Setlist &setlist, const SetlistItem &item)
+{
+    return SetlistSearchIndex::MakeDocumentId(setlist.GetId(), item.key);
+}
+
+uint64_t LastItemDocument(const Setlist &setlist)
+{
+    return ItemDocument(setlist,
+                        setlist.GetItems()[setlist.GetItemCount() - 1]);
+}
+
+// What the search index holds for one item: its name and notes.
+std::string ItemSearchText(const SetlistItem &item)
+{
+    std::string text = item.GetName();
+    text += ' ';
+    text += item.notes;
+    return text;
+}
+} // namespace
 
-bool Setlist::AddItem(const PdfEntry &entry)
+Setlist::Setlist(const std::string &name)
+    : m_id(NextSetlistId()), m_name(name)
 {
-    return AddItem(entry.filename, entry.fullPath);
 }
 
-bool Setlist::AddItem(const std::string &name, const std::string &fullPath)
+bool Setlist::AddItem(PathId path)
 {
-    if (fullPath.empty())
+    if (path == INVALID_PATH_ID)
         return false;
 
-    m_items.push_back({name, fullPath, {}});
+    m_items = m_items.PushBack({path, {}, NextItemKey()});
     return true;
 }
 
@@ -39,7 +73,7 @@ bool Setlist::RemoveItem(size_t index)
     if (index >= m_items.size())
         return false;
 
-    m_items.erase(m_items.begin() + static_cast<std::ptrdiff_t>(index));
+    m_items = m_items.Erase(index);
     return true;
 }
 
@@ -48,18 +82,13 @@ bool Setlist::MoveItem(size_t fromIndex, size_t toIndex)
     if (fromIndex >= m_items.size() || toIndex >= m_items.size())
         return false;
 
-    if (fromIndex == toIndex)
-        return true;
-
-    SetlistItem item = m_items[fromIndex];
-    m_items.erase(m_items.begin() + static_cast<std::ptrdiff_t>(fromIndex));
-    m_items.insert(m_items.begin() + static_cast<std::ptrdiff_t>(toIndex), item);
+    m_items = m_items.Move(fromIndex, toIndex);
     return true;
 }
 
 void Setlist::Clear()
 {
-    m_items.clear();
+    m_items = PersistentVector<SetlistItem>();
 }
 
 static const std::string EMPTY_STRING;
@@ -73,8 +102,12 @@ const std::string &Setlist::GetItemNotes(size_t index) const
 
 void Setlist::SetItemNotes(size_t index, const std::string &notes)
 {
-    if (index < m_items.size())
-        m_items[index].notes = notes;
+    if (index >= m_items.size())
+        return;
+
+    SetlistItem item = m_items[index];
+    item.notes = notes;
+    m_items = m_items.Set(index, std::move(item));
 }
 
 size_t SetlistManager::CreateSetlist(const std::string &name)
@@ -85,7 +118,10 @@ size_t SetlistManager::CreateSetlist(const std::string &name)
         finalName = "Setlist " + std::to_string(m_setlists.size() + 1);
     }
 
-    m_setlists.emplace_back(finalName);
+    RecordEdit("Create Setlist");
+    Setlist setlist(finalName);
+    m_searchIndex.Add(NameDocument(setlist), finalName);
+    m_setlists = m_setlists.PushBack(std::move(setlist));
     return m_setlists.size() - 1;
 }
 
@@ -94,6 +130,7 @@ bool SetlistManager::RemoveSetlist(size_t index)
     if (index >= m_setlists.size())
         return false;
 
+    RecordEdit("Delete Setlist");
     if (static_cast<int>(index) == m_activeSetlistIndex)
     {
         Deactivate();
@@ -103,16 +140,60 @@ bool SetlistManager::RemoveSetlist(size_t index)
         m_activeSetlistIndex--;
     }
 
-    m_setlists.erase(m_setlists.begin() + static_cast<std::ptrdiff_t>(index));
+    UnindexSetlist(m_setlists[index]);
+    m_setlists = m_setlists.Erase(index);
+    return true;
+}
+
+// Edits below change a copy of the setlist and put it back with Set(), so
+// the versions held by the history are never touched.
+
+bool SetlistManager::AddItem(size_t setlistIndex, PathId path)
+{
+    if (setlistIndex >= m_setlists.size() || path == INVALID_PATH_ID)
+        return false;
+
+    RecordEdit("Add Item");
+    Setlist setlist = m_setlists[setlistIndex];
+    if (!setlist.AddItem(path))
+        return false;
+    m_searchIndex.Add(LastItemDocument(setlist),
+                      PathInterner::Shared().GetName(path));
+    m_setlists = m_setlists.Set(setlistIndex, std::move(setlist));
     return true;
 }
 
+bool SetlistManager::AddItems(size_t setlistIndex,
+                              const std::vector<PathId> &paths)
+{
+    if (setlistIndex >= m_setlists.size() || paths.empty())
+        return false;
+
+    // One undo step for the whole batch.
+    RecordEdit(paths.size() == 1 ? "Add Item" : "Add Items");
+    Setlist setlist = m_setlists[setlistIndex];
+    bool added = false;
+    for (PathId path : paths)
+    {
+        if (!setlist.AddItem(path))
+            continue;
+        m_searchIndex.Add(LastItemDocument(setlist),
+                          PathInterner::Shared().GetName(path));
+        added = true;
+    }
+    if (added)
+        m_setlists = m_setlists.Set(setlistIndex, std::move(setlist));
+    return added;
+}
+
 bool SetlistManager::RemoveItem(size_t setlistIndex, size_t itemIndex)
 {
-    Setlist *setlist = GetSetlist(setlistIndex);
-    if (!setlist || itemIndex >= setlist->GetItemCount())
+    if (setlistIndex >= m_setlists.size() ||
+        itemIndex >= m_setlists[setlistIndex].GetItemCount())
         return false;
 
+    RecordEdit("Remove Item");
+
     if (static_cast<int>(setlistIndex) == m_activeSetlistIndex)
     {
         const int removedIndex = static_cast<int>(itemIndex);
@@ -122,17 +203,27 @@ bool SetlistManager::RemoveItem(size_t setlistIndex, size_t itemIndex)
             m_activeItemIndex--;
     }
 
-    return setlist->RemoveItem(itemIndex);
+    Setlist setlist = m_setlists[setlistIndex];
+    m_searchIndex.RemoveDocument(
+        ItemDocument(setlist, setlist.GetItems()[itemIndex]));
+    setlist.RemoveItem(itemIndex);
+    m_setlists = m_setlists.Set(setlistIndex, std::move(setlist));
+    return true;
 }
 
 bool SetlistManager::MoveItem(size_t setlistIndex,
                               size_t fromIndex,
                               size_t toIndex)
 {
-    Setlist *setlist = GetSetlist(setlistIndex);
-    if (!setlist || fromIndex >= setlist->GetItemCount() ||
-        toIndex >= setlist->GetItemCount())
+    if (setlistIndex >= m_setlists.size())
+        return false;
+    const size_t itemCount = m_setlists[setlistIndex].GetItemCount();
+    if (fromIndex >= itemCount || toIndex >= itemCount)
         return false;
+    if (fromIndex == toIndex)
+        return true;
+
+    RecordEdit("Move Item");
 
     if (static_cast<int>(setlistIndex) == m_activeSetlistIndex)
     {
@@ -146,27 +237,63 @@ bool SetlistManager::MoveItem(size_t setlistIndex,
             m_activeItemIndex++;
     }
 
-    return setlist->MoveItem(fromIndex, toIndex);
+    Setlist setlist = m_setlists[setlistIndex];
+    setlist.MoveItem(fromIndex, toIndex);
+    m_setlists = m_setlists.Set(setlistIndex, std::move(setlist));
+    return true;
 }
 
 bool SetlistManager::ClearSetlist(size_t setlistIndex)
 {
-    Setlist *setlist = GetSetlist(setlistIndex);
-    if (!setlist)
+    if (setlistIndex >= m_setlists.size())
         return false;
 
+    RecordEdit("Clear Setlist");
     if (static_cast<int>(setlistIndex) == m_activeSetlistIndex)
         Deactivate();
-    setlist->Clear();
+    Setlist setlist = m_setlists[setlistIndex];
+    for (const SetlistItem &item : setlist.GetItems())
+        m_searchIndex.RemoveDocument(ItemDocument(setlist, item));
+    setlist.Clear();
+    m_setlists = m_setlists.Set(setlistIndex, std::move(setlist));
     return true;
 }
 
-Setlist *SetlistManager::GetSetlist(size_t index)
+bool SetlistManager::SetItemNotes(size_t setlistIndex,
+                                  size_t itemIndex,
+                                  const std::string &notes)
 {
-    if (index >= m_setlists.size())
-        return nullptr;
+    if (setlistIndex >= m_setlists.size() ||
+        itemIndex >= m_setlists[setlistIndex].GetItemCount())
+        return false;
+    if (m_setlists[setlistIndex].GetItemNotes(itemIndex) == notes)
+        return true;
 
-    return &m_setlists[index];
+    // While the user keeps typing into the same item, the entry recorded
+    // before the first keystroke already covers the whole edit.
+    const bool continuing =
+        m_redoStack.empty() && !m_undoStack.empty() &&
+        m_undoStack.back().notesSetlist == static_cast<int>(setlistIndex) &&
+        m_undoStack.back().notesItem == static_cast<int>(itemIndex);
+    if (!continuing)
+    {
+        RecordEdit("Edit Notes");
+        m_undoStack.back().notesSetlist = static_cast<int>(setlistIndex);
+        m_undoStack.back().notesItem = static_cast<int>(itemIndex);
+    }
+    else
+    {
+        m_revision++;
+    }
+
+    Setlist setlist = m_setlists[setlistIndex];
+    const uint64_t document =
+        ItemDocument(setlist, setlist.GetItems()[itemIndex]);
+    m_searchIndex.Remove(document, setlist.GetItemNotes(itemIndex));
+    m_searchIndex.Add(document, notes);
+    setlist.SetItemNotes(itemIndex, notes);
+    m_setlists = m_setlists.Set(setlistIndex, std::move(setlist));
+    return true;
 }
 
 const Setlist *SetlistManager::GetSetlist(size_t index) const
@@ -177,38 +304,117 @@ const Setlist *SetlistManager::GetSetlist(size_t index) const
     return &m_setlists[index];
 }
 
-const Setlist *SetlistManager::GetActiveSetlist() const
+int SetlistManager::FindSetlist(const std::string &name) const
 {
-    if (m_activeSetlistIndex < 0 ||
-        m_activeSetlistIndex >= static_cast<int>(m_setlists.size()))
-        return nullptr;
+    auto foldedEquals = [](const std::string &a, const std::string &b) {
+        return a.size() == b.size() &&
+               std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+                   auto fold = [](char c) {
+                       return (c >= 'A' && c <= 'Z')
+                                  ? static_cast<char>(c - 'A' + 'a')
+                                  : c;
+                   };
+                   return fold(x) == fold(y);
+               });
+    };
+
+    int folded = -1;
+    for (size_t i = 0; i < m_setlists.size(); i++)
+    {
+        const std::string &candidate = m_setlists[i].GetName();
+        if (candidate == name)
+            return static_cast<int>(i);
+        if (folded < 0 && foldedEquals(candidate, name))
+            folded = static_cast<int>(i);
+    }
+    return folded;
+}
 
-    return &m_setlists[static_cast<size_t>(m_activeSetlistIndex)];
+int SetlistManager::FindSetlistById(uint32_t id) const
+{
+    int index = 0;
+    for (const Setlist &setlist : m_setlists)
+    {
+        if (setlist.GetId() == id)
+            return index;
+        index++;
+    }
+    return -1;
 }
 
-bool SetlistManager::ActivateSetlist(size_t index, PdfViewer &viewer)
+void SetlistManager::Search(const std::string &query,
+                            std::vector<SetlistSearchHit> &hits) const
 {
-    if (index >= m_setlists.size())
-        return false;
+    hits.clear();
+    std::vector<uint64_t> documents;
+    std::vector<uint32_t> groups;
+    m_searchIndex.Find(query, documents, groups);
+    if (groups.empty())
+        return;
+
+    for (size_t i = 0; i < m_setlists.size(); i++)
+    {
+        const Setlist &setlist = m_setlists[i];
+        if (!std::binary_search(groups.begin(), groups.end(), setlist.GetId()))
+            continue;
+
+        // The setlist's matching items are one run of the sorted documents;
+        // they are only placed in list order here, not checked again.
+        const auto first = std::lower_bound(
+            documents.begin(), documents.end(),
+            SetlistSearchIndex::MakeDocumentId(setlist.GetId(), 1));
+        const auto last = std::lower_bound(
+            first, documents.end(),
+            SetlistSearchIndex::MakeDocumentId(setlist.GetId(), UINT32_MAX));
+        if (first == last)
+        {
+            hits.push_back({i, -1});
+            continue;
+        }
 
-    const Setlist &setlist = m_setlists[index];
-    if (setlist.GetItemCount() == 0)
-        return false;
+        size_t remaining = static_cast<size_t>(last - first);
+        int itemIndex = 0;
+        for (const SetlistItem &item : setlist.GetItems())
+        {
+            if (std::binary_search(first, last, ItemDocument(setlist, item)))
+            {
+                hits.push_back({i, itemIndex});
+                if (--remaining == 0)
+                    break;
+            }
+            itemIndex++;
+        }
+    }
+}
 
-    int previousSetlist = m_activeSetlistIndex;
-    int previousItem = m_activeItemIndex;
+void SetlistManager::IndexSetlist(const Setlist &setlist)
+{
+    m_searchIndex.Add(NameDocument(setlist), setlist.GetName());
+    for (const SetlistItem &item : setlist.GetItems())
+        m_searchIndex.Add(ItemDocument(setlist, item), ItemSearchText(item));
+}
+
+void SetlistManager::UnindexSetlist(const Setlist &setlist)
+{
+    m_searchIndex.RemoveDocument(NameDocument(setlist));
+    for (const SetlistItem &item : setlist.GetItems())
+        m_searchIndex.RemoveDocument(ItemDocument(setlist, item));
+}
 
-    m_activeSetlistIndex = static_cast<int>(index);
-    m_activeItemIndex = 0;
+void SetlistManager::RebuildSearchIndex()
+{
+    m_searchIndex.Clear();
+    for (const Setlist &setlist : m_setlists)
+        IndexSetlist(setlist);
+}
 
-    if (!LoadActiveItem(viewer, m_activeItemIndex))
-    {
-        m_activeSetlistIndex = previousSetlist;
-        m_activeItemIndex = previousItem;
-        return false;
-    }
+const Setlist *SetlistManager::GetActiveSetlist() const
+{
+    if (m_activeSetlistIndex < 0 ||
+        m_activeSetlistIndex >= static_cast<int>(m_setlists.size()))
+        return nullptr;
 
-    return true;
+    return &m_setlists[static_cast<size_t>(m_activeSetlistIndex)];
 }
 
 void SetlistManager::Deactivate()
@@ -217,127 +423,134 @@ void SetlistManager::Deactivate()
     m_activeItemIndex = -1;
 }
 
-bool SetlistManager::JumpToItem(size_t setlistIndex,
-                                size_t itemIndex,
-                                PdfViewer &viewer)
-{
-    if (setlistIndex >= m_setlists.size())
-        return false;
-
-    const Setlist &setlist = m_setlists[setlistIndex];
-    if (itemIndex >= setlist.GetItemCount())
-        return false;
-
-    int previousSetlist = m_activeSetlistIndex;
-    int previousItem = m_activeItemIndex;
+// =============================================================================
+// History
+// =============================================================================
 
-    m_activeSetlistIndex = static_cast<int>(setlistIndex);
-    m_activeItemIndex = static_cast<int>(itemIndex);
+void SetlistManager::RecordEdit(const std::string &label)
+{
+    HistoryEntry entry;
+    entry.setlists = m_setlists;
+    entry.label = label;
+    m_undoStack.push_back(std::move(entry));
+    m_revision++;
+    if (m_undoStack.size() > HISTORY_CAPACITY)
+        m_undoStack.erase(m_undoStack.begin());
+    m_redoStack.clear();
+}
 
-    if (!LoadActiveItem(viewer, m_activeItemIndex))
-    {
-        m_activeSetlistIndex = previousSetlist;
-        m_activeItemIndex = previousItem;
-        return false;
-    }
+const std::string &SetlistManager::GetUndoLabel() const
+{
+    return m_undoStack.empty() ? EMPTY_STRING : m_undoStack.back().label;
+}
 
-    return true;
+const std::string &SetlistManager::GetRedoLabel() const
+{
+    return m_redoStack.empty() ? EMPTY_STRING : m_redoStack.back().label;
 }
 
-bool SetlistManager::LoadActiveItem(PdfViewer &viewer, int itemIndex)
+bool SetlistManager::Undo()
 {
-    const Setlist *setlist = GetActiveSetlist();
-    if (!setlist)
+    if (m_undoStack.empty())
         return false;
 
-    if (itemIndex < 0 ||
-        itemIndex >= static_cast<int>(setlist->GetItemCount()))
-        return false;
+    HistoryEntry entry = std::move(m_undoStack.back());
+    m_undoStack.pop_back();
 
-    const SetlistItem &item =
-        setlist->GetItems()[static_cast<size_t>(itemIndex)];
-    float currentZoom = viewer.GetZoom();
-    if (!viewer.Load(item.fullPath))
-        return false;
-    viewer.SetZoom(currentZoom);
+    HistoryEntry redo;
+    redo.setlists = m_setlists;
+    redo.label = entry.label;
+    m_redoStack.push_back(std::move(redo));
 
-    m_activeItemIndex = itemIndex;
+    RestoreSnapshot(std::move(entry.setlists));
     return true;
 }
 
-bool SetlistManager::Next(PdfViewer &viewer)
+bool SetlistManager::Redo()
 {
-    const Setlist *setlist = GetActiveSetlist();
-    if (!setlist)
+    if (m_redoStack.empty())
         return false;
 
-    if (viewer.IsLoaded() && viewer.CanGoNext())
-    {
-        viewer.NextPage();
-        return true;
-    }
+    HistoryEntry entry = std::move(m_redoStack.back());
+    m_redoStack.pop_back();
 
-    int nextItem = m_activeItemIndex + 1;
-    if (nextItem < static_cast<int>(setlist->GetItemCount()))
-    {
-        return LoadActiveItem(viewer, nextItem);
-    }
+    HistoryEntry undo;
+    undo.setlists = m_setlists;
+    undo.label = entry.label;
+    m_undoStack.push_back(std::move(undo));
 
-    return false;
+    RestoreSnapshot(std::move(entry.setlists));
+    return true;
 }
 
-bool SetlistManager::Previous(PdfViewer &viewer)
+void SetlistManager::RestoreSnapshot(SetlistSnapshot setlists)
 {
-    const Setlist *setlist = GetActiveSetlist();
-    if (!setlist)
-        return false;
-
-    if (viewer.IsLoaded() && viewer.CanGoPrevious())
+    // Keep playing the same file when the restored active setlist still
+    // contains it, wherever either of them moved to. Undoing a create or
+    // delete shifts the positions of the setlists after it, so the active
+    // setlist is followed by id.
+    PathId activePath = INVALID_PATH_ID;
+    uint32_t activeId = 0;
+    if (const Setlist *active = GetActiveSetlist())
     {
-        viewer.PreviousPage();
-        return true;
+        activeId = active->GetId();
+        if (m_activeItemIndex >= 0 &&
+            m_activeItemIndex < static_cast<int>(active->GetItemCount()))
+            activePath =
+                active->GetItems()[static_cast<size_t>(m_activeItemIndex)]
+                    .path;
     }
 
-    int prevItem = m_activeItemIndex - 1;
-    if (prevItem >= 0)
+    // Reindex only the setlists the restore changes. Untouched setlists
+    // still share their item tree with the live copy.
+    std::unordered_map<uint32_t, const Setlist *> previous;
+    for (const Setlist &setlist : m_setlists)
+        previous[setlist.GetId()] = &setlist;
+    for (const Setlist &setlist : setlists)
     {
-        if (!LoadActiveItem(viewer, prevItem))
-            return false;
-
-        if (viewer.GetPageCount() > 0)
+        auto it = previous.find(setlist.GetId());
+        if (it != previous.end())
         {
-            viewer.GoToPage(viewer.GetPageCount() - 1);
+            const Setlist &before = *it->second;
+            previous.erase(it);
+            if (before.GetName() == setlist.GetName() &&
+                before.GetItems().SharesRootWith(setlist.GetItems()))
+                continue;
+            UnindexSetlist(before);
         }
-        return true;
+        IndexSetlist(setlist);
+    }
+    for (const auto &removed : previous)
+        UnindexSetlist(*removed.second);
+
+    m_setlists = std::move(setlists);
+    m_revision++;
+    m_activeSetlistIndex =
+        activePath != INVALID_PATH_ID ? FindSetlistById(activeId) : -1;
+    if (m_activeSetlistIndex < 0)
+    {
+        Deactivate();
+        return;
     }
 
-    return false;
-}
-
-bool SetlistManager::CanGoNext(const PdfViewer &viewer) const
-{
-    const Setlist *setlist = GetActiveSetlist();
-    if (!setlist)
-        return false;
-
-    if (viewer.IsLoaded() && viewer.CanGoNext())
-        return true;
-
-    int nextItem = m_activeItemIndex + 1;
-    return nextItem < static_cast<int>(setlist->GetItemCount());
-}
-
-bool SetlistManager::CanGoPrevious(const PdfViewer &viewer) const
-{
-    const Setlist *setlist = GetActiveSetlist();
-    if (!setlist)
-        return false;
-
-    if (viewer.IsLoaded() && viewer.CanGoPrevious())
-        return true;
+    const Setlist &active =
+        m_setlists[static_cast<size_t>(m_activeSetlistIndex)];
+    const auto &items = active.GetItems();
+    if (m_activeItemIndex < static_cast<int>(items.size()) &&
+        items[static_cast<size_t>(m_activeItemIndex)].path == activePath)
+        return;
 
-    int prevItem = m_activeItemIndex - 1;
-    return prevItem >= 0;
+    int index = 0;
+    for (const SetlistItem &item : items)
+    {
+        if (item.path == activePath)
+        {
+            m_activeItemIndex = index;
+            return;
+        }
+        index++;
+    }
+    Deactivate();
 }
 
 // =============================================================================
@@ -355,33 +568,58 @@ bool SetlistManager::CanGoPrevious(const PdfViewer &viewer) const
 //   END
 //
 
-namespace
-{
-bool ReplaceSaveFile(const std::filesystem::path &temporaryPath,
-                     const std::filesystem::path &destinationPath)
+std::string SetlistManager::EncodeNotes(const std::string &notes)
 {
-#ifdef _WIN32
-    if (MoveFileExW(temporaryPath.c_str(), destinationPath.c_str(),
-                    MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
-        return true;
-
-    std::error_code cleanupError;
-    std::filesystem::remove(temporaryPath, cleanupError);
-    return false;
-#else
-    std::error_code renameError;
-    std::filesystem::rename(temporaryPath, destinationPath, renameError);
-    if (!renameError)
-        return true;
+    // One pass, so long notes with many lines stay linear.
+    std::string encoded;
+    encoded.reserve(notes.size() + notes.size() / 16);
+    for (char c : notes)
+    {
+        if (c == '\\')
+            encoded += "\\\\";
+        else if (c == '\n')
+            encoded += "\\n";
+        else
+            encoded += c;
+    }
+    return encoded;
+}
 
-    std::error_code cleanupError;
-    std::filesystem::remove(temporaryPath, cleanupError);
-    return false;
-#endif
+std::string SetlistManager::DecodeNotes(std::string_view encoded)
+{
+    // Backslash-n becomes a newline and a doubled backslash a single one;
+    // any other backslash is kept as written.
+    std::string decoded;
+    decoded.reserve(encoded.size());
+    for (size_t i = 0; i < encoded.size(); i++)
+    {
+        if (encoded[i] == '\\' && i + 1 < encoded.size())
+        {
+            if (encoded[i + 1] == 'n')
+            {
+                decoded += '\n';
+                i++;
+                continue;
+            }
+            if (encoded[i + 1] == '\\')
+            {
+                decoded += '\\';
+                i++;
+                continue;
+            }
+        }
+        decoded += encoded[i];
+    }
+    return decoded;
 }
-} // namespace
 
 bool SetlistManager::SaveToFile(const std::string &filepath) const
+{
+    return SaveSnapshotToFile(m_setlists, filepath);
+}
+
+bool SetlistManager::SaveSnapshotToFile(const SetlistSnapshot &snapshot,
+                                        const std::string &filepath)
 {
     const std::filesystem::path destinationPath(filepath);
     std::filesystem::path temporaryPath = destinationPath;
@@ -396,32 +634,17 @@ bool SetlistManager::SaveToFile(const std::string &filepath) const
 
     out << "SETLISTS_V2\n";
 
-    for (const auto &setlist : m_setlists)
+    for (const auto &setlist : snapshot)
     {
         out << "SETLIST:" << setlist.GetName() << "\n";
         for (const auto &item : setlist.GetItems())
         {
-            out << "ITEM:" << item.name << "\t" << item.fullPath << "\n";
+            const PathInterner &paths = PathInterner::Shared();
+            out << "ITEM:" << paths.GetName(item.path) << "\t"
+                << paths.GetDirectory(item.path) << paths.GetName(item.path)
+                << "\n";
             if (!item.notes.empty())
-            {
-                // Encode notes: replace newlines with \n literal for safe
-                // single-line storage
-                std::string encoded = item.notes;
-                // Replace backslashes first to avoid double-encoding
-                for (size_t pos = 0;
-                     (pos = encoded.find('\\', pos)) != std::string::npos;
-                     pos += 2)
-                {
-                    encoded.replace(pos, 1, "\\\\");
-                }
-                for (size_t pos = 0;
-                     (pos = encoded.find('\n', pos)) != std::string::npos;
-                     pos += 2)
-                {
-                    encoded.replace(pos, 1, "\\n");
-                }
-                out << "NOTES:" << encoded << "\n";
-            }
+                out << "NOTES:" << EncodeNotes(item.notes) << "\n";
         }
     }
 
@@ -488,49 +711,22 @@ bool SetlistManager::LoadFromFile(const std::string &filepath)
         }
         else if (line.rfind("ITEM:", 0) == 0 && current)
         {
-            // Item — format is "ITEM:<name>\t<path>"
-            std::string rest = line.substr(5);
-            size_t tabPos = rest.find('\t');
+            // Item — format is "ITEM:<name>\t<path>". The display name is
+            // always the file name, so only the path is read back.
+            const size_t tabPos = line.find('\t', 5);
             if (tabPos != std::string::npos)
             {
-                std::string name = rest.substr(0, tabPos);
-                std::string path = rest.substr(tabPos + 1);
-                current->AddItem(name, path);
+                current->AddItem(PathInterner::Shared().Intern(
+                    std::string_view(line).substr(tabPos + 1)));
             }
         }
         else if (line.rfind("NOTES:", 0) == 0 && current &&
                  current->GetItemCount() > 0)
         {
             // Notes for the most recently added item
-            std::string encoded = line.substr(6);
-            // Decode: \\n -> \n, \\\\ -> backslash
-            std::string decoded;
-            decoded.reserve(encoded.size());
-            for (size_t i = 0; i < encoded.size(); i++)
-            {
-                if (encoded[i] == '\\' && i + 1 < encoded.size())
-                {
-                    if (encoded[i + 1] == 'n')
-                    {
-                        decoded += '\n';
-                        i++;
-                    }
-                    else if (encoded[i + 1] == '\\')
-                    {
-                        decoded += '\\';
-                        i++;
-                    }
-                    else
-                    {
-                        decoded += encoded[i];
-                    }
-                }
-                else
-                {
-                    decoded += encoded[i];
-                }
-            }
-            current->SetItemNotes(current->GetItemCount() - 1, decoded);
+            current->SetItemNotes(
+                current->GetItemCount() - 1,
+                DecodeNotes(std::string_view(line).substr(6)));
         }
         // Skip unknown lines gracefully
     }
@@ -543,7 +739,14 @@ bool SetlistManager::LoadFromFile(const std::string &filepath)
 
     in.close();
     Deactivate();
-    m_setlists = std::move(loadedSetlists);
+    m_setlists = SetlistSnapshot();
+    for (Setlist &setlist : loadedSetlists)
+        m_setlists = m_setlists.PushBack(std::move(setlist));
+    RebuildSearchIndex();
+    m_revision++;
+    // Loading replaces everything; there is nothing meaningful to undo to.
+    m_undoStack.clear();
+    m_redoStack.clear();
     return true;
 }
 
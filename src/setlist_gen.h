@@ -1,35 +1,63 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 
-#include "pdf_library.h"
-#include "pdf_viewer.h"
+#include "path_interner.h"
+#include "persistent_vector.h"
+#include "setlist_search.h"
+
+class PdfViewer;
 
 /**
  * @brief Represents a single PDF file entry within a setlist.
+ *
+ * The file is referenced by its interned path, so items for the same file
+ * share one copy of the path and compare by id.
  */
 struct SetlistItem
 {
-    std::string name;
-    std::string fullPath;
+    PathId path = INVALID_PATH_ID;
     std::string notes;
+    // Names the item in the search index; stays with it when it moves.
+    uint32_t key = 0;
+
+    const char *GetName() const
+    {
+        return PathInterner::Shared().GetName(path);
+    }
+
+    std::string GetFullPath() const
+    {
+        return PathInterner::Shared().GetPath(path);
+    }
 };
 
 /**
  * @brief An ordered collection of PDF files that can be played through
  *        sequentially as a single combined document.
+ *
+ * Items are kept in a PersistentVector, so copying a setlist is cheap and
+ * each edit allocates only O(log n) nodes; copies taken for undo history or
+ * saving share everything else with the live setlist.
  */
 class Setlist
 {
 public:
     explicit Setlist(const std::string &name);
 
+    /**
+     * @brief Identifier that stays with the setlist through reordering and
+     *        undo, unlike its index. Copies share it.
+     */
+    uint32_t GetId() const { return m_id; }
+
     const std::string &GetName() const { return m_name; }
     void SetName(const std::string &name) { m_name = name; }
 
-    const std::vector<SetlistItem> &GetItems() const { return m_items; }
-    std::vector<SetlistItem> &GetItemsMut() { return m_items; }
+    const PersistentVector<SetlistItem> &GetItems() const { return m_items; }
     size_t GetItemCount() const { return m_items.size(); }
 
     /**
@@ -47,19 +75,11 @@ public:
     void SetItemNotes(size_t index, const std::string &notes);
 
     /**
-     * @brief Add a PDF file to the end of the setlist from a library entry.
-     * @param entry The PdfEntry to add.
-     * @return true if added successfully, false if the path was empty.
+     * @brief Add a PDF file to the end of the setlist by interned path.
+     * @param path Id from PathInterner::Shared().
+     * @return true if added successfully, false if the path was invalid.
      */
-    bool AddItem(const PdfEntry &entry);
-
-    /**
-     * @brief Add a PDF file to the end of the setlist by name and path.
-     * @param name Display name for the item.
-     * @param fullPath Absolute path to the PDF file.
-     * @return true if added successfully, false if the path was empty.
-     */
-    bool AddItem(const std::string &name, const std::string &fullPath);
+    bool AddItem(PathId path);
 
     /**
      * @brief Remove an item from the setlist by index.
@@ -82,8 +102,25 @@ public:
     void Clear();
 
 private:
+    uint32_t m_id = 0;
     std::string m_name;
-    std::vector<SetlistItem> m_items;
+    PersistentVector<SetlistItem> m_items;
+};
+
+/**
+ * @brief A point-in-time copy of every setlist. Taking one copies a single
+ *        pointer, and it is safe to read on another thread while the live
+ *        setlists keep changing.
+ */
+using SetlistSnapshot = PersistentVector<Setlist>;
+
+/**
+ * @brief One search result: a setlist, or an item within it.
+ */
+struct SetlistSearchHit
+{
+    size_t setlistIndex = 0;
+    int itemIndex = -1; // -1 when the setlist matched by name
 };
 
 /**
@@ -111,17 +148,101 @@ public:
      */
     bool RemoveSetlist(size_t index);
 
-    /** Mutate setlist items while keeping active playback indices valid. */
+    /**
+     * Mutate setlist items while keeping active playback indices valid.
+     * Every edit is recorded for Undo().
+     */
+    bool AddItem(size_t setlistIndex, PathId path);
+    bool AddItems(size_t setlistIndex, const std::vector<PathId> &paths);
     bool RemoveItem(size_t setlistIndex, size_t itemIndex);
     bool MoveItem(size_t setlistIndex, size_t fromIndex, size_t toIndex);
     bool ClearSetlist(size_t setlistIndex);
 
+    /**
+     * @brief Set an item's notes. Consecutive edits to the same item's
+     *        notes are undone as one step.
+     */
+    bool SetItemNotes(size_t setlistIndex,
+                      size_t itemIndex,
+                      const std::string &notes);
+
     size_t GetSetlistCount() const { return m_setlists.size(); }
-    const std::vector<Setlist> &GetSetlists() const { return m_setlists; }
+    const SetlistSnapshot &GetSetlists() const { return m_setlists; }
 
-    Setlist *GetSetlist(size_t index);
+    /**
+     * @brief Get a setlist by index. An edit replaces the edited setlist
+     *        rather than changing it in place, so fetch it again after
+     *        any edit to see the result.
+     */
     const Setlist *GetSetlist(size_t index) const;
 
+    /**
+     * @brief Find a setlist by name, preferring an exact match over one
+     *        that differs only in ASCII letter case.
+     * @return Index of the setlist, or -1 if none has that name.
+     */
+    int FindSetlist(const std::string &name) const;
+
+    /**
+     * @brief Find a setlist by Setlist::GetId().
+     * @return Index of the setlist, or -1 if it no longer exists.
+     */
+    int FindSetlistById(uint32_t id) const;
+
+    /**
+     * @brief Counts edits, including undo, redo and loading, so callers can
+     *        cache anything derived from the setlists.
+     */
+    uint64_t GetRevision() const { return m_revision; }
+
+    // --- Search ---
+
+    /**
+     * @brief Find setlists and items whose name or notes contain every word
+     *        of the query as a word prefix.
+     *
+     * Items are reported when their own name and notes match; a setlist
+     * that matches only through its name, or through words spread across
+     * several items, is reported once with itemIndex -1. Each item is its
+     * own document in the word index, so hits come straight from it.
+     */
+    void Search(const std::string &query,
+                std::vector<SetlistSearchHit> &hits) const;
+
+    // --- History ---
+
+    bool CanUndo() const { return !m_undoStack.empty(); }
+    bool CanRedo() const { return !m_redoStack.empty(); }
+
+    /**
+     * @brief Short description of the edit Undo()/Redo() would revert,
+     *        for menu labels.
+     */
+    const std::string &GetUndoLabel() const;
+    const std::string &GetRedoLabel() const;
+
+    /**
+     * @brief Restore the setlists from before the last edit. Playback stays
+     *        on the same file if it is still in the active setlist.
+     */
+    bool Undo();
+    bool Redo();
+
+    /**
+     * @brief Copy the current setlists for saving elsewhere, e.g. on a
+     *        background thread with SaveSnapshotToFile().
+     */
+    SetlistSnapshot GetSnapshot() const { return m_setlists; }
+    static bool SaveSnapshotToFile(const SetlistSnapshot &snapshot,
+                                   const std::string &filepath);
+
+    /**
+     * @brief Escape notes for the single-line NOTES: field of the save
+     *        file, and reverse it. Backslashes and newlines are escaped.
+     */
+    static std::string EncodeNotes(const std::string &notes);
+    static std::string DecodeNotes(std::string_view encoded);
+
 
     bool IsActive() const { return m_activeSetlistIndex >= 0; }
     int GetActiveSetlistIndex() const { return m_activeSetlistIndex; }
@@ -156,7 +277,36 @@ private:
     bool LoadActiveItem(PdfViewer &viewer, int itemIndex);
     const Setlist *GetActiveSetlist() const;
 
-    std::vector<Setlist> m_setlists;
+    struct HistoryEntry
+    {
+        SetlistSnapshot setlists;
+        std::string label;
+        // Item whose notes this entry precedes, so typing coalesces.
+        int notesSetlist = -1;
+        int notesItem = -1;
+    };
+
+    void RecordEdit(const std::string &label);
+    void RestoreSnapshot(SetlistSnapshot setlists);
+
+    void IndexSetlist(const Setlist &setlist);
+    void UnindexSetlist(const Setlist &setlist);
+    void RebuildSearchIndex();
+
+    // Each edit copies the edited setlist's name and item root and the
+    // O(log n) nodes above it; the other setlists are shared.
+    SetlistSnapshot m_setlists;
     int m_activeSetlistIndex = -1;
     int m_activeItemIndex = -1;
+
+    // Oldest first. Entries share nodes with each other and with
+    // m_setlists, so each costs only the nodes its edit replaced.
+    std::vector<HistoryEntry> m_undoStack;
+    std::vector<HistoryEntry> m_redoStack;
+    static constexpr size_t HISTORY_CAPACITY = 200;
+
+    // One document per setlist id: its name, item names and notes. Kept in
+    // step with every edit rather than rebuilt per query.
+    SetlistSearchIndex m_searchIndex;
+    uint64_t m_revision = 0;
 };
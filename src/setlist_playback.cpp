@@ -0,0 +1,156 @@
+#include "setlist_gen.h"
+
+#include "pdf_viewer.h"
+
+// Playback through a PdfViewer. Kept apart from the setlist model and its
+// persistence so those build without PDFium, e.g. in the benchmarks.
+
+bool SetlistManager::ActivateSetlist(size_t index, PdfViewer &viewer)
+{
+    if (index >= m_setlists.size())
+        return false;
+
+    const Setlist &setlist = m_setlists[index];
+    if (setlist.GetItemCount() == 0)
+        return false;
+
+    int previousSetlist = m_activeSetlistIndex;
+    int previousItem = m_activeItemIndex;
+
+    m_activeSetlistIndex = static_cast<int>(index);
+    m_activeItemIndex = 0;
+
+    if (!LoadActiveItem(viewer, m_activeItemIndex))
+    {
+        m_activeSetlistIndex = previousSetlist;
+        m_activeItemIndex = previousItem;
+        return false;
+    }
+
+    return true;
+}
+
+bool SetlistManager::JumpToItem(size_t setlistIndex,
+                                size_t itemIndex,
+                                PdfViewer &viewer)
+{
+    if (setlistIndex >= m_setlists.size())
+        return false;
+
+    const Setlist &setlist = m_setlists[setlistIndex];
+    if (itemIndex >= setlist.GetItemCount())
+        return false;
+
+    int previousSetlist = m_activeSetlistIndex;
+    int previousItem = m_activeItemIndex;
+
+    m_activeSetlistIndex = static_cast<int>(setlistIndex);
+    m_activeItemIndex = static_cast<int>(itemIndex);
+
+    if (!LoadActiveItem(viewer, m_activeItemIndex))
+    {
+        m_activeSetlistIndex = previousSetlist;
+        m_activeItemIndex = previousItem;
+        return false;
+    }
+
+    return true;
+}
+
+bool SetlistManager::LoadActiveItem(PdfViewer &viewer, int itemIndex)
+{
+    const Setlist *setlist = GetActiveSetlist();
+    if (!setlist)
+        return false;
+
+    if (itemIndex < 0 ||
+        itemIndex >= static_cast<int>(setlist->GetItemCount()))
+        return false;
+
+    const SetlistItem &item =
+        setlist->GetItems()[static_cast<size_t>(itemIndex)];
+    // Songs start on their first page, at the zoom already in use, rather
+    // than where they were last left.
+    float currentZoom = viewer.GetZoom();
+    if (!viewer.Load(item.GetFullPath(), false))
+        return false;
+    viewer.SetZoom(currentZoom);
+
+    m_activeItemIndex = itemIndex;
+    return true;
+}
+
+bool SetlistManager::Next(PdfViewer &viewer)
+{
+    const Setlist *setlist = GetActiveSetlist();
+    if (!setlist)
+        return false;
+
+    if (viewer.IsLoaded() && viewer.CanGoNext())
+    {
+        viewer.NextPage();
+        return true;
+    }
+
+    int nextItem = m_activeItemIndex + 1;
+    if (nextItem < static_cast<int>(setlist->GetItemCount()))
+    {
+        return LoadActiveItem(viewer, nextItem);
+    }
+
+    return false;
+}
+
+bool SetlistManager::Previous(PdfViewer &viewer)
+{
+    const Setlist *setlist = GetActiveSetlist();
+    if (!setlist)
+        return false;
+
+    if (viewer.IsLoaded() && viewer.CanGoPrevious())
+    {
+        viewer.PreviousPage();
+        return true;
+    }
+
+    int prevItem = m_activeItemIndex - 1;
+    if (prevItem >= 0)
+    {
+        if (!LoadActiveItem(viewer, prevItem))
+            return false;
+
+        if (viewer.GetPageCount() > 0)
+        {
+            viewer.GoToPage(viewer.GetPageCount() - 1);
+        }
+        return true;
+    }
+
+    return false;
+}
+
+bool SetlistManager::CanGoNext(const PdfViewer &viewer) const
+{
+    const Setlist *setlist = GetActiveSetlist();
+    if (!setlist)
+        return false;
+
+    if (viewer.IsLoaded() && viewer.CanGoNext())
+        return true;
+
+    int nextItem = m_activeItemIndex + 1;
+    return nextItem < static_cast<int>(setlist->GetItemCount());
+}
+
+bool SetlistManager::CanGoPrevious(const PdfViewer &viewer) const
+{
+    const Setlist *setlist = GetActiveSetlist();
+    if (!setlist)
+        return false;
+
+    if (viewer.IsLoaded() && viewer.CanGoPrevious())
+        return true;
+
+    int prevItem = m_activeItemIndex - 1;
+    return prevItem >= 0;
+}
@@ -0,0 +1,209 @@
+#include "setlist_search.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace
+{
+bool IsWordByte(unsigned char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+           (c >= '0' && c <= '9') || c >= 0x80;
+}
+
+// The entry for word in a document's list, or end() if it has none.
+auto FindWord(std::vector<std::pair<std::string, uint32_t>> &words,
+              std::string_view word)
+{
+    return std::find_if(
+        words.begin(), words.end(),
+        [word](const auto &counted) { return counted.first == word; });
+}
+
+bool StartsWith(std::string_view word, std::string_view prefix)
+{
+    return word.size() >= prefix.size() &&
+           word.compare(0, prefix.size(), prefix) == 0;
+}
+} // namespace
+
+void SetlistSearchIndex::Add(uint64_t documentId, std::string_view text)
+{
+    std::vector<std::string> words;
+    Tokenize(text, words);
+    if (words.empty())
+        return;
+
+    DocumentWords &documentWords = m_documents[documentId];
+    for (std::string &word : words)
+    {
+        auto counted = FindWord(documentWords, word);
+        if (counted != documentWords.end())
+        {
+            counted->second++;
+            continue;
+        }
+
+        // Documents mostly arrive in id order, so this is usually an
+        // append.
+        Postings &postings = m_postings[word];
+        if (postings.empty() || postings.back() < documentId)
+            postings.push_back(documentId);
+        else
+            postings.insert(std::lower_bound(postings.begin(),
+                                             postings.end(), documentId),
+                            documentId);
+        documentWords.emplace_back(std::move(word), 1);
+    }
+}
+
+void SetlistSearchIndex::Remove(uint64_t documentId, std::string_view text)
+{
+    auto document = m_documents.find(documentId);
+    if (document == m_documents.end())
+        return;
+
+    std::vector<std::string> words;
+    Tokenize(text, words);
+    for (const std::string &word : words)
+    {
+        auto counted = FindWord(document->second, word);
+        if (counted == document->second.end() || --counted->second > 0)
+            continue;
+        document->second.erase(counted);
+        RemovePosting(word, documentId);
+    }
+
+    if (document->second.empty())
+        m_documents.erase(document);
+}
+
+void SetlistSearchIndex::RemoveDocument(uint64_t documentId)
+{
+    auto document = m_documents.find(documentId);
+    if (document == m_documents.end())
+        return;
+
+    for (const auto &counted : document->second)
+        RemovePosting(counted.first, documentId);
+    m_documents.erase(document);
+}
+
+void SetlistSearchIndex::RemovePosting(const std::string &word,
+                                       uint64_t documentId)
+{
+    auto postings = m_postings.find(word);
+    if (postings == m_postings.end())
+        return;
+    auto found = std::lower_bound(postings->second.begin(),
+                                  postings->second.end(), documentId);
+    if (found != postings->second.end() && *found == documentId)
+        postings->second.erase(found);
+    if (postings->second.empty())
+        m_postings.erase(postings);
+}
+
+void SetlistSearchIndex::Clear()
+{
+    m_postings.clear();
+    m_documents.clear();
+}
+
+void SetlistSearchIndex::Find(std::string_view query,
+                              std::vector<uint64_t> &documents,
+                              std::vector<uint32_t> &groups) const
+{
+    documents.clear();
+    groups.clear();
+    std::vector<std::string> queryWords;
+    Tokenize(query, queryWords);
+
+    bool first = true;
+    std::vector<uint64_t> matches;
+    std::vector<uint32_t> matchedGroups;
+    for (const std::string &prefix : queryWords)
+    {
+        matches.clear();
+        for (auto it = m_postings.lower_bound(prefix);
+             it != m_postings.end() && StartsWith(it->first, prefix); ++it)
+        {
+            matches.insert(matches.end(), it->second.begin(),
+                           it->second.end());
+        }
+        std::sort(matches.begin(), matches.end());
+        matches.erase(std::unique(matches.begin(), matches.end()),
+                      matches.end());
+
+        // Sorted ids keep each group together, so this stays sorted.
+        matchedGroups.clear();
+        for (uint64_t document : matches)
+        {
+            const auto group = static_cast<uint32_t>(document >> 32);
+            if (matchedGroups.empty() || matchedGroups.back() != group)
+                matchedGroups.push_back(group);
+        }
+
+        if (first)
+        {
+            documents.swap(matches);
+            groups.swap(matchedGroups);
+            first = false;
+        }
+        else
+        {
+            std::vector<uint64_t> bothDocuments;
+            std::set_intersection(documents.begin(), documents.end(),
+                                  matches.begin(), matches.end(),
+                                  std::back_inserter(bothDocuments));
+            documents.swap(bothDocuments);
+            std::vector<uint32_t> bothGroups;
+            std::set_intersection(groups.begin(), groups.end(),
+                                  matchedGroups.begin(), matchedGroups.end(),
+                                  std::back_inserter(bothGroups));
+            groups.swap(bothGroups);
+        }
+
+        if (groups.empty())
+            break;
+    }
+}
+
+void SetlistSearchIndex::Tokenize(std::string_view text,
+                                  std::vector<std::string> &words)
+{
+    words.clear();
+    std::string word;
+    for (char c : text)
+    {
+        const auto byte = static_cast<unsigned char>(c);
+        if (IsWordByte(byte))
+        {
+            word += (byte >= 'A' && byte <= 'Z')
+                        ? static_cast<char>(byte - 'A' + 'a')
+                        : c;
+        }
+        else if (!word.empty())
+        {
+            words.push_back(std::move(word));
+            word.clear();
+        }
+    }
+    if (!word.empty())
+        words.push_back(std::move(word));
+}
+
+bool SetlistSearchIndex::FuzzyMatch(std::string_view text,
+                                    std::string_view query)
+{
+    auto fold = [](char c) {
+        return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+    };
+
+    size_t matched = 0;
+    for (size_t i = 0; i < text.size() && matched < query.size(); i++)
+    {
+        if (fold(text[i]) == fold(query[matched]))
+            matched++;
+    }
+    return matched == query.size();
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Word index from text to the documents containing it.
+ *
+ * Text is split into lowercase words (runs of letters, digits and any
+ * non-ASCII bytes). Each document keeps an occurrence count per word, so
+ * text can be removed again exactly as it was added; callers update the
+ * index edit by edit instead of rebuilding it. Query words match as
+ * prefixes, so "cap" finds "capo".
+ *
+ * The upper 32 bits of a document id name its group, such as a setlist
+ * whose name and items are separate documents. A query can then match a
+ * single document or a group whose documents hold its words between them.
+ */
+class SetlistSearchIndex
+{
+public:
+    static uint64_t MakeDocumentId(uint32_t group, uint32_t member)
+    {
+        return (uint64_t(group) << 32) | member;
+    }
+
+    void Add(uint64_t documentId, std::string_view text);
+    void Remove(uint64_t documentId, std::string_view text);
+
+    /**
+     * @brief Drop everything indexed for a document.
+     */
+    void RemoveDocument(uint64_t documentId);
+
+    void Clear();
+
+    /**
+     * @brief Find where every query word starts some indexed word.
+     * @param documents Receives, in ascending order, the documents that
+     *        contain every query word themselves.
+     * @param groups Receives, in ascending order, the groups whose
+     *        documents contain every query word between them.
+     */
+    void Find(std::string_view query,
+              std::vector<uint64_t> &documents,
+              std::vector<uint32_t> &groups) const;
+
+    size_t GetWordCount() const { return m_postings.size(); }
+
+    /**
+     * @brief Split text into the words the index stores.
+     */
+    static void Tokenize(std::string_view text, std::vector<std::string> &words);
+
+    /**
+     * @brief Whether the query's characters appear in text in order,
+     *        ignoring ASCII case, so "cnc" matches "Concert". The setlist
+     *        list falls back to it for names the word index misses.
+     */
+    static bool FuzzyMatch(std::string_view text, std::string_view query);
+
+private:
+    void RemovePosting(const std::string &word, uint64_t documentId);
+
+    // Documents containing a word, in ascending order. How often they
+    // contain it is counted in m_documents.
+    using Postings = std::vector<uint64_t>;
+
+    // Ordered so that every word with a given prefix is one range.
+    std::map<std::string, Postings, std::less<>> m_postings;
+    // Words per document with their counts, so a document can be dropped
+    // without its text. Documents hold a few words each, so a short list
+    // searched in order is cheaper than a map.
+    using DocumentWords = std::vector<std::pair<std::string, uint32_t>>;
+    std::unordered_map<uint64_t, DocumentWords> m_documents;
+};
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+/**
+ * @brief Fixed-capacity lock-free queue for one producer and one consumer.
+ *
+ * Push() may only be called from a single thread and Pop() from a single
+ * (possibly different) thread. Neither call blocks or allocates.
+ */
+template <typename T, size_t Capacity>
+class SpscQueue
+{
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0,
+                  "SpscQueue capacity must be a power of two");
+
+public:
+    /**
+     * @brief Append an item.
+     * @return false if the queue is full.
+     */
+    bool Push(const T &value)
+    {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        if (head - m_tail.load(std::memory_order_acquire) == Capacity)
+            return false;
+
+        m_items[head & (Capacity - 1)] = value;
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Remove the oldest item.
+     * @return false if the queue is empty.
+     */
+    bool Pop(T &value)
+    {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail == m_head.load(std::memory_order_acquire))
+            return false;
+
+        value = m_items[tail & (Capacity - 1)];
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    // Producer and consumer indices live on separate cache lines.
+    alignas(64) std::atomic<size_t> m_head{0};
+    alignas(64) std::atomic<size_t> m_tail{0};
+    std::array<T, Capacity> m_items{};
+};
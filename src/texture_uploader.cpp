@@ -0,0 +1,180 @@
+#include "texture_uploader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+#ifndef GL_CLAMP_TO_EDGE
+#define GL_CLAMP_TO_EDGE 0x812F
+#endif
+
+TextureUploader::TextureUploader() : m_worker(1) {}
+
+TextureUploader::~TextureUploader() { Stop(); }
+
+bool TextureUploader::Start(GLFWwindow *shareWith)
+{
+    if (m_window)
+        return true;
+    if (!LoadGlFunctions() || !Gl().HasSync())
+    {
+        printf("[TextureUploader] Sync objects unavailable; uploading on "
+               "the main thread\n");
+        return false;
+    }
+
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow *window =
+        glfwCreateWindow(1, 1, "PDF Manager Uploader", nullptr, shareWith);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+    if (!window)
+    {
+        printf("[TextureUploader] Could not create upload context\n");
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_window = window;
+    return true;
+}
+
+void TextureUploader::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_window)
+            return;
+    }
+
+    // Each task releases the context when it finishes, so once the worker
+    // is idle nothing holds it.
+    m_worker.CancelPending();
+    while (m_worker.GetPendingCount() > 0)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const InFlight &upload : m_inFlight)
+    {
+        Gl().DeleteSync(upload.fence);
+        glDeleteTextures(1, &upload.texture.texture);
+    }
+    m_inFlight.clear();
+    m_requested.clear();
+    glfwDestroyWindow(m_window);
+    m_window = nullptr;
+}
+
+bool TextureUploader::IsRunning() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_window != nullptr;
+}
+
+void TextureUploader::Request(uint64_t documentId,
+                              int page,
+                              std::shared_ptr<const PageBitmap> bitmap)
+{
+    if (!bitmap || !bitmap->IsValid())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_window || documentId < m_minimumDocumentId)
+            return;
+
+        const auto key = std::make_pair(documentId, page);
+        if (std::find(m_requested.begin(), m_requested.end(), key) !=
+            m_requested.end())
+            return;
+        for (const InFlight &upload : m_inFlight)
+        {
+            if (upload.texture.documentId == documentId &&
+                upload.texture.page == page)
+                return;
+        }
+        m_requested.push_back(key);
+    }
+
+    m_worker.Post([this, documentId, page, bitmap]() {
+        Upload(documentId, page, *bitmap);
+    });
+}
+
+void TextureUploader::CancelBefore(uint64_t documentId)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_minimumDocumentId = (std::max)(m_minimumDocumentId, documentId);
+}
+
+// Runs on the worker thread.
+void TextureUploader::Upload(uint64_t documentId,
+                             int page,
+                             const PageBitmap &bitmap)
+{
+    GLFWwindow *window;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        window = m_window;
+        if (!window || documentId < m_minimumDocumentId)
+        {
+            m_requested.erase(std::remove(m_requested.begin(),
+                                          m_requested.end(),
+                                          std::make_pair(documentId, page)),
+                              m_requested.end());
+            return;
+        }
+    }
+
+    glfwMakeContextCurrent(window);
+
+    InFlight upload;
+    upload.texture.documentId = documentId;
+    upload.texture.page = page;
+    upload.texture.width = bitmap.width;
+    upload.texture.height = bitmap.height;
+    glGenTextures(1, &upload.texture.texture);
+    glBindTexture(GL_TEXTURE_2D, upload.texture.texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    // Use nearest-neighbor when magnifying to keep text edges crisper.
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, bitmap.width, bitmap.height, 0,
+                 GL_RGBA, GL_UNSIGNED_BYTE, bitmap.pixels.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+    upload.fence = Gl().FenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    // The fence must reach the GPU before another context can wait on it.
+    glFlush();
+    glfwMakeContextCurrent(nullptr);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_requested.erase(std::remove(m_requested.begin(), m_requested.end(),
+                                  std::make_pair(documentId, page)),
+                      m_requested.end());
+    m_inFlight.push_back(upload);
+}
+
+void TextureUploader::TakeCompleted(std::vector<UploadedTexture> &textures)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (size_t i = 0; i < m_inFlight.size();)
+    {
+        InFlight &upload = m_inFlight[i];
+        // A zero timeout only polls the fence.
+        GLenum status = Gl().ClientWaitSync(upload.fence, 0, 0);
+        if (status == GL_TIMEOUT_EXPIRED)
+        {
+            i++;
+            continue;
+        }
+
+        Gl().DeleteSync(upload.fence);
+        if (status == GL_WAIT_FAILED ||
+            upload.texture.documentId < m_minimumDocumentId)
+            glDeleteTextures(1, &upload.texture.texture);
+        else
+            textures.push_back(upload.texture);
+        m_inFlight.erase(m_inFlight.begin() + static_cast<std::ptrdiff_t>(i));
+    }
+}
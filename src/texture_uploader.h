@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include <GLFW/glfw3.h>
+
+#include "background_worker.h"
+#include "gl_functions.h"
+#include "pdfium_support.h"
+
+/**
+ * @brief A page texture created off the main thread.
+ */
+struct UploadedTexture
+{
+    uint64_t documentId = 0;
+    int page = -1;
+    GLuint texture = 0;
+    int width = 0;
+    int height = 0;
+};
+
+/**
+ * @brief Creates and fills page textures on a background thread.
+ *
+ * The thread renders into a hidden window whose context shares objects with
+ * the main window. Each upload is followed by a fence, and a texture is
+ * handed to the main thread only once the GPU has signalled that fence, so
+ * the main thread never samples a half-written texture and never blocks on
+ * glTexImage2D itself.
+ */
+class TextureUploader
+{
+public:
+    TextureUploader();
+    ~TextureUploader();
+
+    TextureUploader(const TextureUploader &) = delete;
+    TextureUploader &operator=(const TextureUploader &) = delete;
+
+    /**
+     * @brief Create the upload context. Call on the main thread with the
+     *        main window's context current.
+     * @return false if sync objects are unsupported or the hidden window
+     *         cannot be created; uploads then stay on the main thread.
+     */
+    bool Start(GLFWwindow *shareWith);
+
+    /**
+     * @brief Drop queued uploads and destroy the upload context. Call on
+     *        the main thread before glfwTerminate().
+     */
+    void Stop();
+
+    bool IsRunning() const;
+
+    /**
+     * @brief Queue a bitmap for upload. Safe to call from any thread;
+     *        a page already queued or in flight is ignored.
+     */
+    void Request(uint64_t documentId,
+                 int page,
+                 std::shared_ptr<const PageBitmap> bitmap);
+
+    /**
+     * @brief Forget uploads for older documents. Queued ones are dropped
+     *        and finished ones are deleted when collected.
+     */
+    void CancelBefore(uint64_t documentId);
+
+    /**
+     * @brief Move every upload the GPU has finished into textures.
+     * Main thread only; never waits on the GPU.
+     */
+    void TakeCompleted(std::vector<UploadedTexture> &textures);
+
+private:
+    struct InFlight
+    {
+        UploadedTexture texture;
+        GLsync fence = nullptr;
+    };
+
+    void Upload(uint64_t documentId, int page, const PageBitmap &bitmap);
+
+    GLFWwindow *m_window = nullptr;
+
+    mutable std::mutex m_mutex;
+    std::vector<std::pair<uint64_t, int>> m_requested;
+    std::vector<InFlight> m_inFlight;
+    uint64_t m_minimumDocumentId = 0;
+
+    BackgroundWorker m_worker;
+};
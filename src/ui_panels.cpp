@@ -14,16 +14,26 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <filesystem>
 #include <fstream>
+#include <memory>
 #include <string>
 
+#include "drop_import.h"
 #include "file_dialog.h"
 #include "imgui.h"
+#include "library_thumbnails.h"
+#include "page_layout.h"
+#include "page_mirror.h"
+#include "pdf_compare.h"
+#include "pdf_export.h"
 #include "pdf_library.h"
 #include "pdf_viewer.h"
+#include "presenter_window.h"
+#include "remote_control.h"
 #include "setlist_gen.h"
 #include "ui_helpers.h"
 
@@ -38,6 +48,8 @@ static const float MAX_NOTES_RATIO = 0.36f;
 static const float SPLITTER_THICKNESS = 6.0f;
 static const float TOOLBAR_HEIGHT = 58.0f;
 static const int FONT_SIZE_OPTIONS[] = {18, 20, 22, 24, 26, 30};
+static const float THUMBNAIL_CELL_WIDTH = 112.0f;
+static const float THUMBNAIL_CELL_IMAGE_HEIGHT = 144.0f;
 
 static bool g_draggingSidebar = false;
 static bool g_draggingNotes = false;
@@ -119,30 +131,6 @@ static bool LoadSetlists(SetlistManager &setlistManager,
     return ok;
 }
 
-static char ToLowerAscii(char c)
-{
-    if (c >= 'A' && c <= 'Z')
-        return static_cast<char>(c - 'A' + 'a');
-    return c;
-}
-
-static bool FuzzyMatch(const char *text, const char *query)
-{
-    if (!query || query[0] == '\0')
-        return true;
-    if (!text)
-        return false;
-
-    while (*text && *query)
-    {
-        if (ToLowerAscii(*text) == ToLowerAscii(*query))
-            query++;
-        text++;
-    }
-
-    return *query == '\0';
-}
-
 static void TooltipIfHovered(const char *text)
 {
     if (text && text[0] != '\0' &&
@@ -227,26 +215,261 @@ static void OpenLibraryFolder(PdfLibrary &library,
     }
 }
 
+// Type-ahead picker for adding library files to a setlist. The list is
+// virtualized and supports Ctrl/Shift multi-select; Enter adds the
+// selection, or the top match when nothing is selected.
+static void RenderAddPdfPicker(const PdfLibrary &library,
+                               SetlistManager &setlistManager,
+                               size_t setlistIndex)
+{
+    static char query[128] = "";
+    static std::vector<uint32_t> matches;
+    static std::string matchedQuery;
+    static uint64_t matchedRevision = UINT64_MAX;
+    static ImGuiSelectionBasicStorage selection;
+
+    const bool hasFiles = library.GetFileCount() > 0;
+    ImGui::BeginDisabled(!hasFiles);
+    if (PrimaryButton("Add PDFs...", ImVec2(-1.0f, 0.0f)))
+    {
+        query[0] = '\0';
+        selection.Clear();
+        ImGui::OpenPopup("AddPdfPicker");
+    }
+    ImGui::EndDisabled();
+
+    ImGui::SetNextWindowSize(ImVec2(440.0f, 420.0f), ImGuiCond_Appearing);
+    if (!ImGui::BeginPopup("AddPdfPicker"))
+        return;
+
+    if (ImGui::IsWindowAppearing())
+        ImGui::SetKeyboardFocusHere();
+    ImGui::SetNextItemWidth(-1.0f);
+    const bool submitted = ImGui::InputTextWithHint(
+        "##AddPdfSearch", "Type to search the library...", query,
+        IM_ARRAYSIZE(query), ImGuiInputTextFlags_EnterReturnsTrue);
+
+    if (matchedQuery != query || matchedRevision != library.GetRevision())
+    {
+        library.Filter(query, matches);
+        matchedQuery = query;
+        matchedRevision = library.GetRevision();
+    }
+
+    // Selection is keyed by path so it survives changes to the query.
+    selection.PreserveOrder = true;
+    selection.UserData = const_cast<PdfLibrary *>(&library);
+    selection.AdapterIndexToStorageId = [](ImGuiSelectionBasicStorage *self,
+                                           int index) -> ImGuiID {
+        const auto *owner = static_cast<const PdfLibrary *>(self->UserData);
+        return owner->GetPath(matches[static_cast<size_t>(index)]);
+    };
+
+    const float footerHeight = ImGui::GetFrameHeightWithSpacing() + 4.0f;
+    ImGui::BeginChild("AddPdfList", ImVec2(0.0f, -footerHeight),
+                      ImGuiChildFlags_Borders);
+    ImGuiMultiSelectIO *io = ImGui::BeginMultiSelect(
+        ImGuiMultiSelectFlags_ClearOnEscape |
+            ImGuiMultiSelectFlags_BoxSelect1d,
+        selection.Size, static_cast<int>(matches.size()));
+    selection.ApplyRequests(io);
+
+    ImGuiListClipper clipper;
+    clipper.Begin(static_cast<int>(matches.size()));
+    if (io->RangeSrcItem != -1)
+        clipper.IncludeItemByIndex(static_cast<int>(io->RangeSrcItem));
+    while (clipper.Step())
+    {
+        for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++)
+        {
+            const size_t index = matches[static_cast<size_t>(row)];
+            const PathId path = library.GetPath(index);
+            ImGui::PushID(static_cast<int>(path));
+            ImGui::SetNextItemSelectionUserData(row);
+            ImGui::Selectable(library.GetFilename(index),
+                              selection.Contains(path));
+            if (ImGui::IsItemHovered(ImGuiHoveredFlags_DelayNormal))
+                ImGui::SetTooltip("%s", library.GetFullPath(index).c_str());
+            ImGui::PopID();
+        }
+    }
+
+    io = ImGui::EndMultiSelect();
+    selection.ApplyRequests(io);
+    if (matches.empty())
+        ImGui::TextDisabled("No PDFs match the search.");
+    ImGui::EndChild();
+
+    std::vector<PathId> picked;
+    void *it = nullptr;
+    ImGuiID id = 0;
+    while (selection.GetNextSelectedItem(&it, &id))
+        picked.push_back(static_cast<PathId>(id));
+    if (picked.empty() && submitted && !matches.empty())
+        picked.push_back(library.GetPath(matches.front()));
+
+    std::string addLabel =
+        selection.Size > 0 ? "Add " + std::to_string(selection.Size)
+                           : std::string("Add");
+    const float buttonWidth = 96.0f;
+    ImGui::AlignTextToFramePadding();
+    ImGui::TextDisabled("%zu of %zu", matches.size(), library.GetFileCount());
+    ImGui::SameLine();
+    ImGui::SetCursorPosX(ImGui::GetCursorPosX() +
+                         ImGui::GetContentRegionAvail().x -
+                         buttonWidth * 2.0f - ImGui::GetStyle().ItemSpacing.x);
+    if (SecondaryButton("Cancel", ImVec2(buttonWidth, 0.0f)))
+        ImGui::CloseCurrentPopup();
+    ImGui::SameLine();
+    ImGui::BeginDisabled(selection.Size == 0);
+    const bool clicked =
+        PrimaryButton(addLabel.c_str(), ImVec2(buttonWidth, 0.0f));
+    ImGui::EndDisabled();
+
+    if ((clicked || submitted) && !picked.empty())
+    {
+        setlistManager.AddItems(setlistIndex, picked);
+        selection.Clear();
+        ImGui::CloseCurrentPopup();
+    }
+    ImGui::EndPopup();
+}
+
 static void RefreshLibrary(PdfLibrary &library, int &selectedFileIndex)
 {
-    std::string selectedPath;
-    const auto &oldFiles = library.GetFiles();
+    PathId selectedPath = INVALID_PATH_ID;
     if (selectedFileIndex >= 0 &&
-        selectedFileIndex < static_cast<int>(oldFiles.size()))
-        selectedPath = oldFiles[static_cast<size_t>(selectedFileIndex)].fullPath;
+        selectedFileIndex < static_cast<int>(library.GetFileCount()))
+        selectedPath = library.GetPath(static_cast<size_t>(selectedFileIndex));
 
     library.Refresh();
-    selectedFileIndex = -1;
-    if (selectedPath.empty())
-        return;
+    selectedFileIndex = selectedPath != INVALID_PATH_ID
+                            ? library.FindFile(selectedPath)
+                            : -1;
+}
+
+static void SortLibrary(PdfLibrary &library,
+                        LibrarySortKey key,
+                        int &selectedFileIndex)
+{
+    PathId selectedPath = INVALID_PATH_ID;
+    if (selectedFileIndex >= 0 &&
+        selectedFileIndex < static_cast<int>(library.GetFileCount()))
+        selectedPath = library.GetPath(static_cast<size_t>(selectedFileIndex));
+
+    library.Sort(key);
+    selectedFileIndex = selectedPath != INVALID_PATH_ID
+                            ? library.FindFile(selectedPath)
+                            : -1;
+}
 
-    const auto &newFiles = library.GetFiles();
-    for (size_t i = 0; i < newFiles.size(); i++)
+// Opens a library file unless it is already the one on screen.
+static void SelectLibraryFile(const PdfLibrary &library,
+                              PdfViewer &viewer,
+                              SetlistManager &setlistManager,
+                              size_t index,
+                              int &selectedFileIndex)
+{
+    selectedFileIndex = static_cast<int>(index);
+    if (PathInterner::Shared().Find(viewer.GetFilepath()) !=
+        library.GetPath(index))
     {
-        if (newFiles[i].fullPath == selectedPath)
+        setlistManager.Deactivate();
+        viewer.Load(library.GetFullPath(index));
+    }
+}
+
+// Cover thumbnails, a row of cells at a time. Only rows the clipper shows
+// ask for their thumbnails, so scrolling a large folder loads just what
+// passes through view.
+static void RenderLibraryGrid(const std::vector<uint32_t> &visiblePdfs,
+                              const PdfLibrary &library,
+                              LibraryThumbnails &thumbnails,
+                              PdfViewer &viewer,
+                              SetlistManager &setlistManager,
+                              int &selectedIndex)
+{
+    const ImGuiStyle &style = ImGui::GetStyle();
+    const int columns = (std::max)(
+        1, static_cast<int>((ImGui::GetContentRegionAvail().x +
+                             style.ItemSpacing.x) /
+                            (THUMBNAIL_CELL_WIDTH + style.ItemSpacing.x)));
+    const float cellHeight =
+        THUMBNAIL_CELL_IMAGE_HEIGHT + ImGui::GetTextLineHeightWithSpacing();
+    const int count = static_cast<int>(visiblePdfs.size());
+    const int rows = (count + columns - 1) / columns;
+    ImDrawList *drawList = ImGui::GetWindowDrawList();
+
+    ImGuiListClipper clipper;
+    clipper.Begin(rows, cellHeight + style.ItemSpacing.y);
+    while (clipper.Step())
+    {
+        for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++)
         {
-            selectedFileIndex = static_cast<int>(i);
-            break;
+            for (int column = 0; column < columns; column++)
+            {
+                const int cell = row * columns + column;
+                if (cell >= count)
+                    break;
+                const size_t i = visiblePdfs[static_cast<size_t>(cell)];
+
+                if (column > 0)
+                    ImGui::SameLine();
+                ImGui::PushID(static_cast<int>(i));
+                if (ImGui::Selectable(
+                        "##thumbnail", static_cast<int>(i) == selectedIndex,
+                        ImGuiSelectableFlags_AllowDoubleClick,
+                        ImVec2(THUMBNAIL_CELL_WIDTH, cellHeight)))
+                    SelectLibraryFile(library, viewer, setlistManager, i,
+                                      selectedIndex);
+                if (ImGui::IsItemHovered())
+                    ImGui::SetTooltip("%s", library.GetFullPath(i).c_str());
+                ImGui::PopID();
+
+                const ImVec2 origin = ImGui::GetItemRectMin();
+                GLuint texture = 0;
+                int width = 0;
+                int height = 0;
+                if (thumbnails.GetTexture(library.GetPath(i),
+                                          library.GetFileSize(i),
+                                          library.GetModifiedTime(i),
+                                          texture, width, height) &&
+                    width > 0 && height > 0)
+                {
+                    const float scale = (std::min)(
+                        THUMBNAIL_CELL_WIDTH / static_cast<float>(width),
+                        THUMBNAIL_CELL_IMAGE_HEIGHT /
+                            static_cast<float>(height));
+                    const ImVec2 size(width * scale, height * scale);
+                    const ImVec2 min(
+                        origin.x + (THUMBNAIL_CELL_WIDTH - size.x) * 0.5f,
+                        origin.y + (THUMBNAIL_CELL_IMAGE_HEIGHT - size.y));
+                    drawList->AddImage(
+                        (ImTextureID)(void *)(uintptr_t)texture, min,
+                        ImVec2(min.x + size.x, min.y + size.y));
+                }
+                else
+                {
+                    // Placeholder while loading, or for unreadable files.
+                    drawList->AddRectFilled(
+                        ImVec2(origin.x + 12.0f, origin.y + 4.0f),
+                        ImVec2(origin.x + THUMBNAIL_CELL_WIDTH - 12.0f,
+                               origin.y + THUMBNAIL_CELL_IMAGE_HEIGHT),
+                        ImGui::GetColorU32(ImGuiCol_FrameBg), 4.0f);
+                }
+
+                const ImVec2 labelMin(
+                    origin.x, origin.y + THUMBNAIL_CELL_IMAGE_HEIGHT +
+                                  style.ItemSpacing.y * 0.5f);
+                drawList->PushClipRect(
+                    labelMin,
+                    ImVec2(origin.x + THUMBNAIL_CELL_WIDTH,
+                           origin.y + cellHeight),
+                    true);
+                drawList->AddText(labelMin, ImGui::GetColorU32(ImGuiCol_Text),
+                                  library.GetFilename(i));
+                drawList->PopClipRect();
+            }
         }
     }
 }
@@ -348,6 +571,31 @@ static void RenderSettingsPopup(AppUiState &uiState)
         ImGui::Checkbox("Restore last library and setlist",
                         &uiState.restoreLastSession);
 
+        ImGui::Separator();
+        ImGui::Checkbox("Enable remote control server",
+                        &uiState.remoteControlEnabled);
+        ImGui::BeginDisabled(!uiState.remoteControlEnabled);
+        ImGui::SetNextItemWidth(140.0f);
+        if (ImGui::InputInt("Port", &uiState.remoteControlPort, 0, 0,
+                            ImGuiInputTextFlags_EnterReturnsTrue))
+            uiState.remoteControlPort =
+                (std::clamp)(uiState.remoteControlPort, 1024, 65535);
+        ImGui::Checkbox("Allow other devices on the network",
+                        &uiState.remoteControlAllowLan);
+        if (uiState.remoteControlAllowLan)
+        {
+            ImGui::TextDisabled("Access token: %s",
+                                uiState.remoteControlToken.c_str());
+            ImGui::SameLine();
+            // Devices holding the old token lose access.
+            if (ImGui::SmallButton("New token"))
+                uiState.remoteControlToken =
+                    RemoteControlServer::GenerateToken();
+        }
+        ImGui::Checkbox("Mirror pages to followers at /mirror",
+                        &uiState.mirrorEnabled);
+        ImGui::EndDisabled();
+
         ImGui::Separator();
         std::string autoFontLabel =
             "Auto (" + std::to_string(uiState.autoFontSizePx) + " px)";
@@ -489,6 +737,27 @@ bool LoadUiSettings(AppUiState &uiState)
         }
         else if (key == "lastSetlistName")
             uiState.lastSetlistName = value;
+        else if (key == "remoteControlEnabled")
+            uiState.remoteControlEnabled = value == "1";
+        else if (key == "remoteControlPort")
+        {
+            try
+            {
+                uiState.remoteControlPort =
+                    (std::clamp)(std::stoi(value), 1024, 65535);
+            }
+            catch (...)
+            {
+            }
+        }
+        else if (key == "remoteControlAllowLan")
+            uiState.remoteControlAllowLan = value == "1";
+        else if (key == "remoteControlToken")
+            uiState.remoteControlToken = value;
+        else if (key == "mirrorEnabled")
+            uiState.mirrorEnabled = value == "1";
+        else if (key == "libraryGridView")
+            uiState.libraryGridView = value == "1";
     }
 
     return true;
@@ -517,6 +786,14 @@ bool SaveUiSettings(const AppUiState &uiState)
     out << "lastLibraryPath=" << uiState.lastLibraryPath << "\n";
     out << "lastSetlistIndex=" << uiState.lastSetlistIndex << "\n";
     out << "lastSetlistName=" << uiState.lastSetlistName << "\n";
+    out << "remoteControlEnabled=" << (uiState.remoteControlEnabled ? 1 : 0)
+        << "\n";
+    out << "remoteControlPort=" << uiState.remoteControlPort << "\n";
+    out << "remoteControlAllowLan="
+        << (uiState.remoteControlAllowLan ? 1 : 0) << "\n";
+    out << "remoteControlToken=" << uiState.remoteControlToken << "\n";
+    out << "mirrorEnabled=" << (uiState.mirrorEnabled ? 1 : 0) << "\n";
+    out << "libraryGridView=" << (uiState.libraryGridView ? 1 : 0) << "\n";
     out.flush();
     const bool writeSucceeded = out.good();
     out.close();
@@ -527,6 +804,29 @@ bool SaveUiSettings(const AppUiState &uiState)
 // Main menu
 // =============================================================================
 
+static void ApplySetlistHistory(SetlistManager &setlistManager,
+                                bool redo,
+                                int &selectedSetlistIndex,
+                                int &selectedSetlistItemIndex)
+{
+    if (!(redo ? setlistManager.Redo() : setlistManager.Undo()))
+        return;
+
+    // The restored setlists may be shorter than what was selected.
+    const int setlistCount = static_cast<int>(setlistManager.GetSetlistCount());
+    if (selectedSetlistIndex >= setlistCount)
+        selectedSetlistIndex = setlistCount - 1;
+    const Setlist *selected =
+        selectedSetlistIndex >= 0
+            ? setlistManager.GetSetlist(
+                  static_cast<size_t>(selectedSetlistIndex))
+            : nullptr;
+    const int itemCount =
+        selected ? static_cast<int>(selected->GetItemCount()) : 0;
+    if (selectedSetlistItemIndex >= itemCount)
+        selectedSetlistItemIndex = itemCount - 1;
+}
+
 void RenderMainMenuBar(PdfLibrary &library,
                        PdfViewer &viewer,
                        SetlistManager &setlistManager,
@@ -535,6 +835,20 @@ void RenderMainMenuBar(PdfLibrary &library,
                        int &selectedSetlistIndex,
                        int &selectedSetlistItemIndex)
 {
+    // Text fields keep their own undo for Ctrl+Z.
+    ImGuiIO &io = ImGui::GetIO();
+    if (!io.WantTextInput && io.KeyCtrl)
+    {
+        const bool redo =
+            ImGui::IsKeyPressed(ImGuiKey_Y, false) ||
+            (io.KeyShift && ImGui::IsKeyPressed(ImGuiKey_Z, false));
+        const bool undo =
+            !io.KeyShift && ImGui::IsKeyPressed(ImGuiKey_Z, false);
+        if (undo || redo)
+            ApplySetlistHistory(setlistManager, redo, selectedSetlistIndex,
+                                selectedSetlistItemIndex);
+    }
+
     if (ImGui::BeginMainMenuBar())
     {
         if (ImGui::BeginMenu("File"))
@@ -555,6 +869,14 @@ void RenderMainMenuBar(PdfLibrary &library,
                 LoadSetlists(setlistManager, uiState, selectedSetlistIndex,
                              selectedSetlistItemIndex);
 
+            ImGui::Separator();
+            if (ImGui::MenuItem("Extract Pages...", nullptr, false,
+                                viewer.IsLoaded()))
+                uiState.extractPagesRequested = true;
+
+            if (ImGui::MenuItem("Compare Revisions..."))
+                uiState.compareRequested = true;
+
             ImGui::Separator();
             if (ImGui::MenuItem("Close PDF", nullptr, false,
                                 viewer.IsLoaded()))
@@ -566,11 +888,34 @@ void RenderMainMenuBar(PdfLibrary &library,
             ImGui::EndMenu();
         }
 
+        if (ImGui::BeginMenu("Edit"))
+        {
+            std::string undoLabel = "Undo " + setlistManager.GetUndoLabel();
+            if (ImGui::MenuItem(undoLabel.c_str(), "Ctrl+Z", false,
+                                setlistManager.CanUndo()))
+                ApplySetlistHistory(setlistManager, false,
+                                    selectedSetlistIndex,
+                                    selectedSetlistItemIndex);
+
+            std::string redoLabel = "Redo " + setlistManager.GetRedoLabel();
+            if (ImGui::MenuItem(redoLabel.c_str(), "Ctrl+Y", false,
+                                setlistManager.CanRedo()))
+                ApplySetlistHistory(setlistManager, true,
+                                    selectedSetlistIndex,
+                                    selectedSetlistItemIndex);
+
+            ImGui::EndMenu();
+        }
+
         if (ImGui::BeginMenu("View"))
         {
             ImGui::MenuItem("Library Sidebar", nullptr,
                             &uiState.sidebarVisible);
             ImGui::MenuItem("Notes Panel", nullptr, &uiState.notesVisible);
+            ImGui::MenuItem("Remote Control Status", nullptr,
+                            &uiState.remoteControlStatusOpen);
+            ImGui::MenuItem("Performer Window", nullptr,
+                            &uiState.presenterOpen);
 
             ImGui::Separator();
             if (ImGui::MenuItem("Reset Zoom", nullptr, false,
@@ -615,7 +960,103 @@ void RenderMainMenuBar(PdfLibrary &library,
 // Sidebar
 // =============================================================================
 
+static void RenderOutlineLevel(PdfViewer &viewer, int first, int count)
+{
+    for (int i = first; i < first + count; i++)
+    {
+        // Expanding a node appends to the node list, so copy what we need
+        // instead of holding a reference across ExpandOutlineNode().
+        const OutlineNode node =
+            viewer.GetOutline().GetNodes()[static_cast<size_t>(i)];
+        const bool isCurrent = node.pageIndex >= 0 &&
+                               node.pageIndex == viewer.GetCurrentPage();
+
+        ImGuiTreeNodeFlags flags = ImGuiTreeNodeFlags_OpenOnArrow |
+                                   ImGuiTreeNodeFlags_OpenOnDoubleClick |
+                                   ImGuiTreeNodeFlags_SpanAvailWidth;
+        if (!node.hasChildren)
+            flags |= ImGuiTreeNodeFlags_Leaf;
+        if (isCurrent)
+            flags |= ImGuiTreeNodeFlags_Selected;
+
+        const char *title = node.title.empty() ? "(untitled)"
+                                               : node.title.c_str();
+        ImGui::PushID(i);
+        bool open = ImGui::TreeNodeEx("##bookmark", flags, "%s", title);
+
+        if (ImGui::IsItemHovered())
+        {
+            // Rasterize the target while the pointer rests on it so the
+            // click only has to upload a texture.
+            if (node.pageIndex >= 0)
+            {
+                viewer.PrefetchPage(node.pageIndex);
+                ImGui::SetTooltip("%s\nPage %d", title, node.pageIndex + 1);
+            }
+            else if (node.pageResolved)
+            {
+                ImGui::SetTooltip("%s\nNo page in this document", title);
+            }
+        }
+
+        if (ImGui::IsItemClicked(ImGuiMouseButton_Left) &&
+            !ImGui::IsItemToggledOpen() && node.pageIndex >= 0)
+            viewer.GoToPage(node.pageIndex);
+
+        if (node.pageIndex >= 0)
+        {
+            std::string pageLabel = std::to_string(node.pageIndex + 1);
+            float labelWidth = ImGui::CalcTextSize(pageLabel.c_str()).x;
+            ImGui::SameLine();
+            ImGui::SetCursorPosX(
+                ImGui::GetCursorPosX() +
+                (std::max)(0.0f,
+                           ImGui::GetContentRegionAvail().x - labelWidth));
+            ImGui::TextDisabled("%s", pageLabel.c_str());
+        }
+
+        if (open)
+        {
+            if (!node.childrenLoaded)
+                viewer.ExpandOutlineNode(i);
+
+            const OutlineNode &expanded =
+                viewer.GetOutline().GetNodes()[static_cast<size_t>(i)];
+            if (expanded.childCount > 0)
+                RenderOutlineLevel(viewer, expanded.firstChild,
+                                   expanded.childCount);
+            ImGui::TreePop();
+        }
+        ImGui::PopID();
+    }
+}
+
+static void RenderBookmarksTab(PdfViewer &viewer)
+{
+    if (!viewer.IsLoaded())
+    {
+        ImGui::BeginChild("BookmarksEmpty", ImVec2(0.0f, 0.0f), true);
+        ImGui::TextDisabled("Open a PDF to see its bookmarks.");
+        ImGui::EndChild();
+        return;
+    }
+
+    const PdfOutline &outline = viewer.GetOutline();
+    HeaderWithBadge("##BookmarksDocumentName", viewer.GetFilename().c_str(),
+                    viewer.GetFilepath().c_str(),
+                    outline.IsEmpty() ? "None" : "Outline",
+                    ImVec4(0.350f, 0.730f, 0.710f, 1.0f));
+
+    ImGui::BeginChild("BookmarkTree", ImVec2(0.0f, 0.0f), true);
+    if (outline.IsEmpty())
+        ImGui::TextDisabled("This PDF has no bookmarks.");
+    else
+        RenderOutlineLevel(viewer, 0, outline.GetRootCount());
+    ImGui::EndChild();
+}
+
 void RenderLibraryPanel(PdfLibrary &library,
+                        LibraryThumbnails &thumbnails,
                         PdfViewer &viewer,
                         SetlistManager &setlistManager,
                         AppUiState &uiState,
@@ -678,47 +1119,87 @@ void RenderLibraryPanel(PdfLibrary &library,
                                 countLabel.c_str(),
                                 ImVec4(0.350f, 0.730f, 0.710f, 1.0f));
 
-                ImGui::SetNextItemWidth(-1.0f);
+                static const char *SORT_LABELS[] = {"Name", "Newest",
+                                                     "Largest"};
+                const float sortWidth = 92.0f;
+                const float viewWidth = 52.0f;
+                ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x -
+                                        sortWidth - viewWidth -
+                                        ImGui::GetStyle().ItemSpacing.x * 2.0f);
                 ImGui::InputTextWithHint("##PdfSearch", "Search PDFs...",
                                          pdfSearch, IM_ARRAYSIZE(pdfSearch));
+                ImGui::SameLine();
+                ImGui::SetNextItemWidth(sortWidth);
+                int sortKey = static_cast<int>(library.GetSortKey());
+                if (ImGui::Combo("##PdfSort", &sortKey, SORT_LABELS,
+                                 IM_ARRAYSIZE(SORT_LABELS)))
+                    SortLibrary(library, static_cast<LibrarySortKey>(sortKey),
+                                selectedIndex);
+                ImGui::SameLine();
+                if (CompactButtonWithTooltip(
+                        false, uiState.libraryGridView ? "List" : "Grid",
+                        uiState.libraryGridView ? "Show file names"
+                                                : "Show cover thumbnails",
+                        ImVec2(-1.0f, 0.0f)))
+                    uiState.libraryGridView = !uiState.libraryGridView;
 
                 float listHeight = ImGui::GetContentRegionAvail().y;
                 if (listHeight < 160.0f)
                     listHeight = 160.0f;
                 ImGui::BeginChild("PdfList", ImVec2(0.0f, listHeight), true);
 
-                const auto &files = library.GetFiles();
-                bool hasVisiblePdfs = false;
-                for (size_t i = 0; i < files.size(); i++)
+                // Only refilter when the query or the library changes.
+                static std::vector<uint32_t> visiblePdfs;
+                static std::string visibleQuery;
+                static uint64_t visibleRevision = 0;
+                if (visibleQuery != pdfSearch ||
+                    visibleRevision != library.GetRevision())
                 {
-                    const auto &entry = files[i];
-                    if (!FuzzyMatch(entry.filename.c_str(), pdfSearch))
-                        continue;
+                    library.Filter(pdfSearch, visiblePdfs);
+                    visibleQuery = pdfSearch;
+                    visibleRevision = library.GetRevision();
+                }
 
-                    hasVisiblePdfs = true;
-                    bool isSelected = static_cast<int>(i) == selectedIndex;
-                    std::string label =
-                        entry.filename + "##pdf_" + std::to_string(i);
-                    if (ImGui::Selectable(label.c_str(), isSelected,
-                                          ImGuiSelectableFlags_AllowDoubleClick))
+                if (uiState.libraryGridView)
+                {
+                    RenderLibraryGrid(visiblePdfs, library, thumbnails,
+                                      viewer, setlistManager, selectedIndex);
+                }
+                else
+                {
+                    ImGuiListClipper clipper;
+                    clipper.Begin(static_cast<int>(visiblePdfs.size()));
+                    while (clipper.Step())
                     {
-                        selectedIndex = static_cast<int>(i);
-                        if (viewer.GetFilepath() != entry.fullPath)
+                        for (int row = clipper.DisplayStart;
+                             row < clipper.DisplayEnd; row++)
                         {
-                            setlistManager.Deactivate();
-                            viewer.Load(entry.fullPath);
+                            const size_t i =
+                                visiblePdfs[static_cast<size_t>(row)];
+                            bool isSelected =
+                                static_cast<int>(i) == selectedIndex;
+                            std::string label =
+                                std::string(library.GetFilename(i)) +
+                                "##pdf_" + std::to_string(i);
+                            if (ImGui::Selectable(
+                                    label.c_str(), isSelected,
+                                    ImGuiSelectableFlags_AllowDoubleClick))
+                                SelectLibraryFile(library, viewer,
+                                                  setlistManager, i,
+                                                  selectedIndex);
+                            if (ImGui::IsItemHovered())
+                                ImGui::SetTooltip(
+                                    "%s", library.GetFullPath(i).c_str());
                         }
                     }
-                    if (ImGui::IsItemHovered())
-                        ImGui::SetTooltip("%s", entry.fullPath.c_str());
                 }
 
-                if (files.empty())
+                if (library.GetFileCount() == 0)
                 {
                     ImGui::Spacing();
                     ImGui::TextDisabled("No PDF files found in this folder.");
                 }
-                else if (!hasVisiblePdfs)
+                else if (visiblePdfs.empty())
                 {
                     ImGui::Spacing();
                     ImGui::TextDisabled("No PDFs match the search.");
@@ -815,20 +1296,48 @@ void RenderLibraryPanel(PdfLibrary &library,
             }
 
             ImGui::SetNextItemWidth(-1.0f);
-            ImGui::InputTextWithHint("##SetlistSearch", "Search setlists...",
+            ImGui::InputTextWithHint("##SetlistSearch",
+                                     "Search setlists, songs, notes...",
                                      setlistSearch,
                                      IM_ARRAYSIZE(setlistSearch));
 
+            // Searched through the index only when the query or the
+            // setlists change.
+            static std::vector<SetlistSearchHit> searchHits;
+            static std::string searchQuery;
+            static uint64_t searchRevision = 0;
+            if (searchQuery != setlistSearch ||
+                searchRevision != setlistManager.GetRevision())
+            {
+                searchQuery = setlistSearch;
+                searchRevision = setlistManager.GetRevision();
+                setlistManager.Search(searchQuery, searchHits);
+            }
+
             float setlistHeight =
                 (std::max)(120.0f, viewport->WorkSize.y * 0.22f);
             ImGui::BeginChild("SetlistList", ImVec2(0.0f, setlistHeight),
                               true);
             const auto &setlists = setlistManager.GetSetlists();
             bool hasVisibleSetlists = false;
+            size_t hitCursor = 0;
             for (size_t i = 0; i < setlists.size(); i++)
             {
                 const Setlist &setlist = setlists[i];
-                if (!FuzzyMatch(setlist.GetName().c_str(), setlistSearch))
+
+                // Hits are ordered by setlist, so this setlist's are the
+                // run starting at hitCursor.
+                while (hitCursor < searchHits.size() &&
+                       searchHits[hitCursor].setlistIndex < i)
+                    hitCursor++;
+                size_t hitEnd = hitCursor;
+                while (hitEnd < searchHits.size() &&
+                       searchHits[hitEnd].setlistIndex == i)
+                    hitEnd++;
+
+                if (hitEnd == hitCursor &&
+                    !SetlistSearchIndex::FuzzyMatch(setlist.GetName(),
+                                                    setlistSearch))
                     continue;
 
                 hasVisibleSetlists = true;
@@ -847,6 +1356,40 @@ void RenderLibraryPanel(PdfLibrary &library,
                     selectedSetlistIndex = static_cast<int>(i);
                     selectedSetlistItemIndex = -1;
                 }
+
+                // Matching songs, with the start of their notes.
+                ImGui::Indent();
+                for (size_t h = hitCursor; h < hitEnd; h++)
+                {
+                    const int itemIndex = searchHits[h].itemIndex;
+                    if (itemIndex < 0 ||
+                        itemIndex >= static_cast<int>(setlist.GetItemCount()))
+                        continue;
+
+                    const SetlistItem &item =
+                        setlist.GetItems()[static_cast<size_t>(itemIndex)];
+                    std::string itemLabel = item.GetName();
+                    if (!item.notes.empty())
+                    {
+                        std::string excerpt =
+                            item.notes.substr(0, item.notes.find('\n'));
+                        if (excerpt.size() > 48)
+                            excerpt = excerpt.substr(0, 48) + "...";
+                        itemLabel += "  - " + excerpt;
+                    }
+                    itemLabel += "##setlist_hit_" + std::to_string(i) + "_" +
+                                 std::to_string(itemIndex);
+
+                    const bool itemSelected =
+                        isSelected && itemIndex == selectedSetlistItemIndex;
+                    if (ImGui::Selectable(itemLabel.c_str(), itemSelected))
+                    {
+                        selectedSetlistIndex = static_cast<int>(i);
+                        selectedSetlistItemIndex = itemIndex;
+                    }
+                }
+                ImGui::Unindent();
+                hitCursor = hitEnd;
             }
             if (setlists.empty())
                 ImGui::TextDisabled("No setlists yet.");
@@ -854,7 +1397,7 @@ void RenderLibraryPanel(PdfLibrary &library,
                 ImGui::TextDisabled("No matching setlists.");
             ImGui::EndChild();
 
-            Setlist *selectedSetlist = nullptr;
+            const Setlist *selectedSetlist = nullptr;
             if (selectedSetlistIndex >= 0 &&
                 selectedSetlistIndex <
                     static_cast<int>(setlistManager.GetSetlistCount()))
@@ -893,6 +1436,11 @@ void RenderLibraryPanel(PdfLibrary &library,
             }
             ImGui::EndDisabled();
 
+            ImGui::BeginDisabled(!canActivate);
+            if (SecondaryButton("Export PDF...", ImVec2(-1.0f, 0.0f)))
+                uiState.exportSetlistRequest = selectedSetlistIndex;
+            ImGui::EndDisabled();
+
             if (ImGui::BeginPopupModal("Delete Setlist", nullptr,
                                        ImGuiWindowFlags_AlwaysAutoResize))
             {
@@ -905,7 +1453,7 @@ void RenderLibraryPanel(PdfLibrary &library,
                 {
                     ImGui::Text("Delete setlist \"%s\"?",
                                 pendingDeleteSetlistName.c_str());
-                    ImGui::TextDisabled("This cannot be undone.");
+                    ImGui::TextDisabled("Edit > Undo restores it.");
                     ImGui::Spacing();
 
                     if (DangerButton("Delete", ImVec2(120.0f, 0.0f)))
@@ -962,51 +1510,11 @@ void RenderLibraryPanel(PdfLibrary &library,
                                 itemCount.c_str(),
                                 ImVec4(0.48f, 0.76f, 0.56f, 1.0f));
 
-                bool hasFiles = library.GetFileCount() > 0;
-                ImGui::BeginDisabled(!hasFiles);
-                const auto &files = library.GetFiles();
-                static int comboFileIndex = 0;
-                if (comboFileIndex >= static_cast<int>(files.size()))
-                    comboFileIndex = 0;
-
-                const char *previewName =
-                    files.empty()
-                        ? "Load a PDF folder first"
-                        : files[static_cast<size_t>(comboFileIndex)]
-                              .filename.c_str();
-                float addRowWidth = ImGui::GetContentRegionAvail().x;
-                float addButtonWidth = 54.0f;
-                bool stackAddControls = addRowWidth < 240.0f;
-                float comboWidth =
-                    stackAddControls
-                        ? -1.0f
-                        : addRowWidth - addButtonWidth -
-                              ImGui::GetStyle().ItemSpacing.x;
-                ImGui::SetNextItemWidth(comboWidth);
-                if (ImGui::BeginCombo("##AddPdfToSetlist", previewName))
-                {
-                    for (size_t i = 0; i < files.size(); i++)
-                    {
-                        bool selected = static_cast<int>(i) == comboFileIndex;
-                        std::string label =
-                            files[i].filename + "##combo_" +
-                            std::to_string(i);
-                        if (ImGui::Selectable(label.c_str(), selected))
-                            comboFileIndex = static_cast<int>(i);
-                        if (selected)
-                            ImGui::SetItemDefaultFocus();
-                    }
-                    ImGui::EndCombo();
-                }
-                if (!stackAddControls)
-                    ImGui::SameLine();
-                if (PrimaryButton("Add", ImVec2(stackAddControls ? -1.0f
-                                                                 : addButtonWidth,
-                                                0.0f)) &&
-                    !files.empty())
-                    selectedSetlist->AddItem(
-                        files[static_cast<size_t>(comboFileIndex)]);
-                ImGui::EndDisabled();
+                const bool hasFiles = library.GetFileCount() > 0;
+                RenderAddPdfPicker(library, setlistManager,
+                                   static_cast<size_t>(selectedSetlistIndex));
+                selectedSetlist = setlistManager.GetSetlist(
+                    static_cast<size_t>(selectedSetlistIndex));
 
                 if (!hasFiles)
                     ImGui::TextDisabled(
@@ -1039,7 +1547,7 @@ void RenderLibraryPanel(PdfLibrary &library,
                             ImVec4(0.48f, 0.76f, 0.56f, 1.0f));
 
                     std::string label =
-                        std::to_string(i + 1) + ". " + item.name;
+                        std::to_string(i + 1) + ". " + item.GetName();
                     if (isPlaying)
                         label = "Playing  " + label;
                     label += "##item_" + std::to_string(i);
@@ -1063,7 +1571,8 @@ void RenderLibraryPanel(PdfLibrary &library,
                         ImGui::PopStyleColor();
 
                     if (ImGui::IsItemHovered())
-                        ImGui::SetTooltip("%s", item.fullPath.c_str());
+                        ImGui::SetTooltip("%s",
+                                          item.GetFullPath().c_str());
                 }
                 if (items.empty())
                     ImGui::TextDisabled("Add PDFs to build this setlist.");
@@ -1127,6 +1636,9 @@ void RenderLibraryPanel(PdfLibrary &library,
                     setlistManager.RemoveItem(
                         static_cast<size_t>(selectedSetlistIndex),
                         static_cast<size_t>(selectedSetlistItemIndex));
+                    // The edit replaced the setlist; read the new one.
+                    selectedSetlist = setlistManager.GetSetlist(
+                        static_cast<size_t>(selectedSetlistIndex));
                     if (selectedSetlistItemIndex >=
                         static_cast<int>(selectedSetlist->GetItemCount()))
                     {
@@ -1155,7 +1667,7 @@ void RenderLibraryPanel(PdfLibrary &library,
                         pendingClearSetlistIndex <
                             static_cast<int>(
                                 setlistManager.GetSetlistCount());
-                    Setlist *pendingClearSetlist =
+                    const Setlist *pendingClearSetlist =
                         canClear
                             ? setlistManager.GetSetlist(static_cast<size_t>(
                                   pendingClearSetlistIndex))
@@ -1165,7 +1677,7 @@ void RenderLibraryPanel(PdfLibrary &library,
                     {
                         ImGui::Text("Clear all items from \"%s\"?",
                                     pendingClearSetlist->GetName().c_str());
-                        ImGui::TextDisabled("This cannot be undone.");
+                        ImGui::TextDisabled("Edit > Undo restores it.");
                         ImGui::Spacing();
 
                         if (DangerButton("Clear", ImVec2(120.0f, 0.0f)))
@@ -1206,6 +1718,12 @@ void RenderLibraryPanel(PdfLibrary &library,
             ImGui::EndTabItem();
         }
 
+        if (ImGui::BeginTabItem("Bookmarks"))
+        {
+            RenderBookmarksTab(viewer);
+            ImGui::EndTabItem();
+        }
+
         ImGui::EndTabBar();
     }
 
@@ -1391,7 +1909,201 @@ void RenderDocumentToolbar(PdfViewer &viewer,
     ImGui::End();
 }
 
-void RenderViewerPanel(const PdfViewer &viewer,
+// Text selection on the displayed page, in character indices of its text
+// layer. Reset whenever the document or page changes.
+struct PageTextSelection
+{
+    std::string filepath;
+    int page = -1;
+    int anchor = -1;
+    int focus = -1;
+    bool dragging = false;
+
+    bool HasRange() const { return anchor >= 0 && focus >= 0; }
+    void Clear()
+    {
+        anchor = -1;
+        focus = -1;
+        dragging = false;
+    }
+};
+
+static PageTextSelection g_textSelection;
+
+static void CopySelectedText(const PageTextLayer &text)
+{
+    if (!g_textSelection.HasRange())
+        return;
+
+    size_t first = static_cast<size_t>(
+        (std::min)(g_textSelection.anchor, g_textSelection.focus));
+    size_t last = static_cast<size_t>(
+        (std::max)(g_textSelection.anchor, g_textSelection.focus));
+    std::string copied = text.ExtractUtf8(first, last);
+    if (!copied.empty())
+        ImGui::SetClipboardText(copied.c_str());
+}
+
+// Draw highlight boxes for the selection, merging runs of characters that
+// share a line into one rectangle.
+static void DrawTextSelection(const PageTextLayer &text,
+                              const ImVec2 &imageMin,
+                              const ImVec2 &imageSize)
+{
+    if (!g_textSelection.HasRange() || text.Size() == 0)
+        return;
+
+    size_t first = static_cast<size_t>(
+        (std::min)(g_textSelection.anchor, g_textSelection.focus));
+    size_t last = (std::min)(
+        static_cast<size_t>(
+            (std::max)(g_textSelection.anchor, g_textSelection.focus)),
+        text.Size() - 1);
+
+    ImDrawList *drawList = ImGui::GetWindowDrawList();
+    const ImU32 color = ImGui::ColorConvertFloat4ToU32(
+        ImVec4(0.33f, 0.52f, 0.86f, 0.35f));
+    auto flush = [&](const NormalizedRect &run) {
+        if (run.IsEmpty())
+            return;
+        drawList->AddRectFilled(
+            ImVec2(imageMin.x + run.left * imageSize.x,
+                   imageMin.y + run.top * imageSize.y),
+            ImVec2(imageMin.x + run.right * imageSize.x,
+                   imageMin.y + run.bottom * imageSize.y),
+            color);
+    };
+
+    const RectColumns &boxes = text.boxes;
+    NormalizedRect run;
+    for (size_t i = first; i <= last; i++)
+    {
+        if (boxes.right[i] <= boxes.left[i])
+            continue;
+
+        bool sameLine = !run.IsEmpty() && boxes.top[i] < run.bottom &&
+                        boxes.bottom[i] > run.top &&
+                        boxes.left[i] >= run.left;
+        if (sameLine)
+        {
+            run.right = (std::max)(run.right, boxes.right[i]);
+            run.top = (std::min)(run.top, boxes.top[i]);
+            run.bottom = (std::max)(run.bottom, boxes.bottom[i]);
+            continue;
+        }
+
+        flush(run);
+        run = boxes.Get(i);
+    }
+    flush(run);
+}
+
+// Map the mouse onto the page image just drawn and act on links and text.
+// That image may still be the previous page while a turn is uploading, so
+// its own page's layout is used.
+static void HandlePageInteraction(PdfViewer &viewer)
+{
+    const int page = viewer.GetTexturePage();
+    if (page < 0)
+        return;
+    if (g_textSelection.filepath != viewer.GetFilepath() ||
+        g_textSelection.page != page)
+    {
+        g_textSelection.Clear();
+        g_textSelection.filepath = viewer.GetFilepath();
+        g_textSelection.page = page;
+    }
+
+    std::shared_ptr<const PageLayout> layout = viewer.GetPageLayout(page);
+    if (!layout)
+        return;
+
+    ImVec2 min = ImGui::GetItemRectMin();
+    ImVec2 max = ImGui::GetItemRectMax();
+    ImVec2 size = ImVec2(max.x - min.x, max.y - min.y);
+    if (size.x <= 0.0f || size.y <= 0.0f)
+        return;
+
+    const PageTextLayer &text = layout->GetText();
+    DrawTextSelection(text, min, size);
+
+    ImGuiIO &io = ImGui::GetIO();
+    if (g_textSelection.HasRange() && !io.WantTextInput && io.KeyCtrl &&
+        ImGui::IsKeyPressed(ImGuiKey_C, false))
+        CopySelectedText(text);
+
+    const bool hovered = ImGui::IsItemHovered();
+    if (hovered && g_textSelection.HasRange() &&
+        ImGui::IsMouseClicked(ImGuiMouseButton_Right))
+        ImGui::OpenPopup("PageTextMenu");
+    if (ImGui::BeginPopup("PageTextMenu"))
+    {
+        if (ImGui::MenuItem("Copy", "Ctrl+C", false,
+                            g_textSelection.HasRange()))
+            CopySelectedText(text);
+        ImGui::EndPopup();
+    }
+
+    float x = (io.MousePos.x - min.x) / size.x;
+    float y = (io.MousePos.y - min.y) / size.y;
+
+    if (g_textSelection.dragging)
+    {
+        if (ImGui::IsMouseDown(ImGuiMouseButton_Left))
+        {
+            // Keep the last hit while the pointer crosses gaps between
+            // characters.
+            int charIndex = layout->HitTestChar(x, y);
+            if (charIndex >= 0)
+                g_textSelection.focus = charIndex;
+            ImGui::SetMouseCursor(ImGuiMouseCursor_TextInput);
+        }
+        else
+        {
+            g_textSelection.dragging = false;
+        }
+        return;
+    }
+
+    if (!hovered)
+        return;
+
+    int linkIndex = layout->HitTestLink(x, y);
+    if (linkIndex >= 0)
+    {
+        const PageLink &link =
+            layout->GetLinks()[static_cast<size_t>(linkIndex)];
+        ImGui::SetMouseCursor(ImGuiMouseCursor_Hand);
+        if (link.targetPage >= 0)
+        {
+            // Warm the destination while the pointer rests on the link.
+            viewer.PrefetchPage(link.targetPage);
+            ImGui::SetTooltip("Go to page %d", link.targetPage + 1);
+            if (ImGui::IsMouseClicked(ImGuiMouseButton_Left))
+                viewer.GoToPage(link.targetPage);
+        }
+        else
+        {
+            ImGui::SetTooltip("%s\nClick to copy link", link.uri.c_str());
+            if (ImGui::IsMouseClicked(ImGuiMouseButton_Left))
+                ImGui::SetClipboardText(link.uri.c_str());
+        }
+        return;
+    }
+
+    int charIndex = layout->HitTestChar(x, y);
+    if (charIndex >= 0)
+        ImGui::SetMouseCursor(ImGuiMouseCursor_TextInput);
+
+    if (ImGui::IsMouseClicked(ImGuiMouseButton_Left))
+    {
+        g_textSelection.anchor = charIndex;
+        g_textSelection.focus = charIndex;
+        g_textSelection.dragging = charIndex >= 0;
+    }
+}
+
+void RenderViewerPanel(PdfViewer &viewer,
                        const SetlistManager &setlistManager,
                        const AppUiState &uiState,
                        const ImGuiViewport *viewport)
@@ -1446,6 +2158,7 @@ void RenderViewerPanel(const PdfViewer &viewer,
 
         ImGui::Image((ImTextureID)(void *)(uintptr_t)texture,
                      ImVec2(displayWidth, displayHeight));
+        HandlePageInteraction(viewer);
     }
     else
     {
@@ -1477,6 +2190,673 @@ void RenderViewerPanel(const PdfViewer &viewer,
     ImGui::End();
 }
 
+// =============================================================================
+// PDF export
+// =============================================================================
+
+struct ExportDraftRow
+{
+    std::string name;
+    std::string sourcePath;
+    char range[64] = {};
+};
+
+// Parts of the export being configured in the "Export PDF" popup.
+struct ExportDraft
+{
+    std::string title;
+    std::string defaultName;
+    std::vector<ExportDraftRow> rows;
+};
+
+static ExportDraft g_exportDraft;
+
+static std::string SafeFileName(const std::string &name)
+{
+    std::string result;
+    for (char c : name)
+    {
+        bool reserved = std::strchr("<>:\"/\\|?*", c) != nullptr ||
+                        static_cast<unsigned char>(c) < 0x20;
+        result += reserved ? '_' : c;
+    }
+    return result.empty() ? "export" : result;
+}
+
+static void BeginSetlistExport(const SetlistManager &setlistManager,
+                               int setlistIndex)
+{
+    const Setlist *setlist =
+        setlistManager.GetSetlist(static_cast<size_t>(setlistIndex));
+    if (!setlist)
+        return;
+
+    g_exportDraft = ExportDraft();
+    g_exportDraft.title = "Export setlist \"" + setlist->GetName() + "\"";
+    g_exportDraft.defaultName = SafeFileName(setlist->GetName()) + ".pdf";
+    for (const SetlistItem &item : setlist->GetItems())
+    {
+        ExportDraftRow row;
+        row.name = item.GetName();
+        row.sourcePath = item.GetFullPath();
+        g_exportDraft.rows.push_back(row);
+    }
+    ImGui::OpenPopup("Export PDF");
+}
+
+static void BeginPageExtract(const PdfViewer &viewer)
+{
+    std::string stem = viewer.GetFilename();
+    size_t extension = stem.find_last_of('.');
+    if (extension != std::string::npos && extension > 0)
+        stem.resize(extension);
+
+    g_exportDraft = ExportDraft();
+    g_exportDraft.title = "Extract pages from \"" + viewer.GetFilename() + "\"";
+    g_exportDraft.defaultName = SafeFileName(stem) + " (extract).pdf";
+
+    ExportDraftRow row;
+    row.name = viewer.GetFilename();
+    row.sourcePath = viewer.GetFilepath();
+    snprintf(row.range, sizeof(row.range), "%d", viewer.GetCurrentPage() + 1);
+    g_exportDraft.rows.push_back(row);
+    ImGui::OpenPopup("Export PDF");
+}
+
+static void RenderExportPopup(PdfExporter &exporter)
+{
+    if (!ImGui::BeginPopupModal("Export PDF", nullptr,
+                                ImGuiWindowFlags_AlwaysAutoResize))
+        return;
+
+    ImGui::TextUnformatted(g_exportDraft.title.c_str());
+    ImGui::TextDisabled("Page ranges like 1,3,5-7. Leave empty for all pages.");
+    ImGui::Spacing();
+
+    const float rangeWidth = 150.0f;
+    const float nameWidth = 320.0f;
+    float rowHeight = ImGui::GetFrameHeightWithSpacing();
+    float listHeight =
+        (std::min)(rowHeight * static_cast<float>(g_exportDraft.rows.size()) +
+                       ImGui::GetStyle().WindowPadding.y * 2.0f,
+                   rowHeight * 12.0f);
+    ImGui::BeginChild("ExportParts",
+                      ImVec2(nameWidth + rangeWidth +
+                                 ImGui::GetStyle().ItemSpacing.x * 3.0f,
+                             listHeight),
+                      true);
+    for (size_t i = 0; i < g_exportDraft.rows.size(); i++)
+    {
+        ExportDraftRow &row = g_exportDraft.rows[i];
+        ImGui::PushID(static_cast<int>(i));
+        ClippedText("##ExportName", row.name.c_str(), nameWidth,
+                    ImGui::GetStyle().Colors[ImGuiCol_Text]);
+        ImGui::SameLine();
+        ImGui::SetNextItemWidth(rangeWidth);
+        ImGui::InputTextWithHint("##ExportRange", "All pages", row.range,
+                                 IM_ARRAYSIZE(row.range));
+        ImGui::PopID();
+    }
+    ImGui::EndChild();
+
+    // Layout choices persist between exports.
+    static int layoutIndex = 0;
+    static int paperIndex = 0;
+    static const char *const LAYOUT_LABELS[] = {"One page per sheet", "2-up",
+                                                "4-up", "Booklet"};
+    static const char *const PAPER_LABELS[] = {"Letter", "A4"};
+    ImGui::SetNextItemWidth(200.0f);
+    ImGui::Combo("Layout", &layoutIndex, LAYOUT_LABELS,
+                 IM_ARRAYSIZE(LAYOUT_LABELS));
+    if (layoutIndex > 0)
+    {
+        ImGui::SameLine();
+        ImGui::SetNextItemWidth(110.0f);
+        ImGui::Combo("Paper", &paperIndex, PAPER_LABELS,
+                     IM_ARRAYSIZE(PAPER_LABELS));
+    }
+    if (layoutIndex == 3)
+        ImGui::TextDisabled("Print double-sided, flip on short edge, and "
+                            "fold in half.");
+
+    ImGui::Spacing();
+    ImGui::BeginDisabled(exporter.IsRunning() || g_exportDraft.rows.empty());
+    if (PrimaryButton("Export...", ImVec2(120.0f, 0.0f)))
+    {
+        std::string outputPath = FileDialog::SavePDF(g_exportDraft.defaultName);
+        if (!outputPath.empty())
+        {
+            std::vector<ExportPart> parts;
+            for (const ExportDraftRow &row : g_exportDraft.rows)
+                parts.push_back({row.name, row.sourcePath, row.range});
+
+            if (layoutIndex == 0)
+            {
+                exporter.StartMerge(parts, outputPath);
+            }
+            else
+            {
+                ImpositionOptions options;
+                options.layout =
+                    layoutIndex == 1   ? ImpositionLayout::TwoUp
+                    : layoutIndex == 2 ? ImpositionLayout::FourUp
+                                       : ImpositionLayout::Booklet;
+                options.paper =
+                    paperIndex == 1 ? PaperSize::A4 : PaperSize::Letter;
+                exporter.StartImposition(parts, options, outputPath);
+            }
+            ImGui::CloseCurrentPopup();
+        }
+    }
+    ImGui::EndDisabled();
+    ImGui::SameLine();
+    if (SecondaryButton("Cancel", ImVec2(120.0f, 0.0f)))
+        ImGui::CloseCurrentPopup();
+
+    ImGui::EndPopup();
+}
+
+static void RenderExportStatus(PdfExporter &exporter)
+{
+    ExportStatus status = exporter.GetStatus();
+    if (!status.running && !status.finished)
+        return;
+
+    const ImGuiViewport *viewport = ImGui::GetMainViewport();
+    ImGui::SetNextWindowPos(
+        ImVec2(viewport->WorkPos.x + viewport->WorkSize.x - 16.0f,
+               viewport->WorkPos.y + viewport->WorkSize.y - 16.0f),
+        ImGuiCond_Always, ImVec2(1.0f, 1.0f));
+    ImGui::SetNextWindowSize(ImVec2(360.0f, 0.0f), ImGuiCond_Always);
+    ImGuiWindowFlags flags = ImGuiWindowFlags_NoDecoration |
+                             ImGuiWindowFlags_NoMove |
+                             ImGuiWindowFlags_NoSavedSettings |
+                             ImGuiWindowFlags_NoDocking;
+    ImGui::Begin("##ExportStatus", nullptr, flags);
+
+    size_t lastSlash = status.outputPath.find_last_of("/\\");
+    std::string filename = lastSlash != std::string::npos
+                               ? status.outputPath.substr(lastSlash + 1)
+                               : status.outputPath;
+    ImGui::TextUnformatted(filename.c_str());
+    if (status.running)
+    {
+        float fraction =
+            status.progressTotal > 0
+                ? static_cast<float>(status.progressDone) /
+                      static_cast<float>(status.progressTotal)
+                : 0.0f;
+        ImGui::ProgressBar(fraction, ImVec2(-1.0f, 0.0f),
+                           status.currentName.c_str());
+        ImGui::TextDisabled("%d pages, %.0f pages/s", status.pagesWritten,
+                            status.pagesPerSecond);
+        ImGui::SameLine();
+        ImGui::SetCursorPosX(ImGui::GetCursorPosX() +
+                             (std::max)(0.0f, ImGui::GetContentRegionAvail().x -
+                                                  80.0f));
+        if (SecondaryButton("Cancel", ImVec2(80.0f, 0.0f)))
+            exporter.Cancel();
+    }
+    else
+    {
+        ImGui::TextColored(status.succeeded
+                               ? ImVec4(0.48f, 0.76f, 0.56f, 1.0f)
+                               : ImVec4(0.90f, 0.42f, 0.42f, 1.0f),
+                           "%s", status.message.c_str());
+        if (status.succeeded && status.pagesPerSecond > 0.0)
+            ImGui::TextDisabled("%.0f pages/s", status.pagesPerSecond);
+        if (SecondaryButton("Dismiss", ImVec2(-1.0f, 0.0f)))
+            exporter.ClearStatus();
+    }
+
+    ImGui::End();
+}
+
+void RenderExportWindows(PdfExporter &exporter,
+                         const PdfViewer &viewer,
+                         const SetlistManager &setlistManager,
+                         AppUiState &uiState)
+{
+    if (uiState.exportSetlistRequest >= 0)
+    {
+        BeginSetlistExport(setlistManager, uiState.exportSetlistRequest);
+        uiState.exportSetlistRequest = -1;
+    }
+    if (uiState.extractPagesRequested)
+    {
+        if (viewer.IsLoaded())
+            BeginPageExtract(viewer);
+        uiState.extractPagesRequested = false;
+    }
+
+    RenderExportPopup(exporter);
+    RenderExportStatus(exporter);
+}
+
+// =============================================================================
+// Revision compare
+// =============================================================================
+
+static void StartCompare(PdfCompare &compare, AppUiState &uiState)
+{
+    std::string originalPath = FileDialog::OpenPDF();
+    if (originalPath.empty())
+        return;
+    std::string revisedPath = FileDialog::OpenPDF();
+    if (revisedPath.empty())
+        return;
+
+    if (compare.Open(originalPath, revisedPath))
+    {
+        uiState.compareWindowOpen = true;
+        uiState.compareRegionIndex = -1;
+    }
+}
+
+// Step through changed regions across the whole document; direction is +1
+// or -1. Crossing a page boundary lands on the nearest scanned page with
+// changes.
+static void StepCompareDifference(PdfCompare &compare,
+                                  AppUiState &uiState,
+                                  int direction)
+{
+    int page = compare.GetDisplayPage();
+    int regionCount =
+        static_cast<int>(compare.GetPageDiff(page).regions.size());
+    int nextRegion = uiState.compareRegionIndex + direction;
+    if (uiState.compareRegionIndex < 0 && direction < 0)
+        nextRegion = -1;
+    if (nextRegion >= 0 && nextRegion < regionCount)
+    {
+        uiState.compareRegionIndex = nextRegion;
+        return;
+    }
+
+    int changedPage = compare.FindChangedPage(page + direction, direction);
+    if (changedPage < 0)
+        return;
+
+    compare.SetDisplayPage(changedPage);
+    int changedRegions =
+        static_cast<int>(compare.GetPageDiff(changedPage).regions.size());
+    uiState.compareRegionIndex = direction > 0 ? 0 : changedRegions - 1;
+}
+
+static void DrawComparePage(const char *label,
+                            GLuint texture,
+                            float aspectRatio,
+                            const PageDiff &diff,
+                            const AppUiState &uiState,
+                            ImVec2 size,
+                            ImU32 highlightColor)
+{
+    ImGui::BeginChild(label, size, true, ImGuiWindowFlags_NoScrollbar);
+    ImVec2 availSize = ImGui::GetContentRegionAvail();
+
+    if (texture && aspectRatio > 0.0f)
+    {
+        float displayWidth = availSize.x;
+        float displayHeight = displayWidth / aspectRatio;
+        if (displayHeight > availSize.y)
+        {
+            displayHeight = availSize.y;
+            displayWidth = displayHeight * aspectRatio;
+        }
+
+        ImVec2 cursor = ImGui::GetCursorPos();
+        cursor.x += (availSize.x - displayWidth) * 0.5f;
+        ImGui::SetCursorPos(cursor);
+        ImVec2 origin = ImGui::GetCursorScreenPos();
+        ImGui::Image((ImTextureID)(void *)(uintptr_t)texture,
+                     ImVec2(displayWidth, displayHeight));
+
+        if (uiState.compareHighlight)
+        {
+            ImDrawList *drawList = ImGui::GetWindowDrawList();
+            for (size_t i = 0; i < diff.regions.size(); i++)
+            {
+                const NormalizedRect &rect = diff.regions[i].rect;
+                ImVec2 min(origin.x + rect.left * displayWidth,
+                           origin.y + rect.top * displayHeight);
+                ImVec2 max(origin.x + rect.right * displayWidth,
+                           origin.y + rect.bottom * displayHeight);
+                bool focused =
+                    static_cast<int>(i) == uiState.compareRegionIndex;
+                drawList->AddRectFilled(min, max,
+                                        (highlightColor & 0x00FFFFFF) |
+                                            (focused ? 0x50000000
+                                                     : 0x28000000));
+                drawList->AddRect(min, max, highlightColor, 0.0f, 0,
+                                  focused ? 3.0f : 1.5f);
+            }
+        }
+    }
+    else
+    {
+        ImGui::TextDisabled("%s", diff.scanned ? "No page in this revision"
+                                               : "Rendering page...");
+    }
+
+    ImGui::EndChild();
+}
+
+void RenderCompareWindow(PdfCompare &compare, AppUiState &uiState)
+{
+    if (uiState.compareRequested)
+    {
+        uiState.compareRequested = false;
+        StartCompare(compare, uiState);
+    }
+
+    if (!uiState.compareWindowOpen)
+        return;
+
+    ImGui::SetNextWindowSize(ImVec2(1100.0f, 760.0f), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin("Compare Revisions", &uiState.compareWindowOpen))
+    {
+        ImGui::End();
+        return;
+    }
+
+    if (!compare.IsOpen())
+    {
+        ImGui::TextDisabled("Choose File > Compare Revisions... to pick "
+                            "two PDFs.");
+        ImGui::End();
+        return;
+    }
+
+    const int pageCount = compare.GetPageCount();
+    const int page = compare.GetDisplayPage();
+    const int scanned = compare.GetScannedPageCount();
+    const int changed = compare.GetChangedPageCount();
+
+    if (SecondaryButton("< Page", ImVec2(0.0f, 0.0f)) && page > 0)
+    {
+        compare.SetDisplayPage(page - 1);
+        uiState.compareRegionIndex = -1;
+    }
+    ImGui::SameLine();
+    ImGui::Text("Page %d / %d", page + 1, pageCount);
+    ImGui::SameLine();
+    if (SecondaryButton("Page >", ImVec2(0.0f, 0.0f)) && page + 1 < pageCount)
+    {
+        compare.SetDisplayPage(page + 1);
+        uiState.compareRegionIndex = -1;
+    }
+
+    ImGui::SameLine();
+    ImGui::TextDisabled("|");
+    ImGui::SameLine();
+    if (SecondaryButton("Previous Change", ImVec2(0.0f, 0.0f)))
+        StepCompareDifference(compare, uiState, -1);
+    ImGui::SameLine();
+    if (PrimaryButton("Next Change", ImVec2(0.0f, 0.0f)))
+        StepCompareDifference(compare, uiState, 1);
+    ImGui::SameLine();
+    ImGui::Checkbox("Highlight", &uiState.compareHighlight);
+
+    ImGui::SameLine();
+    if (scanned < pageCount)
+        ImGui::TextDisabled("Scanning %d / %d pages, %d changed", scanned,
+                            pageCount, changed);
+    else
+        ImGui::TextDisabled("%d of %d pages changed", changed, pageCount);
+
+    // Snapshot the result after navigation so the regions match the page
+    // whose textures are about to be drawn.
+    const PageDiff diff = compare.GetPageDiff(compare.GetDisplayPage());
+    if (diff.layoutChanged)
+        ImGui::TextColored(ImVec4(0.90f, 0.62f, 0.36f, 1.0f),
+                           "Page size differs or page is missing in one "
+                           "revision.");
+    else if (diff.scanned && !diff.changed)
+        ImGui::TextColored(ImVec4(0.48f, 0.76f, 0.56f, 1.0f),
+                           "No visible changes on this page.");
+    else if (diff.scanned)
+        ImGui::Text("%d changed region%s", static_cast<int>(diff.regions.size()),
+                    diff.regions.size() == 1 ? "" : "s");
+    else
+        ImGui::TextDisabled("Comparing...");
+
+    float spacing = ImGui::GetStyle().ItemSpacing.x;
+    float columnWidth = (ImGui::GetContentRegionAvail().x - spacing) * 0.5f;
+    ClippedText("##CompareNameA", compare.GetFilenameA().c_str(), columnWidth,
+                ImVec4(0.55f, 0.58f, 0.64f, 1.0f));
+    ImGui::SameLine(0.0f, spacing);
+    ClippedText("##CompareNameB", compare.GetFilenameB().c_str(), columnWidth,
+                ImVec4(0.55f, 0.58f, 0.64f, 1.0f));
+
+    ImVec2 pageSize(columnWidth,
+                    (std::max)(100.0f, ImGui::GetContentRegionAvail().y));
+    DrawComparePage("##CompareA", compare.GetTextureA(),
+                    compare.GetDisplayAspectA(), diff, uiState, pageSize,
+                    IM_COL32(230, 80, 80, 255));
+    ImGui::SameLine(0.0f, spacing);
+    DrawComparePage("##CompareB", compare.GetTextureB(),
+                    compare.GetDisplayAspectB(), diff, uiState, pageSize,
+                    IM_COL32(80, 200, 120, 255));
+
+    ImGui::End();
+
+    if (!uiState.compareWindowOpen)
+        compare.Close();
+}
+
+// =============================================================================
+// Remote control
+// =============================================================================
+
+void RenderRemoteControlStatus(const RemoteControlServer &remote,
+                               const PageMirror &mirror,
+                               AppUiState &uiState)
+{
+    if (!uiState.remoteControlStatusOpen)
+        return;
+
+    ImGui::SetNextWindowSize(ImVec2(380.0f, 0.0f), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin("Remote Control", &uiState.remoteControlStatusOpen,
+                      ImGuiWindowFlags_AlwaysAutoResize))
+    {
+        ImGui::End();
+        return;
+    }
+
+    if (remote.IsRunning())
+    {
+        ImGui::TextColored(ImVec4(0.48f, 0.76f, 0.56f, 1.0f), "Listening");
+        if (remote.IsLanAllowed())
+        {
+            ImGui::Text("http://<this computer>:%d/?token=%s",
+                        remote.GetPort(), remote.GetToken().c_str());
+            ImGui::TextDisabled("POST /next, /prev, /page/N, /item/N with "
+                                "?token= or X-Remote-Token");
+        }
+        else
+        {
+            ImGui::Text("http://127.0.0.1:%d/", remote.GetPort());
+            ImGui::TextDisabled("POST /next, /prev, /page/N, /item/N");
+        }
+        if (uiState.mirrorEnabled)
+        {
+            ImGui::Text("Followers: %d at /mirror", remote.GetFollowerCount());
+            MirrorEncodeStats encode = mirror.GetEncodeStats();
+            if (encode.samples > 0)
+                ImGui::TextDisabled("Page encode: %.1f ms (average %.1f, "
+                                    "max %.1f)",
+                                    encode.lastMs, encode.averageMs,
+                                    encode.maxMs);
+        }
+
+        RemoteLatencyStats latency = remote.GetLatencyStats();
+        ImGui::Separator();
+        if (latency.samples == 0)
+        {
+            ImGui::TextDisabled("No commands received yet.");
+        }
+        else
+        {
+            ImGui::Text("Command to present: %.1f ms", latency.lastMs);
+            ImGui::TextDisabled("Average %.1f ms, max %.1f ms over %llu",
+                                latency.averageMs, latency.maxMs,
+                                static_cast<unsigned long long>(
+                                    latency.samples));
+        }
+    }
+    else if (!remote.GetLastError().empty())
+    {
+        ImGui::TextColored(ImVec4(0.90f, 0.42f, 0.42f, 1.0f), "%s",
+                           remote.GetLastError().c_str());
+    }
+    else
+    {
+        ImGui::TextDisabled("Disabled. Enable it in Settings > Preferences.");
+    }
+
+    ImGui::End();
+}
+
+// =============================================================================
+// Drag-and-drop import
+// =============================================================================
+
+void RenderImportStatus(DropImporter &importer, AppUiState &uiState)
+{
+    if (!uiState.importStatusOpen)
+        return;
+
+    ImGui::SetNextWindowSize(ImVec2(380.0f, 0.0f), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin("Import", &uiState.importStatusOpen,
+                      ImGuiWindowFlags_AlwaysAutoResize))
+    {
+        ImGui::End();
+        return;
+    }
+
+    const ImportProgress progress = importer.GetProgress();
+    if (progress.IsActive())
+    {
+        const float fraction =
+            progress.found > 0
+                ? static_cast<float>(progress.checked) /
+                      static_cast<float>(progress.found)
+                : 0.0f;
+        std::string overlay =
+            progress.scanning
+                ? "Searching folders..."
+                : std::to_string(progress.checked) + " / " +
+                      std::to_string(progress.found);
+        ImGui::ProgressBar(fraction, ImVec2(320.0f, 0.0f), overlay.c_str());
+        if (SecondaryButton("Cancel", ImVec2(320.0f, 0.0f)))
+            importer.Cancel();
+    }
+    else
+    {
+        ImGui::TextColored(ImVec4(0.48f, 0.76f, 0.56f, 1.0f), "Done");
+    }
+
+    ImGui::Text("Added %zu PDF%s", progress.accepted,
+                progress.accepted == 1 ? "" : "s");
+    if (progress.rejected > 0)
+    {
+        ImGui::TextColored(ImVec4(0.90f, 0.42f, 0.42f, 1.0f), "Skipped %zu",
+                           progress.rejected);
+        if (ImGui::TreeNode("Details"))
+        {
+            for (const std::string &error : importer.GetRecentErrors())
+                ImGui::TextDisabled("%s", error.c_str());
+            ImGui::TreePop();
+        }
+    }
+
+    ImGui::End();
+}
+
+// =============================================================================
+// Presenter
+// =============================================================================
+
+void RenderPresenterControls(PdfViewer &viewer,
+                             PresenterWindow &presenter,
+                             AppUiState &uiState)
+{
+    if (!uiState.presenterOpen)
+        return;
+
+    ImGui::SetNextWindowSize(ImVec2(420.0f, 0.0f), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin("Presenter", &uiState.presenterOpen))
+    {
+        ImGui::End();
+        return;
+    }
+
+    if (!presenter.IsOpen())
+    {
+        ImGui::TextColored(ImVec4(0.90f, 0.42f, 0.42f, 1.0f),
+                           "The performer window could not be opened.");
+        ImGui::End();
+        return;
+    }
+
+    int fit = presenter.GetFit() == PresenterFit::Width ? 1 : 0;
+    ImGui::SetNextItemWidth(140.0f);
+    if (ImGui::Combo("Fit", &fit, "Whole page\0Page width\0"))
+        presenter.SetFit(fit == 1 ? PresenterFit::Width : PresenterFit::Page);
+    ImGui::SameLine();
+    float zoom = presenter.GetZoom() * 100.0f;
+    ImGui::SetNextItemWidth(140.0f);
+    if (ImGui::SliderFloat("Zoom", &zoom, 50.0f, 400.0f, "%.0f%%"))
+        presenter.SetZoom(zoom / 100.0f);
+
+    ImGui::Separator();
+    if (!viewer.IsLoaded())
+    {
+        ImGui::TextDisabled("No document open.");
+        ImGui::End();
+        return;
+    }
+
+    const int current = viewer.GetCurrentPage();
+    ImGui::Text("Showing page %d of %d", current + 1, viewer.GetPageCount());
+    ImGui::TextDisabled("Up next");
+
+    // Upcoming pages come from the prefetch cache and share their textures
+    // with the viewer, so turning to one of them needs no upload.
+    const int UPCOMING_PREVIEWS = 2;
+    const float previewHeight = 220.0f;
+    for (int offset = 1; offset <= UPCOMING_PREVIEWS; offset++)
+    {
+        const int page = current + offset;
+        if (page >= viewer.GetPageCount())
+            break;
+
+        if (offset > 1)
+            ImGui::SameLine();
+        ImGui::BeginGroup();
+        GLuint texture = 0;
+        int width = 0;
+        int height = 0;
+        if (viewer.GetPageTexture(page, texture, width, height) &&
+            height > 0)
+        {
+            const float previewWidth = previewHeight *
+                                       static_cast<float>(width) /
+                                       static_cast<float>(height);
+            ImGui::Image((ImTextureID)(void *)(uintptr_t)texture,
+                         ImVec2(previewWidth, previewHeight));
+        }
+        else
+        {
+            viewer.PrefetchPage(page);
+            ImGui::Dummy(ImVec2(previewHeight * 0.77f, previewHeight));
+        }
+        ImGui::Text("Page %d", page + 1);
+        ImGui::EndGroup();
+    }
+
+    ImGui::End();
+}
+
 // =============================================================================
 // Notes and splitters
 // =============================================================================
@@ -1491,11 +2871,11 @@ void RenderNotesPanel(SetlistManager &setlistManager,
         return;
     }
 
-    Setlist *mutSetlist = setlistManager.GetSetlist(
+    const Setlist *activeSetlist = setlistManager.GetSetlist(
         static_cast<size_t>(setlistManager.GetActiveSetlistIndex()));
     int activeIdx = setlistManager.GetActiveItemIndex();
-    if (!mutSetlist || activeIdx < 0 ||
-        activeIdx >= static_cast<int>(mutSetlist->GetItemCount()))
+    if (!activeSetlist || activeIdx < 0 ||
+        activeIdx >= static_cast<int>(activeSetlist->GetItemCount()))
     {
         uiState.notesInputActive = false;
         return;
@@ -1515,29 +2895,30 @@ void RenderNotesPanel(SetlistManager &setlistManager,
                              ImGuiWindowFlags_NoResize;
     ImGui::Begin("Notes", nullptr, flags);
 
-    const SetlistItem &item =
-        mutSetlist->GetItems()[static_cast<size_t>(activeIdx)];
+    // Copied: editing the notes below replaces the node this lives in.
+    const SetlistItem item =
+        activeSetlist->GetItems()[static_cast<size_t>(activeIdx)];
     ImGui::TextUnformatted("Notes");
     ImGui::Spacing();
     std::string itemBadge =
         "Item " + std::to_string(activeIdx + 1) + " / " +
-        std::to_string(mutSetlist->GetItemCount());
-    HeaderWithBadge("##NotesItemName", item.name.c_str(),
-                    item.fullPath.c_str(), itemBadge.c_str(),
+        std::to_string(activeSetlist->GetItemCount());
+    HeaderWithBadge("##NotesItemName", item.GetName(),
+                    item.GetFullPath().c_str(), itemBadge.c_str(),
                     ImVec4(0.48f, 0.76f, 0.56f, 1.0f));
     ImGui::Separator();
 
     static char notesBuf[4096] = "";
     static int lastActiveSetlist = -1;
     static int lastActiveItem = -1;
-    static std::string lastActiveItemPath;
+    static PathId lastActiveItemPath = INVALID_PATH_ID;
 
     int curSetlist = setlistManager.GetActiveSetlistIndex();
     if (curSetlist != lastActiveSetlist || activeIdx != lastActiveItem ||
-        item.fullPath != lastActiveItemPath)
+        item.path != lastActiveItemPath)
     {
         const std::string &notes =
-            mutSetlist->GetItemNotes(static_cast<size_t>(activeIdx));
+            activeSetlist->GetItemNotes(static_cast<size_t>(activeIdx));
         size_t copyLen = notes.size();
         if (copyLen >= sizeof(notesBuf))
             copyLen = sizeof(notesBuf) - 1;
@@ -1545,7 +2926,7 @@ void RenderNotesPanel(SetlistManager &setlistManager,
         notesBuf[copyLen] = '\0';
         lastActiveSetlist = curSetlist;
         lastActiveItem = activeIdx;
-        lastActiveItemPath = item.fullPath;
+        lastActiveItemPath = item.path;
     }
 
     ImVec2 notesSize = ImVec2(-1.0f, ImGui::GetContentRegionAvail().y);
@@ -1565,8 +2946,9 @@ void RenderNotesPanel(SetlistManager &setlistManager,
     }
     if (notesChanged)
     {
-        mutSetlist->SetItemNotes(static_cast<size_t>(activeIdx),
-                                 std::string(notesBuf));
+        setlistManager.SetItemNotes(static_cast<size_t>(curSetlist),
+                                    static_cast<size_t>(activeIdx),
+                                    std::string(notesBuf));
     }
 
     ImGui::End();
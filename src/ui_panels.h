@@ -4,8 +4,15 @@
 
 #include "imgui.h"
 
+class DropImporter;
+class LibraryThumbnails;
+class PageMirror;
+class PdfCompare;
+class PdfExporter;
 class PdfLibrary;
 class PdfViewer;
+class PresenterWindow;
+class RemoteControlServer;
 class SetlistManager;
 
 enum class AppFontMode
@@ -22,6 +29,19 @@ struct AppUiState
     bool restoreLastSession = false;
     bool settingsOpen = false;
 
+    bool remoteControlEnabled = false;
+    int remoteControlPort = 8765;
+    bool remoteControlAllowLan = false;
+    std::string remoteControlToken; // required from LAN clients
+    bool remoteControlStatusOpen = false;
+    bool mirrorEnabled = false;
+
+    bool presenterOpen = false;
+
+    bool libraryGridView = false;
+
+    bool importStatusOpen = false;
+
     AppFontMode fontMode = AppFontMode::Auto;
     int fontSizePx = 22;
     AppFontMode activeFontMode = AppFontMode::Auto;
@@ -38,6 +58,12 @@ struct AppUiState
     bool fontRestartPromptOpen = false;
     bool exitRequested = false;
     bool setlistsPanelOpenRequested = false;
+    int exportSetlistRequest = -1;
+    bool extractPagesRequested = false;
+    bool compareRequested = false;
+    bool compareWindowOpen = false;
+    bool compareHighlight = true;
+    int compareRegionIndex = -1;
 
     std::string lastLibraryPath;
     int lastSetlistIndex = -1;
@@ -56,6 +82,7 @@ void RenderMainMenuBar(PdfLibrary &library,
                        int &selectedSetlistItemIndex);
 
 void RenderLibraryPanel(PdfLibrary &library,
+                        LibraryThumbnails &thumbnails,
                         PdfViewer &viewer,
                         SetlistManager &setlistManager,
                         AppUiState &uiState,
@@ -79,7 +106,24 @@ void RenderNotesPanel(SetlistManager &setlistManager,
                       AppUiState &uiState,
                       const ImGuiViewport *viewport);
 
-void RenderViewerPanel(const PdfViewer &viewer,
+void RenderExportWindows(PdfExporter &exporter,
+                         const PdfViewer &viewer,
+                         const SetlistManager &setlistManager,
+                         AppUiState &uiState);
+
+void RenderCompareWindow(PdfCompare &compare, AppUiState &uiState);
+
+void RenderRemoteControlStatus(const RemoteControlServer &remote,
+                               const PageMirror &mirror,
+                               AppUiState &uiState);
+
+void RenderImportStatus(DropImporter &importer, AppUiState &uiState);
+
+void RenderPresenterControls(PdfViewer &viewer,
+                             PresenterWindow &presenter,
+                             AppUiState &uiState);
+
+void RenderViewerPanel(PdfViewer &viewer,
                        const SetlistManager &setlistManager,
                        const AppUiState &uiState,
                        const ImGuiViewport *viewport);
@@ -0,0 +1,145 @@
+#include "view_memory.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#include "save_file.h"
+#include "setlist_gen.h"
+
+namespace
+{
+const char *const VIEW_MEMORY_HEADER = "PDF_MANAGER_VIEWS_V1";
+
+bool IsDefaultView(const DocumentView &view)
+{
+    return view.page <= 0 && view.zoom == 1.0f;
+}
+} // namespace
+
+bool ViewMemory::Find(const std::string &filepath, DocumentView &view) const
+{
+    // A path that was never interned was never opened, so it cannot have
+    // been remembered either.
+    const PathId path = PathInterner::Shared().Find(filepath);
+    if (path == INVALID_PATH_ID)
+        return false;
+
+    for (const Entry &entry : m_entries)
+    {
+        if (entry.path == path)
+        {
+            view.page = entry.page;
+            view.zoom = entry.zoom;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ViewMemory::Remember(const std::string &filepath,
+                          const DocumentView &view)
+{
+    const PathId path = PathInterner::Shared().Intern(filepath);
+    if (path == INVALID_PATH_ID)
+        return;
+
+    m_entries.erase(std::remove_if(m_entries.begin(), m_entries.end(),
+                                   [path](const Entry &entry) {
+                                       return entry.path == path;
+                                   }),
+                    m_entries.end());
+    if (IsDefaultView(view))
+        return;
+
+    if (m_entries.size() >= CAPACITY)
+        m_entries.erase(m_entries.begin());
+    m_entries.push_back({path, view.page, view.zoom});
+}
+
+bool ViewMemory::LoadFromFile(const std::string &filepath)
+{
+    std::ifstream in(std::filesystem::path(filepath), std::ios::in);
+    if (!in.is_open())
+        return false;
+
+    std::string line;
+    if (!std::getline(in, line) || line != VIEW_MEMORY_HEADER)
+    {
+        std::cerr << "[ViewMemory] Invalid save file format\n";
+        return false;
+    }
+
+    // One "page<TAB>zoom<TAB>path" line per document, oldest first, so
+    // replaying them through Remember() restores the order.
+    m_entries.clear();
+    while (std::getline(in, line))
+    {
+        const size_t firstTab = line.find('\t');
+        const size_t secondTab = firstTab == std::string::npos
+                                     ? std::string::npos
+                                     : line.find('\t', firstTab + 1);
+        if (secondTab == std::string::npos || secondTab + 1 >= line.size())
+            continue;
+
+        DocumentView view;
+        view.page = std::atoi(line.c_str());
+        view.zoom = std::strtof(line.c_str() + firstTab + 1, nullptr);
+        if (view.page < 0 || !(view.zoom > 0.0f))
+            continue;
+        Remember(line.substr(secondTab + 1), view);
+    }
+    return true;
+}
+
+bool ViewMemory::SaveToFile(const std::string &filepath) const
+{
+    const std::filesystem::path destinationPath(filepath);
+    std::filesystem::path temporaryPath = destinationPath;
+    temporaryPath += ".tmp";
+
+    std::ofstream out(temporaryPath, std::ios::out | std::ios::trunc);
+    if (!out.is_open())
+    {
+        std::cerr << "[ViewMemory] Failed to save: " << filepath << "\n";
+        return false;
+    }
+
+    out << VIEW_MEMORY_HEADER << "\n";
+    const PathInterner &paths = PathInterner::Shared();
+    for (const Entry &entry : m_entries)
+    {
+        out << entry.page << "\t" << entry.zoom << "\t"
+            << paths.GetDirectory(entry.path) << paths.GetName(entry.path)
+            << "\n";
+    }
+    out.flush();
+    const bool writeSucceeded = out.good();
+    out.close();
+
+    if (!writeSucceeded || out.fail())
+    {
+        std::error_code cleanupError;
+        std::filesystem::remove(temporaryPath, cleanupError);
+        std::cerr << "[ViewMemory] Failed while writing: " << filepath
+                  << "\n";
+        return false;
+    }
+
+    if (!ReplaceSaveFile(temporaryPath, destinationPath))
+    {
+        std::cerr << "[ViewMemory] Failed to replace save file: " << filepath
+                  << "\n";
+        return false;
+    }
+    return true;
+}
+
+std::string ViewMemory::GetDefaultSavePath()
+{
+    return std::filesystem::path(SetlistManager::GetDefaultSavePath())
+        .replace_filename("view_state.dat")
+        .string();
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "path_interner.h"
+
+/**
+ * @brief Where a document was left: its page and display zoom.
+ */
+struct DocumentView
+{
+    int page = 0; // zero-based
+    float zoom = 1.0f;
+};
+
+/**
+ * @brief Remembers the view of recently closed documents so reopening one
+ *        returns to the same place.
+ *
+ * Entries are keyed by interned path and kept in least-recently-used order,
+ * up to CAPACITY documents. Documents left on their first page at the
+ * default zoom are not stored. Main thread only.
+ */
+class ViewMemory
+{
+public:
+    /**
+     * @brief Get the view a document was left in.
+     * @return false if the document has no remembered view.
+     */
+    bool Find(const std::string &filepath, DocumentView &view) const;
+
+    /**
+     * @brief Record the view of a document that is being closed.
+     */
+    void Remember(const std::string &filepath, const DocumentView &view);
+
+    size_t GetCount() const { return m_entries.size(); }
+
+    /**
+     * @brief Replace the remembered views with those saved in a file.
+     * @return false if the file is missing or not a view memory file.
+     */
+    bool LoadFromFile(const std::string &filepath);
+
+    bool SaveToFile(const std::string &filepath) const;
+
+    /**
+     * @brief Default location, beside the saved setlists.
+     */
+    static std::string GetDefaultSavePath();
+
+    static constexpr size_t CAPACITY = 512;
+
+private:
+    struct Entry
+    {
+        PathId path = INVALID_PATH_ID;
+        int32_t page = 0;
+        float zoom = 1.0f;
+    };
+
+    // Least recently used first.
+    std::vector<Entry> m_entries;
+};